@@ -0,0 +1,331 @@
+/*
+   Microbenchmark of the primitives and of the key exchange functions of Naxos.c
+   For each curve and operation it runs a warmup, then nsamples samples of iters calls each,
+   and it reports the median and the 99th percentile of the time and of the cycles per call.
+   The cycles are read with rdtsc on x86 (reference cycles of the TSC), they are 0 elsewhere.
+   With -p it prints instead the operations counted in each phase of one handshake
+   (calculateXY, calculateKa, calculateKb), the library must be compiled with -DNAXOS_COUNTERS.
+   Usage: Bench_Naxos [-j] [-p] [-c curve] [-n nsamples] [-w wbits] [-i backend]
+     -j          JSON output, one object per curve and operation (or phase with -p)
+     -p          operation counters per phase instead of the times
+     -c curve    only the curve 192, 224, 256, 384 or 521 (default all)
+     -n nsamples samples per operation (default 101)
+     -w wbits    window of scalarMult, see selectScalarMult (default of the library)
+     -i backend  inversion of coordInv, see selectInversion (default of the library)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Naxos.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define BENCH_WARMUP_NS 20000000   /* warmup of each operation: 20 ms                       */
+#define BENCH_SAMPLE_NS 200000     /* target duration of a sample: 0.2 ms                   */
+#define BENCH_MAX_SAMPLES 10001
+
+void coordInit(coord a);                                                       /* See Naxos.c */
+void coordCopy(coord a,coord b);                                               /* See Naxos.c */
+void coordInvML(coord c,coord a,ellipticCurve* curve);                         /* See Naxos.c */
+void coordInv(coord c,coord a,ellipticCurve* curve);                           /* See Naxos.c */
+void doubleU(pointP* Q,pointP* R,pointP* P,ellipticCurve* curve);              /* See Naxos.c */
+void zAddC(pointP* R,pointP* S,pointP* P,pointP* Q,ellipticCurve* curve);      /* See Naxos.c */
+void zAddU(pointP* R,pointP* P2,pointP* P,pointP* Q,ellipticCurve* curve);     /* See Naxos.c */
+void scalarMult(pointA* Q,coord k,pointA* P,ellipticCurve* curve);             /* See Naxos.c */
+int hashAndMod(coord h,keyC esk,keyC sk,ellipticCurve* curveN);                /* See Naxos.c */
+void coordMul(coord c,coord a,coord b,ellipticCurve* curve);                   /* See Naxos.c */
+void coordToMont(coord c,coord a,ellipticCurve* curve);                        /* See Naxos.c */
+void byteToWord(coord arrayW,uint8_t *arrayB,int byteLen);                     /* See Naxos.c */
+
+typedef struct benchCtx   /* Operands of the operations, the results are overwritten */
+{
+  ellipticCurve curve;
+  coord a,b,c,k;          /* field elements in Montgomery form, k scalar < p         */
+  pointA G,Q;
+  pointP P1,P2,R1,R2;     /* P1 with Z = 1, P1 and P2 co-Z                           */
+  keyC skA,skB,pkAx,pkAy,pkBx,pkBy,eskA,eskB,Xx,Xy,Yx,Yy,idA,idB,kA,kB;
+} benchCtx;
+
+typedef struct benchOp
+{
+  const char* name;
+  int hash;               /* 1 if it needs the hash functions (not P-192)            */
+  void (*run)(benchCtx* x);
+} benchOp;
+
+void runCoordMul(benchCtx* x)   { coordMul(x->c,x->a,x->b,&x->curve); }
+void runCoordInvML(benchCtx* x) { coordInvML(x->c,x->a,&x->curve); }
+void runCoordInv(benchCtx* x)   { coordInv(x->c,x->a,&x->curve); }
+void runDoubleU(benchCtx* x)    { doubleU(&x->R1,&x->R2,&x->P1,&x->curve); }
+void runZAddC(benchCtx* x)      { zAddC(&x->R1,&x->R2,&x->P1,&x->P2,&x->curve); }
+void runZAddU(benchCtx* x)      { zAddU(&x->R1,&x->R2,&x->P1,&x->P2,&x->curve); }
+void runScalarMult(benchCtx* x) { scalarMult(&x->Q,x->k,&x->G,&x->curve); }
+void runHashAndMod(benchCtx* x) { hashAndMod(x->c,x->eskA,x->skA,&x->curve); }
+void runCalculateXY(benchCtx* x){ calculateXY(x->Xx,x->Xy,x->eskA,x->skA,&x->curve); }
+void runCalculateKa(benchCtx* x)
+{
+  calculateKa(x->kA,x->Yx,x->Yy,x->eskA,x->skA,x->pkBx,x->pkBy,x->idA,x->idB,&x->curve);
+}
+void runCalculateKb(benchCtx* x)
+{
+  calculateKb(x->kB,x->pkAx,x->pkAy,x->eskB,x->skB,x->Xx,x->Xy,x->idA,x->idB,&x->curve);
+}
+
+static const benchOp benchOps[] =
+{
+  {"coordMul",0,runCoordMul},
+  {"coordInvML",0,runCoordInvML},
+  {"coordInv",0,runCoordInv},
+  {"doubleU",0,runDoubleU},
+  {"zAddC",0,runZAddC},
+  {"zAddU",0,runZAddU},
+  {"scalarMult",0,runScalarMult},
+  {"hashAndMod",1,runHashAndMod},
+  {"calculateXY",1,runCalculateXY},
+  {"calculateKa",1,runCalculateKa},
+  {"calculateKb",1,runCalculateKb},
+};
+
+uint64_t nowNs(void)
+/* It returns the monotonic time in ns */
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return (uint64_t)t.tv_sec*1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+uint64_t nowCycles(void)
+/* It returns the time stamp counter, 0 where it is not available */
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+int cmpDouble(const void* a,const void* b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+
+  return (x > y) - (x < y);
+}
+
+double percentile(double* v,int n,int pc)
+/* It returns the percentile pc of the sorted array v of n values (nearest rank) */
+{
+  int i;
+
+  i = (pc*n + 99)/100 - 1;
+  if (i < 0) i = 0;
+  return v[i];
+}
+
+void randomCoord(coord a,ellipticCurve* curve)
+/* It sets a to a random number 0 < a < 2^(bsize-1) < p */
+{
+  keyC r;
+
+  memset(r,0,sizeof(r));
+  randomGen(r,curve->bsize-1);
+  r[0] |= 1;
+  coordInit(a);
+  byteToWord(a,r,(curve->bsize+7)/8);
+}
+
+int benchSetup(benchCtx* x,int index,int wbits,int backend)
+/* It selects the curve and prepares the operands of all the operations */
+{
+  int n;
+
+  memset(x,0,sizeof(benchCtx));
+  if (selectCurve(&x->curve,index) != 1) return -1;
+  if ((wbits >= 0) && (selectScalarMult(&x->curve,wbits) != 1)) return -1;
+  if ((backend > 0) && (selectInversion(&x->curve,backend) != 1)) return -1;
+  n = x->curve.bsize-1;
+
+  randomCoord(x->a,&x->curve);
+  randomCoord(x->b,&x->curve);
+  randomCoord(x->k,&x->curve);
+  coordToMont(x->a,x->a,&x->curve);                /* a, b in Montgomery form                */
+  coordToMont(x->b,x->b,&x->curve);
+  x->G = x->curve.g;
+
+  coordCopy(x->P1.pX,x->curve.g.aX);               /* P1 = G with Z = 1                      */
+  coordCopy(x->P1.pY,x->curve.g.aY);
+  coordCopy(x->P1.pZ,x->curve.r1);
+  doubleU(&x->P2,&x->R2,&x->P1,&x->curve);         /* P2 = 2G, R2 = G with the same Z        */
+  x->P1 = x->R2;                                   /* P1 = G co-Z with P2                    */
+
+  randomGen(x->skA,n);
+  randomGen(x->skB,n);
+  randomGen(x->idA,n);
+  randomGen(x->idB,n);
+  if ((publicKey(x->pkAx,x->pkAy,x->skA,&x->curve) != 0) ||
+      (publicKey(x->pkBx,x->pkBy,x->skB,&x->curve) != 0)) return -1;
+  if (x->curve.hash.rate != 0)
+  {
+    calculateXY(x->Xx,x->Xy,x->eskA,x->skA,&x->curve);
+    calculateXY(x->Yx,x->Yy,x->eskB,x->skB,&x->curve);
+  }
+  else
+  {
+    randomGen(x->eskA,n);
+  }
+  return 1;
+}
+
+void benchOne(benchCtx* x,const benchOp* op,int nsamples,int json,int* first)
+/* It measures the operation op and prints the result */
+{
+  static double ns[BENCH_MAX_SAMPLES],cy[BENCH_MAX_SAMPLES];
+  uint64_t t0,t1,c0,c1,end;
+  long iters,i;
+  int s;
+
+  iters = 0;                                       /* warmup, and calls per sample           */
+  t0 = nowNs();
+  end = t0 + BENCH_WARMUP_NS;
+  do
+  {
+    op->run(x);
+    iters++;
+    t1 = nowNs();
+  } while (t1 < end);
+  iters = (long)((double)iters*BENCH_SAMPLE_NS/(double)(t1-t0));
+  if (iters < 1) iters = 1;
+
+  for (s=0;s<nsamples;s++)
+  {
+    t0 = nowNs();
+    c0 = nowCycles();
+    for (i=0;i<iters;i++)
+    {
+      op->run(x);
+    }
+    c1 = nowCycles();
+    t1 = nowNs();
+    ns[s] = (double)(t1-t0)/iters;
+    cy[s] = (double)(c1-c0)/iters;
+  }
+  qsort(ns,nsamples,sizeof(double),cmpDouble);
+  qsort(cy,nsamples,sizeof(double),cmpDouble);
+
+  if (json)
+  {
+    printf("%s\n  {\"curve\": %d, \"op\": \"%s\", \"samples\": %d, \"iters\": %ld, "
+           "\"ns_median\": %.1f, \"ns_p99\": %.1f, \"cycles_median\": %.0f, \"cycles_p99\": %.0f}",
+           (*first)?"":",",x->curve.bsize,op->name,nsamples,iters,
+           percentile(ns,nsamples,50),percentile(ns,nsamples,99),
+           percentile(cy,nsamples,50),percentile(cy,nsamples,99));
+  }
+  else
+  {
+    printf("P-%-4d %-12s %12.1f %12.1f %12.0f %12.0f\n",x->curve.bsize,op->name,
+           percentile(ns,nsamples,50),percentile(ns,nsamples,99),
+           percentile(cy,nsamples,50),percentile(cy,nsamples,99));
+  }
+  *first = 0;
+  fflush(stdout);
+}
+
+int benchCount(benchCtx* x,int json,int* first)
+/* It counts the operations of each phase of one handshake and prints them */
+{
+  naxosCounters c;
+  int ph;
+
+  naxosCountersReset();
+  runCalculateXY(x);
+  runCalculateKa(x);
+  runCalculateKb(x);
+  for (ph=NAXOS_PH_XY_HASH;ph<=NAXOS_PHASES;ph++)
+  {
+    if (naxosCountersGet(&c,ph) != 1) return -1;
+    if (json)
+    {
+      printf("%s\n  {\"curve\": %d, \"phase\": \"%s\", \"mul\": %llu, \"add\": %llu, \"sub\": %llu, "
+             "\"dbl\": %llu, \"inv\": %llu, \"smult\": %llu, \"hash\": %llu}",
+             (*first)?"":",",x->curve.bsize,naxosPhaseName(ph),(unsigned long long)c.mul,
+             (unsigned long long)c.add,(unsigned long long)c.sub,(unsigned long long)c.dbl,
+             (unsigned long long)c.inv,(unsigned long long)c.smult,(unsigned long long)c.hash);
+    }
+    else
+    {
+      printf("P-%-4d %-10s %8llu %8llu %8llu %8llu %6llu %6llu %6llu\n",x->curve.bsize,naxosPhaseName(ph),
+             (unsigned long long)c.mul,(unsigned long long)c.add,(unsigned long long)c.sub,
+             (unsigned long long)c.dbl,(unsigned long long)c.inv,(unsigned long long)c.smult,
+             (unsigned long long)c.hash);
+    }
+    *first = 0;
+  }
+  fflush(stdout);
+  return 1;
+}
+
+int main(int argc,char** argv)
+{
+  static const int curves[] = {NIST_P192,NIST_P224,NIST_P256,NIST_P384,NIST_P521};
+  benchCtx x;
+  naxosCounters c;
+  int i,j,json = 0,count = 0,only = 0,nsamples = 101,wbits = -1,backend = 0,first = 1;
+
+  for (i=1;i<argc;i++)
+  {
+    if (strcmp(argv[i],"-j") == 0) json = 1;
+    else if (strcmp(argv[i],"-p") == 0) count = 1;
+    else if ((strcmp(argv[i],"-c") == 0) && (i+1 < argc)) only = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-n") == 0) && (i+1 < argc)) nsamples = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-w") == 0) && (i+1 < argc)) wbits = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-i") == 0) && (i+1 < argc)) backend = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr,"Usage: %s [-j] [-p] [-c curve] [-n nsamples] [-w wbits] [-i backend]\n",argv[0]);
+      return 1;
+    }
+  }
+  if ((nsamples < 1) || (nsamples > BENCH_MAX_SAMPLES))
+  {
+    fprintf(stderr,"nsamples must be between 1 and %d\n",BENCH_MAX_SAMPLES);
+    return 1;
+  }
+
+  if (count && (naxosCountersGet(&c,NAXOS_PHASES) != 1))
+  {
+    fprintf(stderr,"No counters: compile the library with -DNAXOS_COUNTERS\n");
+    return 1;
+  }
+
+  if (json) printf("[");
+  else if (count) printf("%-6s %-10s %8s %8s %8s %8s %6s %6s %6s\n","curve","phase","mul","add","sub","dbl","inv","smult","hash");
+  else printf("%-6s %-12s %12s %12s %12s %12s\n","curve","op","ns median","ns p99","cyc median","cyc p99");
+  for (i=0;i<(int)(sizeof(curves)/sizeof(curves[0]));i++)
+  {
+    if ((only != 0) && (only != curves[i])) continue;
+    if (benchSetup(&x,curves[i],wbits,backend) != 1)
+    {
+      fprintf(stderr,"P-%d: invalid curve, window or inversion backend\n",curves[i]);
+      return 1;
+    }
+    if (count)
+    {
+      if (x.curve.hash.rate == 0) continue;                        /* P-192: no hash functions */
+      benchCount(&x,json,&first);
+      continue;
+    }
+    for (j=0;j<(int)(sizeof(benchOps)/sizeof(benchOps[0]));j++)
+    {
+      if (benchOps[j].hash && (x.curve.hash.rate == 0)) continue;   /* P-192: no hash functions */
+      benchOne(&x,&benchOps[j],nsamples,json,&first);
+    }
+  }
+  if (json) printf("\n]\n");
+
+  memset(&x,0,sizeof(benchCtx));
+  return 0;
+}
@@ -42,8 +42,6 @@ int main()
 
   int i,res,z,indexC, nBytes;
 
-  srand(time(0));                               /* Initialize the the standard rand() function            */
-
   for (z=0;z<4;z++)
   {
     switch(z)
@@ -90,8 +88,8 @@ int main()
          Here we generate a random idA and skA for the demo
          and we calculate pkA = G*skA.
 	*/
-    generateRand(idA,&curveN);                /* Generate idA using the rand function. To be used only for demo. */
-    generateRand(skA,&curveN);                /* Generate skA using the rand function. To be used only for demo. */
+    generateRand(idA,&curveN);                /* Generate idA using randomGen, for the demo.                     */
+    generateRand(skA,&curveN);                /* Generate skA using randomGen, for the demo.                     */
     if (publicKey(pkAx,pkAy,skA,&curveN)!=0)  /* Calculate pkA from skA                                          */
     {
       printf("Invalid skA: it is 0 or >= p\n");
@@ -105,8 +103,8 @@ int main()
          Here we generate a random idB and skB for the demo
          and we calculate pkB = G*skB.
 	*/
-    generateRand(idB,&curveN);                /* Generate idB using the rand function. To be used only for demo. */
-    generateRand(skB,&curveN);                /* Generate skB using the rand function. To be used only for demo. */
+    generateRand(idB,&curveN);                /* Generate idB using randomGen, for the demo.                     */
+    generateRand(skB,&curveN);                /* Generate skB using randomGen, for the demo.                     */
     if (publicKey(pkBx,pkBy,skB,&curveN)!=0)  /* Calculate pkB from skB                                          */
     {
       printf("Invalid skB: it is 0 or >= p\n");
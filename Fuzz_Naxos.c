@@ -0,0 +1,158 @@
+/*
+   libFuzzer entry point of the byte-level functions of Naxos.c and of the frames of
+   NaxosWire.c: make fuzz (clang)
+   The first byte of the input selects the curve, the second the function, the rest fills
+   the byte arrays of the arguments (keyC, keyPC), zero padded. The functions must not crash
+   and must return one of their documented codes; the decompressed points must round-trip.
+   Compiled with -DNAXOS_FUZZ_MAIN it is a standalone program that runs the files given on the
+   command line, e.g. to replay a crash without libFuzzer.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Naxos.h"
+#include "NaxosWire.h"
+
+#define FUZZ_KEYS 9       /* keyC arguments filled from the input */
+
+typedef struct fuzzInput  /* Input consumed byte by byte, then zeros */
+{
+  const uint8_t* data;
+  size_t size;
+} fuzzInput;
+
+void fuzzFill(uint8_t* b,int len,int maxLen,fuzzInput* in)
+/* It fills the first len bytes of b with the input, the others up to maxLen with zeros */
+{
+  int n;
+
+  memset(b,0,maxLen);
+  n = (in->size < (size_t)len)?(int)in->size:len;
+  memcpy(b,in->data,n);
+  in->data += n;
+  in->size -= n;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data,size_t size)
+{
+  static const int curves[] = {NIST_P192,NIST_P224,NIST_P256,NIST_P384,NIST_P521};
+  ellipticCurve curve;
+  fuzzInput in;
+  keyC k[FUZZ_KEYS],x,y;
+  keyPC c1,c2,c3;
+  uint8_t frame[WIRE_MAX];
+  hashState hs;
+  int i,len,res,op;
+
+  if (size < 2) return 0;
+  if (selectCurve(&curve,curves[data[0]%5]) != 1) abort();
+  op = data[1]%7;
+  in.data = data+2;
+  in.size = size-2;
+  len = (curve.bsize+7)/8;
+
+  switch (op)
+  {
+    case 0:                                /* decompression and compression            */
+      fuzzFill(c1,len+1,sizeof(keyPC),&in);
+      res = decompressPoint(x,y,c1,&curve);
+      if ((res != 1) && (res != -1) && (res != -2)) abort();
+      if (res == 1)
+      {
+        if (compressPoint(c2,x,y,&curve) != 1) abort();
+        if (memcmp(c1,c2,len+1) != 0) abort();
+      }
+      break;
+
+    case 1:                                /* compression of any pair of coordinates   */
+      fuzzFill(x,len,sizeof(keyC),&in);
+      fuzzFill(y,len,sizeof(keyC),&in);
+      res = compressPoint(c1,x,y,&curve);
+      if ((res != 1) && (res != -1)) abort();
+      break;
+
+    case 2:                                /* calculateKa and calculateKb              */
+    case 3:
+      if (curve.hash.rate == 0) break;     /* P-192: no hash functions                 */
+      for (i=0;i<FUZZ_KEYS;i++)
+      {
+        fuzzFill(k[i],len,sizeof(keyC),&in);
+      }
+      if (op == 2) res = calculateKa(k[8],k[0],k[1],k[2],k[3],k[4],k[5],k[6],k[7],&curve);
+      else res = calculateKb(k[8],k[0],k[1],k[2],k[3],k[4],k[5],k[6],k[7],&curve);
+      if ((res < -5) || (res > 1) || (res == 0)) abort();
+      break;
+
+    case 4:                                /* compressed calculateKa and calculateKb   */
+      if (curve.hash.rate == 0) break;
+      fuzzFill(c1,len+1,sizeof(keyPC),&in);
+      fuzzFill(c2,len+1,sizeof(keyPC),&in);
+      for (i=0;i<4;i++)
+      {
+        fuzzFill(k[i],len,sizeof(keyC),&in);
+      }
+      res = calculateKaCompressed(k[4],c1,k[0],k[1],c2,k[2],k[3],&curve);
+      if ((res < -5) || (res > 1) || (res == 0)) abort();
+      res = calculateKbCompressed(k[4],c2,k[0],k[1],c1,k[2],k[3],&curve);
+      if ((res < -5) || (res > 1) || (res == 0)) abort();
+      break;
+
+    case 5:                                /* frames of the wire format, as received   */
+      if (curve.hash.rate == 0) break;
+      for (i=0;i<4;i++)
+      {
+        fuzzFill(k[i],len,sizeof(keyC),&in);
+      }
+      fuzzFill(c1,len+1,sizeof(keyPC),&in);
+      i = (in.size < WIRE_MAX)?(int)in.size:WIRE_MAX;
+      fuzzFill(frame,i,WIRE_MAX,&in);
+      res = calculateKbWire(k[4],frame,i,k[0],k[1],k[2],&curve);
+      if ((res < -6) || (res > 1) || (res == 0)) abort();
+      res = calculateKaWire(k[4],frame,i,k[0],k[1],k[2],c1,k[3],&curve);
+      if ((res < -6) || (res > 1) || (res == 0)) abort();
+      break;
+
+    default:                               /* sponge with chunks of the input          */
+      if (hashInit(&hs,&curve) != 1) break;
+      while (in.size > 0)
+      {
+        len = 1 + in.data[0];
+        if ((size_t)len > in.size) len = in.size;
+        hashAbsorb(&hs,in.data,len);
+        in.data += len;
+        in.size -= len;
+      }
+      if (hashFinal(&hs,c3,curve.hash.hlen) != 1) abort();
+      break;
+  }
+  return 0;
+}
+
+#ifdef NAXOS_FUZZ_MAIN
+int main(int argc,char** argv)
+{
+  FILE* f;
+  uint8_t* buf;
+  long n;
+  int i;
+
+  for (i=1;i<argc;i++)
+  {
+    f = fopen(argv[i],"rb");
+    if (f == NULL) continue;
+    fseek(f,0,SEEK_END);
+    n = ftell(f);
+    fseek(f,0,SEEK_SET);
+    buf = (uint8_t*)malloc(n > 0 ? n : 1);
+    if ((buf != NULL) && (fread(buf,1,n,f) == (size_t)n))
+    {
+      LLVMFuzzerTestOneInput(buf,n);
+    }
+    free(buf);
+    fclose(f);
+  }
+  return 0;
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+   It generates NaxosTables.h, the fixed-base tables of the base point G used by scalarMultBase
+   for the curves NIST P-224, P-256, P-384 and P-521.
+   For each window j = 0, ..., nwin-1 the table contains the points in Affine coordinates
+     1*B_j, 2*B_j, ..., GTAB_NPOINTS*B_j  with  B_j = 2^(GTAB_WBITS*j)*G
+   Each point is stored as x followed by y, nwords words each, less significant word first,
+   in the internal (Montgomery) form of the library.
+   It is linked with Naxos.c compiled with NAXOS_GEN_TABLES, i.e. without tables,
+   and the points are calculated by buildTable.
+   Usage: Gen_NaxosTables > NaxosTables.h
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Naxos.h"
+
+int tableWords(int v,ellipticCurve* curve);                          /* See Naxos.c */
+int buildTable(uint64_t* tab,pointA* P,int v,ellipticCurve* curve);  /* See Naxos.c */
+
+int printTable(int index,const char* name)
+/* It prints the table of the curve index as the array name */
+{
+  ellipticCurve curveN;
+  uint64_t* tab;
+  int i,j,n,nwords;
+
+  selectCurve(&curveN,index);
+  nwords = curveN.wsize;
+  n = tableWords(1,&curveN);
+  tab = (uint64_t*)malloc(n*sizeof(uint64_t));
+  if (tab == NULL) return -1;
+  if (buildTable(tab,&curveN.g,1,&curveN) != 1)     /* B_j = 2^(4*j)*G                        */
+  {
+    free(tab);
+    return -1;
+  }
+
+  printf("static const uint64_t %s[%d] =\n{\n",name,n);
+  for (i=0;i<n;i+=nwords)
+  {
+    printf("  ");
+    for (j=0;j<nwords;j++)
+    {
+      printf("0x%016llxULL,",(unsigned long long)tab[i+j]);
+    }
+    printf("\n");
+  }
+  printf("};\n\n");
+
+  free(tab);
+  return 1;
+}
+
+int main()
+{
+  printf("/* NaxosTables.h: fixed-base tables of G, generated by Gen_NaxosTables. Do not edit. */\n\n");
+  printf("#ifndef _NAXOS_TABLES__\n#define _NAXOS_TABLES__\n\n");
+  if ((printTable(NIST_P224,"gTableP224") != 1) || (printTable(NIST_P256,"gTableP256") != 1) ||
+      (printTable(NIST_P384,"gTableP384") != 1) || (printTable(NIST_P521,"gTableP521") != 1))
+  {
+    fprintf(stderr,"Gen_NaxosTables: memory allocation error\n");
+    return 1;
+  }
+  printf("#endif /* #ifndef _NAXOS_TABLES__  */\n");
+  return 0;
+}
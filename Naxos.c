@@ -9,21 +9,97 @@
    Testing: http://point-at-infinity.org/ecc/nisttv
 */
 
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "Naxos.h"
+#include "NaxosSimd.h"
+#include "NaxosArena.h"
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
 
-#define DOUBLEW_BYTES 144 /* Maximum length in bytes of esk+sk */
-#define FIVET_BYTES 360   /* Maximum length in bytes of input for Hash in K calculation */
 #define BITS64 64         /* For operations with 64 bit words */
 #define BITS63 63         /* For operations with 64 bit words */
 #define BYTES8 8          /* For operations with 64 bit words, number of bytes per word */
 #define BYTES7 7          /* For operations with 64 bit words */
+#define DRBG_KEY 64       /* Bytes of the key of the DRBG of randomGen */
+#define DRBG_BUFFER 512   /* Bytes squeezed at a time by the DRBG */
+#define DRBG_RESEED 4096  /* Buffers of the DRBG between two seeds from getrandom */
+#define RDRAND_RETRY 10   /* Attempts of RDRAND for each word, as recommended by Intel */
+#define SQRT_MAX_Z 1000   /* Search bound of the non-residue of curveSqrt */
+#define PEER_COMB_V 4     /* Groups of digits of the comb tables of the peers: 12 doublings, 1/4 of the table of G */
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define NAXOS_LITTLE_ENDIAN  /* keyC is the coord in memory: byteToWord and wordToByte copy the words */
+#endif
+
+#ifdef NAXOS_COUNTERS
+static _Thread_local naxosCounters naxosCnt[NAXOS_PHASES];   /* per thread, see naxosCountersGet */
+static _Thread_local int naxosPhase;
+#define NAXOS_COUNT(field,n) (naxosCnt[naxosPhase].field += (n))
+#define NAXOS_PHASE(ph) (naxosPhase = (ph))
+#else
+#define NAXOS_COUNT(field,n) ((void)0)
+#define NAXOS_PHASE(ph) ((void)0)
+#endif
+
+/* Hash descriptors of the curves: rate of the sponge in bits, bytes of H(esk,sk), bytes of K */
+static const hashDesc HASH_NONE = {0,0,0};       /* P-192: no hash functions               */
+static const hashDesc HASH_P224 = {1152,28,28};  /* SHA3-224                               */
+static const hashDesc HASH_P256 = {1088,32,32};  /* SHA3-256                               */
+static const hashDesc HASH_P384 = {832,48,48};   /* SHA3-384                               */
+static const hashDesc HASH_P521 = {576,66,64};   /* SHA3-512, squeezed to 528 bits for H   */
+
+#ifndef NAXOS_GEN_TABLES
+#include "NaxosTables.h"  /* Fixed-base tables of G, generated at build time by Gen_NaxosTables */
+#define GTABLE_P224 gTableP224
+#define GTABLE_P256 gTableP256
+#define GTABLE_P384 gTableP384
+#define GTABLE_P521 gTableP521
+#else                     /* Library built for Gen_NaxosTables itself: no tables yet    */
+#define GTABLE_P224 NULL
+#define GTABLE_P256 NULL
+#define GTABLE_P384 NULL
+#define GTABLE_P521 NULL
+#endif
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 uint128; /* 128 bits for the 64x64 bits word products */
+__extension__ typedef __int128 int128;           /* signed 128 bits for the NIST reductions    */
+
+static inline uint64_t wordMulAdd(uint64_t* h,uint64_t a,uint64_t b,uint64_t c,uint64_t d)
+/* It calculates (h,l) = a*b + c + d and returns l
+   The result always fits in 128 bits
+*/
+{
+  uint128 t;
 
-typedef struct pointP    /* Point with Projective coordinates */
+  t = (uint128)a*b + c + d;
+  *h = (uint64_t)(t>>BITS64);
+  return (uint64_t)t;
+}
+#else
+static inline uint64_t wordMulAdd(uint64_t* h,uint64_t a,uint64_t b,uint64_t c,uint64_t d)
+/* It calculates (h,l) = a*b + c + d and returns l
+   Portable version with 32 bits half words for compilers without 128 bits integers
+*/
 {
-  coord pX;
-  coord pY;
-  coord pZ;
-} pointP;
+  uint64_t a0,a1,b0,b1,t00,t01,t10,t11,m,l;
+
+  a0 = a & 0xFFFFFFFF;  a1 = a >> 32;
+  b0 = b & 0xFFFFFFFF;  b1 = b >> 32;
+  t00 = a0*b0;  t01 = a0*b1;  t10 = a1*b0;  t11 = a1*b1;
+  m = (t00>>32) + (t01&0xFFFFFFFF) + (t10&0xFFFFFFFF);   /* middle column, it cannot overflow */
+  l = (m<<32) | (t00&0xFFFFFFFF);
+  t11 = t11 + (t01>>32) + (t10>>32) + (m>>32);
+  l = l + c;
+  t11 = t11 + (l < c);
+  l = l + d;
+  *h = t11 + (l < d);
+  return l;
+}
+#endif
 
 void coordInit(coord a)
 /* It sets a = 0  */
@@ -122,6 +198,51 @@ int coordIsEven(coord a)
   }
 }
 
+/* Field arithmetic on fixed numbers of words, see NaxosField.inc */
+
+#define FW_FN static inline
+
+#define FW_N 3
+#define FW(name) name##_3
+#include "NaxosField.inc"
+#undef FW_N
+#undef FW
+
+#define FW_N 4
+#define FW(name) name##_4
+#include "NaxosField.inc"
+#undef FW_N
+#undef FW
+
+#define FW_N 6
+#define FW(name) name##_6
+#include "NaxosField.inc"
+#undef FW_N
+#undef FW
+
+#define FW_N 9
+#define FW(name) name##_9
+#include "NaxosField.inc"
+#undef FW_N
+#undef FW
+
+#define FW_N nwords
+#define FW(name) name##_n
+#include "NaxosField.inc"
+#undef FW_N
+#undef FW
+
+/* It calls the function name with args for the number of words n, set is "" or "r =" */
+#define FW_DISPATCH(n,set,name,args) \
+  switch (n)                          \
+  {                                   \
+    case 3:  set name##_3 args; break; \
+    case 4:  set name##_4 args; break; \
+    case 6:  set name##_6 args; break; \
+    case 9:  set name##_9 args; break; \
+    default: set name##_n args;        \
+  }
+
 int coordCmp(coord a,coord b, int nwords)
 /* It compares a and b and returns:
    1 if a > b
@@ -130,18 +251,65 @@ int coordCmp(coord a,coord b, int nwords)
    Always the same number of operations
 */
 {
+  int r;
 
-  int i,j=1,g=0,l=0;
+  FW_DISPATCH(nwords,r =,coordCmp,(a,b,nwords));
+  return r;
+}
 
-  for (i=(nwords-1);i>-1;i--)
-  {
-    j = j & (a[i] == b[i]);              /* If any word is not 0 then j is set to 0 */
-    g = g|((j==0)&(a[i]>b[i])&(l==0));   /* if there is a word that it is not 0,    */
-                                         /*   a[i]>b[i] and it was not found lower before it is marked greater */
-    l = l|((j==0)&(a[i]<b[i])&(g==0));   /* if there is a word that it is not 0,    */
-                                         /*   a[i]<b[i] and it was not found greater before it is marked lower */
-  }
-  return (g-l);
+void coordDouble (coord a,coord b,coord p,int nwords)
+/* It calculates a = 2*b mod p with b < p
+   Always the same number of operations
+*/
+{
+  NAXOS_COUNT(dbl,1);
+  FW_DISPATCH(nwords,,coordDouble,(a,b,p,nwords));
+}
+
+void coordAdd(coord c,coord a,coord b,coord p,int nwords)
+/* Algorithm 2.5 Multiprecision addition
+   It calculates c = a + b mod p with a,b< p
+   Always the same number of operations
+*/
+{
+  NAXOS_COUNT(add,1);
+  FW_DISPATCH(nwords,,coordAdd,(c,a,b,p,nwords));
+}
+
+void coordSub(coord c,coord a,coord b,coord p,int nwords)
+/* Algorithm 2.6 Multiprecision subtraction
+   It calculates c = a - b mod p with a,b< p
+   Always the same number of operations
+*/
+{
+  NAXOS_COUNT(sub,1);
+  FW_DISPATCH(nwords,,coordSub,(c,a,b,p,nwords));
+}
+
+void coordCondSub(coord c,uint64_t* t,uint64_t top,coord p,int nwords)
+/* It calculates c = t - p if (top,t) >= p else c = t, with (top,t) < 2p
+   Always the same number of operations, the result is selected by a mask
+*/
+{
+  FW_DISPATCH(nwords,,coordCondSub,(c,t,top,p,nwords));
+}
+
+void coordMulMont(coord c,coord a,coord b,ellipticCurve* curve)
+/* Montgomery multiplication with Coarsely Integrated Operand Scanning (CIOS)
+   It calculates c = a * b * R^-1 mod p with a,b< p and R = 2^(64*nwords)
+   Always the same number of operations
+*/
+{
+  FW_DISPATCH(curve->wsize,,coordMulMont,(c,a,b,curve));
+}
+
+void coordMulWide(uint64_t* t,coord a,coord b,int nwords)
+/* Algorithm 2.9 Integer multiplication (operand scanning form)
+   It calculates the 2*nwords words product t = a * b without reduction
+   Always the same number of operations
+*/
+{
+  FW_DISPATCH(nwords,,coordMulWide,(t,a,b,nwords));
 }
 
 void coordHalf(coord a,coord b, int nwords)
@@ -187,197 +355,332 @@ void coordAddAndHalf(coord c,coord a,coord b,coord p,int nwords)
   {
     c[i]=(d[i]>>1)|(d[i+1]<<BITS63);
   }
-  coordInit(d);
+  naxosWipe(d,COORD_BYTES);
 }
 
-void coordDouble (coord a,coord b,coord p,int nwords)
-/* It calculates a = b^2 mod p with a< p
+#if defined(__SIZEOF_INT128__)
+void coordFoldTop(coord c,coord u,uint64_t top,const uint64_t* k,int nbits,ellipticCurve* curve)
+/* Final step of the fast reduction modulo a NIST prime, see NaxosField.inc
    Always the same number of operations
 */
 {
-  uint64_t t,t1;
-  coord d;
-  int i,r;
+  FW_DISPATCH(curve->wsize,,coordFoldTop,(c,u,top,k,nbits,curve));
+}
 
-  r = b[nwords-1]>>BITS63;
+void coordRedP224(coord c,uint64_t* t,ellipticCurve* curve)
+/* Fast reduction modulo p = 2^224 - 2^96 + 1. Ch. D.2.2 of [3]
+   With t = (x13,...,x0) in 32 bits words, B = s1 + s2 + s3 - s4 - s5 where
+     s1 = ( x6, x5, x4, x3, x2, x1, x0)     s2 = (x10, x9, x8, x7,  0,  0,  0)
+     s3 = (  0,x13,x12,x11,  0,  0,  0)     s4 = (x13,x12,x11,x10, x9, x8, x7)
+     s5 = (  0,  0,  0,  0,x13,x12,x11)
+   is calculated by words of 64 bits with signed 128 bits carries, adding 3p in order to have B >= 0
+   Always the same number of operations
+*/
+{
+  static const uint64_t k[4] = {0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFF, 0, 0}; /* 2^224 - p = 2^96 - 1 */
+  int128 acc,carry;
+  uint64_t top;
+  coord u;
+
+  carry = 0;
+  acc = carry + (int128)0x3ULL;                      /* 3p */
+  acc = acc + t[0];                                  /* +s1 */
+  acc = acc - ((t[3] >> 32) | (t[4] << 32));         /* -s4 */
+  acc = acc - ((t[5] >> 32) | (t[6] << 32));         /* -s5 */
+  u[0] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0xFFFFFFFD00000000ULL;       /* 3p */
+  acc = acc + t[1];                                  /* +s1 */
+  acc = acc + ((t[3] >> 32) << 32);                  /* +s2 */
+  acc = acc + ((t[5] >> 32) << 32);                  /* +s3 */
+  acc = acc - ((t[4] >> 32) | (t[5] << 32));         /* -s4 */
+  acc = acc - (t[6] >> 32);                          /* -s5 */
+  u[1] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0xFFFFFFFFFFFFFFFFULL;       /* 3p */
+  acc = acc + t[2];                                  /* +s1 */
+  acc = acc + t[4];                                  /* +s2 */
+  acc = acc + t[6];                                  /* +s3 */
+  acc = acc - ((t[5] >> 32) | (t[6] << 32));         /* -s4 */
+  u[2] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0x2FFFFFFFFULL;              /* 3p */
+  acc = acc + (t[3] & 0xFFFFFFFF);                   /* +s1 */
+  acc = acc + (t[5] & 0xFFFFFFFF);                   /* +s2 */
+  acc = acc - (t[6] >> 32);                          /* -s4 */
+  u[3] = (uint64_t)acc & 0xFFFFFFFF;  top = (uint64_t)(acc >> 32);
+  coordFoldTop(c,u,top,k,NIST_P224,curve);
+
+  naxosWipe(u,4*sizeof(uint64_t));                   /* Clear u                                    */
+}
 
-  for (i=nwords-1;i>0;i--)                   /* It just shifts one bit to the left */
-  {
-    a[i]=(b[i]<<1)|(b[i-1]>>BITS63);         /* When shifting it must add the highest bit of the lower word in pos 0 */
-  }
-  a[0] = b[0]<<1;
+void coordRedP256(coord c,uint64_t* t,ellipticCurve* curve)
+/* Fast reduction modulo p = 2^256 - 2^224 + 2^192 + 2^96 - 1. Ch. D.2.3 of [3]
+   With t = (x15,...,x0) in 32 bits words, B = s1 + 2s2 + 2s3 + s4 + s5 - s6 - s7 - s8 - s9 where
+     s1 = ( x7, x6, x5, x4, x3, x2, x1, x0)     s2 = (x15,x14,x13,x12,x11,  0,  0,  0)
+     s3 = (  0,x15,x14,x13,x12,  0,  0,  0)     s4 = (x15,x14,  0,  0,  0,x10, x9, x8)
+     s5 = ( x8,x13,x15,x14,x13,x11,x10, x9)     s6 = (x10, x8,  0,  0,  0,x13,x12,x11)
+     s7 = (x11, x9,  0,  0,x15,x14,x13,x12)     s8 = (x12,  0,x10, x9, x8,x15,x14,x13)
+     s9 = (x13,  0,x11,x10, x9,  0,x15,x14)
+   is calculated by words of 64 bits with signed 128 bits carries, adding 5p in order to have B >= 0
+   Always the same number of operations
+*/
+{
+  static const uint64_t k[4] = {0x0000000000000001, 0xFFFFFFFF00000000, 0xFFFFFFFFFFFFFFFF, 0x00000000FFFFFFFE};
+                                                     /* 2^256 - p = 2^224 - 2^192 - 2^96 + 1       */
+  int128 acc,carry;
+  uint64_t top;
+  coord u;
+
+  carry = 0;
+  acc = carry + (int128)0xFFFFFFFFFFFFFFFBULL;       /* 5p */
+  acc = acc + t[0];                                  /* +s1 */
+  acc = acc + t[4];                                  /* +s4 */
+  acc = acc + ((t[4] >> 32) | (t[5] << 32));         /* +s5 */
+  acc = acc - ((t[5] >> 32) | (t[6] << 32));         /* -s6 */
+  acc = acc - t[6];                                  /* -s7 */
+  acc = acc - ((t[6] >> 32) | (t[7] << 32));         /* -s8 */
+  acc = acc - t[7];                                  /* -s9 */
+  u[0] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0x4FFFFFFFFULL;              /* 5p */
+  acc = acc + t[1];                                  /* +s1 */
+  acc = acc + ((int128)((t[5] >> 32) << 32) << 1);   /* +2s2 */
+  acc = acc + ((int128)(t[6] << 32) << 1);           /* +2s3 */
+  acc = acc + (t[5] & 0xFFFFFFFF);                   /* +s4 */
+  acc = acc + ((t[5] >> 32) | ((t[6] >> 32) << 32)); /* +s5 */
+  acc = acc - (t[6] >> 32);                          /* -s6 */
+  acc = acc - t[7];                                  /* -s7 */
+  acc = acc - ((t[7] >> 32) | ((t[4] & 0xFFFFFFFF) << 32)); /* -s8 */
+  acc = acc - ((t[4] >> 32) << 32);                  /* -s9 */
+  u[1] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0x0ULL;                      /* 5p */
+  acc = acc + t[2];                                  /* +s1 */
+  acc = acc + ((int128)t[6] << 1);                   /* +2s2 */
+  acc = acc + ((int128)((t[6] >> 32) | (t[7] << 32)) << 1); /* +2s3 */
+  acc = acc + t[7];                                  /* +s5 */
+  acc = acc - ((t[4] >> 32) | (t[5] << 32));         /* -s8 */
+  acc = acc - t[5];                                  /* -s9 */
+  u[2] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (((int128)4) << 64) + 0xFFFFFFFB00000005ULL; /* 5p */
+  acc = acc + t[3];                                  /* +s1 */
+  acc = acc + ((int128)t[7] << 1);                   /* +2s2 */
+  acc = acc + ((int128)(t[7] >> 32) << 1);           /* +2s3 */
+  acc = acc + t[7];                                  /* +s4 */
+  acc = acc + ((t[6] >> 32) | ((t[4] & 0xFFFFFFFF) << 32)); /* +s5 */
+  acc = acc - ((t[4] & 0xFFFFFFFF) | ((t[5] & 0xFFFFFFFF) << 32)); /* -s6 */
+  acc = acc - ((t[4] >> 32) | ((t[5] >> 32) << 32)); /* -s7 */
+  acc = acc - (t[6] << 32);                          /* -s8 */
+  acc = acc - ((t[6] >> 32) << 32);                  /* -s9 */
+  u[3] = (uint64_t)acc;  top = (uint64_t)(acc >> 64);
+  coordFoldTop(c,u,top,k,NIST_P256,curve);
+
+  naxosWipe(u,4*sizeof(uint64_t));                   /* Clear u                                    */
+}
 
-  if ((r == 1)|(coordCmp(a,p,nwords)!=-1))   /* if r==1 or a >= p then a = a-p. See coordSub */
-  {
-    r = 0;                                   /* initialize carry bit                         */
-    for (i=0;i<nwords;i++)
-    {
-      t1 = a[i]-r;                           /* calculates a - carry bit                     */
-      r = t1 > a[i];                         /* carry bit                                    */
-      t = t1 - p[i];                         /* now subtract p                               */
-      r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
-      a[i] = t;
-    }
-  }
-  else                                       /* in order to maintain the same number of operations */
-  {
-    r = 0;
-    for (i=0;i<nwords;i++)
-    {
-      t1 = d[i]-r;                           /* calculates d - carry bit                     */
-      r = t1 > a[i];                         /* carry bit                                    */
-      t = t1 - p[i];                         /* now subtract p                               */
-      r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
-      d[i] = t;
-    }
-  }
+void coordRedP384(coord c,uint64_t* t,ellipticCurve* curve)
+/* Fast reduction modulo p = 2^384 - 2^128 - 2^96 + 2^32 - 1. Ch. D.2.4 of [3]
+   With t = (x23,...,x0) in 32 bits words, B = s1 + 2s2 + s3 + s4 + s5 + s6 + s7 - s8 - s9 - s10 where
+     s1  = (x11,x10, x9, x8, x7, x6, x5, x4, x3, x2, x1, x0)
+     s2  = (  0,  0,  0,  0,  0,x23,x22,x21,  0,  0,  0,  0)
+     s3  = (x23,x22,x21,x20,x19,x18,x17,x16,x15,x14,x13,x12)
+     s4  = (x20,x19,x18,x17,x16,x15,x14,x13,x12,x23,x22,x21)
+     s5  = (x19,x18,x17,x16,x15,x14,x13,x12,x20,  0,x23,  0)
+     s6  = (  0,  0,  0,  0,x23,x22,x21,x20,  0,  0,  0,  0)
+     s7  = (  0,  0,  0,  0,  0,  0,x23,x22,x21,  0,  0,x20)
+     s8  = (x22,x21,x20,x19,x18,x17,x16,x15,x14,x13,x12,x23)
+     s9  = (  0,  0,  0,  0,  0,  0,  0,x23,x22,x21,x20,  0)
+     s10 = (  0,  0,  0,  0,  0,  0,  0,x23,x23,  0,  0,  0)
+   is calculated by words of 64 bits with signed 128 bits carries, adding 4p in order to have B >= 0
+   Always the same number of operations
+*/
+{
+  static const uint64_t k[6] = {0xFFFFFFFF00000001, 0x00000000FFFFFFFF, 0x0000000000000001, 0, 0, 0};
+                                                     /* 2^384 - p = 2^128 + 2^96 - 2^32 + 1       */
+  int128 acc,carry;
+  uint64_t top;
+  coord u;
+
+  carry = 0;
+  acc = carry + (int128)0x3FFFFFFFCULL;              /* 4p */
+  acc = acc + t[0];                                  /* +s1 */
+  acc = acc + t[6];                                  /* +s3 */
+  acc = acc + ((t[10] >> 32) | (t[11] << 32));       /* +s4 */
+  acc = acc + ((t[11] >> 32) << 32);                 /* +s5 */
+  acc = acc + (t[10] & 0xFFFFFFFF);                  /* +s7 */
+  acc = acc - ((t[11] >> 32) | ((t[6] & 0xFFFFFFFF) << 32)); /* -s8 */
+  acc = acc - (t[10] << 32);                         /* -s9 */
+  u[0] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0xFFFFFFFC00000000ULL;       /* 4p */
+  acc = acc + t[1];                                  /* +s1 */
+  acc = acc + t[7];                                  /* +s3 */
+  acc = acc + ((t[11] >> 32) | ((t[6] & 0xFFFFFFFF) << 32)); /* +s4 */
+  acc = acc + (t[10] << 32);                         /* +s5 */
+  acc = acc + ((t[10] >> 32) << 32);                 /* +s7 */
+  acc = acc - ((t[6] >> 32) | (t[7] << 32));         /* -s8 */
+  acc = acc - ((t[10] >> 32) | (t[11] << 32));       /* -s9 */
+  acc = acc - ((t[11] >> 32) << 32);                 /* -s10 */
+  u[1] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0xFFFFFFFFFFFFFFFBULL;       /* 4p */
+  acc = acc + t[2];                                  /* +s1 */
+  acc = acc + ((int128)((t[10] >> 32) | (t[11] << 32)) << 1); /* +2s2 */
+  acc = acc + t[8];                                  /* +s3 */
+  acc = acc + ((t[6] >> 32) | (t[7] << 32));         /* +s4 */
+  acc = acc + t[6];                                  /* +s5 */
+  acc = acc + t[10];                                 /* +s6 */
+  acc = acc + t[11];                                 /* +s7 */
+  acc = acc - ((t[7] >> 32) | (t[8] << 32));         /* -s8 */
+  acc = acc - (t[11] >> 32);                         /* -s9 */
+  acc = acc - (t[11] >> 32);                         /* -s10 */
+  u[2] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0xFFFFFFFFFFFFFFFFULL;       /* 4p */
+  acc = acc + t[3];                                  /* +s1 */
+  acc = acc + ((int128)(t[11] >> 32) << 1);          /* +2s2 */
+  acc = acc + t[9];                                  /* +s3 */
+  acc = acc + ((t[7] >> 32) | (t[8] << 32));         /* +s4 */
+  acc = acc + t[7];                                  /* +s5 */
+  acc = acc + t[11];                                 /* +s6 */
+  acc = acc - ((t[8] >> 32) | (t[9] << 32));         /* -s8 */
+  u[3] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (int128)0xFFFFFFFFFFFFFFFFULL;       /* 4p */
+  acc = acc + t[4];                                  /* +s1 */
+  acc = acc + t[10];                                 /* +s3 */
+  acc = acc + ((t[8] >> 32) | (t[9] << 32));         /* +s4 */
+  acc = acc + t[8];                                  /* +s5 */
+  acc = acc - ((t[9] >> 32) | (t[10] << 32));        /* -s8 */
+  u[4] = (uint64_t)acc;  carry = acc >> 64;
+  acc = carry + (((int128)3) << 64) + 0xFFFFFFFFFFFFFFFFULL; /* 4p */
+  acc = acc + t[5];                                  /* +s1 */
+  acc = acc + t[11];                                 /* +s3 */
+  acc = acc + ((t[9] >> 32) | (t[10] << 32));        /* +s4 */
+  acc = acc + t[9];                                  /* +s5 */
+  acc = acc - ((t[10] >> 32) | (t[11] << 32));       /* -s8 */
+  u[5] = (uint64_t)acc;  top = (uint64_t)(acc >> 64);
+  coordFoldTop(c,u,top,k,NIST_P384,curve);
+
+  naxosWipe(u,6*sizeof(uint64_t));                   /* Clear u                                    */
 }
 
-void coordAdd(coord c,coord a,coord b,coord p,int nwords)
-/* Algorithm 2.5 Multiprecision addition
-   It calculates c = a + b mod p with a,b< p
+void coordMulP224(coord c,coord a,coord b,ellipticCurve* curve)
+/* It calculates c = a * b mod p for p = 2^224 - 2^96 + 1
    Always the same number of operations
 */
 {
-  uint64_t t,t1;
-  coord d;
-  int i,r;
+  uint64_t t[2*COORD_NWORDS];
 
-  /* It calculates a + b */
-  r = 0;                                     /* initialize carry bit                         */
-  for (i = 0;i<nwords;i++)
-  {
-    t = b[i] + r;                            /* adding b and the carry bit                   */
-    r = t < b[i];                            /* carry bit                                    */
-    t = t + a[i];                            /* adding a                                     */
-    r = r | (t < a[i]);                      /* calculate the result carry bit of the 2 sums */
-    c[i] = t;
-  }
-  if ((r == 1)|(coordCmp(c,p,nwords)!=-1))   /* if r==1 or c >= p then c = c-p. See coordSub */
-  {
-    r = 0;                                   /* initialize carry bit                         */
-    for (i=0;i<nwords;i++)
-    {
-      t1 = c[i]-r;                           /* calculates c - carry bit                     */
-      r = t1 > c[i];                         /* carry bit                                    */
-      t = t1 - p[i];                         /* now subtract p                               */
-      r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
-      c[i] = t;
-    }
-  }
-  else                                       /* in order to maintain the same number of operations */
-  {
-    r = 0;
-    for (i=0;i<nwords;i++)
-    {
-      t1 = d[i]-r;                           /* calculates d - carry bit                     */
-      r = t1 > c[i];                         /* carry bit                                    */
-      t = t1 - p[i];                         /* now subtract p                               */
-      r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
-      d[i] = t;
-    }
-  }
+  coordMulWide_4(t,a,b,4);
+  coordRedP224(c,t,curve);
+
+  naxosWipe(t,8*sizeof(uint64_t));                   /* Clear t                                    */
 }
 
-void coordSub(coord c,coord a,coord b,coord p,int nwords)
-/* Algorithm 2.6 Multiprecision subtraction
-   It calculates c = a - b mod p with a,b< p
+void coordMulP256(coord c,coord a,coord b,ellipticCurve* curve)
+/* It calculates c = a * b mod p for p = 2^256 - 2^224 + 2^192 + 2^96 - 1
    Always the same number of operations
 */
 {
-  uint64_t t,t1;
-  coord d;
-  int i,r;
+  uint64_t t[2*COORD_NWORDS];
 
-  /* It calculates a - b */
-  r = 0;                                       /* initialize carry bit                         */
-  for (i=0;i<nwords;i++)
-  {
-    t1 = a[i]-r;                               /* calculates a - carry bit                     */
-    r = t1 > a[i];                             /* carry bit                                    */
-    t = t1 - b[i];                             /* now subtract b                               */
-    r = r | (t > t1);                          /* calculate the result carry bit of the 2 subs */
-    c[i] = t;
-  }
+  coordMulWide_4(t,a,b,4);
+  coordRedP256(c,t,curve);
+
+  naxosWipe(t,8*sizeof(uint64_t));                   /* Clear t                                    */
+}
+
+void coordMulP384(coord c,coord a,coord b,ellipticCurve* curve)
+/* It calculates c = a * b mod p for p = 2^384 - 2^128 - 2^96 + 2^32 - 1
+   Always the same number of operations
+*/
+{
+  uint64_t t[2*COORD_NWORDS];
+
+  coordMulWide_6(t,a,b,6);
+  coordRedP384(c,t,curve);
+
+  naxosWipe(t,12*sizeof(uint64_t));                  /* Clear t                                    */
+}
+
+#define MUL_P224 coordMulP224
+#define MUL_P256 coordMulP256
+#define MUL_P384 coordMulP384
+#else                              /* the fast reductions need signed 128 bits integers */
+#define MUL_P224 coordMulMont
+#define MUL_P256 coordMulMont
+#define MUL_P384 coordMulMont
+#endif
+
+void coordMulP521(coord c,coord a,coord b,ellipticCurve* curve)
+/* It calculates c = a * b mod p for p = 2^521 - 1
+   Since 2^521 = 1 mod p, t = t1*2^521 + t0 = t1 + t0 mod p with t0, t1 < 2^521,
+   therefore one shift, one addition and one conditional subtraction are enough
+   Always the same number of operations
+*/
+{
+  uint64_t t[2*COORD_NWORDS];
+  coord t1;
+  uint64_t s,r;
+  int i;
 
-  if (r == 1)                                  /* if a - b < 0 so we need to add p. See coordAdd */
+  coordMulWide_9(t,a,b,9);
+  for (i=0;i<9;i++)
   {
-    r = 0;                                     /* initialize carry bit                         */
-    for (i = 0;i<nwords;i++)
-    {
-      t = p[i] + r;                            /* adding p and the carry bit                   */
-      r = t < p[i];                            /* carry bit                                    */
-      t = t + c[i];                            /* adding c                                     */
-      r = r | (t < c[i]);                      /* calculate the result carry bit of the 2 sums */
-      c[i] = t;
-    }
+    t1[i] = (t[8+i] >> 9) | (t[9+i] << 55);          /* t1 = t >> 521                              */
   }
-  else                                         /* in order to maintain the same number of operations */
+  t[8] = t[8] & 0x1FF;                               /* t0 = t mod 2^521                           */
+  r = 0;
+  for (i=0;i<9;i++)                                  /* t0 = t0 + t1 < 2^522. See coordAdd         */
   {
-    r = 0;
-    for (i = 0;i<nwords;i++)
-    {
-      t = d[i] + r;                            /* adding d and the carry bit                   */
-      r = t < d[i];                            /* carry bit                                    */
-      t = t + c[i];                            /* adding c                                     */
-      r = r | (t < c[i]);                      /* calculate the result carry bit of the 2 sums */
-      d[i] = t;
-    }
+    s = t1[i] + r;
+    r = s < t1[i];
+    s = s + t[i];
+    r = r | (s < t[i]);
+    t[i] = s;
   }
+  coordCondSub_9(c,t,0,curve->p,9);                  /* c = t0 mod p                               */
+
+  naxosWipe(t,sizeof(t));                            /* Clear t                                    */
+  naxosWipe(t1,sizeof(t1));                          /* Clear t1                                   */
 }
 
 
-void coordMul(coord c,coord a,coord b,coord p,int nwords)
-/* It calculates c = a * b mod p with a,b< p
-   Always the same number of operations
+void coordMul(coord c,coord a,coord b,ellipticCurve* curve)
+/* It calculates c = a * b mod p in the internal representation of the curve,
+   with the multiplication and reduction selected by selectCurve
 */
 {
-  int i,j;
-  coord t1,t2,t3;
+  NAXOS_COUNT(mul,1);
+  curve->mul(c,a,b,curve);
+}
 
-  coordCopy(t1,a);                    /* Initialized t1 to a                                */
-  coordCopy(t2,a);                    /* t2 is used only to avoid time attacks              */
-  coordInit(t3);                      /* Initialize t3 = 0                                  */
+void coordToMont(coord c,coord a,ellipticCurve* curve)
+/* It converts a in Montgomery form c = a * R mod p with a < p */
+{
+  coordMul(c,a,curve->r2,curve);                     /* c = a * R^2 * R^-1 = a * R mod p          */
+}
 
-  for (i = 0;i<nwords;i++)            /* word by word                                       */
-  {
-    for (j = 0;j<BITS64;j++)          /* bit by bit of the word                             */
-    {
-      if((b[i]>>j)&1)                 /* if the bit j of the word b[i] is one               */
-      {
-        coordAdd(t3,t3,t1,p,nwords);  /* t3 = t3 + t1 mod p                                   */
-      }
-      else                            /* in order to maintain the same number of operations */
-      {
-        coordAdd(t2,t2,t1,p,nwords);
-      }
-      coordDouble(t1,t1,p,nwords);    /* t1 = 2t1 mod p                                     */
-    }
-  }
-  coordCopy(c,t3);                    /* c = t3                                             */
+void coordFromMont(coord c,coord a,ellipticCurve* curve)
+/* It converts a from Montgomery form c = a * R^-1 mod p with a < p */
+{
+  coord one;
 
-  coordInit(t1);                      /* Clear t1                                           */
-  coordInit(t2);                      /* Clear t2                                           */
-  coordInit(t3);                      /* Clear t3                                           */
+  coordInit(one);
+  one[0] = 1;
+  coordMul(c,a,one,curve);                           /* c = a * 1 * R^-1 mod p                    */
 }
 
-void coordInvML(coord c,coord a,coord p,int nwords)
+void coordInvML(coord c,coord a,ellipticCurve* curve)
 /* It calculates c = inv(a) mod p with a < p
    In order to maintain the same number of operations it calculates
    c = a^(p-2) mod p with the Montgomery Ladder
+   a and c are in Montgomery form
 */
 {
-  coord r0, r1, k;
+  coord r0, r1;
   int i, n, b;
   coord f0, f1;                      /* Needed to maintain the same number of operations */
   int order;                         /* Needed to maintain the same number of operations */
+  uint64_t *k = curve->pm2;          /* k = p-2, see curveMontgomery                     */
 
-  order = coordMaxBit(p,nwords);     /* Needed to maintain the same number of operations */
-  coordInit(r0);
-  r0[0] = 2;                         /* r0 = 2                                           */
-  coordSub(k,p,r0,p,nwords);         /* k = p-2                                          */
-  n = coordMaxBit(k,nwords);         /* Calculates n                                     */
-  r0[0] = 1;                         /* r0 = 1                                           */
+  NAXOS_COUNT(inv,1);
+  order = curve->pbits;              /* Needed to maintain the same number of operations */
+  n = coordMaxBit(k,curve->wsize);   /* Calculates n                                     */
+  coordCopy(r0,curve->r1);           /* r0 = 1 in Montgomery form                        */
   coordCopy(r1,a);                   /* r1 = a                                           */
 
 
@@ -388,47 +691,307 @@ void coordInvML(coord c,coord a,coord p,int nwords)
     {
       if (b == 0)
       {
-        coordMul(r1,r0,r1,p,nwords); /* r1 = r0 * r1                                     */
-        coordMul(r0,r0,r0,p,nwords); /* r0 = r0 * r0                                     */
+        coordMul(r1,r0,r1,curve); /* r1 = r0 * r1                                     */
+        coordMul(r0,r0,r0,curve); /* r0 = r0 * r0                                     */
       }
       else
       {
-        coordMul(r0,r0,r1,p,nwords); /* r0 = r0 * r1                                     */
-        coordMul(r1,r1,r1,p,nwords); /* r1 = r1 * r1                                     */
+        coordMul(r0,r0,r1,curve); /* r0 = r0 * r1                                     */
+        coordMul(r1,r1,r1,curve); /* r1 = r1 * r1                                     */
       }
     }
     else                             /* to maintain the same number of operations        */
     {
       if (b == 0)
       {
-        coordMul(f1,f0,f1,p,nwords); /* r1 = r0 * r1                                     */
-        coordMul(f0,f0,f0,p,nwords); /* r0 = r0 * r0                                     */
+        coordMul(f1,f0,f1,curve); /* r1 = r0 * r1                                     */
+        coordMul(f0,f0,f0,curve); /* r0 = r0 * r0                                     */
       }
       else
       {
-        coordMul(f0,f0,f1,p,nwords); /* r0 = r0 * r1                                     */
-        coordMul(f1,f1,f1,p,nwords); /* r1 = r1 * r1                                     */
+        coordMul(f0,f0,f1,curve); /* r0 = r0 * r1                                     */
+        coordMul(f1,f1,f1,curve); /* r1 = r1 * r1                                     */
       }
     }
   }
   coordCopy(c,r0);
 
-  coordInit(r0);                     /* Clear r0                                         */
-  coordInit(r1);                     /* Clear r1                                         */
+  naxosWipe(r0,COORD_BYTES);         /* Clear r0                                         */
+  naxosWipe(r1,COORD_BYTES);         /* Clear r1                                         */
+}
+
+#if defined(__SIZEOF_INT128__)
+#define SG_LIMBS 11       /* Maximum limbs of 62 bits of the safegcd inversion: 521/62 + 2   */
+#define SG_M62 (UINT64_MAX >> 2)
+
+void sgFromCoord(int64_t* r,coord a,int nwords,int nlimbs)
+/* It converts a of nwords words in nlimbs limbs of 62 bits */
+{
+  int i,j,s;
+
+  for (i=0;i<nlimbs;i++)
+  {
+    j = (i*62)/BITS64;
+    s = (i*62)%BITS64;
+    r[i] = 0;
+    if (j < nwords) r[i] = (int64_t)(a[j]>>s);
+    if ((s > 2) && (j+1 < nwords)) r[i] |= (int64_t)(a[j+1]<<(BITS64-s));
+    r[i] &= SG_M62;
+  }
+}
+
+void sgToCoord(coord a,int64_t* r,int nwords,int nlimbs)
+/* It converts r of nlimbs limbs of 62 bits, 0 <= r < p, in a of nwords words */
+{
+  int i,j,s;
+
+  coordInit(a);
+  for (i=0;i<nlimbs;i++)
+  {
+    j = (i*62)/BITS64;
+    s = (i*62)%BITS64;
+    if (j < nwords) a[j] |= ((uint64_t)r[i])<<s;
+    if ((s > 2) && (j+1 < nwords)) a[j+1] |= ((uint64_t)r[i])>>(BITS64-s);
+  }
+}
+
+int64_t sgDivsteps(int64_t delta,uint64_t f,uint64_t g,int64_t* t)
+/* It executes 62 divsteps on the less significant bits of f (odd) and g and returns delta
+   The transition matrix t = [u v; q r] is such that 2^62*[f';g'] = t*[f;g]
+     divstep: if delta > 0 and g odd: delta, f, g = 1 - delta, g, (g - f)/2
+              else                    delta, f, g = 1 + delta, f, (g + (g mod 2)*f)/2
+   Always the same number of operations
+*/
+{
+  uint64_t u = 1, v = 0, q = 0, r = 1;
+  uint64_t c1,c2,x,y,z;
+  int i;
+
+  for (i=0;i<62;i++)
+  {
+    c1 = (uint64_t)((0-delta)>>63);            /* all ones if delta > 0                    */
+    c2 = 0-(g&1);                              /* all ones if g is odd                     */
+    c1 &= c2;                                  /* swap                                     */
+    x = (f^c1)-c1;                             /* x, y, z = -f, -u, -v if swap             */
+    y = (u^c1)-c1;
+    z = (v^c1)-c1;
+    g += x&c2;                                 /* g = g + f or g - f if g is odd           */
+    q += y&c2;
+    r += z&c2;
+    f += g&c1;                                 /* f = old g if swap                        */
+    u += q&c1;
+    v += r&c1;
+    delta = (delta^(int64_t)c1)-(int64_t)c1+1; /* delta = 1 - delta if swap, 1 + delta     */
+    g >>= 1;
+    u <<= 1;
+    v <<= 1;
+  }
+  t[0] = (int64_t)u;
+  t[1] = (int64_t)v;
+  t[2] = (int64_t)q;
+  t[3] = (int64_t)r;
+  return delta;
+}
+
+void sgUpdateDE(int64_t* d,int64_t* e,int64_t* t,int64_t* p,uint64_t pInv62,int nlimbs)
+/* It calculates [d;e] = t*[d;e]/2^62 mod p with -2p < d,e < p, the same range of the result
+   pInv62 = p^-1 mod 2^62
+   Always the same number of operations
+*/
+{
+  int64_t u = t[0], v = t[1], q = t[2], r = t[3];
+  int64_t sd,se,md,me;
+  int128 cd,ce;
+  int i;
+
+  sd = d[nlimbs-1]>>63;                        /* add p if d or e are negative             */
+  se = e[nlimbs-1]>>63;
+  md = (u&sd)+(v&se);
+  me = (q&sd)+(r&se);
+  cd = (int128)u*d[0]+(int128)v*e[0];
+  ce = (int128)q*d[0]+(int128)r*e[0];
+  md -= (int64_t)((pInv62*(uint64_t)cd+(uint64_t)md)&SG_M62);  /* t*[d;e]+p*[md;me] = 0 mod 2^62 */
+  me -= (int64_t)((pInv62*(uint64_t)ce+(uint64_t)me)&SG_M62);
+  cd += (int128)p[0]*md;
+  ce += (int128)p[0]*me;
+  cd >>= 62;
+  ce >>= 62;
+  for (i=1;i<nlimbs;i++)
+  {
+    cd += (int128)u*d[i]+(int128)v*e[i]+(int128)p[i]*md;
+    ce += (int128)q*d[i]+(int128)r*e[i]+(int128)p[i]*me;
+    d[i-1] = (int64_t)((uint64_t)cd&SG_M62);
+    e[i-1] = (int64_t)((uint64_t)ce&SG_M62);
+    cd >>= 62;
+    ce >>= 62;
+  }
+  d[nlimbs-1] = (int64_t)cd;
+  e[nlimbs-1] = (int64_t)ce;
+}
+
+void sgUpdateFG(int64_t* f,int64_t* g,int64_t* t,int nlimbs)
+/* It calculates [f;g] = t*[f;g]/2^62
+   Always the same number of operations
+*/
+{
+  int64_t u = t[0], v = t[1], q = t[2], r = t[3];
+  int128 cf,cg;
+  int i;
+
+  cf = (int128)u*f[0]+(int128)v*g[0];
+  cg = (int128)q*f[0]+(int128)r*g[0];
+  cf >>= 62;                                   /* the 62 less significant bits are 0       */
+  cg >>= 62;
+  for (i=1;i<nlimbs;i++)
+  {
+    cf += (int128)u*f[i]+(int128)v*g[i];
+    cg += (int128)q*f[i]+(int128)r*g[i];
+    f[i-1] = (int64_t)((uint64_t)cf&SG_M62);
+    g[i-1] = (int64_t)((uint64_t)cg&SG_M62);
+    cf >>= 62;
+    cg >>= 62;
+  }
+  f[nlimbs-1] = (int64_t)cf;
+  g[nlimbs-1] = (int64_t)cg;
+}
+
+void sgCarry(int64_t* r,int nlimbs)
+/* It propagates the carries of r, the limbs except the last in [0,2^62) */
+{
+  int i;
+
+  for (i=0;i<nlimbs-1;i++)
+  {
+    r[i+1] += r[i]>>62;
+    r[i] &= SG_M62;
+  }
+}
+
+void sgNormalize(int64_t* r,int64_t sign,int64_t* p,int nlimbs)
+/* It calculates r = r mod p in [0,p) with -2p < r < p, negated if sign < 0
+   Always the same number of operations
+*/
+{
+  int64_t m;
+  int i;
+
+  m = r[nlimbs-1]>>63;                         /* r < 0: r = r + p, -p < r < p              */
+  for (i=0;i<nlimbs;i++)
+  {
+    r[i] += p[i]&m;
+  }
+  sgCarry(r,nlimbs);
+  m = sign>>63;                                /* sign < 0: r = -r                          */
+  for (i=0;i<nlimbs;i++)
+  {
+    r[i] = (r[i]^m)-m;
+  }
+  sgCarry(r,nlimbs);
+  m = r[nlimbs-1]>>63;                         /* r < 0: r = r + p, 0 <= r < p              */
+  for (i=0;i<nlimbs;i++)
+  {
+    r[i] += p[i]&m;
+  }
+  sgCarry(r,nlimbs);
+}
+
+void coordInvSafegcd(coord c,coord a,ellipticCurve* curve)
+/* It calculates c = inv(a) mod p with a < p, with the constant-time safegcd algorithm
+   of Bernstein and Yang (divsteps), in batches of 62 divsteps on limbs of 62 bits
+   The number of divsteps is the bound floor((49*d+80)/17) for d = bits of p,
+   rounded up to a multiple of 62
+   The integer aR (a in Montgomery form) is inverted and c = (aR)^-1 * R^2 = a^-1 * R
+   a and c are in Montgomery form
+   Always the same number of operations
+*/
+{
+  int64_t d[SG_LIMBS],e[SG_LIMBS],f[SG_LIMBS],g[SG_LIMBS],p[SG_LIMBS];
+  int64_t t[4];
+  int64_t delta = 1;
+  uint64_t pInv62;
+  coord r3;
+  int i,nlimbs,nbatch;
+  int nwords = curve->wsize;
+
+  NAXOS_COUNT(inv,1);
+  nlimbs = curve->bsize/62+2;
+  nbatch = ((49*curve->bsize+80)/17+61)/62;
+  pInv62 = (0-curve->pInv)&SG_M62;             /* p^-1 mod 2^62                            */
+
+  sgFromCoord(p,curve->p,nwords,nlimbs);
+  sgFromCoord(f,curve->p,nwords,nlimbs);       /* f = p                                    */
+  sgFromCoord(g,a,nwords,nlimbs);              /* g = a                                    */
+  for (i=0;i<nlimbs;i++)
+  {
+    d[i] = 0;                                  /* d = 0, e = 1: d*a = f, e*a = g mod p     */
+    e[i] = 0;
+  }
+  e[0] = 1;
+
+  for (i=0;i<nbatch;i++)
+  {
+    delta = sgDivsteps(delta,(uint64_t)f[0],(uint64_t)g[0],t);
+    sgUpdateDE(d,e,t,p,pInv62,nlimbs);
+    sgUpdateFG(f,g,t,nlimbs);
+  }
+  sgNormalize(d,f[nlimbs-1],p,nlimbs);         /* g = 0, f = +-1: inv(a) = +-d              */
+  sgToCoord(c,d,nwords,nlimbs);
+
+  coordMul(r3,curve->r2,curve->r2,curve);      /* r3 = R^3 mod p                            */
+  coordMul(c,c,r3,curve);                      /* c = (aR)^-1 * R^3 * R^-1 = a^-1 * R       */
+
+  naxosWipe(d,sizeof(d));                      /* Clear d, e, f, g                          */
+  naxosWipe(e,sizeof(e));
+  naxosWipe(f,sizeof(f));
+  naxosWipe(g,sizeof(g));
 }
+#define INV_DEFAULT coordInvSafegcd
+#else
+#define INV_DEFAULT coordInvML
+#endif
 
-void cProjToAffine(pointA* aA,pointP* bP,coord p,int nwords)
+#ifndef NAXOS_WBITS
+#define NAXOS_WBITS 4     /* Default window of scalarMult (0 = Montgomery ladder), see selectScalarMult */
+#endif
+
+void coordInv(coord c,coord a,ellipticCurve* curve)
+/* It calculates c = inv(a) mod p with the inversion of the curve, see selectInversion */
+{
+  curve->inv(c,a,curve);
+}
+
+int selectInversion(ellipticCurve* curve,int backend)
+/* It selects the inversion of the curve, see Naxos.h */
+{
+  switch(backend)
+  {
+    case INV_FERMAT:
+      curve->inv = coordInvML;
+      return 1;
+
+    case INV_SAFEGCD:
+#if defined(__SIZEOF_INT128__)
+      curve->inv = coordInvSafegcd;
+      return 1;
+#else
+      return -1;
+#endif
+  }
+  return -1;
+}
+
+void cProjToAffine(pointA* aA,pointP* bP,ellipticCurve* curve)
 /* It converts point bP with Projective coordinates in point aA in Affine coordinates */
 {
   coord d;
 
-  coordInvML(d,bP->pZ,p,nwords);             /* d = 1/bP->pZ                                */
-  coordMul(aA->aY,d,d,p,nwords);             /* aA->aY = d*d                                */
-  coordMul(aA->aX,aA->aY,bP->pX,p,nwords);   /* aA->aX = aA->aY*bP->pX = bP->pX /(bP->Pz)^2 */
-  coordMul(aA->aY,aA->aY,d,p,nwords);        /* aA->aY = d*d*d                              */
-  coordMul(aA->aY,aA->aY,bP->pY,p,nwords);   /* aA->aY = aA->aY*bP->pY = bP->pY /(bP->Pz)^3 */
+  coordInv(d,bP->pZ,curve);                  /* d = 1/bP->pZ                                */
+  coordMul(aA->aY,d,d,curve);                /* aA->aY = d*d                                */
+  coordMul(aA->aX,aA->aY,bP->pX,curve);      /* aA->aX = aA->aY*bP->pX = bP->pX /(bP->Pz)^2 */
+  coordMul(aA->aY,aA->aY,d,curve);           /* aA->aY = d*d*d                              */
+  coordMul(aA->aY,aA->aY,bP->pY,curve);      /* aA->aY = aA->aY*bP->pY = bP->pY /(bP->Pz)^3 */
 
-  coordInit(d);                              /* Clear d                                     */
+  naxosWipe(d,COORD_BYTES);                  /* Clear d                                     */
 }
 
 void cAffineToProj(pointP* aP, pointA* bA,int nwords)
@@ -453,7 +1016,7 @@ void copyPointP(pointP* aP, pointP* bP)
   coordCopy(aP->pZ,bP->pZ);           /* aP->pY = bP->pY */
 }
 
-int aIsOnCurve(pointA* aA,coord a,coord b,coord p,int nwords)
+int aIsOnCurve(pointA* aA,ellipticCurve* curve)
 /* It checks that the point in Affine coordinates is on the curve
    It must verify the curve equation y^2 = x^3 -ax + b mod p
    It returns:
@@ -462,13 +1025,17 @@ int aIsOnCurve(pointA* aA,coord a,coord b,coord p,int nwords)
 */
 {
   coord t1,t2;
-
-  coordMul(t1,aA->aX,aA->aX,p,nwords);   /* t1 = x^2 mod p       */
-  coordMul(t1,t1,aA->aX,p,nwords);       /* t1 = x^3 mod p       */
-  coordMul(t2,aA->aX,a,p,nwords);        /* t2 = ax mod p        */
+  uint64_t *a = curve->a;
+  uint64_t *b = curve->b;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordMul(t1,aA->aX,aA->aX,curve);      /* t1 = x^2 mod p       */
+  coordMul(t1,t1,aA->aX,curve);          /* t1 = x^3 mod p       */
+  coordMul(t2,aA->aX,a,curve);           /* t2 = ax mod p        */
   coordSub(t1,t1,t2,p,nwords);           /* t1 = t1 - t2 mod p   */
   coordAdd(t1,t1,b,p,nwords);            /* t1 = t1 + b mod p    */
-  coordMul(t2,aA->aY,aA->aY,p,nwords);   /* t2 = y^2 mod p       */
+  coordMul(t2,aA->aY,aA->aY,curve);      /* t2 = y^2 mod p       */
   if (coordCmp(t1,t2,nwords)==0)
   {
   	return 1;                            /* the equation is verified     */
@@ -479,7 +1046,36 @@ int aIsOnCurve(pointA* aA,coord a,coord b,coord p,int nwords)
   }
 }
 
-void doubleU(pointP* Q,pointP* R,pointP* P,coord a,coord p,int nwords)
+int pIsOnCurve(pointP* P,ellipticCurve* curve)
+/* It checks that the point in Projective coordinates is on the curve, without its Affine y:
+   it must verify the curve equation Y^2 = X^3 - aXZ^4 + bZ^6 mod p
+   It returns:
+     1 if P is on the curve
+    -1 if P is not on the curve
+*/
+{
+  coord t1,t2,z2,z4;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordMul(z2,P->pZ,P->pZ,curve);        /* z2 = Z^2             */
+  coordMul(z4,z2,z2,curve);              /* z4 = Z^4             */
+  coordMul(t1,P->pX,P->pX,curve);        /* t1 = X^2             */
+  coordMul(t1,t1,P->pX,curve);           /* t1 = X^3             */
+  coordMul(t2,P->pX,curve->a,curve);
+  coordMul(t2,t2,z4,curve);              /* t2 = aXZ^4           */
+  coordSub(t1,t1,t2,p,nwords);
+  coordMul(z4,z4,z2,curve);              /* z4 = Z^6             */
+  coordMul(t2,curve->b,z4,curve);        /* t2 = bZ^6            */
+  coordAdd(t1,t1,t2,p,nwords);           /* t1 = X^3 - aXZ^4 + bZ^6 */
+  coordMul(t2,P->pY,P->pY,curve);        /* t2 = Y^2             */
+  return (coordCmp(t1,t2,nwords) == 0)?1:-1;
+}
+
+/* The field kernels, the point kernels below and the functions that call them clear their secret
+   temporaries with naxosWipe before returning, see NaxosArena.h */
+
+void doubleU(pointP* Q,pointP* R,pointP* P,ellipticCurve* curve)
 /* Co-Z initial point doubling. Ch. 4.3
    It calculates Q=2P and R=(d*d*Px1:d*d*d*PY1:d) with input P with Z1=1
    and resulting R and Q same Z3
@@ -487,25 +1083,28 @@ void doubleU(pointP* Q,pointP* R,pointP* P,coord a,coord p,int nwords)
 */
 {
   coord t1,t2,t3,t4,t5,t6,t7,t8;
+  uint64_t *a = curve->a;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
 
   coordCopy(t1,P->pX);            /* t1 = X1                                    */
   coordCopy(t2,P->pY);            /* t2 = Y1                                    */
-  coordMul(t3,t1,t1,p,nwords);    /* t3 = t1 * t1; B = X1^2                     */
+  coordMul(t3,t1,t1,curve);       /* t3 = t1 * t1; B = X1^2                     */
   coordDouble(t4,t3,p,nwords);
   coordAdd(t4,t4,t3,p,nwords);    /* t4 = 3 * t3;  3B                           */
   coordSub(t4,t4,a,p,nwords);     /* t4 = t4 - a;  M = 3B - a (original formula with "-" because of negative representation of a) */
-  coordMul(t5,t2,t2,p,nwords);    /* t5 = t2 * t2; E = Y1^2                     */
-  coordMul(t6,t5,t5,p,nwords);    /* t6 = t5 * t5; L = E^2                      */
+  coordMul(t5,t2,t2,curve);       /* t5 = t2 * t2; E = Y1^2                     */
+  coordMul(t6,t5,t5,curve);       /* t6 = t5 * t5; L = E^2                      */
   coordAdd(t7,t1,t5,p,nwords);    /* t7 = t1 + t5; X1 + E                       */
-  coordMul(t7,t7,t7,p,nwords);    /* t7 = t7 * t7; (X1 + E)^2                   */
+  coordMul(t7,t7,t7,curve);       /* t7 = t7 * t7; (X1 + E)^2                   */
   coordSub(t7,t7,t3,p,nwords);    /* t7 = t7 - t3; (X1 + E)^2 - B               */
   coordSub(t7,t7,t6,p,nwords);    /* t7 = t7 - t6; (X1 + E)^2 - B - L           */
   coordDouble(t7,t7,p,nwords);    /* t7 = 2 * t7;  S = 2((X1 + E)^2 - B - L)    */
-  coordMul(t3,t4,t4,p,nwords);    /* t3 = t4 * t4; M^2                          */
+  coordMul(t3,t4,t4,curve);       /* t3 = t4 * t4; M^2                          */
   coordDouble(t8,t7,p,nwords);    /* t8 = 2 * t7;  2S                           */
   coordSub(t3,t3,t8,p,nwords);    /* t3 = t3 - t8; X(2P) = M^2 - 2S             */
   coordSub(t8,t7,t3,p,nwords);    /* t8 = t7 - t3; S - X(2P)                    */
-  coordMul(t8,t4,t8,p,nwords);    /* t8 = t4 * t8; M * (S - X(2P))              */
+  coordMul(t8,t4,t8,curve);       /* t8 = t4 * t8; M * (S - X(2P))              */
   coordDouble(t4,t6,p,nwords);
   coordDouble(t4,t4,p,nwords);
   coordDouble(t4,t4,p,nwords);    /* t4 = 8 * t6;  Y(P) = 8L                    */
@@ -513,7 +1112,7 @@ void doubleU(pointP* Q,pointP* R,pointP* P,coord a,coord p,int nwords)
   coordDouble(t6,t2,p,nwords);    /* t6 = 2 * t2;  Z(2P) = Z(P) = 2Y1           */
   coordDouble(t1,t1,p,nwords);
   coordDouble(t1,t1,p,nwords);    /* t1 = 4 * t1;  4X1                          */
-  coordMul(t1,t1,t5,p,nwords);    /* t1 = t1 * t5; X(P)= 4X1 * E                */
+  coordMul(t1,t1,t5,curve);       /* t1 = t1 * t5; X(P)= 4X1 * E                */
 
   coordCopy(Q->pX,t3);            /* QX = M^2 - 2S                              */
   coordCopy(Q->pY,t8);            /* QY = M * (S - X(2P)) - 8L                  */
@@ -522,20 +1121,25 @@ void doubleU(pointP* Q,pointP* R,pointP* P,coord a,coord p,int nwords)
   coordCopy(R->pY,t4);            /* RY = 8L                                    */
   coordCopy(R->pZ,t6);            /* RZ = 2Y1                                   */
 
-  coordInit(t1);                  /* Clear t1                                   */
-  coordInit(t3);                  /* Clear t3                                   */
-  coordInit(t4);                  /* Clear t4                                   */
-  coordInit(t6);                  /* Clear t6                                   */
-  coordInit(t8);                  /* Clear t8                                   */
+  naxosWipe(t1,sizeof(t1));       /* Clear t1                                   */
+  naxosWipe(t2,sizeof(t2));       /* Clear t2                                   */
+  naxosWipe(t3,sizeof(t3));       /* Clear t3                                   */
+  naxosWipe(t4,sizeof(t4));       /* Clear t4                                   */
+  naxosWipe(t5,sizeof(t5));       /* Clear t5                                   */
+  naxosWipe(t6,sizeof(t6));       /* Clear t6                                   */
+  naxosWipe(t7,sizeof(t7));       /* Clear t7                                   */
+  naxosWipe(t8,sizeof(t8));       /* Clear t8                                   */
 }
 
-void zAddC(pointP* R,pointP* S,pointP* P,pointP* Q,coord p,int nwords)
+void zAddC(pointP* R,pointP* S,pointP* P,pointP* Q,ellipticCurve* curve)
 /* Algorithm 12, Conjugate co-Z point addition (register allocation).
    It calculates R=P+Q and S=P-Q with input P and Q same Z and resulting R and S same Z3
    Always the same number of operations
 */
 {
   coord t1, t2, t3, t4, t5, t6, t7;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
 
   coordCopy(t1,P->pX);           /* t1 = X1           */
   coordCopy(t2,P->pY);           /* t2 = Y1           */
@@ -544,29 +1148,29 @@ void zAddC(pointP* R,pointP* S,pointP* P,pointP* Q,coord p,int nwords)
   coordCopy(t5,Q->pY);           /* t5 = Y2           */
 
   coordSub(t6,t1,t4,p,nwords);   /* t6 = t1 - t4      */
-  coordMul(t3,t3,t6,p,nwords);   /* t3 = t3 * t6      */
-  coordMul(t6,t6,t6,p,nwords);   /* t6 = t6 * t6      */
-  coordMul(t7,t1,t6,p,nwords);   /* t7 = t1 * t6      */
-  coordMul(t6,t6,t4,p,nwords);   /* t6 = t6 * t4      */
+  coordMul(t3,t3,t6,curve);      /* t3 = t3 * t6      */
+  coordMul(t6,t6,t6,curve);      /* t6 = t6 * t6      */
+  coordMul(t7,t1,t6,curve);      /* t7 = t1 * t6      */
+  coordMul(t6,t6,t4,curve);      /* t6 = t6 * t4      */
   coordAdd(t1,t2,t5,p,nwords);   /* t1 = t2 + t5      */
-  coordMul(t4,t1,t1,p,nwords);   /* t4 = t1 * t1      */
+  coordMul(t4,t1,t1,curve);      /* t4 = t1 * t1      */
   coordSub(t4,t4,t7,p,nwords);   /* t4 = t4 - t7      */
   coordSub(t4,t4,t6,p,nwords);   /* t4 = t4 - t6      */
   coordSub(t1,t2,t5,p,nwords);   /* t1 = t2 - t5      */
-  coordMul(t1,t1,t1,p,nwords);   /* t1 = t1 * t1      */
+  coordMul(t1,t1,t1,curve);      /* t1 = t1 * t1      */
   coordSub(t1,t1,t7,p,nwords);   /* t1 = t1 - t7      */
   coordSub(t1,t1,t6,p,nwords);   /* t1 = t1 - t6      */
   coordSub(t6,t6,t7,p,nwords);   /* t6 = t6 - t7      */
-  coordMul(t6,t6,t2,p,nwords);   /* t6 = t6 * t2      */
+  coordMul(t6,t6,t2,curve);      /* t6 = t6 * t2      */
   coordSub(t2,t2,t5,p,nwords);   /* t2 = t2 - t5      */
   coordDouble(t5,t5,p,nwords);   /* t5 = 2 * t5       */
   coordAdd(t5,t2,t5,p,nwords);   /* t5 = t2 + t5      */
   coordSub(t7,t7,t4,p,nwords);   /* t7 = t7 - t4      */
-  coordMul(t5,t5,t7,p,nwords);   /* t5 = t5 * t7      */
+  coordMul(t5,t5,t7,curve);      /* t5 = t5 * t7      */
   coordAdd(t5,t5,t6,p,nwords);   /* t5 = (t5 + t6)    */
   coordAdd(t7,t4,t7,p,nwords);   /* t7 = t4 + t7      */
   coordSub(t7,t7,t1,p,nwords);   /* t7 = t7 - t1      */
-  coordMul(t2,t2,t7,p,nwords);   /* t2 = t2 * t7      */
+  coordMul(t2,t2,t7,curve);      /* t2 = t2 * t7      */
   coordAdd(t2,t2,t6,p,nwords);   /* t2 = (t2 + t6)    */
 
   coordCopy(R->pX,t1);           /* RX = t1           */
@@ -576,14 +1180,16 @@ void zAddC(pointP* R,pointP* S,pointP* P,pointP* Q,coord p,int nwords)
   coordCopy(S->pY,t5);           /* SY = t5           */
   coordCopy(S->pZ,t3);           /* SZ = t3           */
 
-  coordInit(t1);                 /* Clear t1          */
-  coordInit(t2);                 /* Clear t2          */
-  coordInit(t3);                 /* Clear t3          */
-  coordInit(t4);                 /* Clear t4          */
-  coordInit(t5);                 /* Clear t5          */
+  naxosWipe(t1,sizeof(t1));      /* Clear t1          */
+  naxosWipe(t2,sizeof(t2));      /* Clear t2          */
+  naxosWipe(t3,sizeof(t3));      /* Clear t3          */
+  naxosWipe(t4,sizeof(t4));      /* Clear t4          */
+  naxosWipe(t5,sizeof(t5));      /* Clear t5          */
+  naxosWipe(t6,sizeof(t6));      /* Clear t6          */
+  naxosWipe(t7,sizeof(t7));      /* Clear t7          */
 }
 
-void zAddU(pointP* R,pointP* P2,pointP* P,pointP* Q,coord p,int nwords)
+void zAddU(pointP* R,pointP* P2,pointP* P,pointP* Q,ellipticCurve* curve)
 /* Algorithm 11 Co-Z point addition with update (register allocation)
    It calculates R=P+Q and P2=(d*d*Px1:d*d*dPY1:d*PZ1) with input P and Q
    same Z1 and resulting R and P2 same Z3
@@ -591,6 +1197,8 @@ void zAddU(pointP* R,pointP* P2,pointP* P,pointP* Q,coord p,int nwords)
 */
 {
   coord t1, t2, t3, t4, t5, t6;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
 
   coordCopy(t1,P->pX);           /* t1 = X1           */
   coordCopy(t2,P->pY);           /* t2 = Y1           */
@@ -599,18 +1207,18 @@ void zAddU(pointP* R,pointP* P2,pointP* P,pointP* Q,coord p,int nwords)
   coordCopy(t5,Q->pY);           /* t5 = Y2           */
 
   coordSub(t6,t1,t4,p,nwords);   /* t6 = t1 - t4      */
-  coordMul(t3,t3,t6,p,nwords);   /* t3 = t3 * t6      */
-  coordMul(t6,t6,t6,p,nwords);   /* t6 = t6 ** 2      */
-  coordMul(t1,t1,t6,p,nwords);   /* t1 = t1 * t6      */
-  coordMul(t6,t6,t4,p,nwords);   /* t6 = t6 * t4      */
+  coordMul(t3,t3,t6,curve);      /* t3 = t3 * t6      */
+  coordMul(t6,t6,t6,curve);      /* t6 = t6 ** 2      */
+  coordMul(t1,t1,t6,curve);      /* t1 = t1 * t6      */
+  coordMul(t6,t6,t4,curve);      /* t6 = t6 * t4      */
   coordSub(t5,t2,t5,p,nwords);   /* t5 = t2 - t5      */
-  coordMul(t4,t5,t5,p,nwords);   /* t4 = t5 ** 2      */
+  coordMul(t4,t5,t5,curve);      /* t4 = t5 ** 2      */
   coordSub(t4,t4,t1,p,nwords);   /* t4 = t4 - t1      */
   coordSub(t4,t4,t6,p,nwords);   /* t4 = t4 - t6      */
   coordSub(t6,t1,t6,p,nwords);   /* t6 = t1 - t6      */
-  coordMul(t2,t2,t6,p,nwords);   /* t2 = t2 * t6      */
+  coordMul(t2,t2,t6,curve);      /* t2 = t2 * t6      */
   coordSub(t6,t1,t4,p,nwords);   /* t6 = t1 - t4      */
-  coordMul(t5,t5,t6,p,nwords);   /* t5 = t5 * t6      */
+  coordMul(t5,t5,t6,curve);      /* t5 = t5 * t6      */
   coordSub(t5,t5,t2,p,nwords);   /* t5 = t5 - t2      */
 
   coordCopy(R->pX,t4);           /* RX  = t4          */
@@ -620,721 +1228,3072 @@ void zAddU(pointP* R,pointP* P2,pointP* P,pointP* Q,coord p,int nwords)
   coordCopy(P2->pY,t2);          /* P2Y = t2          */
   coordCopy(P2->pZ,t3);          /* P2Z = t3          */
 
-  coordInit(t1);                 /* Clear t1          */
-  coordInit(t2);                 /* Clear t2          */
-  coordInit(t3);                 /* Clear t3          */
-  coordInit(t4);                 /* Clear t4          */
-  coordInit(t5);                 /* Clear t5          */
-  coordInit(t6);                 /* Clear t6          */
+  naxosWipe(t1,sizeof(t1));      /* Clear t1          */
+  naxosWipe(t2,sizeof(t2));      /* Clear t2          */
+  naxosWipe(t3,sizeof(t3));      /* Clear t3          */
+  naxosWipe(t4,sizeof(t4));      /* Clear t4          */
+  naxosWipe(t5,sizeof(t5));      /* Clear t5          */
+  naxosWipe(t6,sizeof(t6));      /* Clear t6          */
 }
 
-void scalarMult(pointA* Q,coord k,pointA* P,coord a,coord p,int nwords)
-/* Algorithm 7, Montogomery ladder with co-Z addition formula for GF(p)
-   Input: P belonging to E(Fq) and k = (kn-1,...,k0)2 with kn-1=1 and k < p
-          P with Z=1 for initial DBLU
-   Output: Q = kP
+void zAddCXY(pointA* R,pointA* S,pointA* P,pointA* Q,ellipticCurve* curve)
+/* (X,Y)-only conjugate co-Z point addition, zAddC without the Z coordinate.
+   It calculates R=P+Q and S=P-Q with input P and Q same (implicit) Z
+   and resulting R and S same Z3 = Z*(X1-X2), which is not calculated
+   The points are in Projective coordinates X, Y with the Z omitted, in pointA
    Always the same number of operations
 */
 {
-  pointP R0,R1;
-  pointP S0,S1;                          /* Needed to maintain the same number of operations               */
-  int i, n, b;
-  int order;                             /* Needed to maintain the same number of operations               */
+  coord t1, t2, t4, t5, t6, t7;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
 
-  order = coordMaxBit(p,nwords);         /* Needed to maintain the same number of operations               */
-  n = coordMaxBit(k,nwords);             /* Calculates n                                                   */
-  coordCopy(R0.pX,P->aX);
-  coordCopy(R0.pY,P->aY);                /* R0=P                                                           */
-  doubleU(&R1,&R0,&R0,a,p,nwords);       /* (R1,R0)=DBLU(R0),i.e. R1=2R0 and R0=R0 with same Z and Z1=1    */
-  for (i=order-2;i>-1;i--)
-  {
-    b = coordGetBit(k,i);                /* b=ki                                                           */
-    if (i<n-1)
-    {
-      if (b == 0)
-      {
-        zAddC(&R1,&R0,&R0,&R1,p,nwords); /* (R1,R0) = ZADDC(R0,R1), i.e. calculate R1=R0+R1 and R0=R0-R1   */
-                                         /*   with input R0 and R1 same Z and resulting R0 and r1 same Z3  */
-        zAddU(&R0,&R1,&R1,&R0,p,nwords); /* (R0,R1) = ZADDU(R1,R0), i.e. R0=R1+R0 and R1=(d*d*R1x1:d*d*dR1Y1:d*R1Z1) */
-                                         /*   with input R1 and R0 same Z1 and resulting R0 and R1 same Z3 */
-      }
-      else
-      {
-        zAddC(&R0,&R1,&R1,&R0,p,nwords); /* (R0,R1) = ZADDC(R1,R0)                                         */
-        zAddU(&R1,&R0,&R0,&R1,p,nwords); /* (R1,R0) = ZADDU(R0,R1)                                         */
-      }
-    }
-    else                                 /* to maintain the same number of operations                      */
-    {
-      if (b == 0)
-      {
-        zAddC(&S1,&S0,&S0,&S1,p,nwords);
-        zAddU(&S0,&S1,&S1,&S0,p,nwords);
-      }
-      else
-      {
-        zAddC(&S0,&S1,&S1,&S0,p,nwords);
-        zAddU(&S1,&S0,&S0,&S1,p,nwords);
+  coordCopy(t1,P->aX);           /* t1 = X1           */
+  coordCopy(t2,P->aY);           /* t2 = Y1           */
+  coordCopy(t4,Q->aX);           /* t4 = X2           */
+  coordCopy(t5,Q->aY);           /* t5 = Y2           */
+
+  coordSub(t6,t1,t4,p,nwords);   /* t6 = t1 - t4      */
+  coordMul(t6,t6,t6,curve);      /* t6 = t6 * t6      */
+  coordMul(t7,t1,t6,curve);      /* t7 = t1 * t6      */
+  coordMul(t6,t6,t4,curve);      /* t6 = t6 * t4      */
+  coordAdd(t1,t2,t5,p,nwords);   /* t1 = t2 + t5      */
+  coordMul(t4,t1,t1,curve);      /* t4 = t1 * t1      */
+  coordSub(t4,t4,t7,p,nwords);   /* t4 = t4 - t7      */
+  coordSub(t4,t4,t6,p,nwords);   /* t4 = t4 - t6      */
+  coordSub(t1,t2,t5,p,nwords);   /* t1 = t2 - t5      */
+  coordMul(t1,t1,t1,curve);      /* t1 = t1 * t1      */
+  coordSub(t1,t1,t7,p,nwords);   /* t1 = t1 - t7      */
+  coordSub(t1,t1,t6,p,nwords);   /* t1 = t1 - t6      */
+  coordSub(t6,t6,t7,p,nwords);   /* t6 = t6 - t7      */
+  coordMul(t6,t6,t2,curve);      /* t6 = t6 * t2      */
+  coordSub(t2,t2,t5,p,nwords);   /* t2 = t2 - t5      */
+  coordDouble(t5,t5,p,nwords);   /* t5 = 2 * t5       */
+  coordAdd(t5,t2,t5,p,nwords);   /* t5 = t2 + t5      */
+  coordSub(t7,t7,t4,p,nwords);   /* t7 = t7 - t4      */
+  coordMul(t5,t5,t7,curve);      /* t5 = t5 * t7      */
+  coordAdd(t5,t5,t6,p,nwords);   /* t5 = (t5 + t6)    */
+  coordAdd(t7,t4,t7,p,nwords);   /* t7 = t4 + t7      */
+  coordSub(t7,t7,t1,p,nwords);   /* t7 = t7 - t1      */
+  coordMul(t2,t2,t7,curve);      /* t2 = t2 * t7      */
+  coordAdd(t2,t2,t6,p,nwords);   /* t2 = (t2 + t6)    */
+
+  coordCopy(R->aX,t1);           /* RX = t1           */
+  coordCopy(R->aY,t2);           /* RY = t2           */
+  coordCopy(S->aX,t4);           /* SX = t4           */
+  coordCopy(S->aY,t5);           /* SY = t5           */
+
+  naxosWipe(t1,sizeof(t1));      /* Clear t1          */
+  naxosWipe(t2,sizeof(t2));      /* Clear t2          */
+  naxosWipe(t4,sizeof(t4));      /* Clear t4          */
+  naxosWipe(t5,sizeof(t5));      /* Clear t5          */
+  naxosWipe(t6,sizeof(t6));      /* Clear t6          */
+  naxosWipe(t7,sizeof(t7));      /* Clear t7          */
+}
+
+void zAddUXY(pointA* R,pointA* P2,pointA* P,pointA* Q,ellipticCurve* curve)
+/* (X,Y)-only co-Z point addition with update, zAddU without the Z coordinate.
+   It calculates R=P+Q and P2=(d*d*Px1:d*d*dPY1) with input P and Q same (implicit) Z1
+   and resulting R and P2 same Z3 = Z1*(X1-X2), which is not calculated
+   Always the same number of operations
+*/
+{
+  coord t1, t2, t4, t5, t6;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordCopy(t1,P->aX);           /* t1 = X1           */
+  coordCopy(t2,P->aY);           /* t2 = Y1           */
+  coordCopy(t4,Q->aX);           /* t4 = X2           */
+  coordCopy(t5,Q->aY);           /* t5 = Y2           */
+
+  coordSub(t6,t1,t4,p,nwords);   /* t6 = t1 - t4      */
+  coordMul(t6,t6,t6,curve);      /* t6 = t6 ** 2      */
+  coordMul(t1,t1,t6,curve);      /* t1 = t1 * t6      */
+  coordMul(t6,t6,t4,curve);      /* t6 = t6 * t4      */
+  coordSub(t5,t2,t5,p,nwords);   /* t5 = t2 - t5      */
+  coordMul(t4,t5,t5,curve);      /* t4 = t5 ** 2      */
+  coordSub(t4,t4,t1,p,nwords);   /* t4 = t4 - t1      */
+  coordSub(t4,t4,t6,p,nwords);   /* t4 = t4 - t6      */
+  coordSub(t6,t1,t6,p,nwords);   /* t6 = t1 - t6      */
+  coordMul(t2,t2,t6,curve);      /* t2 = t2 * t6      */
+  coordSub(t6,t1,t4,p,nwords);   /* t6 = t1 - t4      */
+  coordMul(t5,t5,t6,curve);      /* t5 = t5 * t6      */
+  coordSub(t5,t5,t2,p,nwords);   /* t5 = t5 - t2      */
+
+  coordCopy(R->aX,t4);           /* RX  = t4          */
+  coordCopy(R->aY,t5);           /* RY  = t5          */
+  coordCopy(P2->aX,t1);          /* P2X = t1          */
+  coordCopy(P2->aY,t2);          /* P2Y = t2          */
+
+  naxosWipe(t1,sizeof(t1));      /* Clear t1          */
+  naxosWipe(t2,sizeof(t2));      /* Clear t2          */
+  naxosWipe(t4,sizeof(t4));      /* Clear t4          */
+  naxosWipe(t5,sizeof(t5));      /* Clear t5          */
+  naxosWipe(t6,sizeof(t6));      /* Clear t6          */
+}
+
+void scalarMultProj(pointP* Q,coord k,pointA* P,ellipticCurve* curve)
+/* Algorithm 7, Montogomery ladder with co-Z addition formula for GF(p)
+   Input: P belonging to E(Fq) and k = (kn-1,...,k0)2 with kn-1=1 and k < p
+          P with Z=1 for initial DBLU
+   Output: Q = kP in Projective coordinates
+   P and Q are in Montgomery form
+   Always the same number of operations
+*/
+{
+  pointP R0,R1;
+  pointP S0,S1;                          /* Needed to maintain the same number of operations               */
+  int i, n, b;
+  int order;                             /* Needed to maintain the same number of operations               */
+  int nwords = curve->wsize;
+
+  order = curve->pbits;                  /* Needed to maintain the same number of operations               */
+  n = coordMaxBit(k,nwords);             /* Calculates n                                                   */
+  coordCopy(R0.pX,P->aX);
+  coordCopy(R0.pY,P->aY);                /* R0=P                                                           */
+  doubleU(&R1,&R0,&R0,curve);            /* (R1,R0)=DBLU(R0),i.e. R1=2R0 and R0=R0 with same Z and Z1=1    */
+  for (i=order-2;i>-1;i--)
+  {
+    b = coordGetBit(k,i);                /* b=ki                                                           */
+    if (i<n-1)
+    {
+      if (b == 0)
+      {
+        zAddC(&R1,&R0,&R0,&R1,curve);        /* (R1,R0) = ZADDC(R0,R1), i.e. calculate R1=R0+R1 and R0=R0-R1   */
+                                         /*   with input R0 and R1 same Z and resulting R0 and r1 same Z3  */
+        zAddU(&R0,&R1,&R1,&R0,curve);        /* (R0,R1) = ZADDU(R1,R0), i.e. R0=R1+R0 and R1=(d*d*R1x1:d*d*dR1Y1:d*R1Z1) */
+                                         /*   with input R1 and R0 same Z1 and resulting R0 and R1 same Z3 */
+      }
+      else
+      {
+        zAddC(&R0,&R1,&R1,&R0,curve);        /* (R0,R1) = ZADDC(R1,R0)                                         */
+        zAddU(&R1,&R0,&R0,&R1,curve);        /* (R1,R0) = ZADDU(R0,R1)                                         */
+      }
+    }
+    else                                 /* to maintain the same number of operations                      */
+    {
+      if (b == 0)
+      {
+        zAddC(&S1,&S0,&S0,&S1,curve);       
+        zAddU(&S0,&S1,&S1,&S0,curve);       
+      }
+      else
+      {
+        zAddC(&S0,&S1,&S1,&S0,curve);       
+        zAddU(&S1,&S0,&S0,&S1,curve);       
+      }
+    }
+  }
+
+  copyPointP(Q,&R0);                     /* Q = R0                                                        */
+
+  naxosWipe(R0.pX,COORD_BYTES);          /* Clear R0.pX                                                   */
+  naxosWipe(R0.pY,COORD_BYTES);          /* Clear R0.pY                                                   */
+  naxosWipe(R0.pZ,COORD_BYTES);          /* Clear R0.pZ                                                   */
+  naxosWipe(R1.pX,COORD_BYTES);          /* Clear R1.pX                                                   */
+  naxosWipe(R1.pY,COORD_BYTES);          /* Clear R1.pY                                                   */
+  naxosWipe(R1.pZ,COORD_BYTES);          /* Clear R1.pZ                                                   */
+}
+
+void scalarMultWindowProj(pointP* Q,coord k,pointA* P,ellipticCurve* curve);  /* See below */
+
+void scalarMult(pointA* Q,coord k,pointA* P,ellipticCurve* curve)
+/* It calculates Q = kP with the Montgomery ladder (see scalarMultProj) or the fixed window
+   (see scalarMultWindowProj) selected for the curve, in Affine coordinates
+   P and Q are in Montgomery form
+   Always the same number of operations
+*/
+{
+  pointP R;
+
+  NAXOS_COUNT(smult,1);
+  if (curve->wbits != 0)
+  {
+    scalarMultWindowProj(&R,k,P,curve);  /* R = kP                                        */
+  }
+  else
+  {
+    scalarMultProj(&R,k,P,curve);        /* R = kP                                        */
+  }
+  cProjToAffine(Q,&R,curve);             /* Q = affine(R)                                 */
+
+  naxosWipe(R.pX,COORD_BYTES);           /* Clear R.pX                                    */
+  naxosWipe(R.pY,COORD_BYTES);           /* Clear R.pY                                    */
+  naxosWipe(R.pZ,COORD_BYTES);           /* Clear R.pZ                                    */
+}
+
+void coordSelect(coord c,coord a,uint64_t mask,int nwords)
+/* It sets c = a if mask is all ones, it leaves c unchanged if mask is 0
+   Always the same number of operations
+*/
+{
+  int i;
+
+  for (i=0;i<nwords;i++)
+  {
+    c[i] = (c[i] & ~mask) | (a[i] & mask);
+  }
+}
+
+void coordPow(coord c,coord a,coord e,ellipticCurve* curve)
+/* It calculates c = a^e mod p with the binary method, left to right
+   a and c are in Montgomery form, e is not
+   The exponent is public (it depends only on p): the operations depend only on e
+*/
+{
+  coord r;
+  int i;
+
+  coordCopy(r,curve->r1);                    /* r = 1 in Montgomery form                     */
+  for (i=coordMaxBit(e,curve->wsize)-1;i>-1;i--)
+  {
+    coordMul(r,r,r,curve);                   /* r = r^2                                      */
+    if (coordGetBit(e,i) == 1)
+    {
+      coordMul(r,r,a,curve);                 /* r = r*a                                      */
+    }
+  }
+  coordCopy(c,r);
+
+  naxosWipe(r,COORD_BYTES);                  /* Clear r                                      */
+}
+
+int curveSqrt(ellipticCurve* curve)
+/* It calculates the constants of coordSqrt for p = 1 mod 4, p - 1 = 2^s * q with q odd:
+     sqrtS = s
+     sqrtZ = z^q in Montgomery form, with z the smallest quadratic non-residue mod p
+   With p = 3 mod 4 they are not used and sqrtS = 1
+   Return:
+     1 = OK
+    -1 = no non-residue lower than SQRT_MAX_Z: p is not prime, or a prime with a large least
+         non-residue (a heuristic, not a primality test)
+*/
+{
+  coord e,z,m1,t;
+  int s,nwords = curve->wsize;
+
+  coordInit(curve->sqrtZ);
+  for (s=1;coordGetBit(curve->p,s) == 0;s++);  /* p - 1 = 2^s * q                            */
+  curve->sqrtS = s;
+  if (s == 1) return 1;                      /* p = 3 mod 4                                  */
+
+  coordHalf(e,curve->p,nwords);              /* e = (p-1)/2, p is odd                        */
+  coordInit(m1);
+  coordSub(m1,m1,curve->r1,curve->p,nwords); /* m1 = -1 in Montgomery form                   */
+  coordInit(z);
+  z[0] = 1;
+  do                                         /* Euler: z^((p-1)/2) = -1 iff z is a non-residue */
+  {
+    z[0]++;
+    if (z[0] > SQRT_MAX_Z) return -1;        /* half of the numbers are non-residues if p is prime */
+    coordToMont(t,z,curve);
+    coordPow(t,t,e,curve);
+  } while (coordCmp(t,m1,nwords) != 0);
+
+  coordToMont(t,z,curve);
+  coordCopy(e,curve->p);
+  for (;s>0;s--)
+  {
+    coordHalf(e,e,nwords);                   /* e = p >> s = q                               */
+  }
+  coordPow(curve->sqrtZ,t,e,curve);          /* sqrtZ = z^q                                  */
+
+  naxosWipe(t,COORD_BYTES);                  /* Clear t                                      */
+  return 1;
+}
+
+int coordSqrt(coord c,coord a,ellipticCurve* curve)
+/* It calculates c = sqrt(a) mod p, a and c in Montgomery form
+     p = 3 mod 4 (P-192, P-256, P-384, P-521): c = a^((p+1)/4)
+     p = 1 mod 4 (P-224, s = 96): constant-time Tonelli-Shanks (RFC 9380, I.4),
+     with p - 1 = 2^s * q and the constants of curveSqrt
+   The square root found is checked, so a non-residue a is detected
+   Always the same number of operations
+   Return:
+     1 = OK, c^2 = a
+    -1 = a is not a square mod p
+*/
+{
+  coord e,z,t,b,g,u;
+  int i,j,res;
+  int nwords = curve->wsize;
+  uint64_t mask;
+
+  coordInit(u);
+  u[0] = 1;
+  if (curve->sqrtS == 1)
+  {
+    coordHalf(e,curve->p,nwords);
+    coordHalf(e,e,nwords);                   /* e = (p-3)/4                                  */
+    coordAdd(e,e,u,curve->p,nwords);         /* e = (p+1)/4                                  */
+    coordPow(z,a,e,curve);                   /* z = a^((p+1)/4)                              */
+  }
+  else
+  {
+    coordCopy(e,curve->p);
+    for (i=0;i<=curve->sqrtS;i++)
+    {
+      coordHalf(e,e,nwords);                 /* e = (q-1)/2 = p >> (s+1)                     */
+    }
+    coordPow(z,a,e,curve);                   /* z = a^((q-1)/2)                              */
+    coordMul(t,z,z,curve);
+    coordMul(t,t,a,curve);                   /* t = a^q                                      */
+    coordMul(z,z,a,curve);                   /* z = a^((q+1)/2)                              */
+    coordCopy(b,t);
+    coordCopy(g,curve->sqrtZ);               /* g = z^q, order 2^s                           */
+    for (i=curve->sqrtS;i>1;i--)
+    {
+      for (j=1;j<i-1;j++)
+      {
+        coordMul(b,b,b,curve);               /* b = t^(2^(i-2))                              */
+      }
+      mask = ((uint64_t)0)-(uint64_t)(coordCmp(b,curve->r1,nwords) != 0);  /* all ones if b != 1 */
+      coordMul(u,z,g,curve);
+      coordSelect(z,u,mask,nwords);          /* z = z*g if b != 1                            */
+      coordMul(g,g,g,curve);                 /* g = g^2                                      */
+      coordMul(u,t,g,curve);
+      coordSelect(t,u,mask,nwords);          /* t = t*g if b != 1                            */
+      coordCopy(b,t);
+    }
+  }
+
+  coordMul(u,z,z,curve);                     /* check z^2 = a                                */
+  res = (coordCmp(u,a,nwords) == 0)?1:-1;
+  coordCopy(c,z);
+
+  naxosWipe(z,COORD_BYTES);                  /* Clear z                                      */
+  naxosWipe(t,COORD_BYTES);                  /* Clear t                                      */
+  naxosWipe(b,COORD_BYTES);                  /* Clear b                                      */
+  naxosWipe(g,COORD_BYTES);                  /* Clear g                                      */
+  naxosWipe(u,COORD_BYTES);                  /* Clear u                                      */
+  return res;
+}
+
+int scalarMultX(pointA* Q,coord k,pointA* P,int withY,ellipticCurve* curve)
+/* Montgomery ladder with (X,Y)-only co-Z addition [2]: the common Z of R0 and R1 is never
+   calculated in the loop, 2 multiplications less per bit than scalarMultProj.
+   Since R1 - R0 = P, after the conjugate addition of the last bit b it is Rb = (-1)^(1-b)*P
+   and the final Z is recovered from the known P:
+     1/Z = (-1)^(1-b)*yP*Xb / (xP*Yb*(X(1-b) - Xb))
+   and Q.x = X0/Z^2, Q.y = Y0/Z^3
+   With a window selected for the curve (see selectScalarMult) Q is calculated by
+   scalarMultWindowProj instead
+   With withY = 0 only Q.x is returned (Q.y = 0), for the callers that use only x: since they
+   cannot check Q, Q is checked on the curve here (with pIsOnCurve before the conversion
+   in the window path, which then calculates only x)
+   Input: P belonging to E(Fq) and k < p; for k < 2 it returns Q = P as scalarMultProj
+   P and Q are in Montgomery form
+   Always the same number of operations
+   Return:
+     1 = OK
+    -4 = kP is not on the curve (only with withY = 0)
+    -5 = kP is the point at infinity
+*/
+{
+  pointP T0,T1;
+  pointA R0,R1,S0,S1;                    /* S0, S1 needed to maintain the same number of operations */
+  pointA *Rb,*Rc;                        /* Rb = R(b), Rc = R(1-b) of the last bit                  */
+  coord num,den,t;
+  uint64_t mask;
+  int i,n,b,order,res;
+  int nwords = curve->wsize;
+
+  NAXOS_COUNT(smult,1);
+  if (curve->wbits != 0)                 /* fixed window                                         */
+  {
+    scalarMultWindowProj(&T0,k,P,curve); /* T0 = kP                                              */
+    res = 1;
+    if (1 == coordIsZero(T0.pZ,nwords))  /* kP is the point at infinity                          */
+    {
+      res = -5;
+      coordCopy(T0.pZ,curve->r1);
+    }
+    else if ((withY == 0) && (pIsOnCurve(&T0,curve) != 1))
+    {
+      res = -4;                          /* kP is not on the curve                               */
+    }
+    if (withY)
+    {
+      cProjToAffine(Q,&T0,curve);
+    }
+    else
+    {
+      coordInv(t,T0.pZ,curve);
+      coordMul(t,t,t,curve);             /* t = 1/Z^2                                            */
+      coordMul(Q->aX,T0.pX,t,curve);     /* Q.x = X/Z^2                                          */
+      coordInit(Q->aY);                  /* Q.y = 0                                              */
+      naxosWipe(t,COORD_BYTES);          /* Clear t                                              */
+    }
+    naxosWipe(&T0,sizeof(pointP));       /* Clear T0                                             */
+    return res;
+  }
+
+  order = curve->pbits;
+  n = coordMaxBit(k,nwords);
+  coordCopy(T0.pX,P->aX);
+  coordCopy(T0.pY,P->aY);
+  doubleU(&T1,&T0,&T0,curve);            /* (R1,R0)=DBLU(P), with the same Z = 2yP              */
+  coordCopy(R0.aX,T0.pX);
+  coordCopy(R0.aY,T0.pY);
+  coordCopy(R1.aX,T1.pX);
+  coordCopy(R1.aY,T1.pY);
+  S0 = R0;
+  S1 = R1;
+  for (i=order-2;i>0;i--)
+  {
+    b = coordGetBit(k,i);                /* b=ki                                                */
+    if (i<n-1)
+    {
+      if (b == 0)
+      {
+        zAddCXY(&R1,&R0,&R0,&R1,curve);  /* (R1,R0) = ZADDC(R0,R1)                              */
+        zAddUXY(&R0,&R1,&R1,&R0,curve);  /* (R0,R1) = ZADDU(R1,R0)                              */
+      }
+      else
+      {
+        zAddCXY(&R0,&R1,&R1,&R0,curve);  /* (R0,R1) = ZADDC(R1,R0)                              */
+        zAddUXY(&R1,&R0,&R0,&R1,curve);  /* (R1,R0) = ZADDU(R0,R1)                              */
+      }
+    }
+    else                                 /* to maintain the same number of operations           */
+    {
+      if (b == 0)
+      {
+        zAddCXY(&S1,&S0,&S0,&S1,curve);
+        zAddUXY(&S0,&S1,&S1,&S0,curve);
+      }
+      else
+      {
+        zAddCXY(&S0,&S1,&S1,&S0,curve);
+        zAddUXY(&S1,&S0,&S0,&S1,curve);
+      }
+    }
+  }
+
+  b = coordGetBit(k,0);                  /* last bit, only if n > 1                              */
+  if (n<2)
+  {
+    Rb = (b == 0)?&S0:&S1;
+    Rc = (b == 0)?&S1:&S0;
+  }
+  else
+  {
+    Rb = (b == 0)?&R0:&R1;
+    Rc = (b == 0)?&R1:&R0;
+  }
+  zAddCXY(Rc,Rb,Rb,Rc,curve);            /* (Rc,Rb) = ZADDC(Rb,Rc), Rb = (-1)^(1-b)*P            */
+
+  coordMul(num,P->aY,Rb->aX,curve);      /* num = yP*Xb                                          */
+  coordInit(t);
+  coordSub(t,t,num,curve->p,nwords);     /* t = -yP*Xb                                           */
+  coordSelect(num,t,((uint64_t)b)-1,nwords);  /* num = (-1)^(1-b)*yP*Xb                          */
+  coordMul(den,P->aX,Rb->aY,curve);      /* den = xP*Yb                                          */
+  coordSub(t,Rc->aX,Rb->aX,curve->p,nwords);
+  coordMul(den,den,t,curve);             /* den = xP*Yb*(Xc - Xb)                                */
+
+  zAddUXY(Rb,Rc,Rc,Rb,curve);            /* (Rb,Rc) = ZADDU(Rc,Rb), R0 = kP                      */
+
+  res = 1;
+  if (1 == coordIsZero(den,nwords))      /* kP is the point at infinity                          */
+  {
+    res = -5;
+    coordCopy(den,curve->r1);
+  }
+  coordInv(t,den,curve);
+  coordMul(t,t,num,curve);               /* t = 1/Z                                              */
+  coordMul(den,t,t,curve);               /* den = 1/Z^2                                          */
+  coordMul(S0.aX,R0.aX,den,curve);       /* x = X0/Z^2                                           */
+  coordMul(den,den,t,curve);             /* den = 1/Z^3                                          */
+  coordMul(S0.aY,R0.aY,den,curve);       /* y = Y0/Z^3                                           */
+
+  mask = ((uint64_t)0)-(uint64_t)(n<2);  /* k < 2: Q = P                                         */
+  coordSelect(S0.aX,P->aX,mask,nwords);
+  coordSelect(S0.aY,P->aY,mask,nwords);
+  if (n<2) res = 1;
+  if ((withY == 0) && (res == 1) && (aIsOnCurve(&S0,curve) != 1))
+  {
+    res = -4;                            /* kP is not on the curve                               */
+  }
+  coordCopy(Q->aX,S0.aX);
+  coordInit(Q->aY);
+  if (withY)
+  {
+    coordCopy(Q->aY,S0.aY);
+  }
+
+  naxosWipe(num,COORD_BYTES);            /* Clear num, den, t                                    */
+  naxosWipe(den,COORD_BYTES);
+  naxosWipe(t,COORD_BYTES);
+  naxosWipe(&T0,sizeof(pointP));         /* Clear T0, T1, R0, R1, S0, S1                         */
+  naxosWipe(&T1,sizeof(pointP));
+  naxosWipe(&R0,sizeof(pointA));
+  naxosWipe(&R1,sizeof(pointA));
+  naxosWipe(&S0,sizeof(pointA));
+  naxosWipe(&S1,sizeof(pointA));
+  return res;
+}
+
+uint64_t addMixed(pointP* R,pointP* P,pointA* Q,ellipticCurve* curve)
+/* Algorithm 3.22 [1], Jacobian-affine point addition
+   It calculates R=P+Q with P in Jacobian coordinates and Q in Affine coordinates, R may be P
+   It returns an all ones mask if P = Q or P = -Q, i.e. when the formula does not hold
+   (doubling or point at infinity), otherwise 0
+   Always the same number of operations
+*/
+{
+  coord t1,t2,t3,t4;
+  uint64_t ex;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordMul(t1,P->pZ,P->pZ,curve);     /* t1 = Z1^2                                    */
+  coordMul(t2,t1,P->pZ,curve);        /* t2 = Z1^3                                    */
+  coordMul(t1,t1,Q->aX,curve);        /* t1 = x2*Z1^2                                 */
+  coordMul(t2,t2,Q->aY,curve);        /* t2 = y2*Z1^3                                 */
+  coordSub(t1,t1,P->pX,p,nwords);     /* t1 = H = x2*Z1^2 - X1                        */
+  coordSub(t2,t2,P->pY,p,nwords);     /* t2 = r = y2*Z1^3 - Y1                        */
+  ex = 0 - (uint64_t)coordIsZero(t1,nwords);  /* H = 0 if P = Q or P = -Q              */
+  coordMul(R->pZ,P->pZ,t1,curve);     /* Z3 = Z1*H                                    */
+  coordMul(t3,t1,t1,curve);           /* t3 = H^2                                     */
+  coordMul(t4,t3,t1,curve);           /* t4 = H^3                                     */
+  coordMul(t3,t3,P->pX,curve);        /* t3 = X1*H^2                                  */
+  coordDouble(t1,t3,p,nwords);        /* t1 = 2*X1*H^2                                */
+  coordMul(R->pX,t2,t2,curve);        /* X3 = r^2                                     */
+  coordSub(R->pX,R->pX,t1,p,nwords);  /* X3 = r^2 - 2*X1*H^2                          */
+  coordSub(R->pX,R->pX,t4,p,nwords);  /* X3 = r^2 - 2*X1*H^2 - H^3                    */
+  coordSub(t3,t3,R->pX,p,nwords);     /* t3 = X1*H^2 - X3                             */
+  coordMul(t3,t3,t2,curve);           /* t3 = r*(X1*H^2 - X3)                         */
+  coordMul(t4,t4,P->pY,curve);        /* t4 = Y1*H^3                                  */
+  coordSub(R->pY,t3,t4,p,nwords);     /* Y3 = r*(X1*H^2 - X3) - Y1*H^3                */
+
+  naxosWipe(t1,sizeof(t1));           /* Clear t1                                     */
+  naxosWipe(t2,sizeof(t2));           /* Clear t2                                     */
+  naxosWipe(t3,sizeof(t3));           /* Clear t3                                     */
+  naxosWipe(t4,sizeof(t4));           /* Clear t4                                     */
+
+  return ex;
+}
+
+void tableSelect(pointA* Q,const uint64_t* t,int m,int npoints,int nwords)
+/* It sets Q = the point m (1, ..., npoints) of the table t of Affine points, x followed by y,
+   or Q = (0,0) if m = 0
+   All the points of the table are read
+   Always the same number of operations
+*/
+{
+  int e,i;
+  uint64_t mask;
+
+  coordInit(Q->aX);
+  coordInit(Q->aY);
+  for (e=1;e<=npoints;e++)
+  {
+    mask = 0 - ((((uint64_t)(e ^ m)) - 1) >> BITS63); /* all ones if e = m, otherwise 0   */
+    for (i=0;i<nwords;i++)
+    {
+      Q->aX[i] = Q->aX[i] | (t[i] & mask);
+      Q->aY[i] = Q->aY[i] | (t[nwords+i] & mask);
+    }
+    t = t + 2*nwords;
+  }
+}
+
+void gTableSelect(pointA* Q,const uint64_t* t,int m,int nwords)
+/* It sets Q = m*B reading the window t = (1*B, ..., GTAB_NPOINTS*B) of the fixed-base table,
+   or Q = (0,0) if m = 0
+   All the points of the window are read
+   Always the same number of operations
+*/
+{
+  tableSelect(Q,t,m,GTAB_NPOINTS,nwords);
+}
+
+void doubleJ(pointP* R,pointP* P,ellipticCurve* curve)
+/* Point doubling in Jacobian coordinates, R = 2P, R may be P
+   M = 3*X1^2 - a*Z1^4, S = 4*X1*Y1^2
+   X3 = M^2 - 2S, Y3 = M*(S - X3) - 8*Y1^4, Z3 = 2*Y1*Z1
+   Always the same number of operations
+*/
+{
+  coord t1,t2,t3,t4;
+  uint64_t *a = curve->a;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordMul(t1,P->pY,P->pY,curve);     /* t1 = Y1^2                                    */
+  coordMul(t2,P->pX,t1,curve);
+  coordDouble(t2,t2,p,nwords);
+  coordDouble(t2,t2,p,nwords);        /* t2 = S = 4*X1*Y1^2                           */
+  coordMul(t1,t1,t1,curve);           /* t1 = Y1^4                                    */
+  coordMul(t3,P->pZ,P->pZ,curve);     /* t3 = Z1^2                                    */
+  coordMul(t3,t3,t3,curve);           /* t3 = Z1^4                                    */
+  coordMul(t3,t3,a,curve);            /* t3 = a*Z1^4                                  */
+  coordMul(t4,P->pX,P->pX,curve);     /* t4 = X1^2                                    */
+  coordSub(t3,t4,t3,p,nwords);
+  coordDouble(t4,t4,p,nwords);
+  coordAdd(t3,t3,t4,p,nwords);        /* t3 = M = 3*X1^2 - a*Z1^4                     */
+  coordMul(R->pZ,P->pY,P->pZ,curve);
+  coordDouble(R->pZ,R->pZ,p,nwords);  /* Z3 = 2*Y1*Z1                                 */
+  coordMul(R->pX,t3,t3,curve);        /* X3 = M^2                                     */
+  coordSub(R->pX,R->pX,t2,p,nwords);
+  coordSub(R->pX,R->pX,t2,p,nwords);  /* X3 = M^2 - 2S                                */
+  coordSub(t2,t2,R->pX,p,nwords);     /* t2 = S - X3                                  */
+  coordMul(t2,t3,t2,curve);           /* t2 = M*(S - X3)                              */
+  coordDouble(t1,t1,p,nwords);
+  coordDouble(t1,t1,p,nwords);
+  coordDouble(t1,t1,p,nwords);        /* t1 = 8*Y1^4                                  */
+  coordSub(R->pY,t2,t1,p,nwords);     /* Y3 = M*(S - X3) - 8*Y1^4                     */
+
+  naxosWipe(t1,sizeof(t1));           /* Clear t1                                     */
+  naxosWipe(t2,sizeof(t2));           /* Clear t2                                     */
+  naxosWipe(t3,sizeof(t3));           /* Clear t3                                     */
+  naxosWipe(t4,sizeof(t4));           /* Clear t4                                     */
+}
+
+void doubleJ3(pointP* R,pointP* P,ellipticCurve* curve)
+/* Point doubling in Jacobian coordinates for the curves with a = 3 (y^2 = x^3 - 3x + b),
+   R = 2P, R may be P. As doubleJ with M = 3*X1^2 - 3*Z1^4 = 3*(X1 - Z1^2)*(X1 + Z1^2),
+   2 multiplications less
+   Always the same number of operations
+*/
+{
+  coord t1,t2,t3,t4;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordMul(t1,P->pY,P->pY,curve);     /* t1 = Y1^2                                    */
+  coordMul(t2,P->pX,t1,curve);
+  coordDouble(t2,t2,p,nwords);
+  coordDouble(t2,t2,p,nwords);        /* t2 = S = 4*X1*Y1^2                           */
+  coordMul(t1,t1,t1,curve);           /* t1 = Y1^4                                    */
+  coordMul(t3,P->pZ,P->pZ,curve);     /* t3 = Z1^2                                    */
+  coordAdd(t4,P->pX,t3,p,nwords);     /* t4 = X1 + Z1^2                               */
+  coordSub(t3,P->pX,t3,p,nwords);     /* t3 = X1 - Z1^2                               */
+  coordMul(t3,t3,t4,curve);
+  coordDouble(t4,t3,p,nwords);
+  coordAdd(t3,t3,t4,p,nwords);        /* t3 = M = 3*(X1 - Z1^2)*(X1 + Z1^2)           */
+  coordMul(R->pZ,P->pY,P->pZ,curve);
+  coordDouble(R->pZ,R->pZ,p,nwords);  /* Z3 = 2*Y1*Z1                                 */
+  coordMul(R->pX,t3,t3,curve);        /* X3 = M^2                                     */
+  coordSub(R->pX,R->pX,t2,p,nwords);
+  coordSub(R->pX,R->pX,t2,p,nwords);  /* X3 = M^2 - 2S                                */
+  coordSub(t2,t2,R->pX,p,nwords);     /* t2 = S - X3                                  */
+  coordMul(t2,t3,t2,curve);           /* t2 = M*(S - X3)                              */
+  coordDouble(t1,t1,p,nwords);
+  coordDouble(t1,t1,p,nwords);
+  coordDouble(t1,t1,p,nwords);        /* t1 = 8*Y1^4                                  */
+  coordSub(R->pY,t2,t1,p,nwords);     /* Y3 = M*(S - X3) - 8*Y1^4                     */
+
+  naxosWipe(t1,sizeof(t1));           /* Clear t1                                     */
+  naxosWipe(t2,sizeof(t2));           /* Clear t2                                     */
+  naxosWipe(t3,sizeof(t3));           /* Clear t3                                     */
+  naxosWipe(t4,sizeof(t4));           /* Clear t4                                     */
+}
+
+void addJ(pointP* R,pointP* P,pointP* Q,ellipticCurve* curve)
+/* Point addition in Jacobian coordinates, R = P + Q with P != +-Q, R may be P or Q
+   U1 = X1*Z2^2, U2 = X2*Z1^2, S1 = Y1*Z2^3, S2 = Y2*Z1^3, H = U2 - U1, r = S2 - S1
+   X3 = r^2 - H^3 - 2*U1*H^2, Y3 = r*(U1*H^2 - X3) - S1*H^3, Z3 = Z1*Z2*H
+   Always the same number of operations
+*/
+{
+  coord t1,t2,t3,t4,t5,t6;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordMul(t1,Q->pZ,Q->pZ,curve);     /* t1 = Z2^2                                    */
+  coordMul(t2,t1,Q->pZ,curve);        /* t2 = Z2^3                                    */
+  coordMul(t1,t1,P->pX,curve);        /* t1 = U1 = X1*Z2^2                            */
+  coordMul(t2,t2,P->pY,curve);        /* t2 = S1 = Y1*Z2^3                            */
+  coordMul(t3,P->pZ,P->pZ,curve);     /* t3 = Z1^2                                    */
+  coordMul(t4,t3,P->pZ,curve);        /* t4 = Z1^3                                    */
+  coordMul(t3,t3,Q->pX,curve);        /* t3 = U2 = X2*Z1^2                            */
+  coordMul(t4,t4,Q->pY,curve);        /* t4 = S2 = Y2*Z1^3                            */
+  coordSub(t3,t3,t1,p,nwords);        /* t3 = H = U2 - U1                             */
+  coordSub(t4,t4,t2,p,nwords);        /* t4 = r = S2 - S1                             */
+  coordMul(t5,P->pZ,Q->pZ,curve);
+  coordMul(R->pZ,t5,t3,curve);        /* Z3 = Z1*Z2*H                                 */
+  coordMul(t5,t3,t3,curve);           /* t5 = H^2                                     */
+  coordMul(t6,t5,t3,curve);           /* t6 = H^3                                     */
+  coordMul(t5,t5,t1,curve);           /* t5 = U1*H^2                                  */
+  coordMul(R->pX,t4,t4,curve);        /* X3 = r^2                                     */
+  coordSub(R->pX,R->pX,t6,p,nwords);
+  coordSub(R->pX,R->pX,t5,p,nwords);
+  coordSub(R->pX,R->pX,t5,p,nwords);  /* X3 = r^2 - H^3 - 2*U1*H^2                    */
+  coordSub(t5,t5,R->pX,p,nwords);     /* t5 = U1*H^2 - X3                             */
+  coordMul(t5,t5,t4,curve);           /* t5 = r*(U1*H^2 - X3)                         */
+  coordMul(t6,t6,t2,curve);           /* t6 = S1*H^3                                  */
+  coordSub(R->pY,t5,t6,p,nwords);     /* Y3 = r*(U1*H^2 - X3) - S1*H^3                */
+
+  naxosWipe(t1,sizeof(t1));           /* Clear t1                                     */
+  naxosWipe(t2,sizeof(t2));           /* Clear t2                                     */
+  naxosWipe(t3,sizeof(t3));           /* Clear t3                                     */
+  naxosWipe(t4,sizeof(t4));           /* Clear t4                                     */
+  naxosWipe(t5,sizeof(t5));           /* Clear t5                                     */
+  naxosWipe(t6,sizeof(t6));           /* Clear t6                                     */
+}
+
+void cProjToAffineBatch(pointA* aA,pointP* bP,int n,ellipticCurve* curve)
+/* It converts the n points bP with Projective coordinates in the points aA in Affine coordinates
+   with only one inversion (Montgomery's simultaneous inversion):
+     c_i = Z_0*...*Z_i,  d = 1/c_(n-1)
+     1/Z_i = d*c_(i-1) and then d = d*Z_i, for i = n-1, ..., 1,  1/Z_0 = d
+   c_i is kept in aA[i].aX until x_i is calculated, so that no memory is allocated
+   All the Z must be different from 0, aA and bP must not overlap
+*/
+{
+  coord d,z,z2;
+  int i;
+
+  coordCopy(aA[0].aX,bP[0].pZ);
+  for (i=1;i<n;i++)
+  {
+    coordMul(aA[i].aX,aA[i-1].aX,bP[i].pZ,curve);  /* c_i = c_(i-1)*Z_i                     */
+  }
+  coordInv(d,aA[n-1].aX,curve);              /* d = 1/(Z_0*...*Z_(n-1))                     */
+  for (i=n-1;i>-1;i--)
+  {
+    if (i > 0)
+    {
+      coordMul(z,d,aA[i-1].aX,curve);        /* z = 1/Z_i                                   */
+      coordMul(d,d,bP[i].pZ,curve);          /* d = 1/(Z_0*...*Z_(i-1))                     */
+    }
+    else
+    {
+      coordCopy(z,d);                        /* z = 1/Z_0                                   */
+    }
+    coordMul(z2,z,z,curve);                  /* z2 = 1/Z_i^2                                */
+    coordMul(aA[i].aX,bP[i].pX,z2,curve);    /* x = X/Z^2, c_i no longer needed             */
+    coordMul(z2,z2,z,curve);                 /* z2 = 1/Z_i^3                                */
+    coordMul(aA[i].aY,bP[i].pY,z2,curve);    /* y = Y/Z^3                                   */
+  }
+
+  naxosWipe(d,COORD_BYTES);                  /* Clear d                                     */
+  naxosWipe(z,COORD_BYTES);                  /* Clear z                                     */
+  naxosWipe(z2,COORD_BYTES);                 /* Clear z2                                    */
+}
+
+void windowTable(uint64_t* tab,pointA* P,ellipticCurve* curve)
+/* It calculates the table tab of scalarMultWindowProj: the odd multiples P, 3P, ..., (2^w-1)P,
+   w = curve->wbits, in Affine coordinates (one inversion, see cProjToAffineBatch), x followed by y
+   tab has (2^(w-1))*2*wsize words
+   Always the same number of operations
+*/
+{
+  pointP J[1<<(WIN_WMAX-1)];
+  pointA T[1<<(WIN_WMAX-1)];
+  pointP D;
+  int i,j,npoints;
+  int nwords = curve->wsize;
+
+  npoints = 1<<(curve->wbits-1);
+  coordCopy(J[0].pX,P->aX);
+  coordCopy(J[0].pY,P->aY);
+  coordCopy(J[0].pZ,curve->r1);          /* J[0] = P                                       */
+  doubleJ(&D,&J[0],curve);               /* D = 2P                                         */
+  for (j=1;j<npoints;j++)
+  {
+    addJ(&J[j],&J[j-1],&D,curve);        /* J[j] = (2j+1)P                                 */
+  }
+  cProjToAffineBatch(T,J,npoints,curve);
+  for (j=0;j<npoints;j++)
+  {
+    for (i=0;i<nwords;i++)
+    {
+      tab[2*j*nwords+i] = T[j].aX[i];
+      tab[(2*j+1)*nwords+i] = T[j].aY[i];
+    }
+  }
+
+  naxosWipe(J,sizeof(J));                /* Clear J, T, D                                  */
+  naxosWipe(T,sizeof(T));
+  naxosWipe(&D,sizeof(pointP));
+}
+
+uint64_t windowEval(pointP* Q,coord k,const uint64_t* tab,pointA* P,ellipticCurve* curve)
+/* It calculates Q = k*P with the table tab of P (see windowTable), see scalarMultWindowProj
+   It returns an all ones mask if an addition was exceptional (Q not valid), otherwise 0
+   Always the same number of operations
+*/
+{
+  pointP R;
+  pointA S;
+  coord kk,t;
+  int dig[COORD_NWORDS*BITS64/WIN_WMIN];
+  int i,j,w,npoints,m,d,s,u,a3;
+  uint64_t ex,even,mask;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  w = curve->wbits;
+  npoints = 1<<(w-1);
+  coordDouble(t,curve->r1,p,nwords);
+  coordAdd(t,t,curve->r1,p,nwords);      /* t = 3 in Montgomery form                       */
+  a3 = (coordCmp(curve->a,t,nwords) == 0);  /* a = 3: doubleJ3                             */
+
+  coordInit(kk);
+  for (i=0;i<nwords;i++)
+  {
+    kk[i] = k[i];                        /* kk = k with the upper words cleared            */
+  }
+  kk[nwords] = 0;
+  even = (kk[0] & 1) - 1;                /* all ones if k is even                          */
+  kk[0] = kk[0] | 1;                     /* kk = k or k+1, odd                             */
+
+  m = (curve->pbits+w)/w - 1;            /* digits below the top one                      */
+  mask = (((uint64_t)1)<<(w+1)) - 1;
+  for (i=0;i<m;i++)
+  {
+    dig[i] = (int)(kk[0] & mask) - (1<<w);          /* d_i = (kk mod 2^(w+1)) - 2^w        */
+    kk[0] = (kk[0] & ~mask) | (((uint64_t)1)<<w);   /* kk - d_i                            */
+    for (j=0;j<nwords;j++)
+    {
+      kk[j] = (kk[j]>>w) | (kk[j+1]<<(BITS64-w));   /* kk = (kk - d_i)/2^w                */
+    }
+  }
+  tableSelect(&S,tab,(int)((kk[0]+1)>>1),npoints,nwords);  /* S = d_m*P                   */
+  coordCopy(Q->pX,S.aX);
+  coordCopy(Q->pY,S.aY);
+  coordCopy(Q->pZ,curve->r1);
+  ex = 0;
+  for (i=m-1;i>-1;i--)
+  {
+    for (j=0;j<w;j++)
+    {
+      if (a3)
+      {
+        doubleJ3(Q,Q,curve);             /* Q = 2^w*Q                                      */
+      }
+      else
+      {
+        doubleJ(Q,Q,curve);
+      }
+    }
+    d = dig[i];                          /* d = d_i, odd                                   */
+    s = (int)(((unsigned)d)>>31);        /* sign of the digit                              */
+    u = (d ^ (0-s)) + s;                 /* u = |d|                                        */
+    tableSelect(&S,tab,(u+1)>>1,npoints,nwords);   /* S = |d|*P                            */
+    coordSub(t,p,S.aY,p,nwords);
+    coordSelect(S.aY,t,0-(uint64_t)s,nwords);     /* S = d*P                              */
+    ex = ex | addMixed(Q,Q,&S,curve);    /* Q = Q + S                                      */
+  }
+
+  coordCopy(S.aX,P->aX);
+  coordSub(S.aY,p,P->aY,p,nwords);       /* S = -P                                         */
+  ex = ex | (addMixed(&R,Q,&S,curve) & even);    /* R = Q - P                              */
+  coordSelect(Q->pX,R.pX,even,nwords);
+  coordSelect(Q->pY,R.pY,even,nwords);
+  coordSelect(Q->pZ,R.pZ,even,nwords);   /* Q = kP                                         */
+
+  naxosWipe(&R,sizeof(pointP));          /* Clear R, S                                     */
+  naxosWipe(&S,sizeof(pointA));
+  naxosWipe(kk,COORD_BYTES);             /* Clear kk                                       */
+  naxosWipe(t,COORD_BYTES);              /* Clear t                                        */
+  naxosWipe(dig,sizeof(dig));            /* Clear the digits                               */
+  return ex;
+}
+
+void scalarMultWindowProj(pointP* Q,coord k,pointA* P,ellipticCurve* curve)
+/* Signed fixed-window scalar multiplication Q = k*P, k < p, with windows of w = curve->wbits bits
+   The table contains the odd multiples P, 3P, ..., (2^w-1)P in Affine coordinates
+   (one inversion, see windowTable)
+   The odd kk = k or k+1 is recoded in m+1 odd digits, m = ceil((bits of p + 1)/w) - 1:
+     d_i = (kk mod 2^(w+1)) - 2^w,  kk = (kk - d_i)/2^w  for i = 0, ..., m-1,  d_m = kk
+   with |d_i| < 2^w, so that kk = sum_i d_i*2^(w*i) and with the Horner rule
+     Q = 2^w*(...(2^w*d_m*P + d_(m-1)*P)...) + d_0*P
+   i.e. w doublings (doubleJ3 if a = 3) and one Jacobian-affine addition per digit,
+   and Q = Q - P if k is even (see windowEval).
+   Each addition reads all the points of the table and negates y by mask
+   If an addition is exceptional (possible only for a negligible set of scalars) Q is
+   calculated again with the Montgomery ladder
+   Q is in Projective coordinates, Q and P are in Montgomery form
+   Always the same number of operations
+*/
+{
+  uint64_t tab[(1<<(WIN_WMAX-1))*2*COORD_NWORDS];
+
+  windowTable(tab,P,curve);
+  if (windowEval(Q,k,tab,P,curve) != 0)
+  {
+    scalarMultProj(Q,k,P,curve);         /* exceptional case: Montgomery ladder            */
+  }
+  naxosWipe(tab,sizeof(tab));            /* Clear tab                                      */
+}
+
+int scalarMultDual(pointA* Q1,pointA* Q2,coord k1,coord k2,pointA* P,int withY,ellipticCurve* curve)
+/* It calculates Q1 = k1*P and Q2 = k2*P with the same base P, k1, k2 < p:
+   with a window selected for the curve the table of P (see windowTable) is calculated once and
+   both results are converted to Affine coordinates with one inversion,
+   otherwise Q1 and Q2 are calculated by scalarMultX
+   With withY = 0 only the x are returned and Q1, Q2 are checked on the curve, as scalarMultX
+   P, Q1 and Q2 are in Montgomery form
+   Always the same number of operations
+   Return:
+     1 = OK
+    -4 = k1*P or k2*P is not on the curve (only with withY = 0)
+    -5 = k1*P or k2*P is the point at infinity
+*/
+{
+  uint64_t tab[(1<<(WIN_WMAX-1))*2*COORD_NWORDS];
+  pointP R[2];
+  pointA A[2];
+  int i,res;
+  int nwords = curve->wsize;
+
+  if (curve->wbits == 0)                 /* Montgomery ladder                              */
+  {
+    res = scalarMultX(Q1,k1,P,withY,curve);
+    i = scalarMultX(Q2,k2,P,withY,curve);
+    return (res == 1)?i:res;
+  }
+
+  NAXOS_COUNT(smult,2);
+  windowTable(tab,P,curve);
+  if (windowEval(&R[0],k1,tab,P,curve) != 0) scalarMultProj(&R[0],k1,P,curve);  /* exceptional */
+  if (windowEval(&R[1],k2,tab,P,curve) != 0) scalarMultProj(&R[1],k2,P,curve);
+
+  res = 1;
+  for (i=0;i<2;i++)
+  {
+    if (1 == coordIsZero(R[i].pZ,nwords))    /* the point at infinity                     */
+    {
+      res = -5;
+      coordCopy(R[i].pZ,curve->r1);
+    }
+    else if ((withY == 0) && (res == 1) && (pIsOnCurve(&R[i],curve) != 1))
+    {
+      res = -4;                              /* not on the curve                          */
+    }
+  }
+  cProjToAffineBatch(A,R,2,curve);
+  if (withY == 0)
+  {
+    coordInit(A[0].aY);                      /* only x                                    */
+    coordInit(A[1].aY);
+  }
+  *Q1 = A[0];
+  *Q2 = A[1];
+
+  naxosWipe(tab,sizeof(tab));            /* Clear tab, R, A                                */
+  naxosWipe(R,sizeof(R));
+  naxosWipe(A,sizeof(A));
+  return res;
+}
+
+int selectScalarMult(ellipticCurve* curve,int wbits)
+/* It selects the scalar multiplication of the curve, see Naxos.h */
+{
+  if ((wbits != 0) && ((wbits < WIN_WMIN) || (wbits > WIN_WMAX))) return -1;
+  curve->wbits = (uint16_t)wbits;
+  return 1;
+}
+
+int tableWords(int v,ellipticCurve* curve)
+/* It returns the number of words of the table of scalarMultTable with v groups of digits */
+{
+  int nwin;
+
+  nwin = (curve->bsize+GTAB_WBITS)/GTAB_WBITS;   /* windows covering bsize+1 bits            */
+  return ((nwin+v-1)/v)*GTAB_NPOINTS*2*curve->wsize;
+}
+
+int buildTable(uint64_t* tab,pointA* P,int v,ellipticCurve* curve)
+/* It calculates the table of P for scalarMultTable with v groups of digits:
+   for j = 0, ..., ntab-1 the points
+     1*B_j, 2*B_j, ..., GTAB_NPOINTS*B_j  with  B_j = 2^(4*v*j)*P
+   in Affine coordinates (Montgomery form), stored as x followed by y, wsize words each.
+   tab must have tableWords(v,curve) words
+   All the points are calculated in Jacobian coordinates and then converted to Affine
+   coordinates with only one inversion
+   Return: 1 = OK, -1 = memory allocation error
+*/
+{
+  pointP *T;
+  pointA *A;
+  pointP B;
+  int i,j,d,n,ntab;
+  int nwords = curve->wsize;
+
+  ntab = tableWords(v,curve)/(GTAB_NPOINTS*2*nwords);
+  n = ntab*GTAB_NPOINTS;
+  T = (pointP*)malloc(n*sizeof(pointP));
+  A = (pointA*)malloc(n*sizeof(pointA));
+  if ((T == NULL) || (A == NULL))
+  {
+    free(T);
+    free(A);
+    return -1;
+  }
+
+  coordCopy(B.pX,P->aX);
+  coordCopy(B.pY,P->aY);
+  coordCopy(B.pZ,curve->r1);                     /* B_0 = P with Z = 1                       */
+  for (j=0;j<ntab;j++)
+  {
+    copyPointP(&T[j*GTAB_NPOINTS],&B);           /* 1*B_j                                    */
+    doubleJ(&T[j*GTAB_NPOINTS+1],&B,curve);      /* 2*B_j                                    */
+    for (d=2;d<GTAB_NPOINTS;d++)
+    {
+      addJ(&T[j*GTAB_NPOINTS+d],&T[j*GTAB_NPOINTS+d-1],&B,curve);  /* (d+1)*B_j = d*B_j + B_j */
+    }
+    for (i=0;(i<GTAB_WBITS*v)&&(j<ntab-1);i++)
+    {
+      doubleJ(&B,&B,curve);                      /* B_j+1 = 2^(4*v)*B_j                      */
+    }
+  }
+
+  cProjToAffineBatch(A,T,n,curve);
+  for (i=0;i<n;i++)
+  {
+    for (j=0;j<nwords;j++)
+    {
+      tab[2*i*nwords+j] = A[i].aX[j];
+      tab[(2*i+1)*nwords+j] = A[i].aY[j];
+    }
+  }
+
+  free(T);
+  free(A);
+  return 1;
+}
+
+void scalarMultTableProj(pointP* Q,coord k,const uint64_t* tab,int v,pointA* P,ellipticCurve* curve)
+/* Fixed-base comb scalar multiplication Q = k*P with the table tab of P (see buildTable), 0 < k < p
+   k is recoded in signed digits d_i in [-8,8] (Booth recoding of the windows of GTAB_WBITS bits)
+     k = sum_i d_i*2^(4*i)
+   The digits are split in v interleaved groups, i = j*v + u, and tab contains the points
+   |d|*B_j with B_j = 2^(4*v*j)*P, therefore with the Horner rule
+     Q = 2^4*(...(2^4*Q_(v-1) + Q_(v-2))...) + Q_0,  with  Q_u = sum_j d_(j*v+u)*B_j
+   i.e. 4*(v-1) doublings and one Jacobian-affine addition per digit.
+   With v = 1 there are no doublings (table of G, see scalarMultBase)
+   The digits equal to 0 and the first addition to the point at infinity are handled by masks
+   If an addition is exceptional (possible only for a negligible set of scalars) Q is
+   calculated again with the Montgomery ladder
+   Q is in Projective coordinates, Q and P are in Montgomery form
+   Always the same number of operations
+*/
+{
+  pointP A,R;
+  pointA T;
+  coord kk,t;
+  int i,j,u,w,s,d,m,ntab;
+  uint64_t inf,zero,ex;
+  uint64_t *p = curve->p;
+  int nwords = curve->wsize;
+
+  coordInit(kk);
+  for (i=0;i<nwords;i++)
+  {
+    kk[i] = k[i];                        /* kk = k with the upper words cleared            */
+  }
+  coordInit(A.pX);
+  coordInit(A.pY);
+  coordInit(A.pZ);
+  inf = ~(uint64_t)0;                    /* A = point at infinity                          */
+  ex = 0;
+
+  ntab = tableWords(v,curve)/(GTAB_NPOINTS*2*nwords);
+  for (u=v-1;u>-1;u--)
+  {
+    for (i=0;(i<GTAB_WBITS)&&(u<v-1);i++)
+    {
+      doubleJ(&A,&A,curve);              /* A = 2^4*A                                      */
+    }
+    for (j=0;j<ntab;j++)
+    {
+      i = (j*v+u)*GTAB_WBITS;
+      w = 0;
+      if (i > 0)
+      {
+        w = coordGetBit(kk,i-1);         /* bit k(4i-1)                                    */
+      }
+      w = w + 2*(coordGetBit(kk,i) + 2*coordGetBit(kk,i+1) + 4*coordGetBit(kk,i+2) + 8*coordGetBit(kk,i+3));
+      s = coordGetBit(kk,i+3);           /* sign of the digit                              */
+      d = ((w+1)>>1) - (s<<GTAB_WBITS);  /* d = k(4i-1) + k(4i) + 2k(4i+1) + 4k(4i+2) - 8k(4i+3) */
+      m = (d ^ (0-s)) + s;               /* m = |d|                                        */
+
+      gTableSelect(&T,tab+j*GTAB_NPOINTS*2*nwords,m,nwords);  /* T = |d|*B_j             */
+      coordSub(t,p,T.aY,p,nwords);
+      coordSelect(T.aY,t,0-(uint64_t)s,nwords);  /* T = d*B_j                              */
+
+      zero = 0 - (uint64_t)(m == 0);     /* all ones if d = 0                              */
+      ex = ex | (addMixed(&R,&A,&T,curve) & ~inf & ~zero);  /* R = A + T                    */
+      coordSelect(A.pX,R.pX,~zero,nwords);
+      coordSelect(A.pY,R.pY,~zero,nwords);
+      coordSelect(A.pZ,R.pZ,~zero,nwords);  /* A = R if d != 0                             */
+      coordSelect(A.pX,T.aX,inf & ~zero,nwords);
+      coordSelect(A.pY,T.aY,inf & ~zero,nwords);
+      coordSelect(A.pZ,curve->r1,inf & ~zero,nwords);  /* A = T if A was at infinity       */
+      inf = inf & zero;
+    }
+  }
+
+  if ((ex | inf) != 0)                   /* exceptional case: it never happens in practice */
+  {
+    scalarMultProj(Q,k,P,curve);
+  }
+  else
+  {
+    copyPointP(Q,&A);                    /* Q = A                                          */
+  }
+
+  naxosWipe(kk,COORD_BYTES);             /* Clear kk                                       */
+  naxosWipe(t,COORD_BYTES);              /* Clear t                                        */
+  naxosWipe(A.pX,COORD_BYTES);           /* Clear A.pX                                     */
+  naxosWipe(A.pY,COORD_BYTES);           /* Clear A.pY                                     */
+  naxosWipe(A.pZ,COORD_BYTES);           /* Clear A.pZ                                     */
+  naxosWipe(R.pX,COORD_BYTES);           /* Clear R.pX                                     */
+  naxosWipe(R.pY,COORD_BYTES);           /* Clear R.pY                                     */
+  naxosWipe(R.pZ,COORD_BYTES);           /* Clear R.pZ                                     */
+  naxosWipe(T.aX,COORD_BYTES);           /* Clear T.aX                                     */
+  naxosWipe(T.aY,COORD_BYTES);           /* Clear T.aY                                     */
+}
+
+void scalarMultTable(pointA* Q,coord k,const uint64_t* tab,int v,pointA* P,ellipticCurve* curve)
+/* It calculates Q = kP with the table tab of P (see scalarMultTableProj) in Affine coordinates
+   Q and P are in Montgomery form
+   Always the same number of operations
+*/
+{
+  pointP R;
+
+  NAXOS_COUNT(smult,1);
+  scalarMultTableProj(&R,k,tab,v,P,curve);  /* R = kP                                     */
+  cProjToAffine(Q,&R,curve);             /* Q = affine(R)                                 */
+
+  naxosWipe(R.pX,COORD_BYTES);           /* Clear R.pX                                    */
+  naxosWipe(R.pY,COORD_BYTES);           /* Clear R.pY                                    */
+  naxosWipe(R.pZ,COORD_BYTES);           /* Clear R.pZ                                    */
+}
+
+void scalarMultBaseProj(pointP* Q,coord k,ellipticCurve* curve)
+/* It calculates Q = k*G in Projective coordinates, with 0 < k < p
+   With the precomputed table of G of the curve (NaxosTables.h) it uses scalarMultTableProj with
+   v = 1, i.e. only one Jacobian-affine addition per window of 4 bits and no doublings,
+   otherwise the Montgomery ladder
+   Q is in Montgomery form
+   Always the same number of operations
+*/
+{
+  NAXOS_COUNT(smult,1);
+  if (curve->gTable == NULL)
+  {
+    scalarMultProj(Q,k,&curve->g,curve);     /* no table: Montgomery ladder                */
+  }
+  else
+  {
+    scalarMultTableProj(Q,k,curve->gTable,1,&curve->g,curve);
+  }
+}
+
+void scalarMultBase(pointA* Q,coord k,ellipticCurve* curve)
+/* It calculates Q = k*G (see scalarMultBaseProj) in Affine coordinates
+   Q is in Montgomery form
+   Always the same number of operations
+*/
+{
+  pointP R;
+
+  scalarMultBaseProj(&R,k,curve);        /* R = k*G                                       */
+  cProjToAffine(Q,&R,curve);             /* Q = affine(R)                                 */
+
+  naxosWipe(R.pX,COORD_BYTES);           /* Clear R.pX                                    */
+  naxosWipe(R.pY,COORD_BYTES);           /* Clear R.pY                                    */
+  naxosWipe(R.pZ,COORD_BYTES);           /* Clear R.pZ                                    */
+}
+
+int curveMontgomery(ellipticCurve* curve)
+/* It calculates the Montgomery constants of the curve and converts a, b and g in Montgomery form
+     pInv = -p^-1 mod 2^64 by Newton iteration, each step doubles the number of correct bits
+     r1 = R mod p and r2 = R^2 mod p by doubling 1 modulo p, with R = 2^(64*wsize)
+   With the NIST fast reductions the numbers are not scaled, i.e. R = 1
+   It calculates also the constants that depend only on p: pbits, pm2 and the ones of coordSqrt
+   Return:
+     1 = OK
+    -1 = no non-residue lower than SQRT_MAX_Z, see curveSqrt
+*/
+{
+  int i,nbits;
+  uint64_t x;
+  coord two;
+
+  x = curve->p[0];                                  /* p*x = 1 mod 2^3 for any odd p            */
+  for (i=0;i<5;i++)
+  {
+    x = x*(2-curve->p[0]*x);                        /* p*x = 1 mod 2^6, 2^12, 2^24, 2^48, 2^96  */
+  }
+  curve->pInv = 0-x;                                /* pInv = -p^-1 mod 2^64                    */
+  curve->pbits = coordMaxBit(curve->p,curve->wsize);
+  coordInit(two);
+  two[0] = 2;
+  coordSub(curve->pm2,curve->p,two,curve->p,curve->wsize);  /* pm2 = p - 2                   */
+  curve->inv = INV_DEFAULT;                         /* safegcd inversion where available        */
+  curve->wbits = NAXOS_WBITS;                       /* scalarMult, see selectScalarMult         */
+
+  nbits = curve->wsize*BITS64;
+  if (curve->mul != coordMulMont)
+  {
+    nbits = 0;                                      /* R = 1                                    */
+  }
+  coordInit(curve->r1);
+  curve->r1[0] = 1;
+  for (i=0;i<nbits;i++)
+  {
+    coordDouble(curve->r1,curve->r1,curve->p,curve->wsize);  /* r1 = 2^nbits mod p = R mod p   */
+  }
+  coordCopy(curve->r2,curve->r1);
+  for (i=0;i<nbits;i++)
+  {
+    coordDouble(curve->r2,curve->r2,curve->p,curve->wsize);  /* r2 = R * 2^nbits mod p = R^2 mod p */
+  }
+
+  coordToMont(curve->a,curve->a,curve);             /* a in Montgomery form                     */
+  coordToMont(curve->b,curve->b,curve);             /* b in Montgomery form                     */
+  coordToMont(curve->g.aX,curve->g.aX,curve);       /* gX in Montgomery form                    */
+  coordToMont(curve->g.aY,curve->g.aY,curve);       /* gY in Montgomery form                    */
+  return curveSqrt(curve);                          /* constants of coordSqrt                   */
+}
+
+int curveNist(ellipticCurve* curve,int index)
+/* It sets the parameters of the elliptic curve among the ones recommended by NIST
+     FIPS PUB 186-4, Digital Signature Standard (DSS)
+   and it calculates all its constants, see curveContext
+   Curve parameters are represented as in the NIST with less significant word on the right
+   The tables of the parameters are static, they are not built at each call
+*/
+{
+  int i,j;
+
+  static const coord P192_p  = {0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFE, 0xFFFFFFFFFFFFFFFF};
+  static const coord P192_a  = {0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
+  static const coord P192_b  = {0x64210519e59c80e7, 0x0fa7e9ab72243049, 0xfeb8deecc146b9b1};
+  static const coord P192_gX = {0x188da80eb03090f6, 0x7cbf20eb43a18800, 0xf4ff0afd82ff1012};
+  static const coord P192_gY = {0x07192b95ffc8da78, 0x631011ed6b24cdd5, 0x73f977a11e794811};
+
+  static const coord P224_p  = {0xFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFF00000000, 0x0000000000000001};
+  static const coord P224_a  = {0x00000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
+  static const coord P224_b  = {0xb4050a85, 0x0c04b3abf5413256, 0x5044b0b7d7bfd8ba, 0x270b39432355ffb4};
+  static const coord P224_gX = {0xb70e0cbd, 0x6bb4bf7f321390b9, 0x4a03c1d356c21122, 0x343280d6115c1d21};
+  static const coord P224_gY = {0xbd376388, 0xb5f723fb4c22dfe6, 0xcd4375a05a074764, 0x44d5819985007e34};
+
+  static const coord P256_p  = {0xFFFFFFFF00000001, 0x0000000000000000, 0x00000000FFFFFFFF, 0xFFFFFFFFFFFFFFFF};
+  static const coord P256_a  = {0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
+  static const coord P256_b  = {0x5ac635d8aa3a93e7, 0xb3ebbd55769886bc, 0x651d06b0cc53b0f6, 0x3bce3c3e27d2604b};
+  static const coord P256_gX = {0x6b17d1f2e12c4247, 0xf8bce6e563a440f2, 0x77037d812deb33a0, 0xf4a13945d898c296};
+  static const coord P256_gY = {0x4fe342e2fe1a7f9b, 0x8ee7eb4a7c0f9e16, 0x2bce33576b315ece, 0xcbb6406837bf51f5};
+
+  static const coord P384_p  = {0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFE, 0xFFFFFFFF00000000, 0x00000000FFFFFFFF};
+  static const coord P384_a  = {0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
+  static const coord P384_b  = {0xb3312fa7e23ee7e4, 0x988e056be3f82d19, 0x181d9c6efe814112, 0x0314088f5013875a, 0xc656398d8a2ed19d, 0x2a85c8edd3ec2aef};
+  static const coord P384_gX = {0xaa87ca22be8b0537, 0x8eb1c71ef320ad74, 0x6e1d3b628ba79b98, 0x59f741e082542a38, 0x5502f25dbf55296c, 0x3a545e3872760ab7};
+  static const coord P384_gY = {0x3617de4a96262c6f, 0x5d9e98bf9292dc29, 0xf8f41dbd289a147c, 0xe9da3113b5f0b8c0, 0x0a60b1ce1d7e819d, 0x7a431d7c90ea0e5f};
+
+  static const coord P521_p  = {0x000001FF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF};
+  static const coord P521_a  = {0x00000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
+  static const coord P521_b  = {0x00000051, 0x953eb9618e1c9a1f, 0x929a21a0b68540ee, 0xa2da725b99b315f3, 0xb8b489918ef109e1, 0x56193951ec7e937b, 0x1652c0bd3bb1bf07, 0x3573df883d2c34f1, 0xef451fd46b503f00};
+  static const coord P521_gX = {0x000000c6, 0x858e06b70404e9cd, 0x9e3ecb662395b442, 0x9c648139053fb521, 0xf828af606b4d3dba, 0xa14b5e77efe75928, 0xfe1dc127a2ffa8de, 0x3348b3c1856a429b, 0xf97e7e31c2e5bd66};
+  static const coord P521_gY = {0x00000118, 0x39296a789a3bc004, 0x5c8a5fb42c7d1bd9, 0x98f54449579b4468, 0x17afbd17273e662c, 0x97ee72995ef42640, 0xc550b9013fad0761, 0x353c7086a272c240, 0x88be94769fd16650};
+
+  switch(index)
+  {
+    case NIST_P192:
+    	curve->bsize = NIST_P192;
+    	curve->wsize = (NIST_P192+BITS63)/BITS64;
+    	curve->mul = coordMulMont;
+    	curve->gTable = NULL;
+    	curve->hash = HASH_NONE;
+      for (i=0;i<curve->wsize;i++)
+      {
+        /* curve parameters are represented as in the NIST with less significant word on the right */
+        /* but in the arrays the less significant word is in [0] position                          */
+        j = curve->wsize-1-i;
+        curve->p[i]    = P192_p[j];
+        curve->a[i]    = P192_a[j];
+        curve->b[i]    = P192_b[j];
+        curve->g.aX[i] = P192_gX[j];
+        curve->g.aY[i] = P192_gY[j];
+      }
+      break;
+
+    case NIST_P224:
+    	curve->bsize = NIST_P224;
+    	curve->wsize = (NIST_P224+BITS63)/BITS64;
+    	curve->mul = MUL_P224;
+    	curve->gTable = GTABLE_P224;
+    	curve->hash = HASH_P224;
+      for (i=0;i<curve->wsize;i++)
+      {
+        /* curve parameters are represented as in the NIST with less significant word on the right */
+        /* but in the arrays the less significant word is in [0] position                          */
+        j = curve->wsize-1-i;
+        curve->p[i]    = P224_p[j];
+        curve->a[i]    = P224_a[j];
+        curve->b[i]    = P224_b[j];
+        curve->g.aX[i] = P224_gX[j];
+        curve->g.aY[i] = P224_gY[j];
+      }
+      break;
+
+    case NIST_P256:
+    	curve->bsize = NIST_P256;
+    	curve->wsize = (NIST_P256+BITS63)/BITS64;
+    	curve->mul = MUL_P256;
+    	curve->gTable = GTABLE_P256;
+    	curve->hash = HASH_P256;
+      for (i=0;i<curve->wsize;i++)
+      {
+        /* curve parameters are represented as in the NIST with less significant word on the right */
+        /* but in the arrays the less significant word is in [0] position                          */
+        j = curve->wsize-1-i;
+        curve->p[i]    = P256_p[j];
+        curve->a[i]    = P256_a[j];
+        curve->b[i]    = P256_b[j];
+        curve->g.aX[i] = P256_gX[j];
+        curve->g.aY[i] = P256_gY[j];
+      }
+      break;
+
+    case NIST_P384:
+    	curve->bsize = NIST_P384;
+    	curve->wsize = (NIST_P384+BITS63)/BITS64;
+    	curve->mul = MUL_P384;
+    	curve->gTable = GTABLE_P384;
+    	curve->hash = HASH_P384;
+      for (i=0;i<curve->wsize;i++)
+      {
+        /* curve parameters are represented as in the NIST with less significant word on the right */
+        /* but in the arrays the less significant word is in [0] position                          */
+        j = curve->wsize-1-i;
+        curve->p[i]    = P384_p[j];
+        curve->a[i]    = P384_a[j];
+        curve->b[i]    = P384_b[j];
+        curve->g.aX[i] = P384_gX[j];
+        curve->g.aY[i] = P384_gY[j];
+      }
+      break;
+
+    case NIST_P521:
+    	curve->bsize = NIST_P521;
+    	curve->wsize = (NIST_P521+BITS63)/BITS64;
+    	curve->mul = coordMulP521;
+    	curve->gTable = GTABLE_P521;
+    	curve->hash = HASH_P521;
+      for (i=0;i<curve->wsize;i++)
+      {
+        /* curve parameters are represented as in the NIST with less significant word on the right */
+        /* but in the arrays the less significant word is in [0] position                          */
+        j = curve->wsize-1-i;
+        curve->p[i]    = P521_p[j];
+        curve->a[i]    = P521_a[j];
+        curve->b[i]    = P521_b[j];
+        curve->g.aX[i] = P521_gX[j];
+        curve->g.aY[i] = P521_gY[j];
+      }
+      break;
+
+    default:
+      return -1;
+  }
+  return curveMontgomery(curve);
+}
+
+static ellipticCurve curveNistCtx[5];             /* contexts of curveContext, see curveNistInit */
+static int curveNistOk[5];
+static pthread_once_t curveNistOnce = PTHREAD_ONCE_INIT;
+
+int curveNistSlot(int index)
+/* It returns the position of the NIST curve index in curveNistCtx, -1 if index is not valid */
+{
+  switch(index)
+  {
+    case NIST_P192: return 0;
+    case NIST_P224: return 1;
+    case NIST_P256: return 2;
+    case NIST_P384: return 3;
+    case NIST_P521: return 4;
+    default: return -1;
+  }
+}
+
+void curveNistInit(void)
+/* It builds the contexts of all the NIST curves, called only once by pthread_once */
+{
+  static const int index[5] = {NIST_P192,NIST_P224,NIST_P256,NIST_P384,NIST_P521};
+  int i;
+
+  for (i=0;i<5;i++)
+  {
+    curveNistOk[i] = curveNist(&curveNistCtx[i],index[i]);
+  }
+}
+
+ellipticCurve* curveContext(int index)
+/* It returns the shared context of the NIST curve index, built at the first call */
+{
+  int i;
+
+  i = curveNistSlot(index);
+  if (i < 0) return NULL;
+  pthread_once(&curveNistOnce,curveNistInit);
+  if (curveNistOk[i] != 1) return NULL;
+  return &curveNistCtx[i];
+}
+
+int selectCurve(ellipticCurve* curve,int index)
+/* It selects the elliptic curve among the ones recommended by NIST
+     FIPS PUB 186-4, Digital Signature Standard (DSS)
+   The ones proposed here are the ones over Prime Fields
+     with the following equation: y^2 = x^3 -ax + b mod p
+   By using curveCreate, new curves can be built over different primes.
+   The curve is a copy of its context, see curveContext
+*/
+{
+  ellipticCurve* ctx;
+
+  ctx = curveContext(index);
+  if (ctx == NULL) return -1;
+  memcpy(curve,ctx,sizeof(ellipticCurve));
+  return 1;
+}
+
+void byteToWord(coord arrayW,uint8_t *arrayB,int byteLen);   /* See below */
+
+ellipticCurve* curveCreate(keyC p,keyC a,keyC b,keyC gX,keyC gY,int bsize)
+/* It builds the context of the curve y^2 = x^3 -ax + b mod p with base point (gX,gY)
+   defined by the user, with the Montgomery multiplication and the table of G
+*/
+{
+  ellipticCurve* curve;
+  uint64_t* tab;
+  int len;
+
+  if ((bsize < 128) || (bsize > 512) || (bsize%8 != 0)) return NULL;  /* H(esk,sk) mod p with one subtraction */
+  curve = (ellipticCurve*)calloc(1,sizeof(ellipticCurve));
+  if (curve == NULL) return NULL;
+
+  len = bsize/8;
+  curve->bsize = bsize;
+  curve->wsize = (bsize+BITS63)/BITS64;
+  curve->mul = coordMulMont;
+  curve->gTable = NULL;
+  if (bsize <= NIST_P224) curve->hash = HASH_P224;
+  else if (bsize <= NIST_P256) curve->hash = HASH_P256;
+  else if (bsize <= NIST_P384) curve->hash = HASH_P384;
+  else curve->hash = HASH_P521;                   /* SHA3-512: hlen = 66 bytes >= len          */
+  byteToWord(curve->p,p,len);
+  byteToWord(curve->a,a,len);
+  byteToWord(curve->b,b,len);
+  byteToWord(curve->g.aX,gX,len);
+  byteToWord(curve->g.aY,gY,len);
+
+  if ((coordMaxBit(curve->p,curve->wsize) != bsize) || ((curve->p[0] & 1) == 0) ||
+      (coordCmp(curve->a,curve->p,curve->wsize) != -1) || (coordCmp(curve->b,curve->p,curve->wsize) != -1) ||
+      (coordCmp(curve->g.aX,curve->p,curve->wsize) != -1) || (coordCmp(curve->g.aY,curve->p,curve->wsize) != -1) ||
+      (curveMontgomery(curve) != 1) || (aIsOnCurve(&curve->g,curve) != 1))
+  {
+    curveDestroy(curve);
+    return NULL;
+  }
+
+  tab = (uint64_t*)malloc(tableWords(1,curve)*sizeof(uint64_t));
+  if ((tab == NULL) || (buildTable(tab,&curve->g,1,curve) != 1))
+  {
+    free(tab);
+    curveDestroy(curve);
+    return NULL;
+  }
+  curve->gTable = tab;                            /* scalarMultBase with one addition per window */
+  return curve;
+}
+
+void curveDestroy(ellipticCurve* curve)
+/* It clears and frees the context of curveCreate */
+{
+  if (curve == NULL) return;
+  if (curve->gTable != NULL)
+  {
+    memset((uint64_t*)curve->gTable,0,tableWords(1,curve)*sizeof(uint64_t));
+    free((uint64_t*)curve->gTable);
+  }
+  memset(curve,0,sizeof(ellipticCurve));
+  free(curve);
+}
+
+void byteToWord(coord arrayW,uint8_t *arrayB,int byteLen)
+/* It converts array of bytes to array of words of 64 bits
+   On little-endian hosts the bytes are already the words: the full words are copied
+*/
+{
+  int i,j,s;
+  j=(byteLen)/BYTES8;
+
+#ifdef NAXOS_LITTLE_ENDIAN
+  memcpy(arrayW,arrayB,j*BYTES8);
+#else
+  for (i=0;i<j;i++)
+  {
+    arrayW[i] = 0;
+    for (s=BYTES7;s>=0;s--)
+    {
+      arrayW[i] = (arrayW[i]<<8) + arrayB[i*BYTES8+s];
+    }
+  }
+#endif
+  s=(byteLen+BYTES7)/BYTES8;
+
+  if (j<s)
+  {
+    s = j*BYTES8-1;
+    arrayW[j] = arrayB[byteLen-1];
+    for (i=(byteLen-2);i>s;i--)
+    arrayW[j] = (arrayW[j]<<8) + arrayB[i];
+  }
+}
+
+
+void wordToByte(uint8_t *arrayB,coord arrayW,int wordLen)
+/* It converts array of of words of 64 bits to array of bits */
+{
+#ifdef NAXOS_LITTLE_ENDIAN
+  memcpy(arrayB,arrayW,wordLen*BYTES8);         /* same layout: copy the words           */
+#else
+  int i,j,k;
+  uint64_t t;
+
+  for (i=0;i<wordLen;i++)
+  {
+    t = arrayW[i];
+    j = i*BYTES8;
+    for (k=0;k<BYTES8;k++)
+    {
+      arrayB[j+k] = (uint8_t)(t&0xFF);
+      t = t>>8;
+    }
+  }
+#endif
+}
+
+void convPointToBytes(keyC pX,keyC pY,pointA* aP,ellipticCurve* curve)
+/* It converts aP in Montgomery form in byte arrays pX and pY */
+{
+  coord t;
+
+  coordFromMont(t,aP->aX,curve);      /* Convert coord x of aP from Montgomery form   */
+  wordToByte(pX,t,curve->wsize);      /* Convert coord x of aP in byte array format   */
+  coordFromMont(t,aP->aY,curve);      /* Convert coord y of aP from Montgomery form   */
+  wordToByte(pY,t,curve->wsize);      /* Convert coord y of aP in byte array format   */
+
+  naxosWipe(t,COORD_BYTES);           /* Clear t                                      */
+}
+
+int convBytesToPoint(pointA* aP,keyC pX,keyC pY,ellipticCurve* curve)
+/* It converts byte arrays pX and pY in aP in Montgomery form */
+{
+  int byteLen;
+
+  byteLen = (curve->bsize+7)/8;
+
+  byteToWord(aP->aX,pX,byteLen); /* Convert pX in coord format  */
+  byteToWord(aP->aY,pY,byteLen); /* Convert pY in coord format  */
+
+  if (coordCmp(aP->aX,curve->p,curve->wsize) != -1) return -1;  /* coordinates must be lower than p */
+  if (coordCmp(aP->aY,curve->p,curve->wsize) != -1) return -1;  /* coordinates must be lower than p */
+
+  coordToMont(aP->aX,aP->aX,curve);  /* Convert x in Montgomery form */
+  coordToMont(aP->aY,aP->aY,curve);  /* Convert y in Montgomery form */
+
+  return 1;
+
+}
+
+void convPointToCompressed(keyPC pC,pointA* aP,ellipticCurve* curve)
+/* It converts aP in Montgomery form in the compressed byte array pC:
+   pC[0] = 2 + (y mod 2) as in SEC1, followed by x in the byte order of keyC
+*/
+{
+  coord t;
+
+  coordFromMont(t,aP->aY,curve);      /* Convert coord y of aP from Montgomery form   */
+  pC[0] = (uint8_t)(2 + (t[0]&1));    /* parity of y                                  */
+  coordFromMont(t,aP->aX,curve);      /* Convert coord x of aP from Montgomery form   */
+  wordToByte(pC+1,t,curve->wsize);    /* Convert coord x of aP in byte array format   */
+
+  naxosWipe(t,COORD_BYTES);           /* Clear t                                      */
+}
+
+int convXToPoint(pointA* aP,uint8_t* x,int byteLen,int odd,ellipticCurve* curve)
+/* It converts the coord x of byteLen bytes and the parity odd of y in aP in Montgomery form
+   y is the square root of x^3 - ax + b with parity odd (see coordSqrt), so the
+   point found is on the curve and it does not need to be checked again
+   Return:
+     1 = OK
+    -1 = x is not lower than p
+    -2 = x^3 - ax + b is not a square, or y = 0 and odd = 1, i.e. there is no point with coord x
+         and parity odd on the curve
+*/
+{
+  coord t1,t2;
+  uint64_t mask;
+  int res;
+  int nwords = curve->wsize;
+
+  byteToWord(aP->aX,x,byteLen);      /* Convert x in coord format    */
+  if (coordCmp(aP->aX,curve->p,nwords) != -1) return -1;       /* coordinates must be lower than p */
+  coordToMont(aP->aX,aP->aX,curve);  /* Convert x in Montgomery form */
+
+  coordMul(t1,aP->aX,aP->aX,curve);      /* t1 = x^2 mod p       */
+  coordMul(t1,t1,aP->aX,curve);          /* t1 = x^3 mod p       */
+  coordMul(t2,aP->aX,curve->a,curve);    /* t2 = ax mod p        */
+  coordSub(t1,t1,t2,curve->p,nwords);    /* t1 = t1 - t2 mod p   */
+  coordAdd(t1,t1,curve->b,curve->p,nwords);  /* t1 = t1 + b mod p */
+  res = coordSqrt(aP->aY,t1,curve);      /* y = sqrt(t1)         */
+  if (res == 1)
+  {
+    coordFromMont(t1,aP->aY,curve);
+    if (coordIsZero(t1,nwords) & odd) res = -2;            /* y = 0 has no odd root      */
+    mask = ((uint64_t)0)-((t1[0]^(uint64_t)odd)&1);        /* all ones if the parity is wrong */
+    coordInit(t2);
+    coordSub(t2,t2,aP->aY,curve->p,nwords);                /* t2 = -y                    */
+    coordSelect(aP->aY,t2,mask,nwords);                    /* y = -y if the parity is wrong */
+  }
+  else
+  {
+    res = -2;
+  }
+
+  naxosWipe(t1,COORD_BYTES);         /* Clear t1                     */
+  naxosWipe(t2,COORD_BYTES);         /* Clear t2                     */
+  return res;
+}
+
+int convCompressedToPoint(pointA* aP,keyPC pC,ellipticCurve* curve)
+/* It converts the compressed byte array pC in aP in Montgomery form, see convXToPoint
+   Return:
+     1 = OK
+    -1 = x is not lower than p or pC[0] is not 2 or 3
+    -2 = x^3 - ax + b is not a square, i.e. there is no point with coord x on the curve
+*/
+{
+  if ((pC[0] != 2) && (pC[0] != 3)) return -1;
+  return convXToPoint(aP,pC+1,(curve->bsize+7)/8,pC[0]&1,curve);
+}
+
+int compressPoint(keyPC pC,keyC pX,keyC pY,ellipticCurve* curve)
+/* It converts the point pX, pY in the compressed byte array pC, see Naxos.h */
+{
+  pointA P;
+
+  if (convBytesToPoint(&P,pX,pY,curve) != 1) return -1;      /* The coords are not lower than p */
+  convPointToCompressed(pC,&P,curve);
+
+  naxosWipe(P.aX,COORD_BYTES);       /* clear P.aX                   */
+  naxosWipe(P.aY,COORD_BYTES);       /* clear P.aY                   */
+  return 1;
+}
+
+int decompressPoint(keyC pX,keyC pY,keyPC pC,ellipticCurve* curve)
+/* It converts the compressed byte array pC in the point pX, pY, see Naxos.h */
+{
+  pointA P;
+  int res;
+
+  res = convCompressedToPoint(&P,pC,curve);
+  if (res == 1)
+  {
+    convPointToBytes(pX,pY,&P,curve);
+  }
+
+  naxosWipe(P.aX,COORD_BYTES);       /* clear P.aX                   */
+  naxosWipe(P.aY,COORD_BYTES);       /* clear P.aY                   */
+  return res;
+}
+
+
+int naxosCountersGet(naxosCounters* c,int phase)
+/* It copies in c the counters of the calling thread for a phase or for all of them */
+{
+  memset(c,0,sizeof(naxosCounters));
+  if ((phase < 0) || (phase > NAXOS_PHASES)) return -1;
+#ifdef NAXOS_COUNTERS
+  {
+    int i;
+
+    for (i=0;i<NAXOS_PHASES;i++)
+    {
+      if ((phase != NAXOS_PHASES) && (phase != i)) continue;
+      c->mul += naxosCnt[i].mul;
+      c->add += naxosCnt[i].add;
+      c->sub += naxosCnt[i].sub;
+      c->dbl += naxosCnt[i].dbl;
+      c->inv += naxosCnt[i].inv;
+      c->smult += naxosCnt[i].smult;
+      c->hash += naxosCnt[i].hash;
+    }
+  }
+  return 1;
+#else
+  return -1;
+#endif
+}
+
+void naxosCountersReset(void)
+/* It sets to 0 the counters of the calling thread */
+{
+#ifdef NAXOS_COUNTERS
+  memset(naxosCnt,0,sizeof(naxosCnt));
+#endif
+}
+
+void naxosPhaseNone(void)
+/* It ends the phase of the counters of the calling thread, for the functions of the other files */
+{
+  NAXOS_PHASE(NAXOS_PH_NONE);
+}
+
+const char* naxosPhaseName(int phase)
+/* It returns the name of a phase */
+{
+  static const char* names[NAXOS_PHASES+1] = {"none","XY hash","XY mult","Ka check","Ka mult","Ka hash",
+                                              "Kb check","Kb mult","Kb hash","all"};
+
+  if ((phase < 0) || (phase > NAXOS_PHASES)) return "?";
+  return names[phase];
+}
+
+int hashInit(hashState* s,ellipticCurve* curve)
+/* It initializes the sponge s of the hash function of the curve, see Naxos.h */
+{
+  if (curve->hash.rate == 0) return -1;
+  if (KeccakWidth1600_SpongeInitialize(s,curve->hash.rate,1600-curve->hash.rate) != 0) return -1;
+  return 1;
+}
+
+void hashAbsorb(hashState* s,const uint8_t* data,int len)
+/* It absorbs len bytes of data in the sponge s */
+{
+  KeccakWidth1600_SpongeAbsorb(s,data,len);
+}
+
+void hashAbsorbCoord(hashState* s,coord a,int len)
+/* It absorbs the first len bytes of a in the sponge s, less significant byte first
+   as wordToByte, one word at a time without converting the whole number
+*/
+{
+  uint8_t b[BYTES8];
+  uint64_t t;
+  int i,k,n;
+
+  for (i=0;len>0;i++)
+  {
+    t = a[i];
+    for (k=0;k<BYTES8;k++)
+    {
+      b[k] = (uint8_t)(t&0xFF);
+      t = t>>8;
+    }
+    n = (len < BYTES8)?len:BYTES8;
+    KeccakWidth1600_SpongeAbsorb(s,b,n);
+    len = len - n;
+  }
+  naxosWipe(b,BYTES8);                       /* clear b                                      */
+}
+
+int hashFinal(hashState* s,uint8_t* out,int len)
+/* It pads the message with the SHA3 suffix and squeezes len bytes in out, then it clears s */
+{
+  int res;
+
+  NAXOS_COUNT(hash,1);
+  res = KeccakWidth1600_SpongeAbsorbLastFewBits(s,0x06);
+  res = res | KeccakWidth1600_SpongeSqueeze(s,out,len);
+  naxosWipe(s,sizeof(hashState));            /* clear the state of the sponge                */
+  return (res == 0)?1:-1;
+}
+
+int generateRand(keyC num,ellipticCurve* curve)
+/* It generates random numbers mod p
+   by using randomGen and Keccak functions
+*/
+{
+  int i,r,res,inputByteLen;
+  keyC msg;
+  coord h,h2;
+  uint64_t t,t1;
+  hashState hs;
+
+  inputByteLen=(curve->bsize+7)/8;
+
+  if (randomGen(msg,inputByteLen*8) != 1)        /* random number by using randomGen */
+    return -1;
+
+  res = hashInit(&hs,curve);                     /* use Keccak routines to hash the random number */
+  if (res != 1)
+    return -1;
+  hashAbsorb(&hs,msg,inputByteLen);
+  res = hashFinal(&hs,num,curve->hash.hlen);
+
+  if (res!=1)
+    return -1;
+
+  byteToWord(h,num,inputByteLen);
+
+  if (coordCmp(h,curve->p,curve->wsize)==0)  /* if h = p then error                          */
+	return -1;
+
+  if (curve->bsize == NIST_P521) /* num[65] is only one bit, therefore NIST P-521 modular reduction is used */
+  {
+	  coordInit(h2);
+	  h2[0] = h[8]>>9;
+	  h[8] = h[8] & 0x000001FF;
+	  coordAdd(h,h,h2,curve->p,curve->wsize);
+  }
+  else
+  {
+    if (coordCmp(h,curve->p,curve->wsize)!=-1) /* if h > p then h = h - p                      */
+    {
+      r = 0;                                   /* initialize carry bit                         */
+      for (i=0;i<curve->wsize;i++)
+      {
+        t1 = h[i]-r;                           /* calculates h - carry bit                     */
+        r = t1 > h[i];                         /* carry bit                                    */
+        t = t1 - curve->p[i];                  /* now subtract p                               */
+        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
+        h[i] = t;
+      }
+    }
+    else
+    {
+      r = 0;                                   /* initialize carry bit                         */
+      for (i=0;i<curve->wsize;i++)
+      {
+        t1 = msg[i]-r;                         /* calculates msg - carry bit                   */
+        r = t1 > msg[i];                       /* carry bit                                    */
+        t = t1 - curve->p[i];                  /* now subtract p                               */
+        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
+        msg[i] = t;
+      }
+    }
+  }
+
+  wordToByte(num,h,curve->wsize);
+
+  naxosWipe(msg,COORD_BYTES);                /* clear msg                                    */
+  naxosWipe(h,COORD_BYTES);                  /* clear h                                      */
+
+  return 1;
+}
+
+
+typedef struct drbgState   /* DRBG of a thread, see selectEntropy                           */
+{
+  uint8_t key[DRBG_KEY];
+  uint8_t buf[DRBG_BUFFER];   /* output not used yet: buf[pos], ..., buf[DRBG_BUFFER-1]      */
+  int pos;
+  int fills;                  /* buffers since the last seed                                 */
+  unsigned int fork;          /* drbgFork at the last seed                                   */
+  int seeded;
+} drbgState;
+
+static _Thread_local drbgState drbg;
+static unsigned int drbgFork;               /* incremented in the child after a fork          */
+static pthread_once_t drbgOnce = PTHREAD_ONCE_INIT;
+static atomic_int entropyBackend = ENTROPY_DRBG;             /* read by all the threads      */
+static int (* _Atomic entropyUser)(uint8_t* buf,int len);   /* stored before entropyBackend */
+
+int systemRandom(uint8_t* buf,int len)
+/* It fills buf with len bytes of getrandom (urandom source), also after short reads */
+{
+  ssize_t n;
+
+  while (len > 0)
+  {
+    n = getrandom(buf,len,0);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    buf += n;
+    len -= (int)n;
+  }
+  return 1;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("rdrnd")))
+int rdrandRandom(uint8_t* buf,int len)
+/* It fills buf with len bytes of the RDRAND instruction */
+{
+  unsigned long long w;
+  int i,j;
+
+  while (len > 0)
+  {
+    for (i=0;(i<RDRAND_RETRY)&&(__builtin_ia32_rdrand64_step(&w) == 0);i++);
+    if (i == RDRAND_RETRY) return -1;       /* the generator of the processor failed          */
+    for (j=0;(j<BYTES8)&&(len>0);j++)
+    {
+      *buf++ = (uint8_t)w;
+      w = w>>8;
+      len--;
+    }
+  }
+  w = 0;
+  return 1;
+}
+
+int rdrandAvailable(void)
+/* It returns 1 if the processor has the RDRAND instruction */
+{
+  unsigned int a,b,c,d;
+
+  if (__get_cpuid(1,&a,&b,&c,&d) == 0) return 0;
+  return (c & bit_RDRND) != 0;
+}
+#else
+int rdrandRandom(uint8_t* buf,int len)
+{
+  return -1;
+}
+
+int rdrandAvailable(void)
+{
+  return 0;
+}
+#endif
+
+void drbgAtFork(void)
+/* Child after a fork: the DRBG of the thread must not repeat the output of the parent */
+{
+  drbgFork++;
+}
+
+void drbgAtForkInit(void)
+{
+  pthread_atfork(NULL,NULL,drbgAtFork);
+}
+
+int drbgFill(int reseed)
+/* It squeezes the new key and a buffer from SHAKE256("NaxosDRBG" || key || seed),
+   the seed of getrandom is absorbed only if reseed = 1
+*/
+{
+  hashState hs;
+  uint8_t seed[DRBG_KEY];
+  int res;
+
+  if (reseed)
+  {
+    if (systemRandom(seed,DRBG_KEY) != 1) return -1;
+  }
+  res = KeccakWidth1600_SpongeInitialize(&hs,1088,512);          /* SHAKE256                   */
+  res |= KeccakWidth1600_SpongeAbsorb(&hs,(const uint8_t*)"NaxosDRBG",9);  /* domain separation */
+  res |= KeccakWidth1600_SpongeAbsorb(&hs,drbg.key,DRBG_KEY);
+  if (reseed)
+  {
+    res |= KeccakWidth1600_SpongeAbsorb(&hs,seed,DRBG_KEY);
+  }
+  res |= KeccakWidth1600_SpongeAbsorbLastFewBits(&hs,0x1F);     /* SHAKE suffix               */
+  res |= KeccakWidth1600_SpongeSqueeze(&hs,drbg.key,DRBG_KEY);  /* next key                   */
+  res |= KeccakWidth1600_SpongeSqueeze(&hs,drbg.buf,DRBG_BUFFER);
+  naxosWipe(&hs,sizeof(hashState));         /* clear the sponge                               */
+  naxosWipe(seed,DRBG_KEY);                 /* clear seed                                     */
+  if (res != 0) return -1;
+  drbg.pos = 0;
+  drbg.fills = (reseed)?1:drbg.fills+1;
+  return 1;
+}
+
+int drbgRandom(uint8_t* buf,int len)
+/* It fills buf with len bytes of the DRBG of the calling thread */
+{
+  int n;
+
+  pthread_once(&drbgOnce,drbgAtForkInit);
+  if ((drbg.seeded == 0) || (drbg.fork != drbgFork))
+  {
+    if (drbgFill(1) != 1) return -1;        /* seeded again at the next call, not before    */
+    drbg.fork = drbgFork;
+    drbg.seeded = 1;
+  }
+  while (len > 0)
+  {
+    if ((drbg.pos == DRBG_BUFFER) && (drbgFill(drbg.fills >= DRBG_RESEED) != 1)) return -1;
+    n = DRBG_BUFFER-drbg.pos;
+    if (n > len) n = len;
+    memcpy(buf,drbg.buf+drbg.pos,n);
+    memset(drbg.buf+drbg.pos,0,n);          /* the output is never kept                       */
+    drbg.pos += n;
+    buf += n;
+    len -= n;
+  }
+  return 1;
+}
+
+int selectEntropy(int backend,int (*source)(uint8_t* buf,int len))
+/* It selects the entropy source of randomGen */
+{
+  switch (backend)
+  {
+    case ENTROPY_DRBG:
+    case ENTROPY_SYSTEM:
+      break;
+    case ENTROPY_RDRAND:
+      if (rdrandAvailable() != 1) return -1;
+      break;
+    case ENTROPY_USER:
+      if (source == NULL) return -1;
+      atomic_store_explicit(&entropyUser,source,memory_order_release);
+      break;
+    default:
+      return -1;
+  }
+  atomic_store_explicit(&entropyBackend,backend,memory_order_release);   /* after the source */
+  return 1;
+}
+
+void randomClear(void)
+/* It clears the DRBG of the calling thread, the next randomGen seeds it again */
+{
+  memset(&drbg,0,sizeof(drbgState));
+}
+
+int randomGen(uint8_t* esk,int nbits)
+/* It returns a random number of nbits with the source of selectEntropy
+   By default the DRBG of the thread: one getrandom every DRBG_RESEED*DRBG_BUFFER bytes,
+   instead of one for each call
+   getrandom has the urandom source in linux (i.e., the same source as the /dev/urandom
+   device, it does not block after its initialization). See <sys/random.h>
+   It should be replaced by BCryptGenRandom in windows system, getentropy in OpenBSD
+*/
+{
+  int buflen;
+
+  buflen = (nbits+7)/8;
+
+  switch (atomic_load_explicit(&entropyBackend,memory_order_acquire))
+  {
+    case ENTROPY_SYSTEM: return systemRandom(esk,buflen);
+    case ENTROPY_RDRAND: return rdrandRandom(esk,buflen);
+    case ENTROPY_USER:   return (atomic_load_explicit(&entropyUser,memory_order_acquire)(esk,buflen) == 1)?1:-1;
+    default:             return drbgRandom(esk,buflen);
+  }
+}
+
+int publicKey(keyC pkx,keyC pky,keyC sk,ellipticCurve* curveN)
+/* It returns the public key pk from the secret key sk
+   pk = G*sk
+*/
+{
+  coord t1;
+  pointA t2;
+  int byteLen;
+
+
+  byteLen = (curveN->bsize+7)/8;
+
+  byteToWord(t1,sk,byteLen);                /* Convert sk to t in coord format             */
+  if (coordIsZero(t1,curveN->wsize)==1) return -1;            /* sk = 0, return error     */
+  if (coordCmp(t1,curveN->p,curveN->wsize) != -1) return -2;  /* sk >= p, return error    */
+  scalarMultBase(&t2,t1,curveN);            /* t2 = G*sk                                   */
+  convPointToBytes(pkx,pky,&t2,curveN);     /* Convert t2 in byte array format             */
+
+  naxosWipe(t1,COORD_BYTES);                /* Clear t1                                    */
+  naxosWipe(t2.aX,COORD_BYTES);             /* Clear t2.aX                                 */
+  naxosWipe(t2.aY,COORD_BYTES);             /* Clear t2.aY                                 */
+  return 0;
+}
+
+int publicKeyCompressed(keyPC pk,keyC sk,ellipticCurve* curveN)
+/* It returns the public key pk = G*sk compressed, see publicKey */
+{
+  keyC pkx,pky;
+  int res;
+
+  res = publicKey(pkx,pky,sk,curveN);
+  if (res == 0)
+  {
+    compressPoint(pk,pkx,pky,curveN);
+  }
+  return res;
+}
+
+int hashAndMod(coord h,keyC esk,keyC sk,ellipticCurve* curveN)
+/* It calculates h=H(esk,sk) mod p */
+{
+  int res,inputByteLen,r,i;
+  keyC hashed;
+  uint64_t t,t1;
+  coord h1,h2;
+  hashState hs;
+
+  inputByteLen = (curveN->bsize+7)/8;
+
+  if (hashInit(&hs,curveN) != 1)                    /* Calculate hashed=H(esk,sk)     */
+    return -1;
+  hashAbsorb(&hs,esk,inputByteLen);                 /* absorb esk and sk, no concatenation */
+  hashAbsorb(&hs,sk,inputByteLen);
+  res = hashFinal(&hs,hashed,curveN->hash.hlen);
+  naxosWipe(&hs,sizeof(hashState));                 /* Clear the state of the sponge  */
+
+  if (res!=1)
+  {
+    naxosWipe(hashed,sizeof(keyC));
+    return -1;
+  }
+
+  byteToWord(h,hashed,inputByteLen);         /* Convert hashed to h in coord format               */
+
+  if (curveN->bsize == NIST_P521) /* num[65] is only one bit, therefore NIST P-521 modular reduction is used */
+  {
+	  coordInit(h2);
+	  h2[0] = h[8]>>9;
+	  h[8] = h[8] & 0x000001FF;
+	  coordAdd(h,h,h2,curveN->p,curveN->wsize);
+  }
+  else
+  {
+    if (coordCmp(h,curveN->p,curveN->wsize)==1)/* if h > p then h = h - p                           */
+    {
+      r = 0;                                   /* initialize carry bit                              */
+      for (i=0;i<curveN->wsize;i++)
+      {
+        t1 = h[i]-r;                           /* calculates h - carry bit                           */
+        r = t1 > h[i];                         /* carry bit                                          */
+        t = t1 - curveN->p[i];                 /* now subtract p                                     */
+        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs       */
+        h[i] = t;
+      }
+    }
+    else                                       /* In order to maintain the same number of operations */
+    {
+      r = 0;                                   /* initialize carry bit                               */
+      for (i=0;i<curveN->wsize;i++)
+      {
+        t1 = h1[i]-r;                          /* calculates h1 - carry bit                          */
+        r = t1 > h[i];                         /* carry bit                                          */
+        t = t1 - curveN->p[i];                 /* now subtract p                                     */
+        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs       */
+        h1[i] = t;
       }
     }
   }
 
-  cProjToAffine(Q,&R0,p,nwords);         /* Q = affine(R0)                                                */
-
-  coordInit(R0.pX);                      /* Clear R0.pX                                                   */
-  coordInit(R0.pY);                      /* Clear R0.pY                                                   */
-  coordInit(R0.pZ);                      /* Clear R0.pZ                                                   */
-  coordInit(R1.pX);                      /* Clear R1.pX                                                   */
-  coordInit(R1.pY);                      /* Clear R1.pY                                                   */
-  coordInit(R1.pZ);                      /* Clear R1.pZ                                                   */
+  naxosWipe(hashed,sizeof(keyC));            /* Clear hashed, h1 and h2: H(esk,sk) and sk are secret */
+  naxosWipe(h1,sizeof(coord));
+  naxosWipe(h2,sizeof(coord));
+  return 1;
 }
 
-int selectCurve(ellipticCurve* curve,int index)
-/* It selects the elliptic curve among the ones recommended by NIST
-     FIPS PUB 186-4, Digital Signature Standard (DSS)
-   The ones proposed here are the ones over Prime Fields
-     with the following equation: y^2 = x^3 -ax + b mod p
-   By using the routines included in this package, new curves can be built
-     over different primes.
-   Curve parameters are represented as in the NIST with less significant word on the right
+int calculateXYPoint(pointA* X,keyC esk,keyC sk,ellipticCurve* curveN)
+/* Generate esk and calculate X=G*H(esk,sk):
+     1. generate the random esk
+     2. calculate H(esk,sk)
+     3. if H(esk,sk)==0 goto step 1
+     4. calculate X=G*H(esk,sk)
+   X is in Montgomery form
+   Return:
+     1 = OK
+    -1 = the entropy source failed: esk and X are set to 0
+    -5 = the hash of the curve is not available (P-192): esk and X are set to 0
 */
 {
-  int i,j;
-
-  const coord P192_p  = {0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFE, 0xFFFFFFFFFFFFFFFF};
-  const coord P192_a  = {0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
-  const coord P192_b  = {0x64210519e59c80e7, 0x0fa7e9ab72243049, 0xfeb8deecc146b9b1};
-  const coord P192_gX = {0x188da80eb03090f6, 0x7cbf20eb43a18800, 0xf4ff0afd82ff1012};
-  const coord P192_gY = {0x07192b95ffc8da78, 0x631011ed6b24cdd5, 0x73f977a11e794811};
-
-  const coord P224_p  = {0xFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFF00000000, 0x0000000000000001};
-  const coord P224_a  = {0x00000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
-  const coord P224_b  = {0xb4050a85, 0x0c04b3abf5413256, 0x5044b0b7d7bfd8ba, 0x270b39432355ffb4};
-  const coord P224_gX = {0xb70e0cbd, 0x6bb4bf7f321390b9, 0x4a03c1d356c21122, 0x343280d6115c1d21};
-  const coord P224_gY = {0xbd376388, 0xb5f723fb4c22dfe6, 0xcd4375a05a074764, 0x44d5819985007e34};
-
-  const coord P256_p  = {0xFFFFFFFF00000001, 0x0000000000000000, 0x00000000FFFFFFFF, 0xFFFFFFFFFFFFFFFF};
-  const coord P256_a  = {0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
-  const coord P256_b  = {0x5ac635d8aa3a93e7, 0xb3ebbd55769886bc, 0x651d06b0cc53b0f6, 0x3bce3c3e27d2604b};
-  const coord P256_gX = {0x6b17d1f2e12c4247, 0xf8bce6e563a440f2, 0x77037d812deb33a0, 0xf4a13945d898c296};
-  const coord P256_gY = {0x4fe342e2fe1a7f9b, 0x8ee7eb4a7c0f9e16, 0x2bce33576b315ece, 0xcbb6406837bf51f5};
-
-  const coord P384_p  = {0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFE, 0xFFFFFFFF00000000, 0x00000000FFFFFFFF};
-  const coord P384_a  = {0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
-  const coord P384_b  = {0xb3312fa7e23ee7e4, 0x988e056be3f82d19, 0x181d9c6efe814112, 0x0314088f5013875a, 0xc656398d8a2ed19d, 0x2a85c8edd3ec2aef};
-  const coord P384_gX = {0xaa87ca22be8b0537, 0x8eb1c71ef320ad74, 0x6e1d3b628ba79b98, 0x59f741e082542a38, 0x5502f25dbf55296c, 0x3a545e3872760ab7};
-  const coord P384_gY = {0x3617de4a96262c6f, 0x5d9e98bf9292dc29, 0xf8f41dbd289a147c, 0xe9da3113b5f0b8c0, 0x0a60b1ce1d7e819d, 0x7a431d7c90ea0e5f};
-
-  const coord P521_p  = {0x000001FF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF};
-  const coord P521_a  = {0x00000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000000, 0x0000000000000003};
-  const coord P521_b  = {0x00000051, 0x953eb9618e1c9a1f, 0x929a21a0b68540ee, 0xa2da725b99b315f3, 0xb8b489918ef109e1, 0x56193951ec7e937b, 0x1652c0bd3bb1bf07, 0x3573df883d2c34f1, 0xef451fd46b503f00};
-  const coord P521_gX = {0x000000c6, 0x858e06b70404e9cd, 0x9e3ecb662395b442, 0x9c648139053fb521, 0xf828af606b4d3dba, 0xa14b5e77efe75928, 0xfe1dc127a2ffa8de, 0x3348b3c1856a429b, 0xf97e7e31c2e5bd66};
-  const coord P521_gY = {0x00000118, 0x39296a789a3bc004, 0x5c8a5fb42c7d1bd9, 0x98f54449579b4468, 0x17afbd17273e662c, 0x97ee72995ef42640, 0xc550b9013fad0761, 0x353c7086a272c240, 0x88be94769fd16650};
+  coord h;
+  int res = 1;
 
-  switch(index)
+  NAXOS_PHASE(NAXOS_PH_XY_HASH);
+  do
   {
-    case NIST_P192:
-    	curve->bsize = NIST_P192;
-    	curve->wsize = (NIST_P192+BITS63)/BITS64;
-      for (i=0;i<curve->wsize;i++)
-      {
-        /* curve parameters are represented as in the NIST with less significant word on the right */
-        /* but in the arrays the less significant word is in [0] position                          */
-        j = curve->wsize-1-i;
-        curve->p[i]    = P192_p[j];
-        curve->a[i]    = P192_a[j];
-        curve->b[i]    = P192_b[j];
-        curve->g.aX[i] = P192_gX[j];
-        curve->g.aY[i] = P192_gY[j];
-      }
-      break;
-
-    case NIST_P224:
-    	curve->bsize = NIST_P224;
-    	curve->wsize = (NIST_P224+BITS63)/BITS64;
-      for (i=0;i<curve->wsize;i++)
-      {
-        /* curve parameters are represented as in the NIST with less significant word on the right */
-        /* but in the arrays the less significant word is in [0] position                          */
-        j = curve->wsize-1-i;
-        curve->p[i]    = P224_p[j];
-        curve->a[i]    = P224_a[j];
-        curve->b[i]    = P224_b[j];
-        curve->g.aX[i] = P224_gX[j];
-        curve->g.aY[i] = P224_gY[j];
-      }
-      break;
-
-    case NIST_P256:
-    	curve->bsize = NIST_P256;
-    	curve->wsize = (NIST_P256+BITS63)/BITS64;
-      for (i=0;i<curve->wsize;i++)
-      {
-        /* curve parameters are represented as in the NIST with less significant word on the right */
-        /* but in the arrays the less significant word is in [0] position                          */
-        j = curve->wsize-1-i;
-        curve->p[i]    = P256_p[j];
-        curve->a[i]    = P256_a[j];
-        curve->b[i]    = P256_b[j];
-        curve->g.aX[i] = P256_gX[j];
-        curve->g.aY[i] = P256_gY[j];
-      }
-      break;
-
-    case NIST_P384:
-    	curve->bsize = NIST_P384;
-    	curve->wsize = (NIST_P384+BITS63)/BITS64;
-      for (i=0;i<curve->wsize;i++)
-      {
-        /* curve parameters are represented as in the NIST with less significant word on the right */
-        /* but in the arrays the less significant word is in [0] position                          */
-        j = curve->wsize-1-i;
-        curve->p[i]    = P384_p[j];
-        curve->a[i]    = P384_a[j];
-        curve->b[i]    = P384_b[j];
-        curve->g.aX[i] = P384_gX[j];
-        curve->g.aY[i] = P384_gY[j];
-      }
+    if (randomGen(esk,curveN->bsize) != 1)     /* Generate eskB using an entropy source     */
+    {
+      res = -1;
       break;
-
-    case NIST_P521:
-    	curve->bsize = NIST_P521;
-    	curve->wsize = (NIST_P521+BITS63)/BITS64;
-      for (i=0;i<curve->wsize;i++)
-      {
-        /* curve parameters are represented as in the NIST with less significant word on the right */
-        /* but in the arrays the less significant word is in [0] position                          */
-        j = curve->wsize-1-i;
-        curve->p[i]    = P521_p[j];
-        curve->a[i]    = P521_a[j];
-        curve->b[i]    = P521_b[j];
-        curve->g.aX[i] = P521_gX[j];
-        curve->g.aY[i] = P521_gY[j];
-      }
+    }
+    if (hashAndMod(h,esk,sk,curveN) != 1)      /* Calculate h = H(esk,sk)                   */
+    {
+      res = -5;
       break;
+    }
+  } while (1 == coordIsZero(h,curveN->wsize)); /* h must be different than 0                */
 
-    default:
-      return -1;
+  if (res == 1)
+  {
+    NAXOS_PHASE(NAXOS_PH_XY_MULT);
+    scalarMultBase(X,h,curveN);                /* X = G*h = G*H(esk,sk)                     */
   }
-  return 1;
+  else                                         /* no X from an esk that is not random or    */
+  {                                            /* without H(esk,sk)                         */
+    naxosWipe(esk,sizeof(keyC));
+    coordInit(X->aX);
+    coordInit(X->aY);
+  }
+
+  naxosWipe(h,COORD_BYTES);                    /* clear h                                   */
+  return res;
 }
 
-void byteToWord(coord arrayW,uint8_t *arrayB,int byteLen)
-/* It converts array of bytes to array of words of 64 bits */
+int calculateXY(keyC Xx,keyC Xy,keyC esk,keyC sk,ellipticCurve* curveN)
+/* Generate esk and calculate X=G*H(esk,sk), see calculateXYPoint */
 {
-  int i,j,k,s;
-  j=(byteLen)/BYTES8;
+  pointA X;
+  int res;
 
-  for (i=0;i<j;i++)
+  res = calculateXYPoint(&X,esk,sk,curveN);
+  if (res == 1)
   {
-    s = i*BYTES8-1;
-    arrayW[i] = arrayB[BYTES8+s];
-    for (k=BYTES7+s;k>s;k--)
-    {
-      arrayW[i] = (arrayW[i]<<8) + arrayB[k];
-    }
+    convPointToBytes(Xx,Xy,&X,curveN);         /* Convert X in byte array format            */
   }
-  s=(byteLen+BYTES7)/BYTES8;
-
-  if (j<s)
+  else
   {
-    s = j*BYTES8-1;
-    arrayW[j] = arrayB[byteLen-1];
-    for (i=(byteLen-2);i>s;i--)
-    arrayW[j] = (arrayW[j]<<8) + arrayB[i];
+    memset(Xx,0,sizeof(keyC));
+    memset(Xy,0,sizeof(keyC));
   }
-}
+  NAXOS_PHASE(NAXOS_PH_NONE);
 
+  naxosWipe(X.aX,COORD_BYTES);                 /* clear X.aX                                */
+  naxosWipe(X.aY,COORD_BYTES);                 /* clear X.aY                                */
+  return res;
+}
 
-void wordToByte(uint8_t *arrayB,coord arrayW,int wordLen)
-/* It converts array of of words of 64 bits to array of bits */
+int calculateXYCompressed(keyPC X,keyC esk,keyC sk,ellipticCurve* curveN)
+/* Generate esk and calculate X=G*H(esk,sk) compressed, see calculateXYPoint */
 {
-  int i,j,k;
-  uint64_t t;
+  pointA XP;
+  int res;
 
-  for (i=0;i<wordLen;i++)
+  res = calculateXYPoint(&XP,esk,sk,curveN);
+  if (res == 1)
   {
-    t = arrayW[i];
-    j = i*BYTES8;
-    for (k=0;k<BYTES8;k++)
-    {
-      arrayB[j+k] = (uint8_t)(t&0xFF);
-      t = t>>8;
-    }
+    convPointToCompressed(X,&XP,curveN);       /* Convert X in compressed format            */
   }
+  else
+  {
+    memset(X,0,sizeof(keyPC));
+  }
+  NAXOS_PHASE(NAXOS_PH_NONE);
+
+  naxosWipe(XP.aX,COORD_BYTES);                /* clear X.aX                                */
+  naxosWipe(XP.aY,COORD_BYTES);                /* clear X.aY                                */
+  return res;
 }
 
-void convPointToBytes(keyC pX,keyC pY,pointA* aP,ellipticCurve* curve)
-/* It converts aP in byte arrays pX and pY */
+int isOnTheCurve(pointA* pA,ellipticCurve* curveN)
+/* It checks that the point in Affine coordinates is on the curve
+   It must verify the curve equation y^2 = x^3 -ax + b mod p
+   It returns 1 when it is verified
+*/
 {
-  wordToByte(pX,aP->aX,curve->wsize); /* Convert coord x of aP in byte array format */
-  wordToByte(pY,aP->aY,curve->wsize); /* Convert coord y of aP in byte array format */
+  return aIsOnCurve(pA,curveN);
 }
 
-int convBytesToPoint(pointA* aP,keyC pX,keyC pY,ellipticCurve* curve)
-/* It converts byte arrays pX and pY in aP */
+int hashK(keyC k,pointA* t1,pointA* t2,pointA* t3,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates the key k = H(x1, x2, x3, idA, idB) with x1, x2, x3 the x coordinates
+   of the points t1, t2, t3 in Montgomery form, using the proper SHA3 function
+   The coordinates are absorbed by the sponge as soon as they are converted
+   Return:
+     1 = OK
+    -1 = error
+*/
 {
-  int byteLen;
+  hashState hs;
+  coord x;
+  int byteLen,res;
 
-  byteLen = (curve->bsize+7)/8;
+  if (hashInit(&hs,curveN) != 1)
+    return -1;
 
-  byteToWord(aP->aX,pX,byteLen); /* Convert pX in coord format  */
-  byteToWord(aP->aY,pY,byteLen); /* Convert pY in coord format  */
+  byteLen = (curveN->bsize+7)/8;
 
-  if (coordCmp(aP->aX,curve->p,curve->wsize) != -1) return -1;  /* coordinates must be lower than p */
-  if (coordCmp(aP->aY,curve->p,curve->wsize) != -1) return -1;  /* coordinates must be lower than p */
+  coordFromMont(x,t1->aX,curveN);                             /* Convert coords x from Montgomery form */
+  hashAbsorbCoord(&hs,x,byteLen);                             /* Absorb coord x of t1                  */
+  coordFromMont(x,t2->aX,curveN);
+  hashAbsorbCoord(&hs,x,byteLen);                             /* Absorb coord x of t2                  */
+  coordFromMont(x,t3->aX,curveN);
+  hashAbsorbCoord(&hs,x,byteLen);                             /* Absorb coord x of t3                  */
+  hashAbsorb(&hs,idA,byteLen);                                /* Absorb idA and idB                    */
+  hashAbsorb(&hs,idB,byteLen);
+  res = hashFinal(&hs,k,curveN->hash.klen);
 
-  return 1;
+  naxosWipe(x,COORD_BYTES);            /* clear x                  */
 
+  return res;
 }
 
-
-int generateRand(keyC num,ellipticCurve* curve)
-/* It generates non cryptographic secure random numbers mod p
-   by using rand() function and Keccak functions
+int calculateKaPoint(keyC kA,pointA* Y,keyC eskA,keyC skAb,pointA* pkB,const uint64_t* pkBTable,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates kA as calculateKa with Y and pkB already converted and validated
+   If pkBTable is not NULL, pkB*H(eskA,skA) is calculated by scalarMultTable with the table
+   of pkB (PEER_COMB_V groups of digits), otherwise with the Montgomery ladder
+   Return: as calculateKa, except -1, -2, -3 and -4
 */
 {
-  int i,r,res,inputByteLen;
-  keyC msg;
-  coord h,h2;
-  uint64_t t,t1;
+  pointA t1A,t2A,t3A;              /* Temporary points on the curve   */
+  coord skA,hA;                    /* Temporary coordinates           */
+  int byteLen,res = -5;
 
-  inputByteLen=(curve->bsize+7)/8;
+  NAXOS_PHASE(NAXOS_PH_KA_MULT);
+  byteLen = (curveN->bsize+7)/8;
+  byteToWord(skA,skAb,byteLen);                               /* Convert skAb to skA in coord format   */
+  if (hashAndMod(hA,eskA,skAb,curveN) != 1) goto done;        /* Calculate hA = H(eskA,skA), no hash (P-192) */
+
+  /* only the x of t1A, t2A and t3A are hashed: they are calculated without y and checked on the curve
+     by scalarMultDual and scalarMultX */
+  if (scalarMultDual(&t1A,&t3A,skA,hA,Y,0,curveN) != 1) goto done;  /* t1A=Y*skA, t3A=Y*hA=Y*H(eskA,skA) */
 
-  for (i=0;i<inputByteLen;i++)                   /* random number by using rand() */
+  if (pkBTable != NULL)
   {
-    msg[i] = 0xFF&rand();
+    scalarMultTable(&t2A,hA,pkBTable,PEER_COMB_V,pkB,curveN); /* Calculate t2A=pkB*hA with the table  */
+    if (isOnTheCurve(&t2A,curveN) != 1) goto done;            /* t2A is not on the curve               */
   }
-
-  switch(curve->bsize)                           /* use Keccak routines to hash the random number */
+  else
   {
-  	case NIST_P224:
-  		res = SHA3_224(num,msg,inputByteLen);
-  		break;
-
-  	case NIST_P256:
-  		res = SHA3_256(num,msg,inputByteLen);
-  		break;
-
-  	case NIST_P384:
-  		res = SHA3_384(num,msg,inputByteLen);
-  		break;
-
-  	case NIST_P521:
-  		res = KeccakWidth1600_Sponge(576, 1024, msg, inputByteLen, 0x06, num, 528/8);
-  		break;
-
-     default:
-        return -1;
+    if (scalarMultX(&t2A,hA,pkB,0,curveN) != 1) goto done;    /* Calculate t2A=pkB*hA=pkB*H(eskA,skA)  */
   }
 
-  if (res!=0)
-    return -1;
+  NAXOS_PHASE(NAXOS_PH_KA_HASH);
+  res = hashK(kA,&t1A,&t2A,&t3A,idA,idB,curveN);              /* kA = H(t1A, t2A, t3A, idA, idB)       */
+
+done:                                  /* also on the errors: skA and hA are secret */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  naxosWipe(t1A.aX,COORD_BYTES);       /* clear t1A.aX             */
+  naxosWipe(t1A.aY,COORD_BYTES);       /* clear t1A.aY             */
+  naxosWipe(t2A.aX,COORD_BYTES);       /* clear t2A.aX             */
+  naxosWipe(t2A.aY,COORD_BYTES);       /* clear t2A.aY             */
+  naxosWipe(t3A.aX,COORD_BYTES);       /* clear t3A.aX             */
+  naxosWipe(t3A.aY,COORD_BYTES);       /* clear t3A.aY             */
+  naxosWipe(skA,COORD_BYTES);          /* clear skA                */
+  naxosWipe(hA,COORD_BYTES);           /* clear hA                 */
+
+  return res;
+}
 
-  byteToWord(h,num,inputByteLen);
+int calculateKbPoint(keyC kB,pointA* pkA,const uint64_t* pkATable,keyC eskB,keyC skBb,pointA* X,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates kB as calculateKb with pkA and X already converted and validated
+   If pkATable is not NULL, pkA*H(eskB,skB) is calculated by scalarMultTable with the table
+   of pkA (PEER_COMB_V groups of digits), otherwise with the Montgomery ladder
+   Return: as calculateKb, except -1, -2, -3 and -4
+*/
+{
+  pointA t1B,t2B,t3B;              /* Temporary points on the curve   */
+  coord skB,hB;                    /* Temporary coordinates           */
+  int byteLen,res = -5;
 
-  if (coordCmp(h,curve->p,curve->wsize)==0)  /* if h = p then error                          */
-	return -1;
+  NAXOS_PHASE(NAXOS_PH_KB_MULT);
+  byteLen = (curveN->bsize+7)/8;
+  byteToWord(skB,skBb,byteLen);                               /* Convert skBb to skB in coord format */
+  if (hashAndMod(hB,eskB,skBb,curveN) != 1) goto done;        /* Calculate hB = H(eskB,skB), no hash (P-192) */
 
-  if (curve->bsize == NIST_P521) /* num[65] is only one bit, therefore NIST P-521 modular reduction is used */
+  /* only the x of t1B, t2B and t3B are hashed: they are calculated without y and checked on the curve
+     by scalarMultX and scalarMultDual */
+  if (pkATable != NULL)
   {
-	  coordInit(h2);
-	  h2[0] = h[8]>>9;
-	  h[8] = h[8] & 0x000001FF;
-	  coordAdd(h,h,h2,curve->p,curve->wsize);
+    scalarMultTable(&t1B,hB,pkATable,PEER_COMB_V,pkA,curveN); /* Calculate t1B=pkA*hB with the table */
+    if (isOnTheCurve(&t1B,curveN) != 1) goto done;            /* t1B is not on the curve             */
   }
   else
   {
-    if (coordCmp(h,curve->p,curve->wsize)!=-1) /* if h > p then h = h - p                      */
-    {
-      r = 0;                                   /* initialize carry bit                         */
-      for (i=0;i<curve->wsize;i++)
-      {
-        t1 = h[i]-r;                           /* calculates h - carry bit                     */
-        r = t1 > h[i];                         /* carry bit                                    */
-        t = t1 - curve->p[i];                  /* now subtract p                               */
-        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
-        h[i] = t;
-      }
-    }
-    else
-    {
-      r = 0;                                   /* initialize carry bit                         */
-      for (i=0;i<curve->wsize;i++)
-      {
-        t1 = msg[i]-r;                         /* calculates msg - carry bit                   */
-        r = t1 > msg[i];                       /* carry bit                                    */
-        t = t1 - curve->p[i];                  /* now subtract p                               */
-        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs */
-        msg[i] = t;
-      }
-    }
+    if (scalarMultX(&t1B,hB,pkA,0,curveN) != 1) goto done;    /* Calculate t1B=pkA*hB=pkA*H(eskB,skB) */
   }
 
-  wordToByte(num,h,curve->wsize);
+  if (scalarMultDual(&t2B,&t3B,skB,hB,X,0,curveN) != 1) goto done;  /* t2B=X*skB, t3B=X*hB=X*H(eskB,skB) */
+
+  NAXOS_PHASE(NAXOS_PH_KB_HASH);
+  res = hashK(kB,&t1B,&t2B,&t3B,idA,idB,curveN);              /* kB = H(t1B, t2B, t3B, idA, idB)     */
+
+done:                                  /* also on the errors: skB and hB are secret */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  naxosWipe(t1B.aX,COORD_BYTES);       /* clear t1B.aX             */
+  naxosWipe(t1B.aY,COORD_BYTES);       /* clear t1B.aY             */
+  naxosWipe(t2B.aX,COORD_BYTES);       /* clear t2B.aX             */
+  naxosWipe(t2B.aY,COORD_BYTES);       /* clear t2B.aY             */
+  naxosWipe(t3B.aX,COORD_BYTES);       /* clear t3B.aX             */
+  naxosWipe(t3B.aY,COORD_BYTES);       /* clear t3B.aY             */
+  naxosWipe(skB,COORD_BYTES);          /* clear skB                */
+  naxosWipe(hB,COORD_BYTES);           /* clear hB                 */
+
+  return res;
+}
+
+int calculateKa(keyC kA,keyC Yx,keyC Yy,keyC eskA,keyC skAb, keyC pkBx, keyC pkBy,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates kA using the x coordinates of the points on the curve
+   kA = H(Y*skA, pkB*H(eskA,skA), Y*H(eskA,skA), idA, idB)
+   Return:
+     1 = OK
+     -1 = coord of pkB are not mod p
+     -2 = pkB is not on the curve
+     -3 = coord of Y are not mod p
+     -4 = Y is not on the curve
+     -5 = internal error
+*/
+{
+  pointA pkB,Y;                    /* Temporary points on the curve   */
+  int res;
+
+  NAXOS_PHASE(NAXOS_PH_KA_CHECK);
+  if (convBytesToPoint(&pkB,pkBx,pkBy,curveN)!= 1) res = -1; /* The coords are not lower than p        */
+  else if (isOnTheCurve(&pkB,curveN) != 1) res = -2;         /* pkB is not on the curve                */
+  else if (convBytesToPoint(&Y,Yx,Yy,curveN)!= 1) res = -3;  /* The coords are not lower than p        */
+  else if (isOnTheCurve(&Y,curveN) != 1) res = -4;           /* Y is not on the curve                  */
+  else res = calculateKaPoint(kA,&Y,eskA,skAb,&pkB,NULL,idA,idB,curveN);
+
+  naxosWipe(pkB.aX,COORD_BYTES);       /* clear pkB.aX             */
+  naxosWipe(pkB.aY,COORD_BYTES);       /* clear pkB.aY             */
+  naxosWipe(Y.aX,COORD_BYTES);         /* clear Y.aX               */
+  naxosWipe(Y.aY,COORD_BYTES);         /* clear Y.aY               */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  return res;
+}
+
+int calculateKb(keyC kB,keyC pkAx, keyC pkAy,keyC eskB,keyC skBb,keyC Xx,keyC Xy,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates kB using the x coordinates of the points on the curve
+   kB = H(pkA*H(eskB,skB), X*skB, X*H(eskB,skB), idA, idB)
+   Return:
+     1 = OK
+     -1 = coord of pkA are not mod p
+     -2 = pkA is not on the curve
+     -3 = coord of X are not mod p
+     -4 = X is not on the curve
+     -5 = internal error
+*/
+{
+  pointA pkA,X;                    /* Temporary points on the curve   */
+  int res;
+
+  NAXOS_PHASE(NAXOS_PH_KB_CHECK);
+  if (convBytesToPoint(&pkA,pkAx,pkAy,curveN)!= 1) res = -1; /* The coords are not lower than p      */
+  else if (isOnTheCurve(&pkA,curveN) != 1) res = -2;         /* pkA is not on the curve              */
+  else if (convBytesToPoint(&X,Xx,Xy,curveN)!= 1) res = -3;  /* The coords are not lower than p      */
+  else if (isOnTheCurve(&X,curveN) != 1) res = -4;           /* X is not on the curve                */
+  else res = calculateKbPoint(kB,&pkA,NULL,eskB,skBb,&X,idA,idB,curveN);
+
+  naxosWipe(pkA.aX,COORD_BYTES);       /* clear pkA.aX             */
+  naxosWipe(pkA.aY,COORD_BYTES);       /* clear pkA.aY             */
+  naxosWipe(X.aX,COORD_BYTES);         /* clear X.aX               */
+  naxosWipe(X.aY,COORD_BYTES);         /* clear X.aY               */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  return res;
+}
+
+int calculateKaCompressed(keyC kA,keyPC Y,keyC eskA,keyC skAb,keyPC pkB,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates kA as calculateKa with Y and pkB compressed, see convCompressedToPoint
+   The decompression replaces the check that the points are on the curve
+   Return: as calculateKa
+*/
+{
+  pointA pkBP,YP;                  /* Temporary points on the curve   */
+  int res;
 
-  memset(msg,0,COORD_BYTES);                 /* clear msg                                    */
-  coordInit(h);                              /* clear h                                      */
+  NAXOS_PHASE(NAXOS_PH_KA_CHECK);
+  res = convCompressedToPoint(&pkBP,pkB,curveN);              /* -1: x not lower than p, -2: not on the curve */
+  if (res == 1)
+  {
+    res = convCompressedToPoint(&YP,Y,curveN);
+    if (res == 1)
+    {
+      res = calculateKaPoint(kA,&YP,eskA,skAb,&pkBP,NULL,idA,idB,curveN);
+    }
+    else
+    {
+      res = res-2;                                            /* -3 or -4                              */
+    }
+  }
 
-  return 1;
+  naxosWipe(pkBP.aX,COORD_BYTES);      /* clear pkB.aX             */
+  naxosWipe(pkBP.aY,COORD_BYTES);      /* clear pkB.aY             */
+  naxosWipe(YP.aX,COORD_BYTES);        /* clear Y.aX               */
+  naxosWipe(YP.aY,COORD_BYTES);        /* clear Y.aY               */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  return res;
 }
 
-
-int randomGen(uint8_t* esk,int nbits)
-/* It returns a random number of nbits
-   It uses the getrandom C function based on the urandom source in linux
-      (i.e., the same source as the /dev/urandom device). See <sys/random.h>
-   It should be replaced by BCryptGenRandom in windows system, getentropy in OpenBSD
+int calculateKbCompressed(keyC kB,keyPC pkA,keyC eskB,keyC skBb,keyPC X,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates kB as calculateKb with pkA and X compressed, see convCompressedToPoint
+   The decompression replaces the check that the points are on the curve
+   Return: as calculateKb
 */
 {
-  int buflen;
+  pointA pkAP,XP;                  /* Temporary points on the curve   */
+  int res;
 
-  buflen = (nbits+7)/8;
+  NAXOS_PHASE(NAXOS_PH_KB_CHECK);
+  res = convCompressedToPoint(&pkAP,pkA,curveN);              /* -1: x not lower than p, -2: not on the curve */
+  if (res == 1)
+  {
+    res = convCompressedToPoint(&XP,X,curveN);
+    if (res == 1)
+    {
+      res = calculateKbPoint(kB,&pkAP,NULL,eskB,skBb,&XP,idA,idB,curveN);
+    }
+    else
+    {
+      res = res-2;                                            /* -3 or -4                            */
+    }
+  }
 
-  if (getrandom(esk, buflen, GRND_RANDOM)<buflen)
-    return -1;
-  return 1;
+  naxosWipe(pkAP.aX,COORD_BYTES);      /* clear pkA.aX             */
+  naxosWipe(pkAP.aY,COORD_BYTES);      /* clear pkA.aY             */
+  naxosWipe(XP.aX,COORD_BYTES);        /* clear X.aX               */
+  naxosWipe(XP.aY,COORD_BYTES);        /* clear X.aY               */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  return res;
 }
 
-int publicKey(keyC pkx,keyC pky,keyC sk,ellipticCurve* curveN)
-/* It returns the public key pk from the secret key sk
-   pk = G*sk
+typedef struct peerEntry   /* Validated public key of a peer with its comb table        */
+{
+  uint8_t pk[2*COORD_BYTES];       /* pkx and pky: key of the entry                     */
+  uint64_t hash;                   /* hash of pk                                        */
+  pointA P;                        /* validated point in Montgomery form                */
+  uint64_t* table;                 /* comb table of P, see buildTable                   */
+  int next;                        /* next entry in the same bucket, -1 = end           */
+  int refs;                        /* callers using the entry                           */
+  int temp;                        /* 1 = entry not in the cache, freed when released   */
+  int used;                        /* reference bit for the clock eviction              */
+} peerEntry;
+
+struct peerCache
+{
+  pthread_mutex_t lock;            /* it protects all the fields below                 */
+  uint16_t bsize;                  /* curve of the cache                               */
+  int size;                        /* maximum number of peers                          */
+  int count;                       /* entries in use                                   */
+  int hand;                        /* clock hand for the eviction                      */
+  int nbuckets;                    /* number of buckets, power of 2                    */
+  int* buckets;                    /* first entry of each bucket, -1 = empty           */
+  peerEntry* entries;
+};
+
+peerCache* peerCacheCreate(ellipticCurve* curveN,int maxPeers)
+/* It creates the cache of the public keys of at most maxPeers peers for the curve curveN
+   It returns NULL in case of error
 */
 {
-  coord t1;
-  pointA t2;
-  int byteLen;
-
+  peerCache* cache;
+  int i;
 
-  byteLen = (curveN->bsize+7)/8;
+  if (maxPeers < 1) return NULL;
 
-  byteToWord(t1,sk,byteLen);                /* Convert sk to t in coord format             */
-  if (coordIsZero(t1,curveN->wsize)==1) return -1;            /* sk = 0, return error     */
-  if (coordCmp(t1,curveN->p,curveN->wsize) != -1) return -2;  /* sk >= p, return error    */
-  scalarMult(&t2,t1,&curveN->g,curveN->a,curveN->p,curveN->wsize); /* t2 = G*sk            */
-  wordToByte(pkx,t2.aX,curveN->wsize);      /* Convert coord x of t2 in byte array format  */
-  wordToByte(pky,t2.aY,curveN->wsize);      /* Convert coord y of t2 in byte array format  */
+  cache = (peerCache*)calloc(1,sizeof(peerCache));
+  if (cache == NULL) return NULL;
 
-  coordInit(t1);                            /* Clear t1                                    */
-  coordInit(t2.aX);                         /* Clear t2.aX                                 */
-  coordInit(t2.aY);                         /* Clear t2.aY                                 */
-  return 0;
+  cache->bsize = curveN->bsize;
+  cache->size = maxPeers;
+  cache->nbuckets = 1;
+  while (cache->nbuckets < maxPeers)
+  {
+    cache->nbuckets = cache->nbuckets*2;       /* at most one entry per bucket on average */
+  }
+  cache->buckets = (int*)malloc(cache->nbuckets*sizeof(int));
+  cache->entries = (peerEntry*)calloc(maxPeers,sizeof(peerEntry));
+  if ((cache->buckets == NULL) || (cache->entries == NULL) || (pthread_mutex_init(&cache->lock,NULL) != 0))
+  {
+    free(cache->buckets);
+    free(cache->entries);
+    free(cache);
+    return NULL;
+  }
+  for (i=0;i<cache->nbuckets;i++)
+  {
+    cache->buckets[i] = -1;
+  }
+  return cache;
 }
 
-int hashAndMod(coord h,keyC esk,keyC sk,ellipticCurve* curveN)
-/* It calculates h=H(esk,sk) mod p */
+void peerCacheDestroy(peerCache* cache)
+/* It frees the cache. No thread may be using it */
 {
-  int res,inputByteLen,r,i;
-  uint8_t msg[DOUBLEW_BYTES];
-  keyC hashed;
-  uint64_t t,t1;
-  coord h1,h2;
+  int i;
 
-  inputByteLen = (curveN->bsize+7)/8;
+  if (cache == NULL) return;
 
-  for (i=0;i<inputByteLen;i++)                      /* Concatenate esk and sk in msg */
+  for (i=0;i<cache->count;i++)
   {
-    msg[i] = esk[i];
-    msg[i+inputByteLen] = sk[i];
+    free(cache->entries[i].table);
   }
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->buckets);
+  free(cache->entries);
+  free(cache);
+}
 
-  inputByteLen= inputByteLen*2;
+uint64_t peerHash(uint8_t* pk,int len)
+/* FNV-1a hash of the public key bytes. The public keys are not secret */
+{
+  uint64_t h = 0xcbf29ce484222325;
+  int i;
 
-  switch(curveN->bsize)                             /* Calculate hashed=H(esk,sk)     */
+  for (i=0;i<len;i++)
   {
-  	case NIST_P224:
-  		res = SHA3_224(hashed,msg,inputByteLen);
-  		break;
-
-  	case NIST_P256:
-  		res = SHA3_256(hashed,msg,inputByteLen);
-  		break;
-
-  	case NIST_P384:
-  		res = SHA3_384(hashed,msg,inputByteLen);
-  		break;
+    h = (h ^ pk[i])*0x100000001b3;
+  }
+  return h;
+}
 
-  	case NIST_P521:
-  		res = KeccakWidth1600_Sponge(576, 1024, msg, inputByteLen, 0x06, hashed, 528/8);
-  		break;
+int peerFind(peerCache* cache,uint8_t* pk,uint64_t h,int len)
+/* It returns the index of the entry of pk, -1 if not found. To be called with the lock */
+{
+  int i;
 
-    default:
-      return -1;
+  for (i=cache->buckets[h&(cache->nbuckets-1)];i!=-1;i=cache->entries[i].next)
+  {
+    if ((cache->entries[i].hash == h) && (memcmp(cache->entries[i].pk,pk,len) == 0))
+    {
+      return i;
+    }
   }
+  return -1;
+}
 
-  memset(msg,0,DOUBLEW_BYTES);              /* Clear msg                                         */
-
-  if (res!=0)
-    return -1;
+int peerSlot(peerCache* cache)
+/* It returns a free entry, evicting with the clock algorithm the least recently used entry
+   not in use. It returns -1 if all the entries are in use. To be called with the lock
+*/
+{
+  int i,n,b;
+  int* pi;
+  peerEntry* e;
 
-  inputByteLen = inputByteLen/2;
+  if (cache->count < cache->size)
+  {
+    return cache->count++;
+  }
+  for (n=0;n<2*cache->size;n++)                 /* two rounds: the first clears the used bits */
+  {
+    i = cache->hand;
+    cache->hand = (cache->hand+1)%cache->size;
+    e = &cache->entries[i];
+    if (e->refs > 0) continue;
+    if (e->used)
+    {
+      e->used = 0;
+      continue;
+    }
+    b = e->hash&(cache->nbuckets-1);            /* unlink the entry from its bucket          */
+    for (pi=&cache->buckets[b];*pi!=i;pi=&cache->entries[*pi].next);
+    *pi = e->next;
+    free(e->table);
+    e->table = NULL;
+    return i;
+  }
+  return -1;
+}
 
-  byteToWord(h,hashed,inputByteLen);         /* Convert hashed to h in coord format               */
+peerEntry* peerCacheGet(peerCache* cache,keyC pkx,keyC pky,ellipticCurve* curveN,int* res)
+/* It returns the entry of the public key (pkx,pky) with its validated point and comb table,
+   calculating and inserting them if not yet in the cache.
+   The entry must be released with peerCacheRelease
+   It returns NULL in case of error with res:
+     -1 = coord of pk are not mod p
+     -2 = pk is not on the curve
+     -5 = internal error
+*/
+{
+  peerEntry* e;
+  uint8_t pk[2*COORD_BYTES];
+  uint64_t h;
+  int i,len;
+
+  len = (curveN->bsize+7)/8;
+  memcpy(pk,pkx,len);
+  memcpy(&pk[len],pky,len);
+  h = peerHash(pk,2*len);
+
+  pthread_mutex_lock(&cache->lock);
+  i = peerFind(cache,pk,h,2*len);
+  if (i != -1)                                  /* hit: no validation, no table calculation */
+  {
+    cache->entries[i].refs++;
+    cache->entries[i].used = 1;
+    pthread_mutex_unlock(&cache->lock);
+    return &cache->entries[i];
+  }
+  pthread_mutex_unlock(&cache->lock);
 
-  if (curveN->bsize == NIST_P521) /* num[65] is only one bit, therefore NIST P-521 modular reduction is used */
+  e = (peerEntry*)calloc(1,sizeof(peerEntry));  /* miss: validate pk and build its table     */
+  if (e == NULL)
   {
-	  coordInit(h2);
-	  h2[0] = h[8]>>9;
-	  h[8] = h[8] & 0x000001FF;
-	  coordAdd(h,h,h2,curveN->p,curveN->wsize);
+    *res = -5;
+    return NULL;
   }
-  else
+  *res = -1;
+  if (convBytesToPoint(&e->P,pkx,pky,curveN) == 1)
   {
-    if (coordCmp(h,curveN->p,curveN->wsize)==1)/* if h > p then h = h - p                           */
+    *res = -2;
+    if (isOnTheCurve(&e->P,curveN) == 1)
     {
-      r = 0;                                   /* initialize carry bit                              */
-      for (i=0;i<curveN->wsize;i++)
+      *res = -5;
+      e->table = (uint64_t*)malloc(tableWords(PEER_COMB_V,curveN)*sizeof(uint64_t));
+      if ((e->table != NULL) && (buildTable(e->table,&e->P,PEER_COMB_V,curveN) == 1))
       {
-        t1 = h[i]-r;                           /* calculates h - carry bit                           */
-        r = t1 > h[i];                         /* carry bit                                          */
-        t = t1 - curveN->p[i];                 /* now subtract p                                     */
-        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs       */
-        h[i] = t;
+        *res = 1;
       }
     }
-    else                                       /* In order to maintain the same number of operations */
+  }
+  if (*res != 1)
+  {
+    free(e->table);
+    free(e);
+    return NULL;
+  }
+  memcpy(e->pk,pk,2*len);
+  e->hash = h;
+
+  pthread_mutex_lock(&cache->lock);
+  i = peerFind(cache,pk,h,2*len);               /* inserted by another thread meanwhile?     */
+  if (i == -1)
+  {
+    i = peerSlot(cache);
+    if (i != -1)
     {
-      r = 0;                                   /* initialize carry bit                               */
-      for (i=0;i<curveN->wsize;i++)
-      {
-        t1 = h1[i]-r;                          /* calculates h1 - carry bit                          */
-        r = t1 > h[i];                         /* carry bit                                          */
-        t = t1 - curveN->p[i];                 /* now subtract p                                     */
-        r = r | (t > t1);                      /* calculate the result carry bit of the 2 subs       */
-        h1[i] = t;
-      }
+      cache->entries[i] = *e;
+      cache->entries[i].next = cache->buckets[h&(cache->nbuckets-1)];
+      cache->buckets[h&(cache->nbuckets-1)] = i;
+      cache->entries[i].refs = 0;
+      e->table = NULL;                          /* now owned by the cache                    */
     }
   }
-  memset(hashed,0,COORD_BYTES);              /* Clear hashed                                       */
+  if (i == -1)                                  /* all the entries in use: not cached        */
+  {
+    pthread_mutex_unlock(&cache->lock);
+    e->temp = 1;
+    return e;
+  }
+  cache->entries[i].refs++;
+  cache->entries[i].used = 1;
+  pthread_mutex_unlock(&cache->lock);
 
-  return 1;
+  free(e->table);
+  free(e);
+  return &cache->entries[i];
 }
 
-void calculateXY(keyC Xx,keyC Xy,keyC esk,keyC sk,ellipticCurve* curveN)
-/* Generate esk and calculate X=G*H(esk,sk):
-     1. generate the random esk
-     2. calculate H(esk,sk)
-     3. if H(esk,sk)==0 goto step 1
-     4. calculate X=G*H(esk,sk)
-*/
+void peerCacheRelease(peerCache* cache,peerEntry* e)
+/* It releases an entry returned by peerCacheGet */
 {
-  coord h;
-  pointA X;
-
-  do
+  if (e->temp)                                  /* not in the cache                          */
   {
-    randomGen(esk,curveN->bsize);              /* Generate eskB using an entropy source     */
-    hashAndMod(h,esk,sk,curveN);               /* Calculate h = H(esk,sk)                   */
-  } while (1 == coordIsZero(h,curveN->wsize)); /* h must be different than 0                */
-
-  scalarMult(&X,h,&curveN->g,curveN->a,curveN->p,curveN->wsize); /* X = G*h = G*H(esk,sk)   */
-  wordToByte(Xx,X.aX,curveN->wsize);           /* Convert coord x of X in byte array format */
-  wordToByte(Xy,X.aY,curveN->wsize);           /* Convert coord y of X in byte array format */
-
-  coordInit(h);                                /* clear h                                   */
-  coordInit(X.aX);                             /* clear X.aX                                */
-  coordInit(X.aY);                             /* clear X.aY                                */
+    free(e->table);
+    free(e);
+    return;
+  }
+  pthread_mutex_lock(&cache->lock);
+  e->refs--;
+  pthread_mutex_unlock(&cache->lock);
 }
 
-int isOnTheCurve(pointA* pA,ellipticCurve* curveN)
-/* It checks that the point in Affine coordinates is on the curve
-   It must verify the curve equation y^2 = x^3 -ax + b mod p
-   It returns 1 when it is verified
+int calculateKaCached(keyC kA,keyC Yx,keyC Yy,keyC eskA,keyC skAb, keyC pkBx, keyC pkBy,keyC idA,keyC idB,ellipticCurve* curveN,peerCache* cache)
+/* It calculates kA as calculateKa, taking pkB from the cache:
+   for a peer already in the cache pkB is neither converted nor validated again, and
+   pkB*H(eskA,skA) is calculated with its comb table
+   Return: as calculateKa
 */
 {
-  return aIsOnCurve(pA,curveN->a,curveN->b,curveN->p,curveN->wsize);
+  peerEntry* e;
+  pointA Y;
+  int res;
+
+  if (cache->bsize != curveN->bsize) return -5;    /* cache of another curve             */
+
+  NAXOS_PHASE(NAXOS_PH_KA_CHECK);
+  e = peerCacheGet(cache,pkBx,pkBy,curveN,&res);
+  if (e == NULL)
+  {
+    NAXOS_PHASE(NAXOS_PH_NONE);
+    return res;
+  }
+
+  if (convBytesToPoint(&Y,Yx,Yy,curveN)!= 1) res = -3;       /* The coords are not lower than p       */
+  else if (isOnTheCurve(&Y,curveN) != 1) res = -4;           /* Y is not on the curve                 */
+  else res = calculateKaPoint(kA,&Y,eskA,skAb,&e->P,e->table,idA,idB,curveN);
+  peerCacheRelease(cache,e);
+
+  naxosWipe(Y.aX,COORD_BYTES);         /* clear Y.aX               */
+  naxosWipe(Y.aY,COORD_BYTES);         /* clear Y.aY               */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  return res;
 }
 
-int calculateKa(keyC kA,keyC Yx,keyC Yy,keyC eskA,keyC skAb, keyC pkBx, keyC pkBy,keyC idA,keyC idB,ellipticCurve* curveN)
-/* It calculates kA using the x coordinates of the points on the curve
-   kA = H(Y*skA, pkB*H(eskA,skA), Y*H(eskA,skA), idA, idB)
-   Return:
-     1 = OK
-     -1 = coord of pkB are not mod p
-     -2 = pkB is not on the curve
-     -3 = coord of Y are not mod p
-     -4 = Y is not on the curve
-     -5 = internal error
+int calculateKbCached(keyC kB,keyC pkAx, keyC pkAy,keyC eskB,keyC skBb,keyC Xx,keyC Xy,keyC idA,keyC idB,ellipticCurve* curveN,peerCache* cache)
+/* It calculates kB as calculateKb, taking pkA from the cache:
+   for a peer already in the cache pkA is neither converted nor validated again, and
+   pkA*H(eskB,skB) is calculated with its comb table
+   Return: as calculateKb
 */
 {
-  pointA pkB,Y,t1A,t2A,t3A;        /* Temporary points on the curve   */
-  coord skA,hA;                    /* Temporary coordinates           */
-  uint8_t msg[FIVET_BYTES];
-  int byteLen,inputByteLen,t,res,i;
-
-  if (convBytesToPoint(&pkB,pkBx,pkBy,curveN)!= 1) return -1; /* The coords are not lower than p       */
-  if (isOnTheCurve(&pkB,curveN) != 1) return -2;              /* pkB is not on the curve               */
-  if (convBytesToPoint(&Y,Yx,Yy,curveN)!= 1) return -3;       /* The coords are not lower than p       */
-  if (isOnTheCurve(&Y,curveN) != 1) return -4;                /* Y is not on the curve                 */
+  peerEntry* e;
+  pointA X;
+  int res;
 
-  byteLen = (curveN->bsize+7)/8;
-  byteToWord(skA,skAb,byteLen);                               /* Convert skAb to skA in coord format   */
-  hashAndMod(hA,eskA,skAb,curveN);                            /* Calculate hA = H(eskA,skA)            */
+  if (cache->bsize != curveN->bsize) return -5;    /* cache of another curve             */
 
-  scalarMult(&t1A,skA,&Y,curveN->a,curveN->p,curveN->wsize);  /* Calculate t1A=Y*skA                   */
-  if (isOnTheCurve(&t1A,curveN) != 1) return -5;              /* t1A is not on the curve               */
+  NAXOS_PHASE(NAXOS_PH_KB_CHECK);
+  e = peerCacheGet(cache,pkAx,pkAy,curveN,&res);
+  if (e == NULL)
+  {
+    NAXOS_PHASE(NAXOS_PH_NONE);
+    return res;
+  }
 
-  scalarMult(&t2A,hA,&pkB,curveN->a,curveN->p,curveN->wsize); /* Calculate t2A=pkB*hA=pkB*H(eskA,skA)  */
-  if (isOnTheCurve(&t2A,curveN) != 1) return -5;              /* t2A is not on the curve               */
+  if (convBytesToPoint(&X,Xx,Xy,curveN)!= 1) res = -3;       /* The coords are not lower than p     */
+  else if (isOnTheCurve(&X,curveN) != 1) res = -4;           /* X is not on the curve               */
+  else res = calculateKbPoint(kB,&e->P,e->table,eskB,skBb,&X,idA,idB,curveN);
+  peerCacheRelease(cache,e);
 
-  scalarMult(&t3A,hA,&Y,curveN->a,curveN->p,curveN->wsize);   /* Calculate t3A=Y*hA=Y*H(eskA,skA)      */
-  if (isOnTheCurve(&t3A,curveN) != 1) return -5;              /* t3A is not on the curve               */
+  naxosWipe(X.aX,COORD_BYTES);         /* clear X.aX               */
+  naxosWipe(X.aY,COORD_BYTES);         /* clear X.aY               */
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  return res;
+}
 
+static void* (* _Atomic batchAlloc)(size_t size) = malloc;   /* scratch of the batch functions */
 
-  wordToByte(msg,t1A.aX,curveN->wsize);                       /* Append coord x of t1A to msg          */
-  wordToByte(&msg[byteLen],t2A.aX,curveN->wsize);             /* Append coord x of t2A to msg          */
+void naxosSetBatchAlloc(void* (*alloc)(size_t size))
+/* It sets the allocation function of the scratch of the batch functions, see Naxos.h */
+{
+  atomic_store(&batchAlloc,(alloc == NULL)?malloc:alloc);
+}
 
-  inputByteLen = byteLen*2;
+size_t batchScratchBytes(int n)
+/* It returns the bytes of the scratch of a batch of n sessions: the 3n points and scalars of
+   calculateKBatch, more than the n points of calculateXYBatchScratch
+*/
+{
+  return (n < 1)?0:3*(size_t)n*(sizeof(pointP)+sizeof(pointA)+sizeof(coord));
+}
 
-  wordToByte(&msg[inputByteLen],t3A.aX,curveN->wsize);        /* Append coord x of t3A to msg          */
+int calculateXYBatchScratch(sessionXY* s,int n,void* scratch,ellipticCurve* curveN)
+/* It calculates calculateXY for the n sessions s[i], with only one inversion:
+   the n points X = G*H(esk,sk) are calculated in Projective coordinates in scratch and then
+   converted all together by cProjToAffineBatch
+   Return: 1 = OK
+*/
+{
+  pointP* R;
+  pointA* X;
+  coord h;
+  int i;
 
-  t = inputByteLen + byteLen;
-  inputByteLen = t + byteLen;
+  if (n < 1) return 1;
+  R = (pointP*)scratch;
+  X = (pointA*)(R+n);
 
-  for (i=0;i<byteLen;i++)                                     /* Append idA and idB to msg             */
+  NAXOS_PHASE(NAXOS_PH_XY_MULT);               /* hash and product of each session together */
+  for (i=0;i<n;i++)
   {
-  	msg[t+i] = idA[i];
-  	msg[inputByteLen+i] = idB[i];
+    s[i].res = 1;
+    do
+    {
+      if (randomGen(s[i].esk,curveN->bsize) != 1)   /* Generate esk using an entropy source */
+      {
+        s[i].res = -1;
+        break;
+      }
+      if (hashAndMod(h,s[i].esk,s[i].sk,curveN) != 1)  /* Calculate h = H(esk,sk)           */
+      {
+        s[i].res = -5;
+        break;
+      }
+      scalarMultBaseProj(&R[i],h,curveN);      /* R[i] = G*h = G*H(esk,sk)                  */
+    } while ((1 == coordIsZero(h,curveN->wsize)) || (1 == coordIsZero(R[i].pZ,curveN->wsize)));
+                                               /* h and the Z of X must be different than 0 */
+    if (s[i].res != 1)                         /* dummy point for the batch inversion       */
+    {
+      coordInit(R[i].pX);
+      coordInit(R[i].pY);
+      coordCopy(R[i].pZ,curveN->r1);
+    }
   }
 
-  inputByteLen = inputByteLen + byteLen;
-
-  switch(curveN->bsize)
+  cProjToAffineBatch(X,R,n,curveN);            /* X[i] = affine(R[i]), one inversion         */
+  for (i=0;i<n;i++)
   {
-  	case NIST_P224:
-  		res = SHA3_224(kA,msg,inputByteLen);
-  		break;
-
-  	case NIST_P256:
-  		res = SHA3_256(kA,msg,inputByteLen);
-  		break;
-
-  	case NIST_P384:
-  		res = SHA3_384(kA,msg,inputByteLen);
-  		break;
-
-  	case NIST_P521:
-  		res = SHA3_512(kA,msg,inputByteLen);
-  		break;
-
-    default:
-      return -1;
+    if (s[i].res == 1)
+    {
+      convPointToBytes(s[i].Xx,s[i].Xy,&X[i],curveN); /* Convert X in byte array format      */
+    }
+    else                                       /* no X from an esk that is not random or    */
+    {                                          /* without H(esk,sk)                         */
+      naxosWipe(s[i].esk,sizeof(keyC));
+      memset(s[i].Xx,0,sizeof(keyC));
+      memset(s[i].Xy,0,sizeof(keyC));
+    }
   }
 
-  memset(msg, 0, FIVET_BYTES);         /* clear msg                */
-  coordInit(pkB.aX);                   /* clear pkB.aX             */
-  coordInit(pkB.aY);                   /* clear pkB.aY             */
-  coordInit(Y.aX);                     /* clear Y.azX               */
-  coordInit(Y.aY);                     /* clear Y.azY               */
-  coordInit(t1A.aX);                   /* clear t1A.aX             */
-  coordInit(t1A.aY);                   /* clear t1A.aY             */
-  coordInit(t2A.aX);                   /* clear t2A.aX             */
-  coordInit(t2A.aY);                   /* clear t2A.aY             */
-  coordInit(t3A.aX);                   /* clear t3A.aX             */
-  coordInit(t3A.aY);                   /* clear t3A.aY             */
-  coordInit(skA);                      /* clear skA                */
-  coordInit(hA);                       /* clear hA                 */
-
-  if (res!=0)
-    return -1;
-
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  naxosWipe(h,COORD_BYTES);                    /* clear h                                   */
+  naxosWipe(scratch,n*(sizeof(pointP)+sizeof(pointA)));  /* clear R and X: the scratch may   */
+                                               /* be freed next, a memset would be removed  */
   return 1;
 }
 
-int calculateKb(keyC kB,keyC pkAx, keyC pkAy,keyC eskB,keyC skBb,keyC Xx,keyC Xy,keyC idA,keyC idB,ellipticCurve* curveN)
-/* It calculates kB using the x coordinates of the points on the curve
-   kB = H(pkA*H(eskB,skB), X*skB, X*H(eskB,skB), idA, idB)
-   Return:
-     1 = OK
-     -1 = coord of pkA are not mod p
-     -2 = pkA is not on the curve
-     -3 = coord of X are not mod p
-     -4 = X is not on the curve
-     -5 = internal error
-*/
+int calculateXYBatch(sessionXY* s,int n,ellipticCurve* curveN)
+/* It calculates calculateXYBatchScratch with a scratch given by the allocation function */
 {
-  pointA pkA,X,t1B,t2B,t3B;        /* Temporary points on the curve   */
-  coord skB,hB;                    /* Temporary coordinates           */
-  uint8_t msg[FIVET_BYTES];
-  int byteLen,inputByteLen,t,res,i;
-
-  if (convBytesToPoint(&pkA,pkAx,pkAy,curveN)!= 1) return -1; /* The coords are not lower than p     */
-  if (isOnTheCurve(&pkA,curveN) != 1) return -2;              /* pkB is not on the curve             */
-  if (convBytesToPoint(&X,Xx,Xy,curveN)!= 1) return -3;       /* The coords are not lower than p     */
-  if (isOnTheCurve(&X,curveN) != 1) return -4;                /* Y is not on the curve               */
-
-  byteLen = (curveN->bsize+7)/8;
-  byteToWord(skB,skBb,byteLen);                               /* Convert skBb to skB in coord format */
-  hashAndMod(hB,eskB,skBb,curveN);                            /* Calculate hB = H(eskB,skB)          */
-
-  scalarMult(&t1B,hB,&pkA,curveN->a,curveN->p,curveN->wsize); /* Calculate t1B=pkA*hB=pkA*H(eskB,skB */
-  if (isOnTheCurve(&t1B,curveN) != 1) return -5;              /* t1A is not on the curve             */
-
-  scalarMult(&t2B,skB,&X,curveN->a,curveN->p,curveN->wsize);  /* Calculate t2B=X*skB                 */
-  if (isOnTheCurve(&t2B,curveN) != 1) return -5;              /* t2B is not on the curve             */
-
-  scalarMult(&t3B,hB,&X,curveN->a,curveN->p,curveN->wsize);   /* Calculate t2B=X*hB=X*H(eskB,skB)    */
-  if (isOnTheCurve(&t3B,curveN) != 1) return -5;              /* t3B is not on the curve             */
+  void* scratch;
+  int res;
+
+  if (n < 1) return 1;
+  scratch = atomic_load(&batchAlloc)(batchScratchBytes(n));
+  if (scratch == NULL) return -1;
+  res = calculateXYBatchScratch(s,n,scratch,curveN);
+  free(scratch);
+  return res;
+}
 
+int calculateKBatch(sessionK* s,int n,int isA,void* scratch,ellipticCurve* curveN)
+/* It calculates calculateKa (isA = 1) or calculateKb (isA = 0) for the n sessions s[i],
+   with only one inversion: the 3 points of each session are calculated in Projective
+   coordinates, in the lanes of scalarMultLanesProj where available, and then the 3n points
+   are converted all together by cProjToAffineBatch.
+   The points and the scalars of the batch are in scratch, batchScratchBytes(n) bytes
+   The sessions with errors get a dummy point with Z = 1 in the batch
+   s[i].res is set as the return code of calculateKa or calculateKb
+   Return: 1 = OK
+*/
+{
+  pointP* R;
+  pointA* T;
+  coord* K;
+  pointA pk,E;
+  coord sk,h;
+  int i,j,res,byteLen;
+
+  if (n < 1) return 1;
+  R = (pointP*)scratch;
+  T = (pointA*)(R+3*n);
+  K = (coord*)(T+3*n);
   byteLen = (curveN->bsize+7)/8;
 
-  wordToByte(msg,t1B.aX,curveN->wsize);                       /* Append coord x of t1B to msg        */
-  wordToByte(&msg[byteLen],t2B.aX,curveN->wsize);             /* Append coord x of t2B to msg        */
-
-  inputByteLen = byteLen*2;
+  NAXOS_PHASE(isA?NAXOS_PH_KA_CHECK:NAXOS_PH_KB_CHECK);
+  for (i=0;i<n;i++)                                    /* scalars and points of the 3n products */
+  {
+    res = 1;
+    if (convBytesToPoint(&pk,s[i].pkx,s[i].pky,curveN) != 1) res = -1;         /* pk coords not lower than p */
+    else if (isOnTheCurve(&pk,curveN) != 1) res = -2;                           /* pk not on the curve        */
+    else if (convBytesToPoint(&E,s[i].ePx,s[i].ePy,curveN) != 1) res = -3;      /* coords not lower than p    */
+    else if (isOnTheCurve(&E,curveN) != 1) res = -4;                            /* Y (X) not on the curve     */
 
-  wordToByte(&msg[inputByteLen],t3B.aX,curveN->wsize);        /* Append coord x of t3B to msg        */
+    if (res == 1)
+    {
+      byteToWord(sk,s[i].sk,byteLen);                  /* Convert sk in coord format            */
+      if (hashAndMod(h,s[i].esk,s[i].sk,curveN) != 1) res = -5;   /* Calculate h = H(esk,sk)    */
+    }
+    if (res == 1)
+    {
+      if (isA)
+      {
+        coordCopy(K[3*i],sk);                          /* t1A = Y*skA                           */
+        T[3*i] = E;
+        coordCopy(K[3*i+1],h);                         /* t2A = pkB*H(eskA,skA)                 */
+        T[3*i+1] = pk;
+      }
+      else
+      {
+        coordCopy(K[3*i],h);                           /* t1B = pkA*H(eskB,skB)                 */
+        T[3*i] = pk;
+        coordCopy(K[3*i+1],sk);                        /* t2B = X*skB                           */
+        T[3*i+1] = E;
+      }
+      coordCopy(K[3*i+2],h);                           /* t3 = Y*H(eskA,skA) or X*H(eskB,skB)   */
+      T[3*i+2] = E;
+    }
+    else                                               /* dummy products G*1                    */
+    {
+      for (j=3*i;j<3*i+3;j++)
+      {
+        coordInit(K[j]);
+        K[j][0] = 1;
+        T[j] = curveN->g;
+      }
+    }
+    s[i].res = res;
+  }
 
-  t = inputByteLen + byteLen;
-  inputByteLen = t + byteLen;
+  NAXOS_PHASE(isA?NAXOS_PH_KA_MULT:NAXOS_PH_KB_MULT);
+  scalarMultLanesProj(R,K,T,3*n,curveN);              /* R[j] = K[j]*T[j]                      */
+  NAXOS_COUNT(smult,3*n);
 
-  for (i=0;i<byteLen;i++)                                     /* Append idA and idB to msg           */
+  for (i=0;i<n;i++)
   {
-  	msg[t+i] = idA[i];
-  	msg[inputByteLen+i] = idB[i];
+    for (j=3*i;j<3*i+3;j++)
+    {
+      if ((s[i].res == 1) && (coordIsZero(R[j].pZ,curveN->wsize) == 1)) s[i].res = -5;  /* point at infinity */
+    }
+    if (s[i].res != 1)                                 /* dummy points for the batch inversion  */
+    {
+      for (j=3*i;j<3*i+3;j++)
+      {
+        coordInit(R[j].pX);
+        coordInit(R[j].pY);
+        coordCopy(R[j].pZ,curveN->r1);
+      }
+    }
   }
 
-  inputByteLen = inputByteLen + byteLen;
+  cProjToAffineBatch(T,R,3*n,curveN);                /* T[j] = affine(R[j]), one inversion    */
 
-  switch(curveN->bsize)
+  NAXOS_PHASE(isA?NAXOS_PH_KA_HASH:NAXOS_PH_KB_HASH);
+  for (i=0;i<n;i++)
   {
-  	case NIST_P224:
-  		res = SHA3_224(kB,msg,inputByteLen);
-  		break;
-
-  	case NIST_P256:
-  		res = SHA3_256(kB,msg,inputByteLen);
-  		break;
-
-  	case NIST_P384:
-  		res = SHA3_384(kB,msg,inputByteLen);
-  		break;
+    if (s[i].res != 1) continue;
+    for (j=3*i;j<3*i+3;j++)
+    {
+      if (isOnTheCurve(&T[j],curveN) != 1) s[i].res = -5;   /* t1, t2, t3 not on the curve   */
+    }
+    if (s[i].res == 1)
+    {
+      s[i].res = hashK(s[i].k,&T[3*i],&T[3*i+1],&T[3*i+2],s[i].idA,s[i].idB,curveN);
+    }
+  }
 
-  	case NIST_P521:
-  		res = SHA3_512(kB,msg,inputByteLen);
-  		break;
+  NAXOS_PHASE(NAXOS_PH_NONE);
+  naxosWipe(sk,COORD_BYTES);                           /* clear sk                              */
+  naxosWipe(h,COORD_BYTES);                            /* clear h                               */
+  naxosWipe(pk.aX,COORD_BYTES);                        /* clear pk                              */
+  naxosWipe(pk.aY,COORD_BYTES);
+  naxosWipe(E.aX,COORD_BYTES);                         /* clear E                               */
+  naxosWipe(E.aY,COORD_BYTES);
+  naxosWipe(scratch,batchScratchBytes(n));             /* clear R, T and K: sk, h and the t     */
+                                                       /* points; the scratch may be freed     */
+                                                       /* next, a memset would be removed      */
+  return 1;
+}
 
-    default:
-      return -1;
-  }
+int calculateKBatchAlloc(sessionK* s,int n,int isA,ellipticCurve* curveN)
+/* It calculates calculateKBatch with a scratch given by the allocation function
+   Return: 1 = OK, -1 = memory allocation error
+*/
+{
+  void* scratch;
+  int res;
+
+  if (n < 1) return 1;
+  scratch = atomic_load(&batchAlloc)(batchScratchBytes(n));
+  if (scratch == NULL) return -1;
+  res = calculateKBatch(s,n,isA,scratch,curveN);
+  free(scratch);
+  return res;
+}
 
-  memset(msg, 0, FIVET_BYTES);         /* clear msg                */
-  coordInit(pkA.aX);                   /* clear pkA.aX             */
-  coordInit(pkA.aY);                   /* clear pkA.aY             */
-  coordInit(X.aX);                     /* clear X.aX               */
-  coordInit(X.aY);                     /* clear X.aY               */
-  coordInit(t1B.aX);                   /* clear t1B.aX             */
-  coordInit(t1B.aY);                   /* clear t1B.aY             */
-  coordInit(t2B.aX);                   /* clear t2B.aX             */
-  coordInit(t2B.aY);                   /* clear t2B.aY             */
-  coordInit(t3B.aX);                   /* clear t3B.aX             */
-  coordInit(t3B.aY);                   /* clear t3B.aY             */
-  coordInit(skB);                      /* clear skB                */
-  coordInit(hB);                       /* clear hB                 */
+int calculateKaBatch(sessionK* s,int n,ellipticCurve* curveN)
+/* It calculates calculateKa for the n sessions s[i] with only one inversion, see calculateKBatch */
+{
+  return calculateKBatchAlloc(s,n,1,curveN);
+}
 
+int calculateKbBatch(sessionK* s,int n,ellipticCurve* curveN)
+/* It calculates calculateKb for the n sessions s[i] with only one inversion, see calculateKBatch */
+{
+  return calculateKBatchAlloc(s,n,0,curveN);
+}
 
-  if (res==1)
-    return -1;
+int calculateKaBatchScratch(sessionK* s,int n,void* scratch,ellipticCurve* curveN)
+/* It calculates calculateKa for the n sessions s[i] in scratch, see calculateKBatch */
+{
+  return calculateKBatch(s,n,1,scratch,curveN);
+}
 
-  return 1;
+int calculateKbBatchScratch(sessionK* s,int n,void* scratch,ellipticCurve* curveN)
+/* It calculates calculateKb for the n sessions s[i] in scratch, see calculateKBatch */
+{
+  return calculateKBatch(s,n,0,scratch,curveN);
 }
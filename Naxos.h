@@ -26,6 +26,31 @@
 #define NIST_P384 384     /* Index for NIST curve P-384          */
 #define NIST_P521 521     /* Index for NIST curve P-521          */
 
+#define INV_FERMAT   1    /* Inversion a^(p-2) with the Montgomery ladder          */
+#define INV_SAFEGCD  2    /* Constant-time safegcd inversion (Bernstein-Yang)      */
+
+#define ENTROPY_DRBG   1  /* Per-thread SHAKE256 DRBG seeded by getrandom, see selectEntropy */
+#define ENTROPY_SYSTEM 2  /* getrandom at each call                                      */
+#define ENTROPY_RDRAND 3  /* RDRAND instruction of x86                                   */
+#define ENTROPY_USER   4  /* Function of the user                                        */
+
+#define WIN_WMIN     4    /* Minimum window of the fixed-window scalarMult         */
+#define WIN_WMAX     6    /* Maximum window: table of 2^(6-1) = 32 odd multiples  */
+
+#define GTAB_WBITS   4    /* Bits of the windows of the fixed-base tables of G    */
+#define GTAB_NPOINTS 8    /* Points per window: 1*B, ..., 8*B, B = 2^(4*j)*G       */
+
+#define NAXOS_PH_NONE     0   /* Phases of the counters: outside the phases below        */
+#define NAXOS_PH_XY_HASH  1   /* calculateXY: esk and H(esk,sk)                          */
+#define NAXOS_PH_XY_MULT  2   /* calculateXY: X = G*H(esk,sk)                            */
+#define NAXOS_PH_KA_CHECK 3   /* calculateKa: conversion and validation of pkB and Y     */
+#define NAXOS_PH_KA_MULT  4   /* calculateKa: H(eskA,skA) and the scalar multiplications */
+#define NAXOS_PH_KA_HASH  5   /* calculateKa: kA = H(x1, x2, x3, idA, idB)               */
+#define NAXOS_PH_KB_CHECK 6   /* calculateKb: conversion and validation of pkA and X     */
+#define NAXOS_PH_KB_MULT  7   /* calculateKb: H(eskB,skB) and the scalar multiplications */
+#define NAXOS_PH_KB_HASH  8   /* calculateKb: kB = H(x1, x2, x3, idA, idB)               */
+#define NAXOS_PHASES      9   /* Number of phases, also: sum of all the phases           */
+
 
 typedef uint64_t coord[COORD_NWORDS];
 
@@ -35,18 +60,65 @@ typedef struct pointA     /* Point with Affine coordinates       */
   coord aY;
 } pointA;
 
+typedef struct pointP     /* Point with Projective coordinates   */
+{
+  coord pX;
+  coord pY;
+  coord pZ;
+} pointP;
+
+typedef struct hashDesc     /* Keccak sponge of the hash functions of a curve, see selectCurve */
+{
+  uint16_t rate;             /* rate in bits, capacity = 1600 - rate, 0 = no hash functions */
+  uint16_t hlen;             /* bytes of H(esk,sk) and of generateRand                       */
+  uint16_t klen;             /* bytes of the key K = H(x1, x2, x3, idA, idB)                 */
+} hashDesc;
+
+typedef KeccakWidth1600_SpongeInstance hashState;   /* sponge of hashInit, hashAbsorb, hashFinal */
+
 typedef struct ellipticCurve /* Elliptic curve of type: y^2 = x^3 -ax + b mod p. */
 {
   uint16_t bsize;            /* number of bits                   */
   uint16_t wsize;            /* number of words                  */
-  coord a;
-  coord b;
+  coord a;                   /* in Montgomery form               */
+  coord b;                   /* in Montgomery form               */
   coord p;
-  pointA g;                  /* base point                       */
+  coord pm2;                 /* p - 2, exponent of coordInvML    */
+  uint16_t pbits;            /* bits of p, length of the ladders */
+  pointA g;                  /* base point in Montgomery form    */
+  coord r1;                  /* R mod p, i.e. 1 in Montgomery form */
+  coord r2;                  /* R^2 mod p, used to convert numbers in Montgomery form    */
+  uint64_t pInv;             /* -p^-1 mod 2^64                   */
+  void (*mul)(coord c,coord a,coord b,struct ellipticCurve* curve);
+                             /* c = a*b mod p: Montgomery multiplication with R = 2^(64*wsize),
+                                or product and fast reduction of the NIST primes with R = 1 */
+  void (*inv)(coord c,coord a,struct ellipticCurve* curve);
+                             /* c = a^-1 mod p in Montgomery form, see selectInversion */
+  uint16_t wbits;            /* window of scalarMult, 0 = Montgomery ladder, see selectScalarMult */
+  const uint64_t* gTable;    /* fixed-base table of G, see scalarMultBase, NULL if not available
+                                (built by curveCreate for the curves defined by the user)        */
+  hashDesc hash;             /* SHA3 of the size of the curve (SHA3-512 rate for P-521)       */
+  uint16_t sqrtS;            /* p - 1 = 2^sqrtS * q with q odd, 1 if p = 3 mod 4, see coordSqrt */
+  coord sqrtZ;               /* z^q with z a non-residue, Tonelli-Shanks for P-224            */
 } ellipticCurve;
 
 typedef uint8_t keyC[COORD_BYTES]; /* Coordinate X or Y of a point on the curve in byte array format */
 
+typedef uint8_t keyPC[COORD_BYTES+1]; /* Compressed point: 2 + (y mod 2), then x as keyC, (bsize+7)/8+1 bytes */
+
+typedef struct naxosCounters  /* Operations of a thread in a phase, see naxosCountersGet          */
+{
+  uint64_t mul;              /* coordMul, also the ones of the inversions and of coordToMont   */
+  uint64_t add;              /* coordAdd                                                        */
+  uint64_t sub;              /* coordSub                                                        */
+  uint64_t dbl;              /* coordDouble                                                     */
+  uint64_t inv;              /* inversions, any backend (coordInvML, coordInvSafegcd)           */
+  uint64_t smult;            /* scalar multiplications, fixed or variable base                  */
+  uint64_t hash;             /* SHA3 calls (hashFinal)                                          */
+} naxosCounters;
+
+typedef struct peerCache peerCache; /* Cache of the validated public keys of the peers, see peerCacheCreate */
+
 int selectCurve(ellipticCurve* curve,int index);
 /* It selects the elliptic curve among the ones recommended by NIST
      FIPS PUB 186-4, Digital Signature Standard (DSS)
@@ -55,22 +127,172 @@ int selectCurve(ellipticCurve* curve,int index);
    By using the routines included in this package, new curves can be built
    over different primes.
    Curve parameters are represented as in the NIST with less significant word on the right
+   The field elements a, b and g are stored in Montgomery form (x*R mod p) as
+   all the internal arithmetic; they are converted only to/from byte arrays
+   P-224, P-256, P-384 and P-521 use the fast reduction of their primes in FIPS PUB 186-4 D.2,
+   and R = 1, the other curves use the Montgomery multiplication with R = 2^(64*wsize)
    index = NIST_P192, NIST_P224, NIST_P256, NIST_P384, NIST_P521
+   The curve is copied from its shared context (see curveContext), therefore it can be
+   changed by selectInversion and selectScalarMult
+   Return:
+     1 = OK
+    -1 = index not valid
+*/
+
+ellipticCurve* curveContext(int index);
+/* It returns the context of the NIST curve index (see selectCurve): the parameters and all the
+   derived constants (bits of p, p - 2, Montgomery constants, hash descriptor, table of G,
+   constants of coordSqrt). The contexts are built only once, at the first call from any thread,
+   and they are shared: they can be passed to all the functions of the library by any number of
+   threads at the same time, but they must not be changed (use selectCurve to get a copy)
+   Return: the context, NULL if index is not valid
+*/
+
+ellipticCurve* curveCreate(keyC p,keyC a,keyC b,keyC gX,keyC gY,int bsize);
+/* It builds the context of a curve defined by the user: y^2 = x^3 -ax + b mod p with the base
+   point G = (gX,gY), in the byte array format of the keys ((bsize+7)/8 bytes, see publicKey)
+   p must be a prime of exactly bsize bits, with bsize a multiple of 8 between 128 and 512,
+   the primality of p is not checked: for p = 1 mod 4 the search of the non-residue of
+   coordSqrt only rejects the p without a non-residue lower than 1000 (SQRT_MAX_Z), which can
+   happen when p is not prime. The Montgomery multiplication is used, the hash functions are
+   the SHA3 of the next NIST size, and the fixed-base table of G is calculated.
+   The context is shared as the ones of curveContext and it is freed by curveDestroy
+   Return: the context, NULL if the parameters are not valid (G not on the curve, a, b, gX or gY
+           not lower than p, p even or not of bsize bits, p = 1 mod 4 without a non-residue lower
+           than 1000) or there is no memory
+*/
+
+void curveDestroy(ellipticCurve* curve);
+/* It clears and frees the context created by curveCreate */
+
+int selectInversion(ellipticCurve* curve,int backend);
+/* It selects the modular inversion used by the curve (Projective to Affine conversions):
+     INV_SAFEGCD = constant-time safegcd (divsteps), about 2.2*bits of p steps on 62 bits words,
+                   the default where the compiler supports 128 bits integers
+     INV_FERMAT  = a^(p-2) with the Montgomery ladder, about 2*bits of p multiplications
+   Return:
+     1 = OK
+    -1 = backend not available
+*/
+
+int selectScalarMult(ellipticCurve* curve,int wbits);
+/* It selects the variable-base scalar multiplication used by the curve (Ka, Kb):
+     wbits = 0:                   Montgomery ladder with co-Z addition, the default if the
+                                  library is compiled with -DNAXOS_WBITS=0
+     wbits = WIN_WMIN..WIN_WMAX:  signed fixed window of wbits bits, table of the 2^(wbits-1)
+                                  odd multiples of the point, read entirely at each addition;
+                                  4 bits is the default (NAXOS_WBITS)
+   Both are constant-time
+   Return:
+     1 = OK
+    -1 = window not available
+*/
+
+int naxosCountersGet(naxosCounters* c,int phase);
+/* It copies in c the counters of the calling thread for the phase NAXOS_PH_xxx,
+   or their sum over all the phases if phase = NAXOS_PHASES
+   The counters exist only if the library is compiled with -DNAXOS_COUNTERS, otherwise
+   nothing is counted and there is no cost
+   Return:
+     1 = OK
+    -1 = phase not valid or library compiled without NAXOS_COUNTERS, c is set to 0
+*/
+
+void naxosCountersReset(void);
+/* It sets to 0 the counters of the calling thread */
+
+const char* naxosPhaseName(int phase);
+/* It returns the name of the phase NAXOS_PH_xxx, "all" for NAXOS_PHASES */
+
+int hashInit(hashState* s,ellipticCurve* curve);
+/* It initializes the sponge s with the SHA3 function of the curve (curve->hash)
+   The input is absorbed by hashAbsorb and hashAbsorbCoord as it is produced, without
+   staging buffers, and the digest is squeezed by hashFinal
+   Return:
+     1 = OK
+    -1 = the curve has no hash functions
+*/
+
+void hashAbsorb(hashState* s,const uint8_t* data,int len);
+/* It absorbs len bytes of data in the sponge s */
+
+void hashAbsorbCoord(hashState* s,coord a,int len);
+/* It absorbs the first len bytes of a in the sponge s, in the order of wordToByte */
+
+int hashFinal(hashState* s,uint8_t* out,int len);
+/* It pads the message with the SHA3 suffix, squeezes len bytes in out and clears s
+   Return:
+     1 = OK
+    -1 = error
 */
 
 int generateRand(keyC num,ellipticCurve* curve);
-/* It generates non cryptographic secure random numbers mod p */
+/* It generates random numbers mod p with randomGen and the Keccak functions */
 
 int  publicKey(keyC pkx,keyC pky,keyC sk,ellipticCurve* curveN);
 /* It calculates the public key pkx, pky from the secret key sk
    pk = G*sk
 */
 
+int publicKeyCompressed(keyPC pk,keyC sk,ellipticCurve* curveN);
+/* It calculates the public key pk = G*sk in compressed format
+   Return: as publicKey
+*/
+
+int compressPoint(keyPC pC,keyC pX,keyC pY,ellipticCurve* curve);
+/* It converts the point pX, pY in compressed format pC: the first byte is 2 + (y mod 2) as in
+   SEC1, followed by the (bsize+7)/8 bytes of x in the byte order of keyC
+   The point is not checked to be on the curve
+   Return:
+     1 = OK
+    -1 = coord are not mod p
+*/
+
+int decompressPoint(keyC pX,keyC pY,keyPC pC,ellipticCurve* curve);
+/* It converts the compressed point pC in pX, pY. y is the square root of x^3 - ax + b,
+   calculated in constant time (a^((p+1)/4), or Tonelli-Shanks for P-224)
+   Return:
+     1 = OK
+    -1 = x is not mod p or the first byte is not 2 or 3
+    -2 = there is no point with coord x on the curve
+*/
+
 int randomGen(uint8_t* esk,int nbits);
-/* It generates a random number of nbits using the /dev/urandom device */
+/* It generates a random number of nbits with the entropy source of selectEntropy
+   Return:
+     1 = OK
+    -1 = the entropy source failed
+*/
+
+int selectEntropy(int backend,int (*source)(uint8_t* buf,int len));
+/* It selects the entropy source of randomGen (esk of calculateXY) for all the threads:
+     ENTROPY_DRBG   = the default: a DRBG for each thread, SHAKE256 of a 64 bytes key with
+                      the output buffered 512 bytes at a time, and a new key for each buffer
+                      (forward secrecy). The key is seeded by getrandom, and it is reseeded
+                      every 4096 buffers (2 MB) and in the child after a fork
+     ENTROPY_SYSTEM = getrandom (urandom source of the kernel) at each call
+     ENTROPY_RDRAND = RDRAND instruction of x86, where the processor supports it
+     ENTROPY_USER   = source(buf,len) must fill buf with len random bytes and return 1
+   It can be called while other threads use randomGen: a call of randomGen already started
+   may still use the previous source
+   Return:
+     1 = OK
+    -1 = backend not available
+*/
+
+void randomClear(void);
+/* It clears the state of the DRBG of the calling thread, e.g. before the thread exits */
+
+int calculateXY(keyC Xx,keyC Xy,keyC esk,keyC sk,ellipticCurve* curveN);
+/* It generates esk and calculates X=G*H(esk,sk), using the proper SHA3 function
+   Return:
+     1 = OK
+    -1 = the entropy source failed (see randomGen): esk and X are set to 0 and must not be used
+    -5 = the curve has no hash functions (P-192): esk and X are set to 0 and must not be used
+*/
 
-void calculateXY(keyC Xx,keyC Xy,keyC esk,keyC sk,ellipticCurve* curveN);
-/* It generates esk and calculates X=G*H(esk,sk), using the proper SHA3 function */
+int calculateXYCompressed(keyPC X,keyC esk,keyC sk,ellipticCurve* curveN);
+/* As calculateXY with X in compressed format, see compressPoint */
 
 int calculateKa(keyC kA,keyC Yx,keyC Yy,keyC eskA,keyC skAb, keyC pkBx, keyC pkBy,keyC idA,keyC idB,ellipticCurve* curveN);
 /* It calculates kA using the x coordinates of the points on the curve
@@ -96,4 +318,111 @@ int calculateKb(keyC kB,keyC pkAx, keyC pkAy,keyC eskB,keyC skBb,keyC Xx,keyC Xy
      -5 = internal error
 */
 
+int calculateKaCompressed(keyC kA,keyPC Y,keyC eskA,keyC skAb,keyPC pkB,keyC idA,keyC idB,ellipticCurve* curveN);
+/* As calculateKa with Y and pkB in compressed format, see compressPoint
+   The decompression replaces the check that the points are on the curve
+   Return: as calculateKa, -2 (-4) when there is no point of the curve with the coord x of pkB (Y)
+*/
+
+int calculateKbCompressed(keyC kB,keyPC pkA,keyC eskB,keyC skBb,keyPC X,keyC idA,keyC idB,ellipticCurve* curveN);
+/* As calculateKb with pkA and X in compressed format, see compressPoint
+   Return: as calculateKb, -2 (-4) when there is no point of the curve with the coord x of pkA (X)
+*/
+
+peerCache* peerCacheCreate(ellipticCurve* curveN,int maxPeers);
+/* It creates a thread-safe cache of the public keys of at most maxPeers peers for the curve curveN
+   Each entry, keyed by the public key bytes, holds the validated point and a comb table
+   of its multiples (about 8 KB for P-256, 38 KB for P-521).
+   When it is full the least recently used entry is evicted (clock algorithm)
+   It returns NULL in case of error
+*/
+
+void peerCacheDestroy(peerCache* cache);
+/* It frees the cache. No thread may be using it */
+
+int calculateKaCached(keyC kA,keyC Yx,keyC Yy,keyC eskA,keyC skAb, keyC pkBx, keyC pkBy,keyC idA,keyC idB,ellipticCurve* curveN,peerCache* cache);
+/* As calculateKa, with pkB taken from the cache: for the peers already in the cache pkB is
+   not validated again and pkB*H(eskA,skA) is calculated with its precomputed table
+   Return: as calculateKa
+*/
+
+int calculateKbCached(keyC kB,keyC pkAx, keyC pkAy,keyC eskB,keyC skBb,keyC Xx,keyC Xy,keyC idA,keyC idB,ellipticCurve* curveN,peerCache* cache);
+/* As calculateKb, with pkA taken from the cache: for the peers already in the cache pkA is
+   not validated again and pkA*H(eskB,skB) is calculated with its precomputed table
+   Return: as calculateKb
+*/
+
+typedef struct sessionXY   /* Session of calculateXYBatch                                   */
+{
+  keyC sk;                 /* input: secret key                                            */
+  keyC esk;                /* output: ephemeral secret key                                 */
+  keyC Xx;                 /* output: X = G*H(esk,sk)                                      */
+  keyC Xy;
+  int res;                 /* output: return code as calculateXY                           */
+} sessionXY;
+
+typedef struct sessionK    /* Session of calculateKaBatch and calculateKbBatch              */
+{
+  keyC k;                  /* output: kA or kB                                             */
+  keyC ePx;                /* input: ephemeral public key of the peer, Y for A, X for B    */
+  keyC ePy;
+  keyC pkx;                /* input: public key of the peer, pkB for A, pkA for B          */
+  keyC pky;
+  keyC esk;                /* input: own ephemeral secret key, eskA or eskB                */
+  keyC sk;                 /* input: own secret key, skA or skB                            */
+  keyC idA;                /* input: identities                                            */
+  keyC idB;
+  int res;                 /* output: return code as calculateKa or calculateKb            */
+} sessionK;
+
+int calculateXYBatch(sessionXY* s,int n,ellipticCurve* curveN);
+/* It calculates calculateXY for the n sessions s[i], with only one inversion for all the points
+   (Montgomery's simultaneous inversion). s[i].res is set as the return code of calculateXY
+   (-1 or -5 with esk and X set to 0)
+   Return:
+     1 = OK
+    -1 = memory allocation error, no session calculated
+*/
+
+int calculateXYBatchScratch(sessionXY* s,int n,void* scratch,ellipticCurve* curveN);
+/* As calculateXYBatch, with the points of the batch in scratch instead of allocated:
+   batchScratchBytes(n) bytes aligned to 8 bytes, wiped before returning
+   Return: 1 = OK
+*/
+
+int calculateKaBatch(sessionK* s,int n,ellipticCurve* curveN);
+/* It calculates calculateKa for the n sessions s[i], with only one inversion for all the 3n points
+   (Montgomery's simultaneous inversion). s[i].res is set as the return code of calculateKa
+   Return:
+     1 = OK
+    -1 = memory allocation error, no session calculated
+*/
+
+int calculateKbBatch(sessionK* s,int n,ellipticCurve* curveN);
+/* It calculates calculateKb for the n sessions s[i], with only one inversion for all the 3n points
+   (Montgomery's simultaneous inversion). s[i].res is set as the return code of calculateKb
+   Return:
+     1 = OK
+    -1 = memory allocation error, no session calculated
+*/
+
+int calculateKaBatchScratch(sessionK* s,int n,void* scratch,ellipticCurve* curveN);
+int calculateKbBatchScratch(sessionK* s,int n,void* scratch,ellipticCurve* curveN);
+/* As calculateKaBatch and calculateKbBatch, with the points and the scalars of the batch in
+   scratch instead of allocated: batchScratchBytes(n) bytes aligned to 8 bytes, wiped before
+   returning
+   Return: 1 = OK
+*/
+
+size_t batchScratchBytes(int n);
+/* It returns the bytes of the scratch of a batch of n sessions, for any curve and any of the
+   batch functions
+*/
+
+void naxosSetBatchAlloc(void* (*alloc)(size_t size));
+/* It sets the function that allocates the scratch of calculateXYBatch, calculateKaBatch and
+   calculateKbBatch (NULL = malloc), e.g. to test their memory allocation errors. It is called
+   once per call of these functions, its memory is released by free
+*/
+
 #endif /* #ifndef _NAXOS__  */
@@ -0,0 +1,100 @@
+/*
+   Secure arena of the secrets of the sessions. See NaxosArena.h
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "NaxosArena.h"
+
+struct naxosArena
+{
+  uint8_t* map;           /* mapping: guard page, data, guard page                 */
+  size_t mapSize;
+  uint8_t* data;
+  size_t size;            /* bytes of data, multiple of the page                   */
+  size_t top;             /* bytes allocated                                       */
+  int locked;             /* 1 = data locked by mlock                              */
+};
+
+naxosArena* naxosArenaCreate(size_t size)
+/* It maps the arena between two guard pages and locks it */
+{
+  naxosArena* arena;
+  size_t page;
+
+  page = (size_t)sysconf(_SC_PAGESIZE);
+  if ((size == 0) || (size > SIZE_MAX/2)) return NULL;
+  arena = (naxosArena*)calloc(1,sizeof(naxosArena));
+  if (arena == NULL) return NULL;
+
+  arena->size = (size+page-1)/page*page;
+  arena->mapSize = arena->size + 2*page;
+  arena->map = (uint8_t*)mmap(NULL,arena->mapSize,PROT_NONE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+  if (arena->map == MAP_FAILED)
+  {
+    free(arena);
+    return NULL;
+  }
+  arena->data = arena->map + page;             /* the first and the last page stay PROT_NONE */
+  if (mprotect(arena->data,arena->size,PROT_READ|PROT_WRITE) != 0)
+  {
+    munmap(arena->map,arena->mapSize);
+    free(arena);
+    return NULL;
+  }
+  arena->locked = (mlock(arena->data,arena->size) == 0);
+#ifdef MADV_DONTDUMP
+  madvise(arena->data,arena->size,MADV_DONTDUMP);      /* not in the core dumps             */
+#endif
+#ifdef MADV_WIPEONFORK
+  madvise(arena->data,arena->size,MADV_WIPEONFORK);    /* zero in the child after a fork    */
+#endif
+  return arena;
+}
+
+void* naxosArenaAlloc(naxosArena* arena,size_t len)
+/* It allocates len bytes from the top of the arena */
+{
+  size_t start;
+
+  start = (arena->top+ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+  if ((start > arena->size) || (len > arena->size-start)) return NULL;
+  arena->top = start+len;
+  return arena->data+start;               /* already 0: the arena is wiped when it is released */
+}
+
+size_t naxosArenaMark(naxosArena* arena)
+/* It returns the top of the arena */
+{
+  return arena->top;
+}
+
+void naxosArenaRelease(naxosArena* arena,size_t mark)
+/* It wipes the bytes from mark to the top with one memset and moves the top to mark */
+{
+  if (mark >= arena->top) return;
+  naxosWipe(arena->data+mark,arena->top-mark);
+  arena->top = mark;
+}
+
+int naxosArenaLocked(naxosArena* arena)
+/* It returns 1 if the arena is locked in RAM */
+{
+  return arena->locked;
+}
+
+void naxosArenaDestroy(naxosArena* arena)
+/* It wipes the whole arena, then it unlocks and unmaps it */
+{
+  if (arena == NULL) return;
+  naxosWipe(arena->data,arena->size);
+  if (arena->locked)
+  {
+    munlock(arena->data,arena->size);
+  }
+  munmap(arena->map,arena->mapSize);
+  free(arena);
+}
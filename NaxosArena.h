@@ -0,0 +1,58 @@
+/*
+   Secure arena of the secrets of the sessions.
+   The arena is a region of memory mapped with a guard page before and after it (an overflow
+   faults instead of reaching other data), locked in RAM with mlock (it is never written to the
+   swap), excluded from the core dumps and, where the kernel supports it, wiped in the child
+   after a fork. The memory is given by bump allocation: a session takes a mark, allocates its
+   secrets (keys, sessionXY, sessionK, ...) and at its end releases the mark, which wipes with
+   only one memset everything allocated after it.
+   An arena has no lock: it must be used by one thread at a time, e.g. one arena per thread.
+   naxosWipe is the only way the library clears a secret: the arena with it, and each function
+   with its own secret locals before returning (a memset of a dead local is removed by the
+   compiler, naxosWipe is not).
+*/
+
+#ifndef _NAXOS_ARENA__
+#define _NAXOS_ARENA__
+
+#include <stddef.h>
+#include <string.h>
+
+#define ARENA_ALIGN 64           /* Alignment of the allocations: one cache line  */
+
+typedef struct naxosArena naxosArena;
+
+naxosArena* naxosArenaCreate(size_t size);
+/* It creates an arena of at least size bytes (rounded up to pages)
+   If mlock fails (e.g. RLIMIT_MEMLOCK) the arena is created anyway, see naxosArenaLocked
+   It returns NULL in case of error
+*/
+
+void* naxosArenaAlloc(naxosArena* arena,size_t len);
+/* It allocates len bytes aligned to 64 bytes, set to 0
+   It returns NULL if the arena is full
+*/
+
+size_t naxosArenaMark(naxosArena* arena);
+/* It returns the mark of the current top of the arena, see naxosArenaRelease */
+
+void naxosArenaRelease(naxosArena* arena,size_t mark);
+/* It wipes and frees everything allocated after the mark (0 = the whole arena) */
+
+int naxosArenaLocked(naxosArena* arena);
+/* It returns 1 if the arena is locked in RAM, 0 otherwise */
+
+void naxosArenaDestroy(naxosArena* arena);
+/* It wipes, unlocks and unmaps the arena */
+
+static inline void naxosWipe(void* p,size_t len)
+/* It sets len bytes of p to 0, also when p is not used any more: the empty asm reads the
+   memory of p, so the memset is not removed as a dead store. It is inline, the kernels call it
+   on their temporaries at each call
+*/
+{
+  memset(p,0,len);
+  __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+#endif /* #ifndef _NAXOS_ARENA__  */
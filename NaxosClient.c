@@ -0,0 +1,143 @@
+/*
+   Client library of the initiator A for the handshake server. See NaxosClient.h
+*/
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "NaxosClient.h"
+#include "NaxosArena.h"
+#include "NaxosWire.h"
+
+int naxosClientConnectUnix(const char* path)
+/* It connects a Unix-domain socket to path */
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,path);
+  fd = socket(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0);
+  if ((fd >= 0) && (connect(fd,(struct sockaddr*)&addr,sizeof(addr)) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int naxosClientConnectTcp(int port)
+/* It connects a TCP socket to 127.0.0.1:port, without the delay of Nagle */
+{
+  struct sockaddr_in addr;
+  int fd,on = 1;
+
+  memset(&addr,0,sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fd = socket(AF_INET,SOCK_STREAM|SOCK_CLOEXEC,0);
+  if ((fd >= 0) && (connect(fd,(struct sockaddr*)&addr,sizeof(addr)) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  if (fd >= 0) setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+  return fd;
+}
+
+int clientSend(int fd,uint8_t* buf,int len)
+/* It writes len bytes. Return: 1 = OK, -1 = error */
+{
+  ssize_t n;
+
+  while (len > 0)
+  {
+    n = send(fd,buf,len,MSG_NOSIGNAL);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    buf += n;
+    len -= (int)n;
+  }
+  return 1;
+}
+
+int clientRecv(int fd,uint8_t* buf,int len)
+/* It reads len bytes. Return: 1 = OK, -1 = error or connection closed */
+{
+  ssize_t n;
+
+  while (len > 0)
+  {
+    n = recv(fd,buf,len,0);
+    if (n <= 0)
+    {
+      if ((n < 0) && (errno == EINTR)) continue;
+      return -1;
+    }
+    buf += n;
+    len -= (int)n;
+  }
+  return 1;
+}
+
+int naxosClientHandshake(int fd,keyC kA,keyC skA,keyPC pkA,keyC idA,keyPC pkB,keyC idB,ellipticCurve* curveN)
+/* It sends the hello with X and calculates kA with the Y of the reply, see NaxosWire.h */
+{
+  uint8_t hello[WIRE_MAX];
+  uint8_t reply[WIRE_MAX];
+  keyC eskA;
+  int len,res = -6;
+
+  len = calculateXYWire(hello,eskA,skA,idA,pkA,curveN);
+  if (len < 0)
+  {
+    res = -5;                                  /* calculateXY failed: nothing sent          */
+  }
+  else if ((clientSend(fd,hello,len) == 1) && (clientRecv(fd,reply,WIRE_HEADER) == 1))
+  {
+    len = naxosWireFrameBytes(reply,WIRE_HEADER,WIRE_REPLY,curveN);
+    if ((len > 0) && (clientRecv(fd,reply+WIRE_HEADER,len-WIRE_HEADER) == 1))
+    {
+      res = calculateKaWire(kA,reply,len,eskA,skA,idA,pkB,idB,curveN);
+    }
+  }
+  naxosWipe(eskA,sizeof(keyC));
+  return res;
+}
+
+int naxosClientResume(int fd,keyC kA,naxosTicket* t,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It sends the resume and calculates kA with the nB of the reply, see NaxosTicket.h */
+{
+  uint8_t resume[WIRE_MAX];
+  uint8_t reply[WIRE_MAX];
+  uint8_t nonceA[TICKET_NONCE];
+  int len,res = -6;
+
+  len = naxosWireResume(resume,t,nonceA,curveN);
+  if (len < 0)
+  {
+    res = -7;
+  }
+  else if ((clientSend(fd,resume,len) == 1) && (clientRecv(fd,reply,WIRE_HEADER) == 1))
+  {
+    len = naxosWireFrameBytes(reply,WIRE_HEADER,WIRE_RESUME_REPLY,curveN);
+    if ((len > 0) && (clientRecv(fd,reply+WIRE_HEADER,len-WIRE_HEADER) == 1))
+    {
+      if (reply[6] & 1) res = -7;              /* ticket rejected                        */
+      else res = (naxosResumeKey(kA,t,nonceA,reply+WIRE_HEADER,idA,idB,curveN) == 1)?1:-7;
+    }
+  }
+  if (res != 1) naxosWipe(t,sizeof(naxosTicket));   /* used by the server or not valid    */
+  return res;
+}
@@ -0,0 +1,50 @@
+/*
+   Client library of the initiator A for the handshake server (see NaxosServer.h), with the
+   wire format of NaxosWire.h. The calls are blocking: a thread runs the handshakes of its
+   connections.
+*/
+
+#ifndef _NAXOS_CLIENT__
+#define _NAXOS_CLIENT__
+
+#include "Naxos.h"
+#include "NaxosTicket.h"
+
+int naxosClientConnectUnix(const char* path);
+/* It connects to the server listening on the Unix-domain socket path
+   It returns the socket, -1 in case of error
+*/
+
+int naxosClientConnectTcp(int port);
+/* It connects to the server listening on the TCP port of 127.0.0.1
+   It returns the socket, -1 in case of error
+*/
+
+int naxosClientHandshake(int fd,keyC kA,keyC skA,keyPC pkA,keyC idA,keyPC pkB,keyC idB,ellipticCurve* curveN);
+/* It runs a handshake on the connection fd: it sends the hello with idA, pkA and X
+   (calculateXYWire), it receives the reply with Y and it calculates kA (calculateKaWire). pkA and pkB are in compressed format (see
+   publicKeyCompressed); the server must have the secret key of pkB and the identity idB
+   The connection can be used for another handshake
+   Return:
+     1 = OK
+    -1 ... -5 = as calculateKaCompressed, -5 also when calculateXY failed: the hello is not
+                sent
+    -6 = I/O error, invalid reply, or connection closed by the server (e.g. the server rejected
+         the hello)
+   With a server that has the tickets (naxosServerTickets), A derives its ticket with
+   naxosTicketDerive(t,kA,curveN) to resume the session later (naxosClientResume)
+*/
+
+int naxosClientResume(int fd,keyC kA,naxosTicket* t,keyC idA,keyC idB,ellipticCurve* curveN);
+/* It resumes the session of the ticket t on the connection fd: it sends the resume with the id
+   of t and nA, it receives nB and it calculates kA (naxosResumeKey), without scalar
+   multiplications. t becomes the next ticket
+   Return:
+     1 = OK
+    -6 = I/O error, invalid reply, or connection closed by the server
+    -7 = t not valid or rejected by the server (unknown, used or expired): the connection can
+         be used for a full handshake
+   t is not valid after an error
+*/
+
+#endif /* #ifndef _NAXOS_CLIENT__  */
@@ -0,0 +1,464 @@
+/*
+   Multi-threaded handshake engine with work-stealing scheduler. See NaxosEngine.h
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE       /* pthread_attr_setaffinity_np */
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include "NaxosEngine.h"
+#include "NaxosWire.h"
+#include "NaxosArena.h"
+
+#define DEQUE_SIZE 64     /* Initial capacity of the deques, power of 2 */
+
+typedef struct jobDeque   /* Deque of jobs of a worker                              */
+{
+  pthread_mutex_t lock;
+  naxosJob** jobs;        /* circular buffer                                        */
+  int size;               /* capacity, power of 2                                   */
+  int top;                /* first job, taken by the thieves                        */
+  int bottom;             /* one after the last job, taken by the owner             */
+} jobDeque;
+
+typedef struct naxosWorker
+{
+  pthread_t thread;
+  int index;
+  struct naxosEngine* engine;
+  jobDeque deque;
+  void* scratch;          /* points of a batch job, batchScratchBytes(NAXOS_JOB_BATCH_MAX) */
+} naxosWorker;
+
+struct naxosEngine
+{
+  ellipticCurve curve;
+  peerCache* cache;
+  naxosArena* arena;        /* scratch of the workers: locked, guard pages              */
+  int nworkers;             /* workers with initialized deque                          */
+  int nthreads;             /* workers with started thread                             */
+  naxosWorker* workers;
+  atomic_int pending;       /* jobs submitted and not yet taken by a worker            */
+  atomic_int sleepers;      /* workers waiting for jobs                                */
+  atomic_uint next;         /* round robin index for the submission                    */
+  atomic_int stop;
+  pthread_mutex_t lock;     /* it protects stop and the sleep of the workers           */
+  pthread_cond_t work;
+  pthread_mutex_t cqLock;   /* completion queue                                        */
+  pthread_cond_t cqReady;
+  naxosJob* cqHead;
+  naxosJob* cqTail;
+};
+
+int dequeInit(jobDeque* d)
+/* It initializes the deque. Return: 1 = OK, -1 = error */
+{
+  d->jobs = (naxosJob**)malloc(DEQUE_SIZE*sizeof(naxosJob*));
+  if (d->jobs == NULL) return -1;
+  if (pthread_mutex_init(&d->lock,NULL) != 0)
+  {
+    free(d->jobs);
+    return -1;
+  }
+  d->size = DEQUE_SIZE;
+  d->top = 0;
+  d->bottom = 0;
+  return 1;
+}
+
+int dequePush(jobDeque* d,naxosJob* job)
+/* It appends the job at the bottom of the deque, doubling its capacity if it is full
+   Return: 1 = OK, -2 = memory allocation error
+*/
+{
+  naxosJob** jobs;
+  int i,n;
+
+  pthread_mutex_lock(&d->lock);
+  n = d->bottom - d->top;
+  if (n == d->size)                            /* full: double the capacity                */
+  {
+    jobs = (naxosJob**)malloc(2*d->size*sizeof(naxosJob*));
+    if (jobs == NULL)
+    {
+      pthread_mutex_unlock(&d->lock);
+      return -2;
+    }
+    for (i=0;i<n;i++)
+    {
+      jobs[i] = d->jobs[(d->top+i)&(d->size-1)];
+    }
+    free(d->jobs);
+    d->jobs = jobs;
+    d->size = 2*d->size;
+    d->top = 0;
+    d->bottom = n;
+  }
+  d->jobs[d->bottom&(d->size-1)] = job;
+  d->bottom++;
+  pthread_mutex_unlock(&d->lock);
+  return 1;
+}
+
+naxosJob* dequePop(jobDeque* d,int steal)
+/* It takes a job from the bottom of the deque (owner) or from the top (steal = 1)
+   It returns NULL if the deque is empty
+*/
+{
+  naxosJob* job = NULL;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom != d->top)
+  {
+    if (steal)
+    {
+      job = d->jobs[d->top&(d->size-1)];
+      d->top++;
+    }
+    else
+    {
+      d->bottom--;
+      job = d->jobs[d->bottom&(d->size-1)];
+    }
+  }
+  pthread_mutex_unlock(&d->lock);
+  return job;
+}
+
+void runBatch(naxosWorker* w,naxosJob* job)
+/* It executes the jobs of the batch job with calculateXYBatchScratch or calculateKbBatchScratch
+   in the scratch of the worker, on copies of their sessions on the stack, and gives back the
+   results to each job
+*/
+{
+  naxosEngine* engine = w->engine;
+  sessionXY xy[NAXOS_JOB_BATCH_MAX];
+  sessionK k[NAXOS_JOB_BATCH_MAX];
+  naxosJob* sub[NAXOS_JOB_BATCH_MAX];
+  naxosJob* j;
+  int i,m;
+
+  if (job->batch[0]->type == NAXOS_JOB_XY)
+  {
+    for (i=0;i<job->n;i++)
+    {
+      xy[i] = *job->batch[i]->xy;
+    }
+    calculateXYBatchScratch(xy,job->n,w->scratch,&engine->curve);
+    for (i=0;i<job->n;i++)
+    {
+      *job->batch[i]->xy = xy[i];
+    }
+  }
+  else                                         /* NAXOS_JOB_KB_WIRE                        */
+  {
+    m = 0;
+    for (i=0;i<job->n;i++)                     /* the valid hellos in k[0], ..., k[m-1]    */
+    {
+      j = job->batch[i];
+      j->k->res = naxosWireHelloSession(&k[m],j->wire,j->wireLen,&engine->curve);
+      if (j->k->res != 1) continue;
+      memcpy(k[m].esk,j->k->esk,sizeof(keyC));
+      memcpy(k[m].sk,j->k->sk,sizeof(keyC));
+      memcpy(k[m].idB,j->k->idB,sizeof(keyC));
+      sub[m++] = j;
+    }
+    calculateKbBatchScratch(k,m,w->scratch,&engine->curve);
+    for (i=0;i<m;i++)
+    {
+      memcpy(sub[i]->k->k,k[i].k,sizeof(keyC));
+      sub[i]->k->res = k[i].res;
+    }
+  }
+
+  naxosWipe(xy,sizeof(xy));                    /* Clear the copies of the sessions         */
+  naxosWipe(k,sizeof(k));
+}
+
+void runJob(naxosWorker* w,naxosJob* job)
+/* It executes the job and notifies its completion */
+{
+  naxosEngine* engine = w->engine;
+  sessionK* k = job->k;
+
+  switch(job->type)
+  {
+    case NAXOS_JOB_XY:
+      job->xy->res = calculateXY(job->xy->Xx,job->xy->Xy,job->xy->esk,job->xy->sk,&engine->curve);
+      break;
+
+    case NAXOS_JOB_KA:
+      if (engine->cache != NULL)
+      {
+        k->res = calculateKaCached(k->k,k->ePx,k->ePy,k->esk,k->sk,k->pkx,k->pky,k->idA,k->idB,&engine->curve,engine->cache);
+      }
+      else
+      {
+        k->res = calculateKa(k->k,k->ePx,k->ePy,k->esk,k->sk,k->pkx,k->pky,k->idA,k->idB,&engine->curve);
+      }
+      break;
+
+    case NAXOS_JOB_KB:
+      if (engine->cache != NULL)
+      {
+        k->res = calculateKbCached(k->k,k->pkx,k->pky,k->esk,k->sk,k->ePx,k->ePy,k->idA,k->idB,&engine->curve,engine->cache);
+      }
+      else
+      {
+        k->res = calculateKb(k->k,k->pkx,k->pky,k->esk,k->sk,k->ePx,k->ePy,k->idA,k->idB,&engine->curve);
+      }
+      break;
+
+    case NAXOS_JOB_KB_WIRE:
+      k->res = calculateKbWire(k->k,job->wire,job->wireLen,k->esk,k->sk,k->idB,&engine->curve);
+      break;
+
+    case NAXOS_JOB_BATCH:
+      runBatch(w,job);
+      break;
+  }
+
+  if (job->callback != NULL)
+  {
+    job->callback(job);
+    return;
+  }
+  job->next = NULL;                            /* append to the completion queue           */
+  pthread_mutex_lock(&engine->cqLock);
+  if (engine->cqTail == NULL)
+  {
+    engine->cqHead = job;
+  }
+  else
+  {
+    engine->cqTail->next = job;
+  }
+  engine->cqTail = job;
+  pthread_cond_signal(&engine->cqReady);
+  pthread_mutex_unlock(&engine->cqLock);
+}
+
+void* workerMain(void* arg)
+/* Loop of the worker: own jobs first, then the ones stolen from the other workers */
+{
+  naxosWorker* w = (naxosWorker*)arg;
+  naxosEngine* engine = w->engine;
+  naxosJob* job;
+  int i;
+
+  while (1)
+  {
+    job = dequePop(&w->deque,0);
+    for (i=1;(job==NULL)&&(i<engine->nworkers);i++)
+    {
+      job = dequePop(&engine->workers[(w->index+i)%engine->nworkers].deque,1);
+    }
+    if (job != NULL)
+    {
+      atomic_fetch_sub(&engine->pending,1);
+      runJob(w,job);
+      continue;
+    }
+
+    pthread_mutex_lock(&engine->lock);       /* no job: sleep until a submission          */
+    atomic_fetch_add(&engine->sleepers,1);
+    while ((!engine->stop) && (atomic_load(&engine->pending) == 0))
+    {
+      pthread_cond_wait(&engine->work,&engine->lock);
+    }
+    atomic_fetch_sub(&engine->sleepers,1);
+    if (engine->stop && (atomic_load(&engine->pending) == 0))
+    {
+      pthread_mutex_unlock(&engine->lock);
+      return NULL;
+    }
+    pthread_mutex_unlock(&engine->lock);
+  }
+}
+
+int allowedCpu(cpu_set_t* allowed,int n,int i)
+/* It returns the CPU of the set bit i mod n of allowed, which has n bits set */
+{
+  int cpu,k;
+
+  k = i%n;
+  for (cpu=0;cpu<CPU_SETSIZE;cpu++)
+  {
+    if (CPU_ISSET(cpu,allowed) && (k-- == 0)) break;
+  }
+  return cpu;
+}
+
+naxosEngine* naxosEngineCreate(ellipticCurve* curveN,int nthreads,int pin,peerCache* cache)
+/* It creates the engine and starts the workers, see NaxosEngine.h */
+{
+  naxosEngine* engine;
+  pthread_attr_t attr;
+  cpu_set_t allowed,cpus;
+  int i,ncpu,nallowed,res;
+
+  ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (ncpu < 1) ncpu = 1;
+  if (nthreads <= 0) nthreads = ncpu;
+  nallowed = 0;                                /* CPUs of the process (taskset, cpuset)    */
+  if (pin && (sched_getaffinity(0,sizeof(cpu_set_t),&allowed) == 0)) nallowed = CPU_COUNT(&allowed);
+
+  engine = (naxosEngine*)calloc(1,sizeof(naxosEngine));
+  if (engine == NULL) return NULL;
+  engine->workers = (naxosWorker*)calloc(nthreads,sizeof(naxosWorker));
+  if (engine->workers == NULL)
+  {
+    free(engine);
+    return NULL;
+  }
+  engine->curve = *curveN;
+  engine->cache = cache;
+  atomic_init(&engine->pending,0);
+  atomic_init(&engine->sleepers,0);
+  atomic_init(&engine->next,0);
+  atomic_init(&engine->stop,0);
+  pthread_mutex_init(&engine->lock,NULL);
+  pthread_cond_init(&engine->work,NULL);
+  pthread_mutex_init(&engine->cqLock,NULL);
+  pthread_cond_init(&engine->cqReady,NULL);
+
+  engine->arena = naxosArenaCreate((size_t)nthreads*(batchScratchBytes(NAXOS_JOB_BATCH_MAX)+ARENA_ALIGN));
+  for (i=0;(i<nthreads)&&(engine->arena!=NULL);i++)
+  {
+    engine->workers[i].index = i;
+    engine->workers[i].engine = engine;
+    engine->workers[i].scratch = naxosArenaAlloc(engine->arena,batchScratchBytes(NAXOS_JOB_BATCH_MAX));
+    if (engine->workers[i].scratch == NULL) break;
+    if (dequeInit(&engine->workers[i].deque) != 1) break;
+    engine->nworkers++;
+  }
+  for (i=0;i<engine->nworkers;i++)
+  {
+    res = -1;
+    if (nallowed > 0)                          /* pinned from its start                    */
+    {
+      pthread_attr_init(&attr);
+      CPU_ZERO(&cpus);
+      CPU_SET(allowedCpu(&allowed,nallowed,i),&cpus);
+      if (pthread_attr_setaffinity_np(&attr,sizeof(cpu_set_t),&cpus) == 0)
+      {
+        res = pthread_create(&engine->workers[i].thread,&attr,workerMain,&engine->workers[i]);
+      }
+      pthread_attr_destroy(&attr);
+    }
+    if (res != 0)                              /* not pinned, or the affinity failed        */
+    {
+      res = pthread_create(&engine->workers[i].thread,NULL,workerMain,&engine->workers[i]);
+    }
+    if (res != 0) break;
+    engine->nthreads++;
+  }
+  if (engine->nthreads < nthreads)             /* error: stop the started workers          */
+  {
+    naxosEngineDestroy(engine);
+    return NULL;
+  }
+  return engine;
+}
+
+int batchValid(naxosJob* job)
+/* It returns 1 if the jobs of the batch job are 1 ... NAXOS_JOB_BATCH_MAX, all XY or all Kb wire */
+{
+  int i;
+
+  if ((job->batch == NULL) || (job->n < 1) || (job->n > NAXOS_JOB_BATCH_MAX)) return 0;
+  if ((job->batch[0]->type != NAXOS_JOB_XY) && (job->batch[0]->type != NAXOS_JOB_KB_WIRE)) return 0;
+  for (i=1;i<job->n;i++)
+  {
+    if (job->batch[i]->type != job->batch[0]->type) return 0;
+  }
+  return 1;
+}
+
+int naxosEngineSubmit(naxosEngine* engine,naxosJob* job)
+/* It pushes the job in the deque of the next worker (round robin) and wakes a worker */
+{
+  int res;
+
+  if ((job->type < NAXOS_JOB_XY) || (job->type > NAXOS_JOB_BATCH) || atomic_load(&engine->stop)) return -1;
+  if ((job->type == NAXOS_JOB_BATCH) && (batchValid(job) != 1)) return -1;
+
+  res = dequePush(&engine->workers[atomic_fetch_add(&engine->next,1)%engine->nworkers].deque,job);
+  if (res != 1) return res;
+
+  atomic_fetch_add(&engine->pending,1);
+  if (atomic_load(&engine->sleepers) > 0)
+  {
+    pthread_mutex_lock(&engine->lock);
+    pthread_cond_signal(&engine->work);
+    pthread_mutex_unlock(&engine->lock);
+  }
+  return 1;
+}
+
+naxosJob* completionPop(naxosEngine* engine,int wait)
+/* It takes the first job of the completion queue, waiting for it if wait = 1 */
+{
+  naxosJob* job;
+
+  pthread_mutex_lock(&engine->cqLock);
+  while (wait && (engine->cqHead == NULL))
+  {
+    pthread_cond_wait(&engine->cqReady,&engine->cqLock);
+  }
+  job = engine->cqHead;
+  if (job != NULL)
+  {
+    engine->cqHead = job->next;
+    if (engine->cqHead == NULL) engine->cqTail = NULL;
+  }
+  pthread_mutex_unlock(&engine->cqLock);
+  return job;
+}
+
+naxosJob* naxosEngineWait(naxosEngine* engine)
+/* It waits and returns the first job of the completion queue */
+{
+  return completionPop(engine,1);
+}
+
+naxosJob* naxosEnginePoll(naxosEngine* engine)
+/* It returns the first job of the completion queue, NULL if it is empty */
+{
+  return completionPop(engine,0);
+}
+
+void naxosEngineDestroy(naxosEngine* engine)
+/* It stops the workers when all the jobs are done, and frees the engine */
+{
+  int i;
+
+  if (engine == NULL) return;
+
+  pthread_mutex_lock(&engine->lock);
+  engine->stop = 1;
+  pthread_cond_broadcast(&engine->work);
+  pthread_mutex_unlock(&engine->lock);
+  for (i=0;i<engine->nthreads;i++)
+  {
+    pthread_join(engine->workers[i].thread,NULL);
+  }
+  for (i=0;i<engine->nworkers;i++)
+  {
+    pthread_mutex_destroy(&engine->workers[i].deque.lock);
+    free(engine->workers[i].deque.jobs);
+  }
+  pthread_mutex_destroy(&engine->lock);
+  pthread_cond_destroy(&engine->work);
+  pthread_mutex_destroy(&engine->cqLock);
+  pthread_cond_destroy(&engine->cqReady);
+  naxosArenaDestroy(engine->arena);
+  memset(&engine->curve,0,sizeof(ellipticCurve));
+  free(engine->workers);
+  free(engine);
+}
@@ -0,0 +1,77 @@
+/*
+   Multi-threaded handshake engine.
+   A pool of worker threads, optionally pinned one per core, executes the XY, Ka and Kb jobs
+   submitted by the clients. Each worker has its own deque of jobs: the jobs are distributed
+   round robin among the workers, each worker takes the jobs from the bottom of its deque and,
+   when it is empty, steals them from the top of the deques of the other workers.
+   The completed jobs are notified by a callback, or queued in the completion queue of the engine.
+   A batch job runs up to NAXOS_JOB_BATCH_MAX XY or Kb jobs together on one worker, with one
+   inversion for all their points (calculateXYBatchScratch, calculateKbBatchScratch).
+   There is no memory allocation per job: the single jobs use only the stack of the worker, and
+   the batch jobs the scratch of the worker for the points of NAXOS_JOB_BATCH_MAX sessions,
+   allocated in a secure arena (see NaxosArena.h) when the engine is created.
+*/
+
+#ifndef _NAXOS_ENGINE__
+#define _NAXOS_ENGINE__
+
+#include "Naxos.h"
+
+#define NAXOS_JOB_XY 1    /* calculateXY: session xy, result in xy->res           */
+#define NAXOS_JOB_KA 2    /* calculateKa: session k, result in k->res             */
+#define NAXOS_JOB_KB 3    /* calculateKb: session k, result in k->res             */
+#define NAXOS_JOB_KB_WIRE 4  /* calculateKbWire: hello wire, session k (esk, sk, idB), result in k->res */
+#define NAXOS_JOB_BATCH 5    /* the n jobs of batch, all NAXOS_JOB_XY or all NAXOS_JOB_KB_WIRE,
+                                calculated together: each gets its result, as a single job, but
+                                only the callback of the batch job is called                  */
+#define NAXOS_JOB_BATCH_MAX 16   /* Jobs of a batch job                                        */
+
+typedef struct naxosJob naxosJob;
+
+typedef void (*naxosCallback)(naxosJob* job);
+
+struct naxosJob
+{
+  int type;                 /* NAXOS_JOB_XY, NAXOS_JOB_KA, NAXOS_JOB_KB, NAXOS_JOB_KB_WIRE or
+                               NAXOS_JOB_BATCH                                              */
+  sessionXY* xy;            /* session of a NAXOS_JOB_XY job                               */
+  sessionK* k;              /* session of a NAXOS_JOB_KA, NAXOS_JOB_KB or NAXOS_JOB_KB_WIRE job */
+  const uint8_t* wire;      /* hello of a NAXOS_JOB_KB_WIRE job, see NaxosWire.h           */
+  int wireLen;
+  naxosJob** batch;         /* jobs of a NAXOS_JOB_BATCH job, their callbacks are not used */
+  int n;                    /* number of jobs of batch, 1 ... NAXOS_JOB_BATCH_MAX          */
+  naxosCallback callback;   /* called by the worker when the job is done,
+                               NULL = the job is queued in the completion queue             */
+  void* arg;                /* user data                                                   */
+  naxosJob* next;           /* internal use                                                */
+};
+
+typedef struct naxosEngine naxosEngine;
+
+naxosEngine* naxosEngineCreate(ellipticCurve* curveN,int nthreads,int pin,peerCache* cache);
+/* It creates the engine for the curve curveN with nthreads workers
+   (nthreads <= 0: one per online core)
+   pin = 1: worker i is pinned to the CPU i mod n of the n CPUs allowed to the process
+   (sched_getaffinity: taskset, cpuset of the container), unpinned if its affinity cannot be set
+   cache != NULL: Ka and Kb jobs use calculateKaCached and calculateKbCached with the cache
+   It returns NULL in case of error
+*/
+
+int naxosEngineSubmit(naxosEngine* engine,naxosJob* job);
+/* It submits the job, which must not be modified until it is completed
+   Return:
+     1 = OK
+    -1 = unknown job type, batch not valid or engine stopped
+    -2 = memory allocation error
+*/
+
+naxosJob* naxosEngineWait(naxosEngine* engine);
+/* It waits and returns the first job of the completion queue (jobs without callback) */
+
+naxosJob* naxosEnginePoll(naxosEngine* engine);
+/* It returns the first job of the completion queue, NULL if it is empty */
+
+void naxosEngineDestroy(naxosEngine* engine);
+/* It completes all the submitted jobs, stops the workers and frees the engine */
+
+#endif /* #ifndef _NAXOS_ENGINE__  */
@@ -0,0 +1,321 @@
+/*
+   Pre-generation pool of the ephemeral keys of calculateXY. See NaxosPool.h
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include "NaxosPool.h"
+#include "NaxosArena.h"
+
+#define POOL_BATCH 16     /* Tuples calculated together by calculateXYBatch, one inversion */
+#define POOL_RETRY_MS 100 /* Wait of a producer after a failed batch (entropy source)      */
+
+typedef struct xyTuple    /* Slot of a ring: a tuple without sk                            */
+{
+  keyC esk;
+  keyC Xx;
+  keyC Xy;
+} xyTuple;
+
+typedef struct xyRing     /* Ring of the tuples of a consumer, one producer and one consumer */
+{
+  xyTuple* slots;         /* circular buffer                                               */
+  unsigned size;          /* capacity, power of 2                                          */
+  _Alignas(64) atomic_uint head;   /* next slot written by the producer                    */
+  _Alignas(64) atomic_uint tail;   /* next slot read by the consumer                       */
+} xyRing;
+
+typedef struct xyProducer
+{
+  pthread_t thread;
+  int index;
+  struct naxosPool* pool;
+  atomic_int idle;        /* 1 = waiting for a ring to drain                              */
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  void* scratch;          /* points of a batch, in the arena                              */
+} xyProducer;
+
+struct naxosPool
+{
+  ellipticCurve curve;
+  naxosArena* arena;      /* sk, the slots of the rings and the scratch of the producers:
+                             locked, guard pages                                           */
+  uint8_t* sk;
+  int nconsumers;
+  int nproducers;         /* producers with initialized lock                               */
+  int nthreads;           /* producers with started thread                                 */
+  xyRing* rings;
+  xyProducer* producers;
+  atomic_int stop;
+};
+
+static int ringsFull(naxosPool* pool,int index)
+/* It returns 1 if all the rings of the producer index are full */
+{
+  xyRing* r;
+  int c;
+
+  for (c=index;c<pool->nconsumers;c+=pool->nproducers)
+  {
+    r = &pool->rings[c];
+    if (atomic_load(&r->head) - atomic_load(&r->tail) < r->size) return 0;
+  }
+  return 1;
+}
+
+static void producerWait(xyProducer* p,int failed)
+/* It waits until a ring of the producer is half empty or, after a failed batch, POOL_RETRY_MS */
+{
+  naxosPool* pool = p->pool;
+  struct timespec t;
+
+  pthread_mutex_lock(&p->lock);
+  atomic_store(&p->idle,1);
+  if (failed)                                  /* no retry at once: the source is failing   */
+  {
+    clock_gettime(CLOCK_REALTIME,&t);
+    t.tv_nsec += POOL_RETRY_MS*1000000L;
+    t.tv_sec += t.tv_nsec/1000000000L;
+    t.tv_nsec = t.tv_nsec%1000000000L;
+    while ((!atomic_load(&pool->stop)) && (pthread_cond_timedwait(&p->wake,&p->lock,&t) != ETIMEDOUT));
+  }
+  else
+  {
+    while ((!atomic_load(&pool->stop)) && ringsFull(pool,p->index))
+    {
+      pthread_cond_wait(&p->wake,&p->lock);
+    }
+  }
+  atomic_store(&p->idle,0);
+  pthread_mutex_unlock(&p->lock);
+}
+
+static void* producerMain(void* arg)
+/* Loop of the producer: it fills its rings and waits when they are all full or a batch failed */
+{
+  xyProducer* p = (xyProducer*)arg;
+  naxosPool* pool = p->pool;
+  sessionXY batch[POOL_BATCH];
+  xyRing* r;
+  xyTuple* e;
+  unsigned head,n;
+  int c,j,ok,work,failed;
+
+  while (!atomic_load(&pool->stop))
+  {
+    work = 0;
+    failed = 0;
+    for (c=p->index;(c<pool->nconsumers)&&(!atomic_load(&pool->stop));c+=pool->nproducers)
+    {
+      r = &pool->rings[c];
+      head = atomic_load_explicit(&r->head,memory_order_relaxed);      /* written only here */
+      n = r->size - (head - atomic_load(&r->tail));                    /* free slots        */
+      if (n == 0) continue;
+      if (n > POOL_BATCH) n = POOL_BATCH;
+      for (j=0;j<(int)n;j++)
+      {
+        memcpy(batch[j].sk,pool->sk,COORD_BYTES);
+      }
+      ok = (calculateXYBatchScratch(batch,n,p->scratch,&pool->curve) == 1);
+      for (j=0;j<(int)n;j++)
+      {
+        ok = ok && (batch[j].res == 1);                                /* entropy source    */
+      }
+      if (ok)
+      {
+        for (j=0;j<(int)n;j++)
+        {
+          e = &r->slots[(head+j)&(r->size-1)];
+          memcpy(e->esk,batch[j].esk,sizeof(keyC));
+          memcpy(e->Xx,batch[j].Xx,sizeof(keyC));
+          memcpy(e->Xy,batch[j].Xy,sizeof(keyC));
+        }
+        atomic_store(&r->head,head+n);                                 /* publish the tuples */
+        work = 1;
+      }
+      else                                                             /* retry later       */
+      {
+        failed = 1;
+      }
+      naxosWipe(batch,sizeof(batch));                                  /* copies of sk      */
+    }
+    if (work && !failed) continue;
+    producerWait(p,failed);
+  }
+  return NULL;
+}
+
+static int sameKey(const uint8_t* a,const uint8_t* b,int len)
+/* It returns 1 if the len bytes of a and b are equal, 0 otherwise
+   Always the same number of operations, whatever the first different byte
+*/
+{
+  uint8_t d = 0;
+  int i;
+
+  for (i=0;i<len;i++)
+  {
+    d = d | (a[i] ^ b[i]);
+  }
+  return (int)((((unsigned)d) - 1) >> 8) & 1;
+}
+
+naxosPool* naxosPoolCreate(ellipticCurve* curveN,keyC sk,int nconsumers,int depth,int nthreads)
+/* It creates the pool and starts the producers, see NaxosPool.h */
+{
+  naxosPool* pool;
+  size_t ringBytes;
+  unsigned size;
+  int i;
+
+  if (nconsumers < 1) return NULL;
+  if (nthreads <= 0) nthreads = 1;
+  if (nthreads > nconsumers) nthreads = nconsumers;
+  for (size=2;(int)size<depth;size*=2);
+
+  pool = (naxosPool*)calloc(1,sizeof(naxosPool));
+  if (pool == NULL) return NULL;
+  pool->arena = naxosArenaCreate(sizeof(keyC)+(size_t)nconsumers*(size*sizeof(xyTuple)+ARENA_ALIGN)+
+                                 (size_t)nthreads*(batchScratchBytes(POOL_BATCH)+ARENA_ALIGN));
+  if (pool->arena == NULL)
+  {
+    free(pool);
+    return NULL;
+  }
+  pool->curve = *curveN;
+  pool->sk = (uint8_t*)naxosArenaAlloc(pool->arena,sizeof(keyC));
+  memcpy(pool->sk,sk,COORD_BYTES);
+  atomic_init(&pool->stop,0);
+  ringBytes = ((size_t)nconsumers*sizeof(xyRing)+ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+  pool->rings = (xyRing*)aligned_alloc(ARENA_ALIGN,ringBytes);   /* head and tail aligned */
+  pool->producers = (xyProducer*)calloc(nthreads,sizeof(xyProducer));
+  if ((pool->rings == NULL) || (pool->producers == NULL))
+  {
+    naxosPoolDestroy(pool);
+    return NULL;
+  }
+  memset(pool->rings,0,ringBytes);
+  for (i=0;i<nconsumers;i++)
+  {
+    pool->rings[i].slots = (xyTuple*)naxosArenaAlloc(pool->arena,size*sizeof(xyTuple));
+    if (pool->rings[i].slots == NULL) break;
+    pool->rings[i].size = size;
+    atomic_init(&pool->rings[i].head,0);
+    atomic_init(&pool->rings[i].tail,0);
+    pool->nconsumers++;
+  }
+  if (pool->nconsumers < nconsumers)
+  {
+    naxosPoolDestroy(pool);
+    return NULL;
+  }
+
+  for (i=0;i<nthreads;i++)
+  {
+    pool->producers[i].scratch = naxosArenaAlloc(pool->arena,batchScratchBytes(POOL_BATCH));
+    if (pool->producers[i].scratch == NULL) break;
+    pool->producers[i].index = i;
+    pool->producers[i].pool = pool;
+    atomic_init(&pool->producers[i].idle,0);
+    pthread_mutex_init(&pool->producers[i].lock,NULL);
+    pthread_cond_init(&pool->producers[i].wake,NULL);
+    pool->nproducers++;
+  }
+  for (i=0;i<pool->nproducers;i++)
+  {
+    if (pthread_create(&pool->producers[i].thread,NULL,producerMain,&pool->producers[i]) != 0) break;
+    pool->nthreads++;
+  }
+  if (pool->nthreads < nthreads)               /* error: stop the started producers        */
+  {
+    naxosPoolDestroy(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+int calculateXYPool(keyC Xx,keyC Xy,keyC esk,keyC sk,ellipticCurve* curveN,naxosPool* pool,int consumer)
+/* It takes esk and X from the ring of the consumer, see NaxosPool.h */
+{
+  xyRing* r;
+  xyProducer* p;
+  xyTuple* e;
+  unsigned tail,n;
+  int res;
+
+  if ((pool == NULL) || (consumer < 0) || (consumer >= pool->nconsumers) ||
+      (curveN->bsize != pool->curve.bsize) || (sameKey(sk,pool->sk,(curveN->bsize+7)/8) != 1))
+  {
+    res = calculateXY(Xx,Xy,esk,sk,curveN);
+    return (res == 1)?0:res;
+  }
+
+  r = &pool->rings[consumer];
+  tail = atomic_load_explicit(&r->tail,memory_order_relaxed);          /* written only here */
+  n = atomic_load(&r->head) - tail;                                    /* tuples ready      */
+  if (n == 0)                                  /* empty: inline                            */
+  {
+    res = calculateXY(Xx,Xy,esk,sk,curveN);
+    return (res == 1)?0:res;
+  }
+
+  e = &r->slots[tail&(r->size-1)];
+  memcpy(esk,e->esk,COORD_BYTES);
+  memcpy(Xx,e->Xx,COORD_BYTES);
+  memcpy(Xy,e->Xy,COORD_BYTES);
+  naxosWipe(e,sizeof(xyTuple));                /* wipe the slot before giving it back      */
+  atomic_store(&r->tail,tail+1);
+
+  p = &pool->producers[consumer%pool->nproducers];
+  if ((n-1 <= r->size/2) && atomic_load(&p->idle))   /* half empty: wake the producer     */
+  {
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_signal(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+  }
+  return 1;
+}
+
+int naxosPoolAvailable(naxosPool* pool,int consumer)
+/* It returns the number of tuples ready in the ring of the consumer */
+{
+  xyRing* r;
+
+  if ((pool == NULL) || (consumer < 0) || (consumer >= pool->nconsumers)) return 0;
+  r = &pool->rings[consumer];
+  return (int)(atomic_load(&r->head) - atomic_load(&r->tail));
+}
+
+void naxosPoolDestroy(naxosPool* pool)
+/* It stops the producers, wipes all the tuples and frees the pool */
+{
+  int i;
+
+  if (pool == NULL) return;
+
+  atomic_store(&pool->stop,1);
+  for (i=0;i<pool->nproducers;i++)
+  {
+    pthread_mutex_lock(&pool->producers[i].lock);
+    pthread_cond_signal(&pool->producers[i].wake);
+    pthread_mutex_unlock(&pool->producers[i].lock);
+  }
+  for (i=0;i<pool->nthreads;i++)
+  {
+    pthread_join(pool->producers[i].thread,NULL);
+  }
+  for (i=0;i<pool->nproducers;i++)
+  {
+    pthread_mutex_destroy(&pool->producers[i].lock);
+    pthread_cond_destroy(&pool->producers[i].wake);
+  }
+  naxosArenaDestroy(pool->arena);             /* wipe sk and the tuples                   */
+  memset(&pool->curve,0,sizeof(ellipticCurve));
+  free(pool->rings);
+  free(pool->producers);
+  free(pool);
+}
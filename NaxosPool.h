@@ -0,0 +1,47 @@
+/*
+   Pre-generation pool of the ephemeral keys of calculateXY.
+   X = G*H(esk,sk) does not depend on the peer, so background threads calculate the tuples
+   (esk, X) of a static secret key sk in advance, with calculateXYBatchScratch, and keep full
+   a ring for each consumer thread. Each ring has one producer and one consumer and it is lock-free:
+   the consumer takes a tuple with two atomic operations and wipes its slot.
+   sk, the rings and the scratch of the batches of each producer are in a secure arena (see
+   NaxosArena.h): locked in RAM, between guard pages, and the slots of the rings keep only esk
+   and X. When a batch fails (entropy source) the
+   producer retries after POOL_RETRY_MS instead of at once.
+   calculateXYPool takes the tuple from the ring of the consumer and calculates it inline
+   with calculateXY when the ring is empty.
+*/
+
+#ifndef _NAXOS_POOL__
+#define _NAXOS_POOL__
+
+#include "Naxos.h"
+
+typedef struct naxosPool naxosPool;
+
+naxosPool* naxosPoolCreate(ellipticCurve* curveN,keyC sk,int nconsumers,int depth,int nthreads);
+/* It creates the pool of the secret key sk for the curve curveN, with nconsumers rings of
+   at least depth tuples, and starts nthreads producer threads (nthreads <= 0: 1)
+   The consumer i is served by the producer i mod nthreads
+   It returns NULL in case of error
+*/
+
+int calculateXYPool(keyC Xx,keyC Xy,keyC esk,keyC sk,ellipticCurve* curveN,naxosPool* pool,int consumer);
+/* As calculateXY, with esk and X taken from the ring of the consumer (0, ..., nconsumers-1)
+   Each consumer index must be used by only one thread at a time
+   When the ring is empty, pool is NULL or sk is not the secret key of the pool (compared in
+   constant time), esk and X are calculated inline by calculateXY
+   Return:
+     1 = taken from the pool
+     0 = calculated inline
+    -1 = calculated inline and the entropy source failed, see calculateXY
+    -5 = calculated inline and the curve has no hash functions (P-192), see calculateXY
+*/
+
+int naxosPoolAvailable(naxosPool* pool,int consumer);
+/* It returns the number of tuples ready in the ring of the consumer */
+
+void naxosPoolDestroy(naxosPool* pool);
+/* It stops the producers, wipes all the tuples and frees the pool. No consumer may be using it */
+
+#endif /* #ifndef _NAXOS_POOL__  */
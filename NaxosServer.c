@@ -0,0 +1,697 @@
+/*
+   Event-driven handshake server of the responder B. See NaxosServer.h
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE       /* accept4 */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "NaxosServer.h"
+#include "NaxosEngine.h"
+#include "NaxosPool.h"
+#include "NaxosArena.h"
+#include "NaxosWire.h"
+#include "NaxosTicket.h"
+
+#define CONN_FREE    0    /* State of a connection: slot not used                       */
+#define CONN_READ    1    /* reading the hello or the resume                            */
+#define CONN_BUSY    2    /* handshake in the engine                                    */
+#define CONN_WRITE   3    /* writing the reply                                          */
+#define CONN_CLOSING 4    /* closed by the peer while busy, freed when the job is done  */
+
+#define SERVER_WAKE  UINT64_MAX    /* epoll data of the eventfd, then of the listeners  */
+#define SERVER_BATCH NAXOS_JOB_BATCH_MAX   /* Hellos of a batch job                      */
+#define SERVER_RETRY_MS 100        /* Pause of the listeners when there are no fds left   */
+
+typedef struct serverConn
+{
+  int fd;
+  int state;                       /* CONN_FREE, CONN_READ, ...                          */
+  int inLen;                       /* bytes of the frame read                            */
+  int inNeed;                      /* bytes of the frame: the header, then the frame     */
+  int outLen;                      /* bytes of the reply                                 */
+  int outPos;                      /* bytes of the reply written                         */
+  uint8_t in[WIRE_MAX];            /* hello, parsed in place by the Kb job                */
+  uint8_t out[WIRE_MAX];           /* reply                                              */
+  sessionXY xy;                    /* eskB and Y                                         */
+  sessionK k;                      /* kB                                                 */
+  naxosJob job;                    /* XY or Kb job of the hello, in a batch job          */
+  naxosJob batch;                  /* batch job of which the connection is the first     */
+  naxosJob* jobs[SERVER_BATCH];    /* jobs of batch                                      */
+  struct naxosServer* server;
+  int nextFree;
+} serverConn;
+
+struct naxosServer
+{
+  ellipticCurve curve;
+  naxosEngine* engine;
+  naxosPool* pool;
+  naxosTicketStore* tickets;       /* NULL = no resumption                               */
+  naxosArena* arena;
+  uint8_t* skB;                    /* in the arena                                       */
+  keyC idB;
+  naxosKeyCallback onKey;
+  void* arg;
+  int epfd;
+  int wakefd;                      /* eventfd: jobs completed or stop                    */
+  int listenFd[SERVER_LISTENERS];
+  char* listenPath[SERVER_LISTENERS];  /* path of the Unix-domain sockets, removed at the end */
+  int nlisten;
+  serverConn* conns;               /* in the arena                                       */
+  int maxConn;
+  int freeConn;                    /* first free connection, -1 = none                   */
+  int nworkers;                    /* workers of the engine                              */
+  int ready[SERVER_EVENTS];        /* connections with a hello read in this round        */
+  int nready;
+  int paused;                      /* 1 = listeners disabled: no fds left (EMFILE)       */
+  atomic_int stop;
+  pthread_mutex_t doneLock;        /* jobs completed by the workers                      */
+  naxosJob* doneHead;
+};
+
+void serverWake(naxosServer* server)
+/* It wakes the event loop. It is async-signal-safe */
+{
+  uint64_t one = 1;
+  ssize_t res;
+
+  res = write(server->wakefd,&one,sizeof(one));
+  (void)res;                                   /* the counter is already not 0           */
+}
+
+void serverDone(naxosJob* job)
+/* Callback of the batch jobs, called by the workers: the job goes to the event loop */
+{
+  serverConn* c = (serverConn*)job->arg;
+  naxosServer* server = c->server;
+
+  pthread_mutex_lock(&server->doneLock);
+  job->next = server->doneHead;
+  server->doneHead = job;
+  pthread_mutex_unlock(&server->doneLock);
+  serverWake(server);
+}
+
+naxosServer* naxosServerCreate(ellipticCurve* curveN,keyC skB,keyC idB,int nthreads,int maxConn,int poolDepth,naxosKeyCallback onKey,void* arg)
+/* It creates the engine, the pool, the connections in the arena, epoll and the eventfd */
+{
+  naxosServer* server;
+  struct epoll_event ev;
+  int i;
+
+  if ((maxConn < 1) || (onKey == NULL)) return NULL;
+  server = (naxosServer*)calloc(1,sizeof(naxosServer));
+  if (server == NULL) return NULL;
+  server->curve = *curveN;
+  memcpy(server->idB,idB,sizeof(keyC));
+  server->onKey = onKey;
+  server->arg = arg;
+  server->maxConn = maxConn;
+  server->epfd = -1;
+  server->wakefd = -1;
+  atomic_init(&server->stop,0);
+  pthread_mutex_init(&server->doneLock,NULL);
+
+  server->arena = naxosArenaCreate(sizeof(keyC)+ARENA_ALIGN+(size_t)maxConn*sizeof(serverConn));
+  if (server->arena == NULL)
+  {
+    naxosServerDestroy(server);
+    return NULL;
+  }
+  server->skB = (uint8_t*)naxosArenaAlloc(server->arena,sizeof(keyC));
+  memcpy(server->skB,skB,sizeof(keyC));
+  server->conns = (serverConn*)naxosArenaAlloc(server->arena,(size_t)maxConn*sizeof(serverConn));
+  for (i=0;i<maxConn;i++)                      /* free list: conns[0], conns[1], ...     */
+  {
+    server->conns[i].fd = -1;
+    server->conns[i].server = server;
+    server->conns[i].nextFree = (i+1 < maxConn)?i+1:-1;
+  }
+  server->freeConn = 0;
+
+  server->nworkers = (nthreads > 0)?nthreads:(int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (server->nworkers < 1) server->nworkers = 1;
+  server->engine = naxosEngineCreate(curveN,nthreads,0,NULL);
+  if (poolDepth > 0) server->pool = naxosPoolCreate(curveN,skB,1,poolDepth,1);
+  server->epfd = epoll_create1(EPOLL_CLOEXEC);
+  server->wakefd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+  if ((server->engine == NULL) || ((poolDepth > 0) && (server->pool == NULL)) ||
+      (server->epfd < 0) || (server->wakefd < 0))
+  {
+    naxosServerDestroy(server);
+    return NULL;
+  }
+  ev.events = EPOLLIN;
+  ev.data.u64 = SERVER_WAKE;
+  if (epoll_ctl(server->epfd,EPOLL_CTL_ADD,server->wakefd,&ev) != 0)
+  {
+    naxosServerDestroy(server);
+    return NULL;
+  }
+  return server;
+}
+
+int naxosServerTickets(naxosServer* server,int capacity,int lifetime)
+/* It creates the store of the tickets */
+{
+  if (server->tickets != NULL) return -1;
+  server->tickets = naxosTicketStoreCreate(&server->curve,capacity,lifetime);
+  return (server->tickets != NULL)?1:-1;
+}
+
+int serverListen(naxosServer* server,int fd,const char* path)
+/* It registers the listening socket fd in epoll. Return: 1 = OK, -1 = error */
+{
+  struct epoll_event ev;
+
+  if ((fd >= 0) && (server->nlisten < SERVER_LISTENERS) && (listen(fd,SOMAXCONN) == 0))
+  {
+    ev.events = EPOLLIN;
+    ev.data.u64 = SERVER_WAKE-1-server->nlisten;
+    if (epoll_ctl(server->epfd,EPOLL_CTL_ADD,fd,&ev) == 0)
+    {
+      server->listenFd[server->nlisten] = fd;
+      server->listenPath[server->nlisten] = (path != NULL)?strdup(path):NULL;
+      server->nlisten++;
+      return 1;
+    }
+  }
+  if (fd >= 0) close(fd);
+  return -1;
+}
+
+int naxosServerListenUnix(naxosServer* server,const char* path)
+/* It binds a non-blocking Unix-domain socket to path and listens on it */
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path,path);
+  unlink(path);
+  fd = socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+  if ((fd >= 0) && (bind(fd,(struct sockaddr*)&addr,sizeof(addr)) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  return serverListen(server,fd,path);
+}
+
+int naxosServerListenTcp(naxosServer* server,int port)
+/* It binds a non-blocking TCP socket to 127.0.0.1:port and listens on it */
+{
+  struct sockaddr_in addr;
+  int fd,on = 1;
+
+  memset(&addr,0,sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  fd = socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+  if (fd >= 0) setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+  if ((fd >= 0) && (bind(fd,(struct sockaddr*)&addr,sizeof(addr)) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  return serverListen(server,fd,NULL);
+}
+
+void serverListeners(naxosServer* server,int on)
+/* It enables (on = 1) or disables the events of the listening sockets */
+{
+  struct epoll_event ev;
+  int i;
+
+  for (i=0;i<server->nlisten;i++)
+  {
+    ev.events = on?EPOLLIN:0;
+    ev.data.u64 = SERVER_WAKE-1-i;
+    epoll_ctl(server->epfd,EPOLL_CTL_MOD,server->listenFd[i],&ev);
+  }
+  server->paused = !on;
+}
+
+void connFree(naxosServer* server,serverConn* c)
+/* It closes the connection, wipes its session and puts it in the free list */
+{
+  int i = (int)(c - server->conns);
+
+  if (c->fd >= 0) close(c->fd);                /* close removes it from epoll            */
+  naxosWipe(c,sizeof(serverConn));
+  c->fd = -1;
+  c->server = server;
+  c->nextFree = server->freeConn;
+  server->freeConn = i;
+  if (server->paused) serverListeners(server,1);   /* a fd is free: accept again       */
+}
+
+void connWatch(naxosServer* server,serverConn* c,uint32_t events)
+/* It sets the events of the connection in epoll */
+{
+  struct epoll_event ev;
+
+  ev.events = events;
+  ev.data.u64 = (uint64_t)(c - server->conns);
+  epoll_ctl(server->epfd,EPOLL_CTL_MOD,c->fd,&ev);
+}
+
+void serverAccept(naxosServer* server,int lfd)
+/* It accepts all the pending connections of the listening socket lfd
+   Without fds left (EMFILE, ENFILE) the pending connections stay in the backlog and would wake
+   the loop at once (level triggered): the listeners are disabled until a connection is freed,
+   or for SERVER_RETRY_MS
+*/
+{
+  struct epoll_event ev;
+  serverConn* c;
+  int fd,on = 1;
+
+  while (1)
+  {
+    fd = accept4(lfd,NULL,NULL,SOCK_NONBLOCK|SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+      if ((errno == EINTR) || (errno == ECONNABORTED)) continue;
+      if ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOBUFS) || (errno == ENOMEM))
+      {
+        serverListeners(server,0);
+      }
+      return;                                  /* EAGAIN: no more connections            */
+    }
+    if (server->freeConn < 0)                  /* too many connections                   */
+    {
+      close(fd);
+      continue;
+    }
+    c = &server->conns[server->freeConn];
+    server->freeConn = c->nextFree;
+    setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));  /* fails on Unix-domain sockets */
+    c->fd = fd;
+    c->state = CONN_READ;
+    c->inLen = 0;
+    c->inNeed = WIRE_HEADER;
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint64_t)(c - server->conns);
+    if (epoll_ctl(server->epfd,EPOLL_CTL_ADD,fd,&ev) != 0)
+    {
+      connFree(server,c);
+    }
+  }
+}
+
+void connQueue(naxosServer* server,serverConn* c)
+/* The hello is read: the connection waits for the batch job of this round of the loop */
+{
+  c->state = CONN_BUSY;
+  connWatch(server,c,0);                       /* only EPOLLHUP and EPOLLERR             */
+  server->ready[server->nready++] = (int)(c - server->conns);
+}
+
+int connWrite(serverConn* c)
+/* It writes the reply. Return: 1 = written, 0 = wait EPOLLOUT, -1 = error */
+{
+  ssize_t n;
+
+  while (c->outPos < c->outLen)
+  {
+    n = send(c->fd,c->out+c->outPos,c->outLen-c->outPos,MSG_NOSIGNAL);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return ((errno == EAGAIN) || (errno == EWOULDBLOCK))?0:-1;
+    }
+    c->outPos += (int)n;
+  }
+  return 1;
+}
+
+void connReset(naxosServer* server,serverConn* c)
+/* The reply is written: the connection waits for the next hello */
+{
+  c->state = CONN_READ;
+  c->inLen = 0;
+  c->inNeed = WIRE_HEADER;
+  connWatch(server,c,EPOLLIN);
+}
+
+void connReply(naxosServer* server,serverConn* c)
+/* It writes the outLen bytes of the reply in out */
+{
+  int res;
+
+  c->outPos = 0;
+  c->state = CONN_WRITE;
+  res = connWrite(c);
+  if (res < 0)
+  {
+    connFree(server,c);
+  }
+  else if (res == 1)                           /* ready for the next handshake           */
+  {
+    connReset(server,c);
+  }
+  else
+  {
+    connWatch(server,c,EPOLLOUT);
+  }
+}
+
+void connFinish(naxosServer* server,serverConn* c)
+/* The handshake of the connection is done: it delivers kB, stores its ticket and writes Y */
+{
+  wireHello h;
+  keyC idA;
+  keyPC pkA;
+  int len = (server->curve.bsize+7)/8;
+
+  if ((c->state == CONN_CLOSING) || (c->k.res != 1))
+  {
+    connFree(server,c);
+    return;
+  }
+  naxosWireHelloParse(&h,c->in,c->inLen,&server->curve);   /* valid: the Kb job parsed it */
+  memset(idA,0,sizeof(keyC));
+  memcpy(idA,h.idA,len);
+  pkA[0] = (uint8_t)(2+h.pkAOdd);
+  memcpy(pkA+1,h.pkA,len);
+  server->onKey(c->k.k,idA,pkA,server->arg);
+  if (server->tickets != NULL) naxosTicketStoreAdd(server->tickets,c->k.k,idA,pkA);
+  c->outLen = naxosWireReply(c->out,c->xy.Xx,c->xy.Xy,&server->curve);
+  naxosWipe(&c->xy,sizeof(sessionXY));         /* eskB and kB are not needed any more    */
+  naxosWipe(&c->k,sizeof(sessionK));
+  connReply(server,c);
+}
+
+void connResume(naxosServer* server,serverConn* c)
+/* It resumes the session of the ticket of the resume on the event loop: only hashes
+   A rejected ticket is answered with the flag, A can go on with a full handshake
+*/
+{
+  uint8_t nonceB[TICKET_NONCE];
+  keyPC pkA;
+
+  if (naxosTicketStoreResume(server->tickets,c->k.k,c->k.idA,pkA,c->in+WIRE_HEADER,
+                             c->in+WIRE_HEADER+TICKET_ID,nonceB,server->idB) == 1)
+  {
+    server->onKey(c->k.k,c->k.idA,pkA,server->arg);
+    c->outLen = naxosWireResumeReply(c->out,nonceB,&server->curve);
+  }
+  else
+  {
+    c->outLen = naxosWireResumeReply(c->out,NULL,&server->curve);
+  }
+  naxosWipe(&c->k,sizeof(sessionK));
+  naxosWipe(nonceB,sizeof(nonceB));
+  connReply(server,c);
+}
+
+void connEvent(naxosServer* server,serverConn* c,uint32_t events)
+/* It handles the events of the connection */
+{
+  ssize_t n;
+  int res;
+
+  if (c->state == CONN_FREE) return;           /* freed before in this round             */
+  if (c->state == CONN_BUSY)                   /* the peer has closed: wait for the job  */
+  {
+    epoll_ctl(server->epfd,EPOLL_CTL_DEL,c->fd,NULL);
+    c->state = CONN_CLOSING;
+    return;
+  }
+  if (c->state == CONN_WRITE)
+  {
+    res = ((events & (EPOLLERR|EPOLLHUP)) != 0)?-1:connWrite(c);
+    if (res < 0)
+    {
+      connFree(server,c);
+    }
+    else if (res == 1)
+    {
+      connReset(server,c);
+    }
+    return;
+  }
+  while (c->inLen < c->inNeed)                 /* CONN_READ: the header, then the rest   */
+  {
+    n = recv(c->fd,c->in+c->inLen,c->inNeed-c->inLen,0);
+    if (n > 0)
+    {
+      c->inLen += (int)n;
+      if (c->inLen == WIRE_HEADER)
+      {
+        res = ((server->tickets != NULL) && (c->in[1] == WIRE_RESUME))?WIRE_RESUME:WIRE_HELLO;
+        c->inNeed = naxosWireFrameBytes(c->in,c->inLen,res,&server->curve);
+        if (c->inNeed < 0) break;              /* not a hello or a resume of the curve   */
+      }
+      continue;
+    }
+    if ((n < 0) && (errno == EINTR)) continue;
+    if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) return;
+    connFree(server,c);                        /* closed by the peer or error            */
+    return;
+  }
+  if (c->inNeed < 0)
+  {
+    connFree(server,c);
+  }
+  else if (c->in[1] == WIRE_RESUME)
+  {
+    connResume(server,c);
+  }
+  else
+  {
+    connQueue(server,c);
+  }
+}
+
+void serverSubmit(naxosServer* server,naxosJob** jobs,int n)
+/* It submits the n jobs (1 ... SERVER_BATCH, same type) in a batch job kept by the connection of
+   the first one. The handshakes are closed if the submission fails
+*/
+{
+  serverConn* c = (serverConn*)jobs[0]->arg;
+  int i;
+
+  memcpy(c->jobs,jobs,n*sizeof(naxosJob*));
+  memset(&c->batch,0,sizeof(naxosJob));
+  c->batch.type = NAXOS_JOB_BATCH;
+  c->batch.batch = c->jobs;
+  c->batch.n = n;
+  c->batch.callback = serverDone;
+  c->batch.arg = c;
+  if (naxosEngineSubmit(server->engine,&c->batch) == 1) return;
+  for (i=0;i<n;i++)
+  {
+    c = (serverConn*)jobs[i]->arg;
+    c->k.res = -5;
+    connFinish(server,c);
+  }
+}
+
+void serverFlush(naxosServer* server)
+/* It submits the hellos read in this round of the loop: the ones with eskB and Y from the pool
+   in Kb batch jobs, the other ones in XY batch jobs. The batches are spread over the workers
+*/
+{
+  naxosJob* kb[SERVER_EVENTS];
+  naxosJob* xy[SERVER_EVENTS];
+  naxosJob* job;
+  serverConn* c;
+  int i,nkb = 0,nxy = 0,size;
+
+  for (i=0;i<server->nready;i++)
+  {
+    c = &server->conns[server->ready[i]];
+    job = &c->job;
+    memset(&c->k,0,sizeof(sessionK));
+    memcpy(c->k.idB,server->idB,sizeof(keyC));
+    memcpy(c->k.sk,server->skB,sizeof(keyC));
+    memset(job,0,sizeof(naxosJob));
+    job->k = &c->k;
+    job->xy = &c->xy;
+    job->wire = c->in;
+    job->wireLen = c->inLen;
+    job->arg = c;
+    if ((server->pool != NULL) && (naxosPoolAvailable(server->pool,0) > 0))
+    {
+      if (calculateXYPool(c->xy.Xx,c->xy.Xy,c->k.esk,server->skB,&server->curve,server->pool,0) < 0)
+      {
+        connFree(server,c);                    /* the entropy source failed              */
+        continue;
+      }
+      job->type = NAXOS_JOB_KB_WIRE;
+      kb[nkb++] = job;
+    }
+    else                                       /* eskB and Y by a job before Kb          */
+    {
+      memcpy(c->xy.sk,server->skB,sizeof(keyC));
+      job->type = NAXOS_JOB_XY;
+      xy[nxy++] = job;
+    }
+  }
+  server->nready = 0;
+
+  size = (nkb+nxy+server->nworkers-1)/server->nworkers;   /* one batch per worker       */
+  if (size < 1) size = 1;
+  if (size > SERVER_BATCH) size = SERVER_BATCH;
+  for (i=0;i<nkb;i+=size)
+  {
+    serverSubmit(server,kb+i,(nkb-i < size)?nkb-i:size);
+  }
+  for (i=0;i<nxy;i+=size)
+  {
+    serverSubmit(server,xy+i,(nxy-i < size)?nxy-i:size);
+  }
+}
+
+void serverBatchDone(naxosServer* server,naxosJob* batch)
+/* The batch job is done: after the XY jobs the handshakes go on with a Kb batch job,
+   after the Kb jobs they are finished
+*/
+{
+  naxosJob* jobs[SERVER_BATCH];
+  naxosJob* next[SERVER_BATCH];
+  serverConn* c;
+  int i,m,n = batch->n;
+
+  memcpy(jobs,batch->batch,n*sizeof(naxosJob*));   /* batch is freed with its connection */
+  if (jobs[0]->type == NAXOS_JOB_XY)
+  {
+    m = 0;
+    for (i=0;i<n;i++)
+    {
+      c = (serverConn*)jobs[i]->arg;
+      if ((c->xy.res == 1) && (c->state != CONN_CLOSING))
+      {
+        memcpy(c->k.esk,c->xy.esk,sizeof(keyC));
+        jobs[i]->type = NAXOS_JOB_KB_WIRE;
+        next[m++] = jobs[i];
+        jobs[i] = NULL;
+      }
+      else                                     /* no Y (entropy source) or closed        */
+      {
+        c->k.res = -5;
+      }
+    }
+    if (m > 0) serverSubmit(server,next,m);
+  }
+  for (i=0;i<n;i++)
+  {
+    if (jobs[i] != NULL) connFinish(server,(serverConn*)jobs[i]->arg);
+  }
+}
+
+void serverCompleted(naxosServer* server)
+/* It goes on with the batch jobs completed by the workers */
+{
+  naxosJob* job;
+  naxosJob* next;
+  uint64_t count;
+  ssize_t res;
+
+  res = read(server->wakefd,&count,sizeof(count));
+  (void)res;
+  pthread_mutex_lock(&server->doneLock);
+  job = server->doneHead;
+  server->doneHead = NULL;
+  pthread_mutex_unlock(&server->doneLock);
+  for (;job!=NULL;job=next)
+  {
+    next = job->next;
+    serverBatchDone(server,job);
+  }
+}
+
+int naxosServerRun(naxosServer* server)
+/* Event loop: the hellos read in a round are submitted to the engine at its end, in batch jobs */
+{
+  struct epoll_event events[SERVER_EVENTS];
+  uint64_t id;
+  int i,n;
+
+  while (!atomic_load(&server->stop))
+  {
+    n = epoll_wait(server->epfd,events,SERVER_EVENTS,server->paused?SERVER_RETRY_MS:-1);
+    if (n < 0)
+    {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    if ((n == 0) && server->paused)            /* retry the accept                       */
+    {
+      serverListeners(server,1);
+    }
+    for (i=0;i<n;i++)
+    {
+      id = events[i].data.u64;
+      if (id == SERVER_WAKE)
+      {
+        serverCompleted(server);
+      }
+      else if (id >= SERVER_WAKE-SERVER_LISTENERS)
+      {
+        serverAccept(server,server->listenFd[SERVER_WAKE-1-id]);
+      }
+      else
+      {
+        connEvent(server,&server->conns[id],events[i].events);
+      }
+    }
+    if (server->nready > 0) serverFlush(server);
+  }
+  return 1;
+}
+
+void naxosServerStop(naxosServer* server)
+/* It sets stop and wakes the event loop */
+{
+  atomic_store(&server->stop,1);
+  serverWake(server);
+}
+
+void naxosServerDestroy(naxosServer* server)
+/* It waits for the jobs of the engine, then it closes and wipes everything */
+{
+  int i;
+
+  if (server == NULL) return;
+  naxosEngineDestroy(server->engine);          /* the jobs are done: no more callbacks   */
+  naxosPoolDestroy(server->pool);
+  naxosTicketStoreDestroy(server->tickets);
+  for (i=0;(server->conns!=NULL)&&(i<server->maxConn);i++)
+  {
+    if (server->conns[i].fd >= 0) close(server->conns[i].fd);
+  }
+  for (i=0;i<server->nlisten;i++)
+  {
+    close(server->listenFd[i]);
+    if (server->listenPath[i] != NULL)
+    {
+      unlink(server->listenPath[i]);
+      free(server->listenPath[i]);
+    }
+  }
+  if (server->epfd >= 0) close(server->epfd);
+  if (server->wakefd >= 0) close(server->wakefd);
+  naxosArenaDestroy(server->arena);            /* wipes skB and the sessions             */
+  pthread_mutex_destroy(&server->doneLock);
+  memset(&server->curve,0,sizeof(ellipticCurve));
+  free(server);
+}
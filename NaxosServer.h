@@ -0,0 +1,79 @@
+/*
+   Event-driven handshake server of the responder B, over Unix-domain or loopback TCP sockets.
+   One thread runs the event loop (naxosServerRun): non-blocking sockets multiplexed by epoll,
+   it accepts the connections, reads the hellos of the initiators and writes the replies.
+   The scalar multiplications are handed off to the workers of a handshake engine
+   (see NaxosEngine.h): the hellos read in a round of the loop are submitted at its end in
+   batch jobs (NAXOS_JOB_BATCH, calculateXYBatch and calculateKbBatch) of up to
+   NAXOS_JOB_BATCH_MAX hellos, split so that each worker gets one, and the workers notify the
+   completed batches to the loop by an eventfd.
+   eskB and Y are taken from an optional pool of ephemeral keys (see NaxosPool.h), otherwise
+   they are calculated by an XY batch job before the Kb batch job.
+   When the process has no fds left (EMFILE, ENFILE) the listeners are disabled until a
+   connection is closed, or for 100 ms, instead of waking the loop for each pending connection.
+   The connections, with their sessions, are in a secure arena (see NaxosArena.h).
+
+   The hellos and the replies are frames of the wire format of NaxosWire.h: the workers parse
+   the hello in place in the receive buffer of the connection and decompress pkA and X
+   (naxosWireHelloSession); the event loop only checks the header.
+   After the reply the connection can carry another handshake. B closes the connection when
+   the hello is not valid, pkA or X are not points of the curve, calculateKb fails or eskB cannot
+   be generated (the entropy source failed).
+
+   With naxosServerTickets the server keeps a ticket of each full handshake (see NaxosTicket.h)
+   and accepts the resumes of the initiators: a resumption is only hashes, so it is done by the
+   event loop without the engine. A rejected ticket (unknown, used or expired) is answered with
+   a resume reply with the flag, and the connection waits for a hello.
+*/
+
+#ifndef _NAXOS_SERVER__
+#define _NAXOS_SERVER__
+
+#include "Naxos.h"
+
+#define SERVER_LISTENERS 4          /* Sockets listened by a server                           */
+#define SERVER_EVENTS 64            /* Events of a call of epoll_wait                         */
+
+typedef void (*naxosKeyCallback)(keyC kB,keyC idA,keyPC pkA,void* arg);
+
+typedef struct naxosServer naxosServer;
+
+naxosServer* naxosServerCreate(ellipticCurve* curveN,keyC skB,keyC idB,int nthreads,int maxConn,int poolDepth,naxosKeyCallback onKey,void* arg);
+/* It creates the server of B (secret key skB, identity idB) for the curve curveN, with an engine
+   of nthreads workers (nthreads <= 0: one per online core) and at most maxConn connections
+   poolDepth > 0: eskB and Y are pre-generated in a pool of poolDepth tuples
+   onKey(kB,idA,pkA,arg) is called by the event loop for each handshake completed or resumed,
+   with pkA in compressed format: the server does not authenticate pkA, it is up to the
+   application to check that it is the key of idA
+   It returns NULL in case of error
+*/
+
+int naxosServerTickets(naxosServer* server,int capacity,int lifetime);
+/* It enables the resumption with a store of capacity tickets, which expire lifetime seconds after
+   the full handshake. It must be called before naxosServerRun
+   Return: 1 = OK, -1 = error (e.g. P-192 has no hash functions)
+*/
+
+int naxosServerListenUnix(naxosServer* server,const char* path);
+/* It listens on the Unix-domain socket path (an existing file is removed)
+   Return: 1 = OK, -1 = error
+*/
+
+int naxosServerListenTcp(naxosServer* server,int port);
+/* It listens on the TCP port of the loopback address 127.0.0.1
+   Return: 1 = OK, -1 = error
+*/
+
+int naxosServerRun(naxosServer* server);
+/* It runs the event loop until naxosServerStop
+   Return: 1 = stopped, -1 = error of epoll
+*/
+
+void naxosServerStop(naxosServer* server);
+/* It stops the event loop. It can be called by any thread or by a signal handler */
+
+void naxosServerDestroy(naxosServer* server);
+/* It completes the handshakes in the engine, closes all the connections and the sockets,
+   and frees the server. The event loop must not be running */
+
+#endif /* #ifndef _NAXOS_SERVER__  */
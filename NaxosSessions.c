@@ -0,0 +1,199 @@
+/*
+   Table of the half-open handshakes of an initiator, as structure of arrays. See NaxosSessions.h
+*/
+
+#include <string.h>
+#include "NaxosSessions.h"
+
+static size_t columnBytes(size_t n)
+/* It returns n rounded up to ARENA_ALIGN: each column starts on a cache line */
+{
+  return (n+ARENA_ALIGN-1) & ~(size_t)(ARENA_ALIGN-1);
+}
+
+sessionTable* sessionTableCreate(ellipticCurve* curveN,int capacity)
+/* It allocates the columns of the table, eskA in the arena, and puts all the slots in the free list */
+{
+  sessionTable* t;
+  size_t c,sx,sc,ss;
+  int i;
+
+  if (capacity < 1) return NULL;
+  t = (sessionTable*)calloc(1,sizeof(sessionTable));
+  if (t == NULL) return NULL;
+  t->curve = *curveN;
+  t->capacity = capacity;
+  t->len = (curveN->bsize+7)/8;
+  t->stride = (t->len+7) & ~7;
+  t->strideC = (t->len+1+7) & ~7;
+
+  c = (size_t)capacity;
+  sx = columnBytes(c*t->stride);
+  sc = columnBytes(c*t->strideC);
+  ss = columnBytes(c);
+  t->arena = naxosArenaCreate(sx);
+  t->block = (uint8_t*)aligned_alloc(ARENA_ALIGN,sc+3*sx+ss);
+  t->freeList = (int*)malloc(c*sizeof(int));
+  if ((t->arena == NULL) || (t->block == NULL) || (t->freeList == NULL))
+  {
+    sessionTableDestroy(t);
+    return NULL;
+  }
+  t->esk = (uint8_t*)naxosArenaAlloc(t->arena,sx);
+  memset(t->block,0,sc+3*sx+ss);
+  t->X = t->block;
+  t->pkx = t->X + sc;
+  t->pky = t->pkx + sx;
+  t->id = t->pky + sx;
+  t->status = t->id + sx;
+  for (i=0;i<capacity;i++)
+  {
+    t->freeList[i] = capacity-1-i;             /* slot 0 is taken first                     */
+  }
+  t->nfree = capacity;
+  return t;
+}
+
+int sessionTableOpen(sessionTable* t,keyC pkBx,keyC pkBy,keyC idB)
+/* It takes a free slot and stores the peer */
+{
+  int i;
+
+  if (t->nfree == 0) return -1;
+  i = t->freeList[--t->nfree];
+  memcpy(t->pkx+(size_t)i*t->stride,pkBx,t->len);
+  memcpy(t->pky+(size_t)i*t->stride,pkBy,t->len);
+  memcpy(t->id+(size_t)i*t->stride,idB,t->len);
+  t->status[i] = SESSION_OPEN;
+  return i;
+}
+
+int sessionTableXY(sessionTable* t,keyC skA,const int* idx,int n)
+/* It calculates eskA and X of the open sessions, SESSION_BATCH at a time */
+{
+  sessionXY batch[SESSION_BATCH];
+  keyPC Xc;
+  int pos[SESSION_BATCH];
+  int i,j,m,done;
+
+  done = 0;
+  memset(batch,0,sizeof(batch));
+  for (i=0;i<n;)
+  {
+    for (m=0;(m<SESSION_BATCH)&&(i<n);i++)   /* gather the open sessions                */
+    {
+      if ((idx[i] < 0) || (idx[i] >= t->capacity) || (t->status[idx[i]] != SESSION_OPEN)) continue;
+      pos[m] = idx[i];
+      memcpy(batch[m].sk,skA,t->len);
+      m++;
+    }
+    if (m == 0) continue;
+    if (calculateXYBatch(batch,m,&t->curve) != 1)
+    {
+      naxosWipe(batch,sizeof(batch));
+      return -1;
+    }
+    for (j=0;j<m;j++)                          /* scatter eskA and X in the columns         */
+    {
+      if (batch[j].res != 1) continue;         /* entropy source failed: the session stays open */
+      memcpy(t->esk+(size_t)pos[j]*t->stride,batch[j].esk,t->len);
+      compressPoint(Xc,batch[j].Xx,batch[j].Xy,&t->curve);   /* it writes a whole keyPC   */
+      memcpy(t->X+(size_t)pos[j]*t->strideC,Xc,t->len+1);
+      t->status[pos[j]] = SESSION_PENDING;
+      done++;
+    }
+  }
+  naxosWipe(batch,sizeof(batch));              /* clear sk and esk                          */
+  return done;
+}
+
+const uint8_t* sessionTableGetX(sessionTable* t,int i)
+/* It returns the compressed X of the session i */
+{
+  return t->X+(size_t)i*t->strideC;
+}
+
+int sessionTableKa(sessionTable* t,keyC skA,keyC idA,const int* idx,keyC* Yx,keyC* Yy,int n,keyC* kA,int* res)
+/* It calculates kA of the pending sessions, SESSION_BATCH at a time, and closes them */
+{
+  sessionK batch[SESSION_BATCH];
+  int pos[SESSION_BATCH];
+  int i,j,m,s;
+
+  memset(batch,0,sizeof(batch));
+  for (i=0;i<n;)
+  {
+    for (m=0;(m<SESSION_BATCH)&&(i<n);i++)   /* gather the pending sessions             */
+    {
+      s = idx[i];
+      if ((s < 0) || (s >= t->capacity) || (t->status[s] != SESSION_PENDING))
+      {
+        res[i] = -6;
+        continue;
+      }
+      pos[m] = i;
+      memcpy(batch[m].ePx,Yx[i],t->len);
+      memcpy(batch[m].ePy,Yy[i],t->len);
+      memcpy(batch[m].pkx,t->pkx+(size_t)s*t->stride,t->len);
+      memcpy(batch[m].pky,t->pky+(size_t)s*t->stride,t->len);
+      memcpy(batch[m].esk,t->esk+(size_t)s*t->stride,t->len);
+      memcpy(batch[m].sk,skA,t->len);
+      memcpy(batch[m].idA,idA,t->len);
+      memcpy(batch[m].idB,t->id+(size_t)s*t->stride,t->len);
+      m++;
+    }
+    if (m == 0) continue;
+    if (calculateKaBatch(batch,m,&t->curve) != 1)
+    {
+      for (j=0;j<m;j++)                        /* this batch and the next: still pending    */
+      {
+        res[pos[j]] = -1;
+      }
+      for (;i<n;i++)                           /* -6 for the ones not pending, as above    */
+      {
+        s = idx[i];
+        res[i] = ((s < 0) || (s >= t->capacity) || (t->status[s] != SESSION_PENDING))?-6:-1;
+      }
+      naxosWipe(batch,sizeof(batch));
+      return -1;
+    }
+    for (j=0;j<m;j++)
+    {
+      memcpy(kA[pos[j]],batch[j].k,sizeof(keyC));
+      res[pos[j]] = batch[j].res;
+      sessionTableClose(t,idx[pos[j]]);
+    }
+  }
+  naxosWipe(batch,sizeof(batch));              /* clear the keys                            */
+  return 1;
+}
+
+void sessionTableClose(sessionTable* t,int i)
+/* It wipes the fields of the session i and puts its slot in the free list */
+{
+  if ((i < 0) || (i >= t->capacity) || (t->status[i] == SESSION_FREE)) return;
+  naxosWipe(t->esk+(size_t)i*t->stride,t->stride);
+  memset(t->X+(size_t)i*t->strideC,0,t->strideC);
+  memset(t->pkx+(size_t)i*t->stride,0,t->stride);
+  memset(t->pky+(size_t)i*t->stride,0,t->stride);
+  memset(t->id+(size_t)i*t->stride,0,t->stride);
+  t->status[i] = SESSION_FREE;
+  t->freeList[t->nfree++] = i;
+}
+
+int sessionTableCount(sessionTable* t)
+/* It returns the sessions not free */
+{
+  return t->capacity-t->nfree;
+}
+
+void sessionTableDestroy(sessionTable* t)
+/* It wipes eskA with the arena and frees the columns */
+{
+  if (t == NULL) return;
+  naxosArenaDestroy(t->arena);
+  free(t->block);
+  free(t->freeList);
+  memset(&t->curve,0,sizeof(ellipticCurve));
+  free(t);
+}
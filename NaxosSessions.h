@@ -0,0 +1,89 @@
+/*
+   Table of the half-open handshakes of an initiator A, as structure of arrays.
+   Between calculateXY and calculateKa the initiator keeps, for each session, eskA, X (sent to
+   the peer), the public key and the identity of the peer B, and the status. In sessionK each
+   of them is a keyC of COORD_BYTES, whatever the curve: here each field is a column of the
+   table with only the bytes of the curve ((bsize+7)/8, rounded up to 8), and the columns are
+   aligned to 64 bytes. A P-256 session takes about 170 bytes instead of the 650 of sessionK.
+   The column of eskA is in a secure arena (see NaxosArena.h).
+   sessionTableXY and sessionTableKa stream the sessions through calculateXYBatch and
+   calculateKaBatch in batches of SESSION_BATCH sessions, so that the temporaries of a batch
+   stay in the cache.
+   A table has no lock: it must be used by one thread at a time.
+*/
+
+#ifndef _NAXOS_SESSIONS__
+#define _NAXOS_SESSIONS__
+
+#include "Naxos.h"
+#include "NaxosArena.h"
+
+#define SESSION_BATCH 16      /* Sessions of a call of calculateXYBatch or calculateKaBatch */
+
+#define SESSION_FREE    0     /* Status of a session: slot not used                         */
+#define SESSION_OPEN    1     /* peer set by sessionTableOpen, eskA and X not calculated   */
+#define SESSION_PENDING 2     /* eskA and X calculated, waiting for Y                      */
+
+typedef struct sessionTable
+{
+  ellipticCurve curve;
+  int capacity;
+  int len;                /* bytes of a coordinate: (bsize+7)/8                           */
+  int stride;             /* bytes of a field in a column: len rounded up to 8            */
+  int strideC;            /* bytes of a compressed point: len+1 rounded up to 8           */
+  uint8_t* esk;           /* column eskA, in the arena                                    */
+  uint8_t* X;             /* column X, compressed (see compressPoint)                     */
+  uint8_t* pkx;           /* columns of the public key pkB of the peer                    */
+  uint8_t* pky;
+  uint8_t* id;            /* column of the identity idB of the peer                       */
+  uint8_t* status;        /* SESSION_FREE, SESSION_OPEN, SESSION_PENDING                   */
+  uint8_t* block;         /* memory of the columns X, pkx, pky, id and status             */
+  int* freeList;          /* free slots: freeList[0], ..., freeList[nfree-1]              */
+  int nfree;
+  naxosArena* arena;
+} sessionTable;
+
+sessionTable* sessionTableCreate(ellipticCurve* curveN,int capacity);
+/* It creates a table of capacity sessions for the curve curveN
+   It returns NULL in case of error
+*/
+
+int sessionTableOpen(sessionTable* t,keyC pkBx,keyC pkBy,keyC idB);
+/* It opens a session with the peer of public key pkB and identity idB
+   Return: the index of the session, -1 if the table is full
+*/
+
+int sessionTableXY(sessionTable* t,keyC skA,const int* idx,int n);
+/* It calculates eskA and X for the n open sessions idx[0], ..., idx[n-1]
+   (the sessions not open are skipped), that become pending. X is read by sessionTableGetX
+   A session whose esk cannot be generated (the entropy source failed, see calculateXY) stays
+   open
+   Return:
+     number of sessions calculated
+    -1 = memory allocation error
+*/
+
+const uint8_t* sessionTableGetX(sessionTable* t,int i);
+/* It returns X of the session i in compressed format (len+1 bytes, see compressPoint) */
+
+int sessionTableKa(sessionTable* t,keyC skA,keyC idA,const int* idx,keyC* Yx,keyC* Yy,int n,keyC* kA,int* res);
+/* It calculates kA[j] for the pending sessions idx[j] with the ephemeral public keys
+   Y[j] of the peers (calculateKa), then it closes the sessions
+   res[j] is the return code of calculateKa, -6 if the session is not pending
+   Return:
+     1 = OK
+    -1 = memory allocation error in a batch: the sessions of the batches before it have
+         their res[j] and kA[j] and are closed, the others still pending have res[j] = -1 and are
+         not closed (res[j] = -6 for the sessions not pending)
+*/
+
+void sessionTableClose(sessionTable* t,int i);
+/* It wipes the session i and frees its slot */
+
+int sessionTableCount(sessionTable* t);
+/* It returns the number of sessions open or pending */
+
+void sessionTableDestroy(sessionTable* t);
+/* It wipes all the sessions and frees the table */
+
+#endif /* #ifndef _NAXOS_SESSIONS__  */
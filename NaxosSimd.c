@@ -0,0 +1,211 @@
+/*
+   Multi-lane field arithmetic engine and co-Z ladder. See NaxosSimd.h
+   The lane functions are written once in NaxosLanes.inc and included for each instruction set,
+   with the target attribute of the functions: the file is compiled with the CFLAGS of the library
+*/
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "NaxosSimd.h"
+#include "NaxosArena.h"
+
+void coordInit(coord a);                                          /* See Naxos.c */
+int coordMaxBit(coord a, int nwords);                             /* See Naxos.c */
+int coordGetBit(coord a, int j);                                  /* See Naxos.c */
+void coordDouble (coord a,coord b,coord p,int nwords);            /* See Naxos.c */
+void coordToMont(coord c,coord a,ellipticCurve* curve);           /* See Naxos.c */
+void coordFromMont(coord c,coord a,ellipticCurve* curve);         /* See Naxos.c */
+void scalarMultProj(pointP* Q,coord k,pointA* P,ellipticCurve* curve);  /* See Naxos.c */
+void scalarMultWindowProj(pointP* Q,coord k,pointA* P,ellipticCurve* curve);  /* See Naxos.c */
+
+void coordToLimbs(uint64_t* w,int lane,int nlanes,coord a,int nwords,int L,int r)
+/* It splits a of nwords words in L limbs of r bits, w[j*nlanes+lane] = limb j of a */
+{
+  uint64_t mask = (((uint64_t)1)<<r)-1;
+  int j,b,i,s;
+
+  for (j=0;j<L;j++)
+  {
+    b = j*r;                                    /* first bit of the limb                    */
+    i = b/64;
+    s = b%64;
+    w[j*nlanes+lane] = 0;
+    if (i < nwords)
+    {
+      w[j*nlanes+lane] = a[i]>>s;
+    }
+    if ((s+r > 64) && (i+1 < nwords))
+    {
+      w[j*nlanes+lane] |= a[i+1]<<(64-s);
+    }
+    w[j*nlanes+lane] &= mask;
+  }
+}
+
+void limbsToCoord(coord a,uint64_t* w,int lane,int nlanes,int nwords,int L,int r)
+/* It joins the L limbs of r bits w[j*nlanes+lane], j = 0, ..., L-1, in a of nwords words */
+{
+  int j,b,i,s;
+
+  coordInit(a);
+  for (j=0;j<L;j++)
+  {
+    b = j*r;
+    i = b/64;
+    s = b%64;
+    if (i < nwords)
+    {
+      a[i] |= w[j*nlanes+lane]<<s;
+    }
+    if ((s+r > 64) && (i+1 < nwords))
+    {
+      a[i+1] |= w[j*nlanes+lane]>>(64-s);
+    }
+  }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NAXOS_NO_SIMD)
+
+#include <immintrin.h>
+
+/* AVX-512 IFMA: 8 lanes, radix 2^52 */
+
+#define VEC             __m512i
+#define LANE_W          8
+#define LANE_R          52
+#define LANE_LMAX       11
+#define LANE_FN         __attribute__((target("avx512f,avx512ifma")))
+#define LN(name)        ifma_##name
+#define V_ZERO()        _mm512_setzero_si512()
+#define V_SET1(x)       _mm512_set1_epi64((long long)(x))
+#define V_LOADU(p)      _mm512_loadu_si512((const void*)(p))
+#define V_STOREU(p,a)   _mm512_storeu_si512((void*)(p),a)
+#define V_ADD(a,b)      _mm512_add_epi64(a,b)
+#define V_SUB(a,b)      _mm512_sub_epi64(a,b)
+#define V_AND(a,b)      _mm512_and_si512(a,b)
+#define V_OR(a,b)       _mm512_or_si512(a,b)
+#define V_ANDNOT(a,b)   _mm512_andnot_si512(a,b)
+#define V_SRL(a,n)      _mm512_srli_epi64(a,n)
+#define MULACC(t,j,a,b) do { t[j] = _mm512_madd52lo_epu64(t[j],a,b); \
+                             t[(j)+1] = _mm512_madd52hi_epu64(t[(j)+1],a,b); } while (0)
+#define MULLO(a,b,mask) _mm512_madd52lo_epu64(_mm512_setzero_si512(),a,b)
+
+#include "NaxosLanes.inc"
+
+#undef VEC
+#undef LANE_W
+#undef LANE_R
+#undef LANE_LMAX
+#undef LANE_FN
+#undef LN
+#undef V_ZERO
+#undef V_SET1
+#undef V_LOADU
+#undef V_STOREU
+#undef V_ADD
+#undef V_SUB
+#undef V_AND
+#undef V_OR
+#undef V_ANDNOT
+#undef V_SRL
+#undef MULACC
+#undef MULLO
+
+/* AVX2: 4 lanes, radix 2^26, the 32x32 bits products of vpmuludq */
+
+#define VEC             __m256i
+#define LANE_W          4
+#define LANE_R          26
+#define LANE_LMAX       21
+#define LANE_FN         __attribute__((target("avx2")))
+#define LN(name)        avx2_##name
+#define V_ZERO()        _mm256_setzero_si256()
+#define V_SET1(x)       _mm256_set1_epi64x((long long)(x))
+#define V_LOADU(p)      _mm256_loadu_si256((const __m256i*)(p))
+#define V_STOREU(p,a)   _mm256_storeu_si256((__m256i*)(p),a)
+#define V_ADD(a,b)      _mm256_add_epi64(a,b)
+#define V_SUB(a,b)      _mm256_sub_epi64(a,b)
+#define V_AND(a,b)      _mm256_and_si256(a,b)
+#define V_OR(a,b)       _mm256_or_si256(a,b)
+#define V_ANDNOT(a,b)   _mm256_andnot_si256(a,b)
+#define V_SRL(a,n)      _mm256_srli_epi64(a,n)
+#define MULACC(t,j,a,b) do { t[j] = _mm256_add_epi64(t[j],_mm256_mul_epu32(a,b)); } while (0)
+#define MULLO(a,b,mask) _mm256_and_si256(_mm256_mul_epu32(a,b),mask)
+
+#include "NaxosLanes.inc"
+
+#define SIMD_X86 1
+
+#endif
+
+static atomic_int simdLanes = SIMD_NONE;  /* engine selected, read by the workers             */
+static int simdSupported = SIMD_NONE;     /* best engine supported by the CPU                 */
+static pthread_once_t simdOnce = PTHREAD_ONCE_INIT;
+
+void simdDetect(void)
+/* It detects the best engine supported by the CPU
+   The default is IFMA or none: the 4 lanes of AVX2 with 26 bits limbs are not faster than
+   scalarMultProj with 64 bits words, the AVX2 engine is used only if selected
+*/
+{
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma"))
+  {
+    simdSupported = SIMD_IFMA;
+  }
+  else if (__builtin_cpu_supports("avx2"))
+  {
+    simdSupported = SIMD_AVX2;
+  }
+#endif
+  atomic_store(&simdLanes,(simdSupported == SIMD_IFMA)?SIMD_IFMA:SIMD_NONE);
+}
+
+int naxosSimdLanes(void)
+/* It returns the number of lanes of the engine, see NaxosSimd.h */
+{
+  pthread_once(&simdOnce,simdDetect);
+  return atomic_load(&simdLanes);
+}
+
+int naxosSimdSelect(int lanes)
+/* It selects the engine, see NaxosSimd.h */
+{
+  pthread_once(&simdOnce,simdDetect);
+  if ((lanes != SIMD_NONE) && (lanes != SIMD_AVX2) && (lanes != SIMD_IFMA)) return -1;
+  if (lanes > simdSupported) return -1;   /* IFMA implies AVX2                                */
+  atomic_store(&simdLanes,lanes);
+  return lanes;
+}
+
+void scalarMultLanesProj(pointP* Q,coord* k,pointA* P,int n,ellipticCurve* curve)
+/* It calculates Q[i] = k[i]*P[i] in groups of lanes, see NaxosSimd.h */
+{
+  int i,w;
+
+  w = naxosSimdLanes();
+  if (w == SIMD_NONE) w = 1;
+  for (i=0;i<n;i+=w)
+  {
+#ifdef SIMD_X86
+    if (w == SIMD_IFMA)
+    {
+      ifma_ladder(&Q[i],&k[i],&P[i],(n-i < w)?(n-i):w,curve);
+      continue;
+    }
+    if (w == SIMD_AVX2)
+    {
+      avx2_ladder(&Q[i],&k[i],&P[i],(n-i < w)?(n-i):w,curve);
+      continue;
+    }
+#endif
+    if (curve->wbits != 0)                    /* no engine: one session at a time         */
+    {
+      scalarMultWindowProj(&Q[i],k[i],&P[i],curve);
+      continue;
+    }
+    scalarMultProj(&Q[i],k[i],&P[i],curve);
+  }
+}
@@ -0,0 +1,44 @@
+/*
+   Multi-lane field arithmetic engine.
+   The field elements of LANES independent sessions are kept in the lanes of the vector
+   registers in unsaturated radix (limbs of less than 64 bits), so that the carries are
+   propagated only at the end of each operation:
+     AVX-512 IFMA: 8 lanes, radix 2^52, products by vpmadd52luq/vpmadd52huq
+     AVX2:         4 lanes, radix 2^26, products by vpmuludq
+   Each lane uses the Montgomery multiplication with R = 2^(radix bits * limbs),
+   independently of the reduction used by the curve for the single session.
+   On top of it the co-Z Montgomery ladder of scalarMultProj runs on all the lanes together.
+   The instruction set is selected at run time: IFMA where available, scalarMultProj otherwise;
+   the AVX2 engine, not faster than the 64 bits words of scalarMultProj, only by naxosSimdSelect
+*/
+
+#ifndef _NAXOS_SIMD__
+#define _NAXOS_SIMD__
+
+#include "Naxos.h"
+
+#define SIMD_NONE   0     /* No multi-lane engine                                   */
+#define SIMD_AVX2   4     /* AVX2, 4 lanes                                          */
+#define SIMD_IFMA   8     /* AVX-512 IFMA, 8 lanes                                  */
+
+int naxosSimdLanes(void);
+/* It returns the number of lanes of the engine in use: SIMD_IFMA, SIMD_AVX2 or SIMD_NONE */
+
+int naxosSimdSelect(int lanes);
+/* It selects the engine SIMD_IFMA, SIMD_AVX2 or SIMD_NONE, if supported by the CPU
+   It can be called while other threads use the engine: each scalarMultLanesProj reads the
+   selected engine once, at its start
+   Return:
+     the number of lanes of the selected engine
+    -1 = engine not supported
+*/
+
+void scalarMultLanesProj(pointP* Q,coord* k,pointA* P,int n,ellipticCurve* curve);
+/* It calculates Q[i] = k[i]*P[i], i = 0, ..., n-1, with the Montgomery ladder of scalarMultProj
+   in groups of naxosSimdLanes() sessions, with k[i] < p
+   Without engine, one session at a time with the scalar multiplication of the curve
+   P and Q are in Montgomery form, Q in Projective coordinates
+   Always the same number of operations
+*/
+
+#endif /* #ifndef _NAXOS_SIMD__  */
@@ -0,0 +1,203 @@
+/*
+   Resumption tickets. See NaxosTicket.h
+*/
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "NaxosTicket.h"
+#include "NaxosArena.h"
+
+typedef struct ticketEntry   /* Ticket of the store                                       */
+{
+  naxosTicket t;             /* t.valid = 0: free slot                                    */
+  keyC idA;                  /* peer of the full handshake                                */
+  keyPC pkA;
+  int64_t expiry;            /* ns of CLOCK_MONOTONIC                                     */
+} ticketEntry;
+
+struct naxosTicketStore
+{
+  ellipticCurve curve;
+  naxosArena* arena;
+  ticketEntry* entries;      /* in the arena                                              */
+  uint32_t mask;             /* slots - 1                                                 */
+  int64_t lifetime;          /* ns                                                        */
+  pthread_mutex_t lock;
+};
+
+static const uint8_t labelId[] = "NaxosTicketId";
+static const uint8_t labelSecret[] = "NaxosTicket";
+static const uint8_t labelResume[] = "NaxosResume";
+
+int64_t ticketNow(void)
+/* It returns the ns of CLOCK_MONOTONIC */
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+int ticketHash(uint8_t* out,int outLen,const uint8_t* label,int labelLen,const uint8_t* k,ellipticCurve* curveN)
+/* It calculates out = H(label || k), k of klen bytes. Return: 1 = OK, -1 = no hash functions */
+{
+  hashState hs;
+
+  if (hashInit(&hs,curveN) != 1) return -1;
+  hashAbsorb(&hs,label,labelLen);
+  hashAbsorb(&hs,k,curveN->hash.klen);
+  return hashFinal(&hs,out,outLen);
+}
+
+int naxosTicketDerive(naxosTicket* t,keyC k,ellipticCurve* curveN)
+/* It derives id and secret from k */
+{
+  uint8_t id[TICKET_SECRET];
+
+  t->valid = 0;
+  if ((ticketHash(id,curveN->hash.klen,labelId,sizeof(labelId)-1,k,curveN) != 1) ||
+      (ticketHash(t->secret,curveN->hash.klen,labelSecret,sizeof(labelSecret)-1,k,curveN) != 1)) return -1;
+  memcpy(t->id,id,TICKET_ID);                  /* klen >= TICKET_ID                        */
+  t->valid = 1;
+  return 1;
+}
+
+int naxosResumeKey(keyC k,naxosTicket* t,const uint8_t* nonceA,const uint8_t* nonceB,keyC idA,keyC idB,ellipticCurve* curveN)
+/* It calculates k = H("NaxosResume" || secret || nA || nB || idA || idB) and the next ticket */
+{
+  hashState hs;
+  int len = (curveN->bsize+7)/8;
+
+  if ((t->valid != 1) || (hashInit(&hs,curveN) != 1)) return -1;
+  hashAbsorb(&hs,labelResume,sizeof(labelResume)-1);
+  hashAbsorb(&hs,t->secret,curveN->hash.klen);
+  hashAbsorb(&hs,nonceA,TICKET_NONCE);
+  hashAbsorb(&hs,nonceB,TICKET_NONCE);
+  hashAbsorb(&hs,idA,len);
+  hashAbsorb(&hs,idB,len);
+  if (hashFinal(&hs,k,curveN->hash.klen) != 1) return -1;
+  naxosWipe(t,sizeof(naxosTicket));            /* the ticket is used                       */
+  return naxosTicketDerive(t,k,curveN);
+}
+
+naxosTicketStore* naxosTicketStoreCreate(ellipticCurve* curveN,int capacity,int lifetime)
+/* It allocates the slots in the arena */
+{
+  naxosTicketStore* s;
+  uint32_t size;
+
+  if ((capacity < 1) || (capacity > (1<<24)) || (lifetime < 0) || (curveN->hash.rate == 0)) return NULL;
+  for (size=TICKET_PROBE;(int)size<capacity;size*=2);
+  s = (naxosTicketStore*)calloc(1,sizeof(naxosTicketStore));
+  if (s == NULL) return NULL;
+  s->arena = naxosArenaCreate((size_t)size*sizeof(ticketEntry));
+  if (s->arena == NULL)
+  {
+    free(s);
+    return NULL;
+  }
+  s->curve = *curveN;
+  s->entries = (ticketEntry*)naxosArenaAlloc(s->arena,(size_t)size*sizeof(ticketEntry));
+  s->mask = size-1;
+  s->lifetime = (int64_t)lifetime*1000000000;
+  pthread_mutex_init(&s->lock,NULL);
+  return s;
+}
+
+uint32_t ticketSlot(const uint8_t* id)
+/* It returns the first slot of the ticket id: the id is the output of SHA3 */
+{
+  return (uint32_t)id[0] | ((uint32_t)id[1] << 8) | ((uint32_t)id[2] << 16) | ((uint32_t)id[3] << 24);
+}
+
+void ticketPut(naxosTicketStore* s,naxosTicket* t,keyC idA,keyPC pkA,int64_t expiry,int64_t now)
+/* It stores t in a free or expired probed slot, otherwise in the one that expires first */
+{
+  ticketEntry* e;
+  ticketEntry* victim = NULL;
+  uint32_t h = ticketSlot(t->id);
+  int i;
+
+  for (i=0;i<TICKET_PROBE;i++)
+  {
+    e = &s->entries[(h+i) & s->mask];
+    if ((e->t.valid == 0) || (e->expiry <= now))
+    {
+      victim = e;
+      break;
+    }
+    if ((victim == NULL) || (e->expiry < victim->expiry)) victim = e;
+  }
+  naxosWipe(victim,sizeof(ticketEntry));
+  victim->t = *t;
+  memcpy(victim->idA,idA,sizeof(keyC));
+  memcpy(victim->pkA,pkA,sizeof(keyPC));
+  victim->expiry = expiry;
+}
+
+int naxosTicketStoreAdd(naxosTicketStore* s,keyC k,keyC idA,keyPC pkA)
+/* It derives the ticket of k and stores it with the expiry now + lifetime */
+{
+  naxosTicket t;
+  int64_t now;
+
+  if (naxosTicketDerive(&t,k,&s->curve) != 1) return -1;
+  now = ticketNow();
+  pthread_mutex_lock(&s->lock);
+  ticketPut(s,&t,idA,pkA,now+s->lifetime,now);
+  pthread_mutex_unlock(&s->lock);
+  naxosWipe(&t,sizeof(naxosTicket));
+  return 1;
+}
+
+int naxosTicketStoreResume(naxosTicketStore* s,keyC k,keyC idA,keyPC pkA,const uint8_t* id,const uint8_t* nonceA,uint8_t* nonceB,keyC idB)
+/* It takes the ticket out of the store, calculates k and stores the next ticket */
+{
+  ticketEntry* e;
+  ticketEntry found;
+  uint32_t h = ticketSlot(id);
+  int64_t now = ticketNow();
+  int i,res = -1;
+
+  pthread_mutex_lock(&s->lock);
+  for (i=0;i<TICKET_PROBE;i++)
+  {
+    e = &s->entries[(h+i) & s->mask];
+    if ((e->t.valid == 1) && (memcmp(e->t.id,id,TICKET_ID) == 0))
+    {
+      found = *e;
+      naxosWipe(e,sizeof(ticketEntry));        /* used only once, also when expired       */
+      res = (found.expiry > now)?1:-1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&s->lock);
+  if (res != 1) return -1;
+
+  if ((randomGen(nonceB,8*TICKET_NONCE) != 1) ||
+      (naxosResumeKey(k,&found.t,nonceA,nonceB,found.idA,idB,&s->curve) != 1))
+  {
+    res = -1;
+  }
+  else
+  {
+    memcpy(idA,found.idA,sizeof(keyC));
+    memcpy(pkA,found.pkA,sizeof(keyPC));
+    pthread_mutex_lock(&s->lock);
+    ticketPut(s,&found.t,found.idA,found.pkA,found.expiry,now);   /* the expiry of the first ticket */
+    pthread_mutex_unlock(&s->lock);
+  }
+  naxosWipe(&found,sizeof(ticketEntry));
+  return res;
+}
+
+void naxosTicketStoreDestroy(naxosTicketStore* s)
+/* It wipes the tickets with the arena */
+{
+  if (s == NULL) return;
+  naxosArenaDestroy(s->arena);
+  pthread_mutex_destroy(&s->lock);
+  memset(&s->curve,0,sizeof(ellipticCurve));
+  free(s);
+}
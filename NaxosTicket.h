@@ -0,0 +1,70 @@
+/*
+   Resumption tickets: a reconnection without scalar multiplications.
+   After a full handshake both sides derive from the key k a ticket: an identifier and a
+   resumption secret, with the SHA3 of the curve
+     id     = H("NaxosTicketId" || k), first TICKET_ID bytes
+     secret = H("NaxosTicket" || k)
+   B keeps the tickets in a store with idA and pkA of the handshake. To resume, A sends the id
+   and a fresh nonce nA, B takes the ticket out of the store (a ticket is used only once), sends
+   a fresh nonce nB and both calculate the key
+     k' = H("NaxosResume" || secret || nA || nB || idA || idB)
+   and the next ticket from k'. A resumption costs a few Keccak permutations instead of the three
+   scalar multiplications of calculateKa and calculateKb.
+   The tickets of a store expire lifetime seconds after the full handshake: the tickets of the
+   resumptions keep the expiry of the first one, so the full handshakes are periodic.
+   As the secret is derived from k, a resumed key does not have the forward secrecy of the
+   ephemeral keys of a full handshake until the ticket expires.
+*/
+
+#ifndef _NAXOS_TICKET__
+#define _NAXOS_TICKET__
+
+#include "Naxos.h"
+
+#define TICKET_ID 16         /* Bytes of the identifier of a ticket                   */
+#define TICKET_NONCE 32      /* Bytes of the nonces nA and nB                          */
+#define TICKET_SECRET 64     /* Bytes of the resumption secret: the largest klen       */
+#define TICKET_PROBE 8       /* Slots of the store probed for a ticket                 */
+
+typedef struct naxosTicket   /* Ticket of a session                                       */
+{
+  uint8_t id[TICKET_ID];
+  uint8_t secret[TICKET_SECRET];  /* klen bytes of the curve                              */
+  int valid;                      /* 1 = derived and not used                             */
+} naxosTicket;
+
+typedef struct naxosTicketStore naxosTicketStore;
+
+int naxosTicketDerive(naxosTicket* t,keyC k,ellipticCurve* curveN);
+/* It derives the ticket t from the key k of a handshake
+   Return: 1 = OK, -1 = no hash functions (P-192)
+*/
+
+int naxosResumeKey(keyC k,naxosTicket* t,const uint8_t* nonceA,const uint8_t* nonceB,keyC idA,keyC idB,ellipticCurve* curveN);
+/* It calculates the key k of the resumption of t with the nonces, then t becomes the next ticket
+   Return: 1 = OK, -1 = t not valid or no hash functions
+*/
+
+naxosTicketStore* naxosTicketStoreCreate(ellipticCurve* curveN,int capacity,int lifetime);
+/* It creates the store of B of at least capacity tickets (rounded up to a power of 2), which
+   expire lifetime seconds after the full handshake. The store is in a secure arena
+   It returns NULL in case of error
+*/
+
+int naxosTicketStoreAdd(naxosTicketStore* s,keyC k,keyC idA,keyPC pkA);
+/* It derives the ticket of the key k of a full handshake with A (idA, pkA) and stores it
+   When the probed slots are all used, the ticket that expires first is replaced
+   Return: 1 = OK, -1 = no hash functions
+*/
+
+int naxosTicketStoreResume(naxosTicketStore* s,keyC k,keyC idA,keyPC pkA,const uint8_t* id,const uint8_t* nonceA,uint8_t* nonceB,keyC idB);
+/* It takes the ticket id out of the store, generates nonceB and calculates the key k of the
+   resumption with nonceA (naxosResumeKey); the next ticket is stored. idA and pkA are the ones
+   of the full handshake of the ticket
+   Return: 1 = OK, -1 = unknown, used or expired ticket
+*/
+
+void naxosTicketStoreDestroy(naxosTicketStore* s);
+/* It wipes the tickets and frees the store */
+
+#endif /* #ifndef _NAXOS_TICKET__  */
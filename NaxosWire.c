@@ -0,0 +1,241 @@
+/*
+   Wire format of the handshake messages. See NaxosWire.h
+*/
+
+#include <string.h>
+#include "NaxosWire.h"
+#include "NaxosArena.h"
+
+void coordFromMont(coord c,coord a,ellipticCurve* curve);                           /* See Naxos.c */
+void wordToByte(uint8_t *arrayB,coord arrayW,int wordLen);                          /* See Naxos.c */
+int convXToPoint(pointA* aP,uint8_t* x,int byteLen,int odd,ellipticCurve* curve);   /* See Naxos.c */
+int calculateXYPoint(pointA* X,keyC esk,keyC sk,ellipticCurve* curveN);            /* See Naxos.c */
+int calculateKaPoint(keyC kA,pointA* Y,keyC eskA,keyC skAb,pointA* pkB,const uint64_t* pkBTable,keyC idA,keyC idB,ellipticCurve* curveN);  /* See Naxos.c */
+int calculateKbPoint(keyC kB,pointA* pkA,const uint64_t* pkATable,keyC eskB,keyC skBb,pointA* X,keyC idA,keyC idB,ellipticCurve* curveN);  /* See Naxos.c */
+void naxosPhaseNone(void);                                                          /* See Naxos.c */
+void convPointToBytes(keyC pX,keyC pY,pointA* aP,ellipticCurve* curve);             /* See Naxos.c */
+
+int wireBody(int type,ellipticCurve* curveN)
+/* It returns the bytes of the body of a frame of type, -1 for an unknown type */
+{
+  switch (type)
+  {
+    case WIRE_HELLO:        return 3*WIRE_SLOT(curveN);
+    case WIRE_REPLY:        return WIRE_SLOT(curveN);
+    case WIRE_RESUME:       return TICKET_ID+TICKET_NONCE;
+    case WIRE_RESUME_REPLY: return TICKET_NONCE;
+    default:                return -1;
+  }
+}
+
+int wireFlags(int type)
+/* It returns the bits of the flags of a frame of type */
+{
+  return (type == WIRE_HELLO)?3:((type == WIRE_RESUME)?0:1);
+}
+
+void wireHeader(uint8_t* buf,int type,int parity,ellipticCurve* curveN)
+/* It writes the header of a frame of type */
+{
+  int body = wireBody(type,curveN);
+
+  buf[0] = NAXOS_WIRE_VERSION;
+  buf[1] = (uint8_t)type;
+  buf[2] = (uint8_t)(curveN->bsize & 0xFF);
+  buf[3] = (uint8_t)(curveN->bsize >> 8);
+  buf[4] = (uint8_t)(body & 0xFF);
+  buf[5] = (uint8_t)(body >> 8);
+  buf[6] = (uint8_t)parity;
+  buf[7] = 0;
+}
+
+void wireSlot(uint8_t* slot,const uint8_t* b,ellipticCurve* curveN)
+/* It writes in the slot the number b of (bsize+7)/8 bytes, padded with 0 */
+{
+  int len = (curveN->bsize+7)/8;
+
+  memcpy(slot,b,len);
+  memset(slot+len,0,WIRE_SLOT(curveN)-len);
+}
+
+int wirePoint(uint8_t* slot,pointA* aP,ellipticCurve* curveN)
+/* It writes x of aP in Montgomery form in the slot and it returns the parity of y */
+{
+  coord t;
+  int odd;
+
+  coordFromMont(t,aP->aY,curveN);
+  odd = (int)(t[0]&1);
+  coordFromMont(t,aP->aX,curveN);
+  wordToByte(slot,t,curveN->wsize);           /* the slot is the limbs of x            */
+  naxosWipe(t,COORD_BYTES);
+  return odd;
+}
+
+int naxosWireFrameBytes(const uint8_t* buf,int len,int type,ellipticCurve* curveN)
+/* It checks the version, the type, the curve and the length of the body of the header */
+{
+  int body = wireBody(type,curveN);
+
+  if (len < WIRE_HEADER) return 0;
+  if ((body < 0) || (buf[0] != NAXOS_WIRE_VERSION) || (buf[1] != type) ||
+      ((buf[2] | (buf[3] << 8)) != curveN->bsize) || ((buf[4] | (buf[5] << 8)) != body) ||
+      ((buf[6] & ~wireFlags(type)) != 0) || (buf[7] != 0)) return -1;
+  return WIRE_HEADER+body;
+}
+
+int naxosWireHelloParse(wireHello* h,const uint8_t* buf,int len,ellipticCurve* curveN)
+/* It sets the pointers of h to the slots of the hello, without copies */
+{
+  int slot = WIRE_SLOT(curveN);
+
+  if ((naxosWireFrameBytes(buf,len,WIRE_HELLO,curveN) <= 0) || (len != WIRE_HEADER+3*slot)) return -1;
+  h->idA = buf+WIRE_HEADER;
+  h->pkA = buf+WIRE_HEADER+slot;
+  h->X = buf+WIRE_HEADER+2*slot;
+  h->pkAOdd = buf[6] & 1;
+  h->XOdd = (buf[6] >> 1) & 1;
+  return 1;
+}
+
+int calculateXYWire(uint8_t* hello,keyC eskA,keyC skA,keyC idA,keyPC pkA,ellipticCurve* curveN)
+/* It calculates X with calculateXYPoint and writes it in its slot straight from the point */
+{
+  pointA X;
+  int slot = WIRE_SLOT(curveN);
+  int odd;
+
+  if (calculateXYPoint(&X,eskA,skA,curveN) != 1)   /* entropy source or hash failed: no hello */
+  {
+    naxosPhaseNone();
+    return -1;
+  }
+  wireSlot(hello+WIRE_HEADER,idA,curveN);
+  wireSlot(hello+WIRE_HEADER+slot,pkA+1,curveN);
+  odd = wirePoint(hello+WIRE_HEADER+2*slot,&X,curveN);
+  wireHeader(hello,WIRE_HELLO,(pkA[0]&1) | (odd << 1),curveN);
+  naxosPhaseNone();
+
+  naxosWipe(X.aX,COORD_BYTES);         /* clear X.aX               */
+  naxosWipe(X.aY,COORD_BYTES);         /* clear X.aY               */
+  return WIRE_HEADER+3*slot;
+}
+
+int calculateKbWire(keyC kB,const uint8_t* hello,int len,keyC eskB,keyC skBb,keyC idB,ellipticCurve* curveN)
+/* It decodes pkA and X from their slots in the points and calculates kB with calculateKbPoint
+   idA is hashed from its slot
+*/
+{
+  wireHello h;
+  pointA pkAP,XP;                  /* Temporary points on the curve   */
+  int slot = WIRE_SLOT(curveN);
+  int res;
+
+  if (naxosWireHelloParse(&h,hello,len,curveN) != 1) return -6;
+  res = convXToPoint(&pkAP,(uint8_t*)h.pkA,slot,h.pkAOdd,curveN);   /* -1: x not lower than p, -2: not on the curve */
+  if (res == 1)
+  {
+    res = convXToPoint(&XP,(uint8_t*)h.X,slot,h.XOdd,curveN);
+    if (res == 1)
+    {
+      res = calculateKbPoint(kB,&pkAP,NULL,eskB,skBb,&XP,(uint8_t*)h.idA,idB,curveN);
+    }
+    else
+    {
+      res = res-2;                                                    /* -3 or -4                              */
+    }
+  }
+
+  naxosWipe(pkAP.aX,COORD_BYTES);      /* clear pkA.aX             */
+  naxosWipe(pkAP.aY,COORD_BYTES);      /* clear pkA.aY             */
+  naxosWipe(XP.aX,COORD_BYTES);        /* clear X.aX               */
+  naxosWipe(XP.aY,COORD_BYTES);        /* clear X.aY               */
+  return res;
+}
+
+int naxosWireHelloSession(sessionK* k,const uint8_t* hello,int len,ellipticCurve* curveN)
+/* It decodes idA, pkA and X from their slots in the input of the session of calculateKbBatch */
+{
+  wireHello h;
+  pointA P;                        /* Temporary point on the curve    */
+  int slot = WIRE_SLOT(curveN);
+  int res;
+
+  if (naxosWireHelloParse(&h,hello,len,curveN) != 1) return -6;
+  res = convXToPoint(&P,(uint8_t*)h.pkA,slot,h.pkAOdd,curveN);      /* -1: x not lower than p, -2: not on the curve */
+  if (res == 1)
+  {
+    convPointToBytes(k->pkx,k->pky,&P,curveN);
+    res = convXToPoint(&P,(uint8_t*)h.X,slot,h.XOdd,curveN);
+    if (res == 1)
+    {
+      convPointToBytes(k->ePx,k->ePy,&P,curveN);
+      memset(k->idA,0,sizeof(keyC));
+      memcpy(k->idA,h.idA,(curveN->bsize+7)/8);
+    }
+    else
+    {
+      res = res-2;                                                    /* -3 or -4                              */
+    }
+  }
+
+  naxosWipe(P.aX,COORD_BYTES);         /* clear P.aX               */
+  naxosWipe(P.aY,COORD_BYTES);         /* clear P.aY               */
+  return res;
+}
+
+int naxosWireReply(uint8_t* reply,keyC Yx,keyC Yy,ellipticCurve* curveN)
+/* It writes x of Y in its slot and the parity of y in the header */
+{
+  wireSlot(reply+WIRE_HEADER,Yx,curveN);
+  wireHeader(reply,WIRE_REPLY,Yy[0]&1,curveN);
+  return WIRE_HEADER+WIRE_SLOT(curveN);
+}
+
+int naxosWireResume(uint8_t* resume,naxosTicket* t,uint8_t* nonceA,ellipticCurve* curveN)
+/* It writes the id of the ticket and a fresh nonceA */
+{
+  if ((t->valid != 1) || (randomGen(nonceA,8*TICKET_NONCE) != 1)) return -1;
+  wireHeader(resume,WIRE_RESUME,0,curveN);
+  memcpy(resume+WIRE_HEADER,t->id,TICKET_ID);
+  memcpy(resume+WIRE_HEADER+TICKET_ID,nonceA,TICKET_NONCE);
+  return WIRE_HEADER+TICKET_ID+TICKET_NONCE;
+}
+
+int naxosWireResumeReply(uint8_t* reply,const uint8_t* nonceB,ellipticCurve* curveN)
+/* It writes nonceB, or the flag of the ticket rejected */
+{
+  wireHeader(reply,WIRE_RESUME_REPLY,(nonceB == NULL)?1:0,curveN);
+  if (nonceB != NULL) memcpy(reply+WIRE_HEADER,nonceB,TICKET_NONCE);
+  else memset(reply+WIRE_HEADER,0,TICKET_NONCE);
+  return WIRE_HEADER+TICKET_NONCE;
+}
+
+int calculateKaWire(keyC kA,const uint8_t* reply,int len,keyC eskA,keyC skAb,keyC idA,keyPC pkB,keyC idB,ellipticCurve* curveN)
+/* It decodes pkB and Y from its slot in the points and calculates kA with calculateKaPoint */
+{
+  pointA pkBP,YP;                  /* Temporary points on the curve   */
+  int res;
+
+  if ((naxosWireFrameBytes(reply,len,WIRE_REPLY,curveN) <= 0) || (len != WIRE_HEADER+WIRE_SLOT(curveN))) return -6;
+  if ((pkB[0] != 2) && (pkB[0] != 3)) return -1;
+  res = convXToPoint(&pkBP,pkB+1,(curveN->bsize+7)/8,pkB[0]&1,curveN);   /* -1: x not lower than p, -2: not on the curve */
+  if (res == 1)
+  {
+    res = convXToPoint(&YP,(uint8_t*)reply+WIRE_HEADER,WIRE_SLOT(curveN),reply[6]&1,curveN);
+    if (res == 1)
+    {
+      res = calculateKaPoint(kA,&YP,eskA,skAb,&pkBP,NULL,idA,idB,curveN);
+    }
+    else
+    {
+      res = res-2;                                                    /* -3 or -4                              */
+    }
+  }
+
+  naxosWipe(pkBP.aX,COORD_BYTES);      /* clear pkB.aX             */
+  naxosWipe(pkBP.aY,COORD_BYTES);      /* clear pkB.aY             */
+  naxosWipe(YP.aX,COORD_BYTES);        /* clear Y.aX               */
+  naxosWipe(YP.aY,COORD_BYTES);        /* clear Y.aY               */
+  return res;
+}
@@ -0,0 +1,105 @@
+/*
+   Wire format of the handshake messages, versioned and framed.
+   A frame is a header of WIRE_HEADER bytes followed by the body:
+     byte 0     NAXOS_WIRE_VERSION
+     byte 1     type: WIRE_HELLO, WIRE_RESUME (A -> B) or WIRE_REPLY, WIRE_RESUME_REPLY (B -> A)
+     bytes 2-3  bsize of the curve, little endian
+     bytes 4-5  bytes of the body, little endian
+     byte 6     flags: parity of the y coords of the points of the body (bit 0 first point, bit 1
+                second), or 1 in a resume reply when the ticket is rejected
+     byte 7     0
+   The body is made of slots of WIRE_SLOT(curve) = 8*wsize bytes at fixed offsets, each a
+   little-endian number in the limb layout of coord (wsize words of 64 bits), padded with 0:
+     hello:  idA, x of pkA, x of X     (3 slots)
+     reply:  x of Y                    (1 slot)
+   The resumption messages (see NaxosTicket.h) have no slots:
+     resume:        id of the ticket (TICKET_ID bytes), nA (TICKET_NONCE bytes)
+     resume reply:  nB (TICKET_NONCE bytes, 0 when the ticket is rejected)
+   A frame is parsed in place in the receive buffer: the slots are read as limbs (one copy of the
+   words on little-endian hosts, see byteToWord) straight into the points of the key exchange,
+   without the keyC and keyPC of the other functions.
+*/
+
+#ifndef _NAXOS_WIRE__
+#define _NAXOS_WIRE__
+
+#include "Naxos.h"
+#include "NaxosTicket.h"
+
+#define NAXOS_WIRE_VERSION 1
+#define WIRE_HELLO 1
+#define WIRE_REPLY 2
+#define WIRE_RESUME 3
+#define WIRE_RESUME_REPLY 4
+#define WIRE_HEADER 8                                 /* Bytes of the header                     */
+#define WIRE_SLOT(curve) (8*(curve)->wsize)           /* Bytes of a slot of the body            */
+#define WIRE_MAX (WIRE_HEADER+3*COORD_BYTES)          /* Bytes of the largest frame, hello of P-521 */
+
+typedef struct wireHello   /* Hello parsed in place: pointers to the slots of the frame */
+{
+  const uint8_t* idA;
+  const uint8_t* pkA;      /* x of pkA                                                   */
+  const uint8_t* X;        /* x of X                                                     */
+  int pkAOdd;              /* parity of y of pkA                                         */
+  int XOdd;                /* parity of y of X                                           */
+} wireHello;
+
+int naxosWireFrameBytes(const uint8_t* buf,int len,int type,ellipticCurve* curveN);
+/* It checks the header of a frame of type for the curve curveN in the first len bytes of buf
+   Return:
+     bytes of the frame (header and body)
+     0 = less than WIRE_HEADER bytes
+    -1 = invalid version, type, curve or length
+*/
+
+int naxosWireHelloParse(wireHello* h,const uint8_t* buf,int len,ellipticCurve* curveN);
+/* It parses the hello of len bytes in buf: h points to its slots
+   Return: 1 = OK, -1 = invalid frame
+*/
+
+int calculateXYWire(uint8_t* hello,keyC eskA,keyC skA,keyC idA,keyPC pkA,ellipticCurve* curveN);
+/* It generates eskA, calculates X as calculateXY and writes the hello (idA, pkA, X) in hello,
+   of at least WIRE_MAX bytes. pkA is in compressed format (see publicKeyCompressed)
+   It returns the bytes of the hello, -1 if calculateXY failed (entropy source, or no hash for
+   the curve): eskA is set to 0 and there is no hello
+*/
+
+int calculateKbWire(keyC kB,const uint8_t* hello,int len,keyC eskB,keyC skBb,keyC idB,ellipticCurve* curveN);
+/* It calculates kB as calculateKb with idA, pkA and X read from the hello of len bytes
+   As in calculateKbCompressed the decompression of the points replaces the check that they are
+   on the curve
+   Return: as calculateKbCompressed, -6 = invalid frame
+*/
+
+int naxosWireHelloSession(sessionK* k,const uint8_t* hello,int len,ellipticCurve* curveN);
+/* It decodes the hello of len bytes in the inputs idA, pkx, pky, ePx and ePy (X) of the session k
+   of calculateKbBatch: the decompression of the points replaces the check that they are on the
+   curve. esk, sk and idB of k are not changed
+   Return:
+     1 = OK
+    -1 ... -4 = as calculateKbCompressed
+    -6 = invalid frame
+*/
+
+int naxosWireReply(uint8_t* reply,keyC Yx,keyC Yy,ellipticCurve* curveN);
+/* It writes the reply with Y in reply, of at least WIRE_MAX bytes
+   It returns the bytes of the reply
+*/
+
+int naxosWireResume(uint8_t* resume,naxosTicket* t,uint8_t* nonceA,ellipticCurve* curveN);
+/* It generates nonceA (TICKET_NONCE bytes) and writes the resume with the ticket t in resume,
+   of at least WIRE_MAX bytes
+   It returns the bytes of the resume, -1 if t is not valid or the entropy source failed
+*/
+
+int naxosWireResumeReply(uint8_t* reply,const uint8_t* nonceB,ellipticCurve* curveN);
+/* It writes the reply to a resume with nonceB (NULL = ticket rejected) in reply
+   It returns the bytes of the reply
+*/
+
+int calculateKaWire(keyC kA,const uint8_t* reply,int len,keyC eskA,keyC skAb,keyC idA,keyPC pkB,keyC idB,ellipticCurve* curveN);
+/* It calculates kA as calculateKaCompressed with Y read from the reply of len bytes
+   Return: as calculateKaCompressed, -6 = invalid frame
+*/
+
+#endif /* #ifndef _NAXOS_WIRE__  */
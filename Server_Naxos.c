@@ -0,0 +1,271 @@
+/*
+   Reference handshake server daemon of the responder B (see NaxosServer.h), with a load mode
+   that measures the end-to-end throughput and latency of the handshakes on the local machine.
+   The daemon generates its secret key skB and identity idB, prints pkB (compressed) and idB in
+   hexadecimal, and serves until SIGINT or SIGTERM.
+   With -b the server runs in a thread and nclients client threads (see NaxosClient.h) make
+   nhandshakes handshakes each, on one connection per client; it prints the handshakes per
+   second and the median and 99th percentile of the latency of a handshake (client side:
+   calculateXY, the round trip and calculateKa).
+   With -r the server keeps the tickets of the handshakes (see NaxosTicket.h): in the load mode
+   each client makes one full handshake, then it resumes its session with its ticket.
+   Usage: Server_Naxos [-c curve] [-u path] [-p port] [-t threads] [-m maxconn] [-d depth] [-r] [-b nclients nhandshakes]
+     -c curve    curve 224, 256, 384 or 521 (default 256)
+     -u path     Unix-domain socket (default /tmp/naxos.sock if there is no -p)
+     -p port     TCP port of 127.0.0.1
+     -t threads  workers of the engine (default one per online core)
+     -m maxconn  maximum number of connections (default 1024)
+     -d depth    depth of the pool of ephemeral keys of the server (default 64, 0 = no pool)
+     -r          resumption tickets, valid for 3600 seconds
+     -b          load mode
+*/
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Naxos.h"
+#include "NaxosServer.h"
+#include "NaxosClient.h"
+#include "NaxosTicket.h"
+
+#define TICKET_LIFETIME 3600    /* Seconds of the tickets of -r */
+
+typedef struct loadClient   /* Client thread of the load mode */
+{
+  pthread_t thread;
+  ellipticCurve* curve;
+  const char* path;         /* Unix-domain socket, NULL = TCP port */
+  int port;
+  int n;                    /* handshakes                          */
+  int resume;               /* 1 = resumptions after the first one */
+  keyC skA,idA,idB;
+  keyPC pkA,pkB;
+  double* lat;              /* latency of each handshake in ns     */
+  int errors;
+} loadClient;
+
+static naxosServer* server;
+static long handshakes;      /* completed by the server, updated by the event loop only */
+
+void onKey(keyC kB,keyC idA,keyPC pkA,void* arg)
+/* Callback of the server: here the application would check pkA of idA and use kB */
+{
+  handshakes++;
+}
+
+void onSignal(int sig)
+{
+  naxosServerStop(server);
+}
+
+void printHex(const char* name,uint8_t* b,int len)
+{
+  int i;
+
+  printf("%s",name);
+  for (i=0;i<len;i++)
+  {
+    printf("%02X",b[i]);
+  }
+  printf("\n");
+}
+
+double nowNs(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return (double)t.tv_sec*1e9 + (double)t.tv_nsec;
+}
+
+int cmpDouble(const void* a,const void* b)
+{
+  double x = *(const double*)a, y = *(const double*)b;
+
+  return (x > y) - (x < y);
+}
+
+void* serverMain(void* arg)
+{
+  naxosServerRun(server);
+  return NULL;
+}
+
+void* clientMain(void* arg)
+/* n handshakes on one connection, or one handshake and n-1 resumptions */
+{
+  loadClient* c = (loadClient*)arg;
+  naxosTicket ticket;
+  keyC kA;
+  double t;
+  int i,fd,res;
+
+  fd = (c->path != NULL)?naxosClientConnectUnix(c->path):naxosClientConnectTcp(c->port);
+  if (fd < 0)
+  {
+    c->errors = c->n;
+    return NULL;
+  }
+  for (i=0;i<c->n;i++)
+  {
+    t = nowNs();
+    if ((i > 0) && c->resume)
+    {
+      res = naxosClientResume(fd,kA,&ticket,c->idA,c->idB,c->curve);
+    }
+    else
+    {
+      res = naxosClientHandshake(fd,kA,c->skA,c->pkA,c->idA,c->pkB,c->idB,c->curve);
+      if ((res == 1) && c->resume) res = naxosTicketDerive(&ticket,kA,c->curve);
+    }
+    if (res != 1)
+    {
+      c->errors += c->n-i;
+      break;
+    }
+    c->lat[i] = nowNs()-t;
+  }
+  close(fd);
+  memset(kA,0,sizeof(keyC));
+  memset(&ticket,0,sizeof(naxosTicket));
+  return NULL;
+}
+
+int runLoad(ellipticCurve* curve,const char* path,int port,keyPC pkB,keyC idB,int nclients,int n,int resume)
+/* Load mode: nclients clients of n handshakes against the server */
+{
+  loadClient* clients;
+  pthread_t st;
+  double* lat;
+  double t;
+  int i,done,errors = 0;
+
+  clients = (loadClient*)calloc(nclients,sizeof(loadClient));
+  lat = (double*)calloc((size_t)nclients*n,sizeof(double));
+  if ((clients == NULL) || (lat == NULL))
+  {
+    fprintf(stderr,"Memory allocation error\n");
+    return 1;
+  }
+  pthread_create(&st,NULL,serverMain,NULL);
+  for (i=0;i<nclients;i++)
+  {
+    clients[i].curve = curve;
+    clients[i].path = path;
+    clients[i].port = port;
+    clients[i].n = n;
+    clients[i].resume = resume;
+    clients[i].lat = lat+(size_t)i*n;
+    generateRand(clients[i].skA,curve);
+    generateRand(clients[i].idA,curve);
+    publicKeyCompressed(clients[i].pkA,clients[i].skA,curve);
+    memcpy(clients[i].pkB,pkB,sizeof(keyPC));
+    memcpy(clients[i].idB,idB,sizeof(keyC));
+  }
+  t = nowNs();
+  for (i=0;i<nclients;i++)
+  {
+    pthread_create(&clients[i].thread,NULL,clientMain,&clients[i]);
+  }
+  for (i=0;i<nclients;i++)
+  {
+    pthread_join(clients[i].thread,NULL);
+    errors += clients[i].errors;
+  }
+  t = nowNs()-t;
+  naxosServerStop(server);
+  pthread_join(st,NULL);
+
+  done = nclients*n-errors;
+  qsort(lat,(size_t)nclients*n,sizeof(double),cmpDouble);   /* the failed ones are 0: first */
+  printf("P-%d: %d clients, %d handshakes, %d errors\n",curve->bsize,nclients,done,errors);
+  if (done > 0)
+  {
+    printf("throughput: %.0f handshakes/s\n",done/(t*1e-9));
+    printf("latency:    median %.1f us, p99 %.1f us\n",
+           lat[errors+done/2]*1e-3,lat[errors+(int)(done*0.99)]*1e-3);
+  }
+  for (i=0;i<nclients;i++)
+  {
+    memset(clients[i].skA,0,sizeof(keyC));
+  }
+  free(clients);
+  free(lat);
+  return (errors == 0)?0:1;
+}
+
+int main(int argc,char** argv)
+{
+  ellipticCurve curve;
+  keyC skB,idB;
+  keyPC pkB;
+  const char* path = NULL;
+  int i,bits = 256,port = 0,threads = 0,maxConn = 1024,depth = 64,resume = 0,nclients = 0,n = 0,res = 0;
+
+  for (i=1;i<argc;i++)
+  {
+    if ((strcmp(argv[i],"-c") == 0) && (i+1 < argc)) bits = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-u") == 0) && (i+1 < argc)) path = argv[++i];
+    else if ((strcmp(argv[i],"-p") == 0) && (i+1 < argc)) port = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-t") == 0) && (i+1 < argc)) threads = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-m") == 0) && (i+1 < argc)) maxConn = atoi(argv[++i]);
+    else if ((strcmp(argv[i],"-d") == 0) && (i+1 < argc)) depth = atoi(argv[++i]);
+    else if (strcmp(argv[i],"-r") == 0) resume = 1;
+    else if ((strcmp(argv[i],"-b") == 0) && (i+2 < argc))
+    {
+      nclients = atoi(argv[++i]);
+      n = atoi(argv[++i]);
+    }
+    else
+    {
+      fprintf(stderr,"Usage: %s [-c curve] [-u path] [-p port] [-t threads] [-m maxconn] [-d depth] [-r] [-b nclients nhandshakes]\n",argv[0]);
+      return 1;
+    }
+  }
+  if ((bits == NIST_P192) || (selectCurve(&curve,bits) != 1))
+  {
+    fprintf(stderr,"The curve must be 224, 256, 384 or 521\n");
+    return 1;
+  }
+  if ((path == NULL) && (port == 0)) path = "/tmp/naxos.sock";
+  if (nclients > maxConn) maxConn = nclients;
+
+  generateRand(skB,&curve);
+  generateRand(idB,&curve);
+  publicKeyCompressed(pkB,skB,&curve);
+  server = naxosServerCreate(&curve,skB,idB,threads,maxConn,depth,onKey,NULL);
+  memset(skB,0,sizeof(keyC));                  /* skB is kept only in the arena of the server */
+  if ((server == NULL) ||
+      ((path != NULL) && (naxosServerListenUnix(server,path) != 1)) ||
+      ((port != 0) && (naxosServerListenTcp(server,port) != 1)) ||
+      (resume && (naxosServerTickets(server,maxConn,TICKET_LIFETIME) != 1)))
+  {
+    fprintf(stderr,"Cannot create the server\n");
+    naxosServerDestroy(server);
+    return 1;
+  }
+
+  if (nclients > 0)
+  {
+    res = runLoad(&curve,path,port,pkB,idB,nclients,(n > 0)?n:1,resume);
+  }
+  else
+  {
+    printHex("pkB: ",pkB,(curve.bsize+7)/8+1);
+    printHex("idB: ",idB,(curve.bsize+7)/8);
+    if (path != NULL) printf("listening on %s\n",path);
+    if (port != 0) printf("listening on 127.0.0.1:%d\n",port);
+    fflush(stdout);
+    signal(SIGINT,onSignal);
+    signal(SIGTERM,onSignal);
+    res = (naxosServerRun(server) == 1)?0:1;
+    printf("%ld handshakes\n",handshakes);
+  }
+  naxosServerDestroy(server);
+  return res;
+}
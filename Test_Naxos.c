@@ -0,0 +1,1630 @@
+/*
+   Tests of Naxos.c: known answers and differential tests of the optimized kernels
+     1. NIST known-answer scalar multiplications k*G (http://point-at-infinity.org/ecc/nisttv),
+        with the Montgomery ladder, every window of scalarMult, scalarMultX and scalarMultBase
+     2. SHA3 known answers of the sponge of each curve (hashInit, hashAbsorb, hashFinal)
+     3. randomized differential tests against portable references:
+          field:  coordMul, coordAdd, coordSub, coordDouble of the curve (fast NIST reductions,
+                  fixed-size kernels, Montgomery CIOS) against a bit-serial reference in this file,
+                  coordInv with each backend of selectInversion
+          point:  every window of scalarMult, scalarMultX, scalarMultBase and scalarMultDual
+                  against the Montgomery ladder
+          hash:   the sponge absorbing in random chunks and hashAbsorbCoord against the one-shot SHA3
+          key:    Ka = Kb, and calculateKa/Kb against the cached, compressed and batch functions
+                  (allocated and with the scratch of the caller),
+                  the batches with each multi-lane engine of the CPU (naxosSimdSelect)
+          arena:  bump allocation, wipe on release and guard pages of the secure arena
+          sessions: kA of the session table (sessionTableXY, sessionTableKa) against calculateKb,
+                  the free slots of the table, and the sessions still pending after a failed batch
+          wire:   byteToWord and wordToByte against a byte loop, Ka = Kb with the frames of the
+                  wire format (calculateXYWire, calculateKbWire, calculateKaWire), invalid frames
+          engine: single XY, Ka and Kb jobs, with callback and in the completion queue, and the
+                  batch jobs against calculateXY, calculateKa, calculateKb and calculateKbWire,
+                  the work stealing from a busy worker, the invalid jobs rejected by
+                  naxosEngineSubmit, and the workers pinned with a single CPU allowed
+          pool:   the tuples of the rings against calculateXY, the inline calculation with an
+                  empty ring, another sk and a failing source, and the refill by the producer
+          ticket: resumption keys of A and B, single use and expiry of the tickets of the store
+          server: handshakes and resumptions of client threads with the server on a Unix-domain
+                  socket, with and without the pool of ephemeral keys, a hello and a used ticket
+                  rejected by the server
+          random: the entropy sources of selectEntropy, the DRBG in the child after a fork, and
+                  no X from calculateXY, calculateXYWire and calculateXYBatch when the source fails
+          curve:  the NIST curves defined by the user (curveCreate, Montgomery multiplication)
+                  against their shared contexts (curveContext, fast NIST reductions)
+   The random numbers are generated by xorshift from the seed, so a failure can be reproduced
+   Usage: Test_Naxos [iterations] [seed]
+   It returns 0 if all the tests pass
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE       /* sched_getaffinity */
+#endif
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include "Naxos.h"
+#include "NaxosArena.h"
+#include "NaxosSimd.h"
+#include "NaxosSessions.h"
+#include "NaxosServer.h"
+#include "NaxosClient.h"
+#include "NaxosWire.h"
+#include "NaxosTicket.h"
+#include "NaxosEngine.h"
+#include "NaxosPool.h"
+
+void coordInit(coord a);                                                            /* See Naxos.c */
+void coordCopy(coord a,coord b);                                                    /* See Naxos.c */
+int coordCmp(coord a,coord b,int nwords);                                           /* See Naxos.c */
+void coordAdd(coord c,coord a,coord b,coord p,int nwords);                          /* See Naxos.c */
+void coordSub(coord c,coord a,coord b,coord p,int nwords);                          /* See Naxos.c */
+void coordDouble(coord a,coord b,coord p,int nwords);                               /* See Naxos.c */
+void coordMul(coord c,coord a,coord b,ellipticCurve* curve);                        /* See Naxos.c */
+void coordToMont(coord c,coord a,ellipticCurve* curve);                             /* See Naxos.c */
+void coordFromMont(coord c,coord a,ellipticCurve* curve);                           /* See Naxos.c */
+void coordInv(coord c,coord a,ellipticCurve* curve);                                /* See Naxos.c */
+void byteToWord(coord arrayW,uint8_t *arrayB,int byteLen);                          /* See Naxos.c */
+void wordToByte(uint8_t *arrayB,coord arrayW,int wordLen);                          /* See Naxos.c */
+void scalarMult(pointA* Q,coord k,pointA* P,ellipticCurve* curve);                  /* See Naxos.c */
+int scalarMultX(pointA* Q,coord k,pointA* P,int withY,ellipticCurve* curve);        /* See Naxos.c */
+void scalarMultBase(pointA* Q,coord k,ellipticCurve* curve);                        /* See Naxos.c */
+int scalarMultDual(pointA* Q1,pointA* Q2,coord k1,coord k2,pointA* P,int withY,ellipticCurve* curve);  /* See Naxos.c */
+int aIsOnCurve(pointA* aA,ellipticCurve* curve);                                    /* See Naxos.c */
+void convPointToBytes(keyC pX,keyC pY,pointA* aP,ellipticCurve* curve);             /* See Naxos.c */
+
+typedef struct katVector  /* k*G, hexadecimal with the most significant digit first           */
+                          /* k = n-1 is not included: the ladder reaches (n-1)G + G = infinity */
+{
+  int curve;
+  const char* k;
+  const char* x;
+  const char* y;
+} katVector;
+
+static const katVector katVectors[] =
+{
+  {192,"1","188DA80EB03090F67CBF20EB43A18800F4FF0AFD82FF1012","07192B95FFC8DA78631011ED6B24CDD573F977A11E794811"},
+  {192,"2","DAFEBF5828783F2AD35534631588A3F629A70FB16982A888","DD6BDA0D993DA0FA46B27BBC141B868F59331AFA5C7E93AB"},
+  {192,"3","76E32A2557599E6EDCD283201FB2B9AADFD0D359CBB263DA","782C37E372BA4520AA62E0FED121D49EF3B543660CFD05FD"},
+  {192,"4","35433907297CC378B0015703374729D7A4FE46647084E4BA","A2649984F2135C301EA3ACB0776CD4F125389B311DB3BE32"},
+  {192,"5","10BB8E9840049B183E078D9C300E1605590118EBDD7FF590","31361008476F917BADC9F836E62762BE312B72543CCEAEA1"},
+  {192,"14","BB6F082321D34DBD786A1566915C6DD5EDF879AB0F5ADD67","91E4DD8A77C4531C8B76DEF2E5339B5EB95D5D9479DF4C8D"},
+  {192,"18EBBB95EED0E13","81E6E0F14C9302C8A8DCA8A038B73165E9687D0490CD9F85","F58067119EED8579388C4281DC645A27DB7764750E812477"},
+  {192,"159D893D4CDD747246CDCA43590E13","B357B10AC985C891B29FB37DA56661CCCF50CEC21128D4F6","BA20DC2FA1CC228D3C2D8B538C2177C2921884C6B7F0D96F"},
+  {192,"D9AC5F445FFDABBFD7C7E638D66044649CCB6667F061EF6A","CBA750631B0D8CE742A1EDFFF445EC2AFF425F5724C312B1","D64A5771D7EA2E033B2BA2E11A0A70E55C120307918B1A47"},
+  {192,"FFFFFFFFFFFFFFFFFFFFFFFF99DEF836146BC9B1B4D2281D","BB6F082321D34DBD786A1566915C6DD5EDF879AB0F5ADD67","6E1B2275883BACE37489210D1ACC64A046A2A26B8620B372"},
+  {192,"FFFFFFFFFFFFFFFFFFFFFFFF99DEF836146BC9B1B4D2282F","DAFEBF5828783F2AD35534631588A3F629A70FB16982A888","229425F266C25F05B94D8443EBE4796FA6CCE505A3816C54"},
+  {224,"1","B70E0CBD6BB4BF7F321390B94A03C1D356C21122343280D6115C1D21","BD376388B5F723FB4C22DFE6CD4375A05A07476444D5819985007E34"},
+  {224,"2","706A46DC76DCB76798E60E6D89474788D16DC18032D268FD1A704FA6","1C2B76A7BC25E7702A704FA986892849FCA629487ACF3709D2E4E8BB"},
+  {224,"3","DF1B1D66A551D0D31EFF822558B9D2CC75C2180279FE0D08FD896D04","A3F7F03CADD0BE444C0AA56830130DDF77D317344E1AF3591981A925"},
+  {224,"4","AE99FEEBB5D26945B54892092A8AEE02912930FA41CD114E40447301","0482580A0EC5BC47E88BC8C378632CD196CB3FA058A7114EB03054C9"},
+  {224,"5","31C49AE75BCE7807CDFF22055D94EE9021FEDBB5AB51C57526F011AA","27E8BFF1745635EC5BA0C9F1C2EDE15414C6507D29FFE37E790A079B"},
+  {224,"14","FCC7F2B45DF1CD5A3C0C0731CA47A8AF75CFB0347E8354EEFE782455","0D5D7110274CBA7CDEE90E1A8B0D394C376A5573DB6BE0BF2747F530"},
+  {224,"18EBBB95EED0E13","61F077C6F62ED802DAD7C2F38F5C67F2CC453601E61BD076BB46179E","2272F9E9F5933E70388EE652513443B5E289DD135DCC0D0299B225E4"},
+  {224,"159D893D4CDD747246CDCA43590E13","029895F0AF496BFC62B6EF8D8A65C88C613949B03668AAB4F0429E35","3EA6E53F9A841F2019EC24BDE1A75677AA9B5902E61081C01064DE93"},
+  {224,"C9C7451472BD7596A8AD5C2F7364E5EF9E8F5986249E93B5762A2E1C","9ED7FB166D4FEB9253EB01C7992AE4074B48E3984423D4806BE5FFAE","0B7840B2F6FA1764BEAAB3EC248235EE4F33F961782EED71A54E45F3"},
+  {224,"FFFFFFFFFFFFFFFFFFFFFFFFFFFF16A2E0B8F03E13DD29455C5C2A29","FCC7F2B45DF1CD5A3C0C0731CA47A8AF75CFB0347E8354EEFE782455","F2A28EEFD8B345832116F1E574F2C6B2C895AA8C24941F40D8B80AD1"},
+  {224,"FFFFFFFFFFFFFFFFFFFFFFFFFFFF16A2E0B8F03E13DD29455C5C2A3B","706A46DC76DCB76798E60E6D89474788D16DC18032D268FD1A704FA6","E3D4895843DA188FD58FB0567976D7B50359D6B78530C8F62D1B1746"},
+  {256,"1","6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296","4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5"},
+  {256,"2","7CF27B188D034F7E8A52380304B51AC3C08969E277F21B35A60B48FC47669978","07775510DB8ED040293D9AC69F7430DBBA7DADE63CE982299E04B79D227873D1"},
+  {256,"3","5ECBE4D1A6330A44C8F7EF951D4BF165E6C6B721EFADA985FB41661BC6E7FD6C","8734640C4998FF7E374B06CE1A64A2ECD82AB036384FB83D9A79B127A27D5032"},
+  {256,"4","E2534A3532D08FBBA02DDE659EE62BD0031FE2DB785596EF509302446B030852","E0F1575A4C633CC719DFEE5FDA862D764EFC96C3F30EE0055C42C23F184ED8C6"},
+  {256,"5","51590B7A515140D2D784C85608668FDFEF8C82FD1F5BE52421554A0DC3D033ED","E0C17DA8904A727D8AE1BF36BF8A79260D012F00D4D80888D1D0BB44FDA16DA4"},
+  {256,"14","83A01A9378395BAB9BCD6A0AD03CC56D56E6B19250465A94A234DC4C6B28DA9A","76E49B6DE2F73234AE6A5EB9D612B75C9F2202BB6923F54FF8240AAA86F640B8"},
+  {256,"18EBBB95EED0E13","339150844EC15234807FE862A86BE77977DBFB3AE3D96F4C22795513AEAAB82F","B1C14DDFDC8EC1B2583F51E85A5EB3A155840F2034730E9B5ADA38B674336A21"},
+  {256,"159D893D4CDD747246CDCA43590E13","1B7E046A076CC25E6D7FA5003F6729F665CC3241B5ADAB12B498CD32F2803264","BFEA79BE2B666B073DB69A2A241ADAB0738FE9D2DD28B5604EB8C8CF097C457B"},
+  {256,"157A930DFB0616EDA81D1B53F3AF5E38448896A55A999A97F63A5AE2F0D99BDF","2D3854A31371FE86AFA7A7DC0B22BC2DC255D3B8D3D0AD4EF6C25DA402117103","F6D66F0A39465C49852747337CEE6219F5E0872C6A8E8431EE57410C5392F3DB"},
+  {256,"FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC63253D","83A01A9378395BAB9BCD6A0AD03CC56D56E6B19250465A94A234DC4C6B28DA9A","891B64911D08CDCC5195A14629ED48A360DDFD4596DC0AB007DBF5557909BF47"},
+  {256,"FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC63254F","7CF27B188D034F7E8A52380304B51AC3C08969E277F21B35A60B48FC47669978","F888AAEE24712FC0D6C26539608BCF244582521AC3167DD661FB4862DD878C2E"},
+  {384,"1","AA87CA22BE8B05378EB1C71EF320AD746E1D3B628BA79B9859F741E082542A385502F25DBF55296C3A545E3872760AB7","3617DE4A96262C6F5D9E98BF9292DC29F8F41DBD289A147CE9DA3113B5F0B8C00A60B1CE1D7E819D7A431D7C90EA0E5F"},
+  {384,"2","08D999057BA3D2D969260045C55B97F089025959A6F434D651D207D19FB96E9E4FE0E86EBE0E64F85B96A9C75295DF61","8E80F1FA5B1B3CEDB7BFE8DFFD6DBA74B275D875BC6CC43E904E505F256AB4255FFD43E94D39E22D61501E700A940E80"},
+  {384,"3","077A41D4606FFA1464793C7E5FDC7D98CB9D3910202DCD06BEA4F240D3566DA6B408BBAE5026580D02D7E5C70500C831","C995F7CA0B0C42837D0BBE9602A9FC998520B41C85115AA5F7684C0EDC111EACC24ABD6BE4B5D298B65F28600A2F1DF1"},
+  {384,"4","138251CD52AC9298C1C8AAD977321DEB97E709BD0B4CA0ACA55DC8AD51DCFC9D1589A1597E3A5120E1EFD631C63E1835","CACAE29869A62E1631E8A28181AB56616DC45D918ABC09F3AB0E63CF792AA4DCED7387BE37BBA569549F1C02B270ED67"},
+  {384,"5","11DE24A2C251C777573CAC5EA025E467F208E51DBFF98FC54F6661CBE56583B037882F4A1CA297E60ABCDBC3836D84BC","8FA696C77440F92D0F5837E90A00E7C5284B447754D5DEE88C986533B6901AEB3177686D0AE8FB33184414ABE6C1713A"},
+  {384,"14","605508EC02C534BCEEE9484C86086D2139849E2B11C1A9CA1E2808DEC2EAF161AC8A105D70D4F85C50599BE5800A623F","5158EE87962AC6B81F00A103B8543A07381B7639A3A65F1353AEF11B733106DDE92E99B78DE367B48E238C38DAD8EEDD"},
+  {384,"18EBBB95EED0E13","A499EFE48839BC3ABCD1C5CEDBDD51904F9514DB44F4686DB918983B0C9DC3AEE05A88B72433E9515F91A329F5F4FA60","3B7CA28EF31F809C2F1BA24AAED847D0F8B406A4B8968542DE139DB5828CA410E615D1182E25B91B1131E230B727D36A"},
+  {384,"159D893D4CDD747246CDCA43590E13","90A0B1CAC601676B083F21E07BC7090A3390FE1B9C7F61D842D27FA315FB38D83667A11A71438773E483F2A114836B24","3197D3C6123F0D6CD65D5F0DE106FEF36656CB16DC7CD1A6817EB1D51510135A8F492F72665CFD1053F75ED03A7D04C9"},
+  {384,"FFE00007FFE1001930C01D179D9D1B37D7A3DA803F6262C423417B8818899AD2CB0A53A9B6B3FC5DCEC4F39B970A03A6","FAAC95228BCE74BAC57F3549DF76E7F85C822EE1E501D6E7CD4E77344028C09771A7A6C7BB3CBB76C6AC264A32338B53","B73D776C5BCA974B16BF3EFD940A4152A2B6F869B3D4B8EEE9EB9ACCA654D7E4DB99D219D87DA68B3507772110F9060B"},
+  {384,"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFC7634D81F4372DDF581A0DB248B0A77AECEC196ACCC5295F","605508EC02C534BCEEE9484C86086D2139849E2B11C1A9CA1E2808DEC2EAF161AC8A105D70D4F85C50599BE5800A623F","AEA7117869D53947E0FF5EFC47ABC5F8C7E489C65C59A0ECAC510EE48CCEF92116D16647721C984B71DC73C825271122"},
+  {384,"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFC7634D81F4372DDF581A0DB248B0A77AECEC196ACCC52971","08D999057BA3D2D969260045C55B97F089025959A6F434D651D207D19FB96E9E4FE0E86EBE0E64F85B96A9C75295DF61","717F0E05A4E4C312484017200292458B4D8A278A43933BC16FB1AFA0DA954BD9A002BC15B2C61DD29EAFE190F56BF17F"},
+  {521,"1","0C6858E06B70404E9CD9E3ECB662395B4429C648139053FB521F828AF606B4D3DBAA14B5E77EFE75928FE1DC127A2FFA8DE3348B3C1856A429BF97E7E31C2E5BD66","11839296A789A3BC0045C8A5FB42C7D1BD998F54449579B446817AFBD17273E662C97EE72995EF42640C550B9013FAD0761353C7086A272C24088BE94769FD16650"},
+  {521,"2","0433C219024277E7E682FCB288148C282747403279B1CCC06352C6E5505D769BE97B3B204DA6EF55507AA104A3A35C5AF41CF2FA364D60FD967F43E3933BA6D783D","0F4BB8CC7F86DB26700A7F3ECEEEED3F0B5C6B5107C4DA97740AB21A29906C42DBBB3E377DE9F251F6B93937FA99A3248F4EAFCBE95EDC0F4F71BE356D661F41B02"},
+  {521,"3","1A73D352443DE29195DD91D6A64B5959479B52A6E5B123D9AB9E5AD7A112D7A8DD1AD3F164A3A4832051DA6BD16B59FE21BAEB490862C32EA05A5919D2EDE37AD7D","13E9B03B97DFA62DDD9979F86C6CAB814F2F1557FA82A9D0317D2F8AB1FA355CEEC2E2DD4CF8DC575B02D5ACED1DEC3C70CF105C9BC93A590425F588CA1EE86C0E5"},
+  {521,"4","035B5DF64AE2AC204C354B483487C9070CDC61C891C5FF39AFC06C5D55541D3CEAC8659E24AFE3D0750E8B88E9F078AF066A1D5025B08E5A5E2FBC87412871902F3","082096F84261279D2B673E0178EB0B4ABB65521AEF6E6E32E1B5AE63FE2F19907F279F283E54BA385405224F750A95B85EEBB7FAEF04699D1D9E21F47FC346E4D0D"},
+  {521,"5","0652BF3C52927A432C73DBC3391C04EB0BF7A596EFDB53F0D24CF03DAB8F177ACE4383C0C6D5E3014237112FEAF137E79A329D7E1E6D8931738D5AB5096EC8F3078","15BE6EF1BDD6601D6EC8A2B73114A8112911CD8FE8E872E0051EDD817C9A0347087BB6897C9072CF374311540211CF5FF79D1F007257354F7F8173CC3E8DEB090CB"},
+  {521,"14","18BDD7F1B889598A4653DEEAE39CC6F8CC2BD767C2AB0D93FB12E968FBED342B51709506339CB1049CB11DD48B9BDB3CD5CAD792E43B74E16D8E2603BFB11B0344F","0C5AADBE63F68CA5B6B6908296959BF0AF89EE7F52B410B9444546C550952D311204DA3BDDDC6D4EAE7EDFAEC1030DA8EF837CCB22EEE9CFC94DD3287FED0990F94"},
+  {521,"18EBBB95EED0E13","1650048FBD63E8C30B305BF36BD7643B91448EF2206E8A0CA84A140789A99B0423A0A2533EA079CA7E049843E69E5FA2C25A163819110CEC1A30ACBBB3A422A40D8","10C9C64A0E0DB6052DBC5646687D06DECE5E9E0703153EFE9CB816FE025E85354D3C5F869D6DB3F4C0C01B5F97919A5E72CEEBE03042E5AA99112691CFFC2724828"},
+  {521,"159D893D4CDD747246CDCA43590E13","17E1370D39C9C63925DAEEAC571E21CAAF60BD169191BAEE8352E0F54674443B29786243564ABB705F6FC0FE5FC5D3F98086B67CA0BE7AC8A9DEC421D9F1BC6B37F","1CD559605EAD19FBD99E83600A6A81A0489E6F20306EE0789AE00CE16A6EFEA2F42F7534186CF1C60DF230BD9BCF8CB95E5028AD9820B2B1C0E15597EE54C4614A6"},
+  {521,"83FF83FFFFFC03FFF80007FFFC000F8003FFE00007FFE0FFFC000F8000000007FFFFFF00FFFF000FFFFFF001FFFC000000001C0000400000003803FFFFFFCFFFFF","0B45CB84651C9D4F08858B867F82D816E84E94FE4CAE3DA5F65E420B08398D0C5BF019253A6C26D20671BDEF0B8E6C1D348A4B0734687F73AC6A4CBB2E085C68B3F","1C84942BBF538903062170A4BA8B3410D385719BA2037D29CA5248BFCBC8478220FEC79244DCD45D31885A1764DEE479CE20B12CEAB62F9001C7AA4282CE4BE7F56"},
+  {521,"1FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFA51868783BF2F966B7FCC0148F709A5D03BB5C9B8899C47AEBB6FB71E913863F5","18BDD7F1B889598A4653DEEAE39CC6F8CC2BD767C2AB0D93FB12E968FBED342B51709506339CB1049CB11DD48B9BDB3CD5CAD792E43B74E16D8E2603BFB11B0344F","13A552419C09735A49496F7D696A640F50761180AD4BEF46BBBAB93AAF6AD2CEEDFB25C4222392B1518120513EFCF257107C8334DD11163036B22CD78012F66F06B"},
+  {521,"1FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFA51868783BF2F966B7FCC0148F709A5D03BB5C9B8899C47AEBB6FB71E91386407","0433C219024277E7E682FCB288148C282747403279B1CCC06352C6E5505D769BE97B3B204DA6EF55507AA104A3A35C5AF41CF2FA364D60FD967F43E3933BA6D783D","10B44733807924D98FF580C1311112C0F4A394AEF83B25688BF54DE5D66F93BD2444C1C882160DAE0946C6C805665CDB70B1503416A123F0B08E41CA9299E0BE4FD"},
+};
+
+typedef struct katHash    /* SHA3 of "abc" */
+{
+  int curve;
+  const char* md;
+} katHash;
+
+static const katHash katHashes[] =
+{
+  {224,"e642824c3f8cf24ad09234ee7d3c766fc9a3a5168d0c94ad73b46fdf"},
+  {256,"3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532"},
+  {384,"ec01498288516fc926459f58e2c6ad8df9b473cb0fc08c2596da7cf0e49be4b298d88cea927ac7f539f1edf228376d25"},
+  {521,"b751850b1a57168a5693cd924b6b096e08f621827444f70d884f5d0240d2712e10e116e9192af3c91a7ec57647e3934057340b4cf408d5a56592f8274eec53f0"},
+};
+
+static const int curves[] = {NIST_P192,NIST_P224,NIST_P256,NIST_P384,NIST_P521};
+#define NCURVES ((int)(sizeof(curves)/sizeof(curves[0])))
+
+static uint64_t rngState;
+static int failures;
+
+uint64_t rng(void)
+/* xorshift64* */
+{
+  rngState ^= rngState >> 12;
+  rngState ^= rngState << 25;
+  rngState ^= rngState >> 27;
+  return rngState*0x2545F4914F6CDD1DULL;
+}
+
+void check(int ok,const char* test,int curve,int i)
+/* It counts and prints a failure */
+{
+  if (!ok)
+  {
+    failures++;
+    if (failures <= 20)
+    {
+      printf("FAIL %s P-%d iteration %d\n",test,curve,i);
+    }
+  }
+}
+
+void hexToBytes(uint8_t* b,int len,const char* hex,int lsbFirst)
+/* It converts the hexadecimal string hex in len bytes, less significant byte first if lsbFirst */
+{
+  int i,n,d;
+
+  memset(b,0,len);
+  n = strlen(hex);
+  for (i=0;i<n;i++)
+  {
+    d = hex[n-1-i];
+    d = (d <= '9')?(d-'0'):((d|0x20)-'a'+10);
+    if (lsbFirst) b[i/2] |= (uint8_t)(d << (4*(i&1)));
+    else b[(n-1-i)/2] |= (uint8_t)(d << (4*(i&1)));
+  }
+}
+
+void randomCoord(coord a,ellipticCurve* curve)
+/* It sets a to a random number 0 <= a < p */
+{
+  int i;
+
+  do
+  {
+    coordInit(a);
+    for (i=0;i<curve->wsize;i++)
+    {
+      a[i] = rng();
+    }
+    if ((curve->bsize & 63) != 0)
+    {
+      a[curve->wsize-1] &= (((uint64_t)1) << (curve->bsize & 63)) - 1;
+    }
+    switch (rng() & 7)                     /* bias towards the edge cases                  */
+    {
+      case 0: coordInit(a); a[0] = rng() & 3; break;               /* 0, 1, 2, 3           */
+      case 1: coordCopy(a,curve->p); a[0] -= 1 + (rng() & 3); break; /* p-1, ..., p-4      */
+      default: break;
+    }
+  } while (coordCmp(a,curve->p,curve->wsize) != -1);
+}
+
+int isZero(coord a,int nwords)
+/* It returns 1 if a = 0 */
+{
+  coord z;
+
+  coordInit(z);
+  return coordCmp(a,z,nwords) == 0;
+}
+
+void randomKey(keyC k,ellipticCurve* curve)
+/* It sets k to a random number 0 < k < 2^(bsize-1), as array of bytes */
+{
+  coord a;
+
+  do
+  {
+    randomCoord(a,curve);
+    a[(curve->bsize-1)/64] &= ~(((uint64_t)1) << ((curve->bsize-1) & 63));
+  } while (isZero(a,curve->wsize));
+  memset(k,0,sizeof(keyC));
+  wordToByte(k,a,curve->wsize);
+}
+
+/* Portable reference of the field arithmetic: schoolbook, bit-serial, not constant-time */
+
+void refAdd(coord c,coord a,coord b,coord p,int nwords)
+/* It calculates c = a + b mod p with a,b < p */
+{
+  uint64_t t,r = 0;
+  coord s;
+  int i;
+
+  for (i=0;i<nwords;i++)
+  {
+    t = a[i] + r;
+    r = t < r;
+    s[i] = t + b[i];
+    r = r | (s[i] < t);
+  }
+  if (r || (coordCmp(s,p,nwords) != -1))
+  {
+    r = 0;
+    for (i=0;i<nwords;i++)
+    {
+      t = s[i] - p[i] - r;
+      r = (s[i] < p[i]) || ((s[i] == p[i]) && r);
+      s[i] = t;
+    }
+  }
+  coordInit(c);
+  memcpy(c,s,nwords*sizeof(uint64_t));
+}
+
+void refMul(coord c,coord a,coord b,coord p,int nwords)
+/* It calculates c = a * b mod p with a,b < p, by doubling and adding */
+{
+  coord r;
+  int i;
+
+  coordInit(r);
+  for (i=nwords*64-1;i>-1;i--)
+  {
+    refAdd(r,r,r,p,nwords);
+    if ((b[i/64] >> (i&63)) & 1)
+    {
+      refAdd(r,r,a,p,nwords);
+    }
+  }
+  coordCopy(c,r);
+}
+
+int samePoint(pointA* P,pointA* Q,ellipticCurve* curve)
+/* It returns 1 if P = Q */
+{
+  return (coordCmp(P->aX,Q->aX,curve->wsize) == 0) && (coordCmp(P->aY,Q->aY,curve->wsize) == 0);
+}
+
+int sameX(pointA* P,pointA* Q,ellipticCurve* curve)
+/* It returns 1 if P and Q have the same x and Q.y = 0 (Q calculated without y) */
+{
+  return (coordCmp(P->aX,Q->aX,curve->wsize) == 0) && isZero(Q->aY,curve->wsize);
+}
+
+void testKat(void)
+/* Known-answer scalar multiplications k*G */
+{
+  ellipticCurve curve;
+  keyC kb,xb,yb,qx,qy;
+  coord k;
+  pointA Q;
+  int i,w,len,n = 0;
+
+  for (i=0;i<(int)(sizeof(katVectors)/sizeof(katVectors[0]));i++)
+  {
+    selectCurve(&curve,katVectors[i].curve);
+    len = (curve.bsize+7)/8;
+    hexToBytes(kb,sizeof(keyC),katVectors[i].k,1);
+    hexToBytes(xb,sizeof(keyC),katVectors[i].x,1);
+    hexToBytes(yb,sizeof(keyC),katVectors[i].y,1);
+    coordInit(k);
+    byteToWord(k,kb,len);
+
+    for (w=0;w<=WIN_WMAX;w++)              /* ladder and each window                      */
+    {
+      if ((w != 0) && (w < WIN_WMIN)) continue;
+      selectScalarMult(&curve,w);
+      scalarMult(&Q,k,&curve.g,&curve);
+      convPointToBytes(qx,qy,&Q,&curve);
+      check((memcmp(qx,xb,len) == 0) && (memcmp(qy,yb,len) == 0),"KAT scalarMult",curve.bsize,i);
+      n++;
+    }
+    check(scalarMultX(&Q,k,&curve.g,1,&curve) == 1,"KAT scalarMultX",curve.bsize,i);
+    convPointToBytes(qx,qy,&Q,&curve);
+    check((memcmp(qx,xb,len) == 0) && (memcmp(qy,yb,len) == 0),"KAT scalarMultX",curve.bsize,i);
+    scalarMultBase(&Q,k,&curve);
+    convPointToBytes(qx,qy,&Q,&curve);
+    check((memcmp(qx,xb,len) == 0) && (memcmp(qy,yb,len) == 0),"KAT scalarMultBase",curve.bsize,i);
+    n += 2;
+  }
+
+  for (i=0;i<(int)(sizeof(katHashes)/sizeof(katHashes[0]));i++)
+  {
+    hashState hs;
+    uint8_t md[64],out[66];
+
+    selectCurve(&curve,katHashes[i].curve);
+    len = strlen(katHashes[i].md)/2;
+    hexToBytes(md,len,katHashes[i].md,0);
+    check(hashInit(&hs,&curve) == 1,"KAT hashInit",curve.bsize,i);
+    hashAbsorb(&hs,(const uint8_t*)"abc",3);
+    check(hashFinal(&hs,out,curve.hash.hlen) == 1,"KAT hashFinal",curve.bsize,i);
+    check(memcmp(out,md,len) == 0,"KAT SHA3",curve.bsize,i);
+    n++;
+  }
+  printf("known answers:        %d\n",n);
+}
+
+void testField(int iters)
+/* Field arithmetic of the curves against the reference */
+{
+  ellipticCurve curve;
+  coord a,b,c,d,am,bm,cm,one;
+  int i,j,backend;
+
+  for (j=0;j<NCURVES;j++)
+  {
+    selectCurve(&curve,curves[j]);
+    coordInit(one);
+    one[0] = 1;
+    for (i=0;i<iters;i++)
+    {
+      randomCoord(a,&curve);
+      randomCoord(b,&curve);
+      coordToMont(am,a,&curve);
+      coordToMont(bm,b,&curve);
+
+      coordMul(cm,am,bm,&curve);           /* internal representation of the curve        */
+      coordFromMont(c,cm,&curve);
+      refMul(d,a,b,curve.p,curve.wsize);
+      check(coordCmp(c,d,curve.wsize) == 0,"coordMul",curve.bsize,i);
+
+      coordAdd(c,a,b,curve.p,curve.wsize);
+      refAdd(d,a,b,curve.p,curve.wsize);
+      check(coordCmp(c,d,curve.wsize) == 0,"coordAdd",curve.bsize,i);
+
+      coordSub(c,c,b,curve.p,curve.wsize); /* (a + b) - b = a                             */
+      check(coordCmp(c,a,curve.wsize) == 0,"coordSub",curve.bsize,i);
+
+      coordDouble(c,a,curve.p,curve.wsize);
+      refAdd(d,a,a,curve.p,curve.wsize);
+      check(coordCmp(c,d,curve.wsize) == 0,"coordDouble",curve.bsize,i);
+
+      if (coordCmp(a,one,curve.wsize) == 1)   /* a > 1: inversion with each backend      */
+      {
+        for (backend=INV_FERMAT;backend<=INV_SAFEGCD;backend++)
+        {
+          if (selectInversion(&curve,backend) != 1) continue;
+          coordInv(cm,am,&curve);
+          coordMul(cm,cm,am,&curve);
+          check(coordCmp(cm,curve.r1,curve.wsize) == 0,"coordInv",curve.bsize,i);
+        }
+      }
+    }
+  }
+  printf("field:                %d x %d curves\n",iters,NCURVES);
+}
+
+void testPoint(int iters)
+/* Scalar multiplications against the Montgomery ladder */
+{
+  ellipticCurve curve;
+  coord k,k2;
+  pointA P,Q,R,S,Q2;
+  int i,j,w;
+
+  for (j=0;j<NCURVES;j++)
+  {
+    selectCurve(&curve,curves[j]);
+    for (i=0;i<iters;i++)
+    {
+      randomCoord(k,&curve);
+      if (isZero(k,curve.wsize)) k[0] = 1; /* 0 < k < p                                   */
+      randomCoord(k2,&curve);
+      k2[0] |= 1;
+      selectScalarMult(&curve,0);
+      scalarMultBase(&P,k2,&curve);        /* random point P                              */
+
+      scalarMult(&Q,k,&P,&curve);          /* reference: ladder                           */
+      for (w=WIN_WMIN;w<=WIN_WMAX;w++)
+      {
+        selectScalarMult(&curve,w);
+        scalarMult(&R,k,&P,&curve);
+        check(samePoint(&Q,&R,&curve),"scalarMult window",curve.bsize,i);
+      }
+      check((scalarMultX(&R,k,&P,1,&curve) == 1) && samePoint(&Q,&R,&curve),"scalarMultX",curve.bsize,i);
+
+      selectScalarMult(&curve,0);
+      scalarMult(&R,k,&curve.g,&curve);
+      scalarMultBase(&S,k,&curve);
+      check(samePoint(&R,&S,&curve),"scalarMultBase",curve.bsize,i);
+
+      scalarMult(&Q2,k2,&P,&curve);
+      for (w=0;w<=WIN_WMAX;w++)
+      {
+        if ((w != 0) && (w < WIN_WMIN)) continue;
+        selectScalarMult(&curve,w);
+        check(scalarMultDual(&R,&S,k,k2,&P,1,&curve) == 1,"scalarMultDual",curve.bsize,i);
+        check(samePoint(&Q,&R,&curve) && samePoint(&Q2,&S,&curve),"scalarMultDual",curve.bsize,i);
+        check((scalarMultDual(&R,&S,k,k2,&P,0,&curve) == 1) && sameX(&Q,&R,&curve) &&
+              sameX(&Q2,&S,&curve),"scalarMultDual x only",curve.bsize,i);
+        check((scalarMultX(&R,k,&P,0,&curve) == 1) && sameX(&Q,&R,&curve),"scalarMultX x only",curve.bsize,i);
+      }
+
+      coordCopy(S.aX,P.aX);                /* a point not on the curve: kS is rejected     */
+      coordCopy(S.aY,Q.aX);
+      if (aIsOnCurve(&S,&curve) != 1)
+      {
+        for (w=0;w<=WIN_WMAX;w++)
+        {
+          if ((w != 0) && (w < WIN_WMIN)) continue;
+          selectScalarMult(&curve,w);
+          check(scalarMultX(&R,k2,&S,0,&curve) == -4,"scalarMultX not on the curve",curve.bsize,i);
+          check(scalarMultDual(&R,&Q2,k,k2,&S,0,&curve) == -4,"scalarMultDual not on the curve",curve.bsize,i);
+        }
+      }
+    }
+  }
+  printf("point:                %d x %d curves\n",iters,NCURVES);
+}
+
+void testHash(int iters)
+/* Sponge absorbing in chunks against the one-shot SHA3 */
+{
+  ellipticCurve curve;
+  hashState hs;
+  uint8_t msg[400],md[66],ref[66];
+  coord a;
+  int i,j,n,m,len;
+
+  for (j=1;j<NCURVES;j++)                  /* P-192 has no hash functions                 */
+  {
+    selectCurve(&curve,curves[j]);
+    for (i=0;i<iters;i++)
+    {
+      len = rng() % sizeof(msg);
+      for (n=0;n<len;n++)
+      {
+        msg[n] = (uint8_t)rng();
+      }
+      hashInit(&hs,&curve);
+      for (n=0;n<len;n+=m)                 /* random chunks                               */
+      {
+        m = 1 + rng() % 150;
+        if (m > len-n) m = len-n;
+        hashAbsorb(&hs,msg+n,m);
+      }
+      hashFinal(&hs,md,curve.hash.hlen);
+      switch (curve.bsize)
+      {
+        case NIST_P224: SHA3_224(ref,msg,len); break;
+        case NIST_P256: SHA3_256(ref,msg,len); break;
+        case NIST_P384: SHA3_384(ref,msg,len); break;
+        default:        KeccakWidth1600_Sponge(576,1024,msg,len,0x06,ref,66); break;
+      }
+      check(memcmp(md,ref,curve.hash.hlen) == 0,"hashAbsorb",curve.bsize,i);
+
+      randomCoord(a,&curve);               /* hashAbsorbCoord = wordToByte + hashAbsorb   */
+      len = (curve.bsize+7)/8;
+      wordToByte(msg,a,curve.wsize);
+      hashInit(&hs,&curve);
+      hashAbsorbCoord(&hs,a,len);
+      hashFinal(&hs,md,curve.hash.klen);
+      hashInit(&hs,&curve);
+      hashAbsorb(&hs,msg,len);
+      hashFinal(&hs,ref,curve.hash.klen);
+      check(memcmp(md,ref,curve.hash.klen) == 0,"hashAbsorbCoord",curve.bsize,i);
+    }
+  }
+  printf("hash:                 %d x %d curves\n",iters,NCURVES-1);
+}
+
+#define TEST_BATCH 9           /* Sessions of the batches: a group of 8 lanes and one more  */
+
+void batchSessions(sessionK* sa,sessionK* sb,keyC* refA,keyC* refB,ellipticCurve* curve)
+/* It fills TEST_BATCH sessions of A (sa) and of B (sb), each with its own keys and identities,
+   and their keys calculated by calculateKa (refA) and calculateKb (refB); the last session of
+   A has an invalid Y and the last session of B an invalid pkA
+*/
+{
+  keyC skA,skB,eskA,eskB;
+  int b;
+
+  for (b=0;b<TEST_BATCH;b++)
+  {
+    randomKey(skA,curve);
+    randomKey(skB,curve);
+    randomKey(sa[b].idA,curve);
+    randomKey(sa[b].idB,curve);
+    publicKey(sb[b].pkx,sb[b].pky,skA,curve);      /* pkA for B                             */
+    publicKey(sa[b].pkx,sa[b].pky,skB,curve);      /* pkB for A                             */
+    calculateXY(sb[b].ePx,sb[b].ePy,eskA,skA,curve);  /* X for B                            */
+    calculateXY(sa[b].ePx,sa[b].ePy,eskB,skB,curve);  /* Y for A                            */
+    memcpy(sa[b].esk,eskA,sizeof(keyC));
+    memcpy(sa[b].sk,skA,sizeof(keyC));
+    memcpy(sb[b].esk,eskB,sizeof(keyC));
+    memcpy(sb[b].sk,skB,sizeof(keyC));
+    memcpy(sb[b].idA,sa[b].idA,sizeof(keyC));
+    memcpy(sb[b].idB,sa[b].idB,sizeof(keyC));
+    calculateKa(refA[b],sa[b].ePx,sa[b].ePy,eskA,skA,sa[b].pkx,sa[b].pky,sa[b].idA,sa[b].idB,curve);
+    calculateKb(refB[b],sb[b].pkx,sb[b].pky,eskB,skB,sb[b].ePx,sb[b].ePy,sb[b].idA,sb[b].idB,curve);
+  }
+  sa[TEST_BATCH-1].ePx[0] ^= 1;            /* and one invalid session                     */
+  sb[TEST_BATCH-1].pkx[0] ^= 1;
+}
+
+void testKey(int iters)
+/* Key exchange: Ka = Kb with all the variants of calculateKa and calculateKb */
+{
+  ellipticCurve curve;
+  keyC skA,skB,pkAx,pkAy,pkBx,pkBy,eskA,eskB,Xx,Xy,Yx,Yy,idA,idB,kA,kB,k;
+  keyPC pkAc,pkBc,Xc,Yc;
+  keyC refA[TEST_BATCH],refB[TEST_BATCH];
+  sessionK s[TEST_BATCH],sa[TEST_BATCH],sb[TEST_BATCH];
+  peerCache* cache;
+  static const int engines[] = {SIMD_NONE,SIMD_AVX2,SIMD_IFMA};
+  void* scratch = malloc(batchScratchBytes(TEST_BATCH));
+  int i,j,b,e,len,lanes,ok;
+
+  for (j=1;j<NCURVES;j++)                  /* P-192 has no hash functions                 */
+  {
+    selectCurve(&curve,curves[j]);
+    len = curve.hash.klen;
+    cache = peerCacheCreate(&curve,4);
+    for (i=0;i<iters;i++)
+    {
+      randomKey(skA,&curve);
+      randomKey(skB,&curve);
+      randomKey(idA,&curve);
+      randomKey(idB,&curve);
+      publicKey(pkAx,pkAy,skA,&curve);
+      publicKey(pkBx,pkBy,skB,&curve);
+      calculateXY(Xx,Xy,eskA,skA,&curve);
+      calculateXY(Yx,Yy,eskB,skB,&curve);
+
+      check(calculateKa(kA,Yx,Yy,eskA,skA,pkBx,pkBy,idA,idB,&curve) == 1,"calculateKa",curve.bsize,i);
+      check(calculateKb(kB,pkAx,pkAy,eskB,skB,Xx,Xy,idA,idB,&curve) == 1,"calculateKb",curve.bsize,i);
+      check(memcmp(kA,kB,len) == 0,"Ka = Kb",curve.bsize,i);
+
+      if (cache != NULL)
+      {
+        check((calculateKaCached(k,Yx,Yy,eskA,skA,pkBx,pkBy,idA,idB,&curve,cache) == 1) &&
+              (memcmp(k,kA,len) == 0),"calculateKaCached",curve.bsize,i);
+        check((calculateKbCached(k,pkAx,pkAy,eskB,skB,Xx,Xy,idA,idB,&curve,cache) == 1) &&
+              (memcmp(k,kB,len) == 0),"calculateKbCached",curve.bsize,i);
+      }
+
+      compressPoint(pkAc,pkAx,pkAy,&curve);
+      compressPoint(pkBc,pkBx,pkBy,&curve);
+      compressPoint(Xc,Xx,Xy,&curve);
+      compressPoint(Yc,Yx,Yy,&curve);
+      check((calculateKaCompressed(k,Yc,eskA,skA,pkBc,idA,idB,&curve) == 1) &&
+            (memcmp(k,kA,len) == 0),"calculateKaCompressed",curve.bsize,i);
+      check((calculateKbCompressed(k,pkAc,eskB,skB,Xc,idA,idB,&curve) == 1) &&
+            (memcmp(k,kB,len) == 0),"calculateKbCompressed",curve.bsize,i);
+
+      batchSessions(sa,sb,refA,refB,&curve);
+      for (b=0;b<TEST_BATCH-1;b++)
+      {
+        check(memcmp(refA[b],refB[b],len) == 0,"Ka = Kb batch sessions",curve.bsize,i);
+      }
+      lanes = naxosSimdLanes();
+      for (e=0;e<(int)(sizeof(engines)/sizeof(engines[0]));e++)   /* each engine of the CPU */
+      {
+        if (naxosSimdSelect(engines[e]) < 0) continue;
+        memcpy(s,sa,sizeof(s));
+        check(calculateKaBatch(s,TEST_BATCH,&curve) == 1,"calculateKaBatch",engines[e],i);
+        for (b=0;b<TEST_BATCH-1;b++)       /* each lane against its single session       */
+        {
+          check((s[b].res == 1) && (memcmp(s[b].k,refA[b],len) == 0),"calculateKaBatch",engines[e],i);
+        }
+        check(s[TEST_BATCH-1].res != 1,"calculateKaBatch invalid",engines[e],i);
+
+        memcpy(s,sb,sizeof(s));
+        check(calculateKbBatch(s,TEST_BATCH,&curve) == 1,"calculateKbBatch",engines[e],i);
+        for (b=0;b<TEST_BATCH-1;b++)
+        {
+          check((s[b].res == 1) && (memcmp(s[b].k,refB[b],len) == 0),"calculateKbBatch",engines[e],i);
+        }
+        check(s[TEST_BATCH-1].res != 1,"calculateKbBatch invalid",engines[e],i);
+      }
+      naxosSimdSelect(lanes);
+
+      memcpy(s,sa,sizeof(s));              /* the scratch of the caller                   */
+      ok = (scratch != NULL) && (calculateKaBatchScratch(s,TEST_BATCH,scratch,&curve) == 1);
+      for (b=0;b<TEST_BATCH-1;b++)
+      {
+        ok = ok && (s[b].res == 1) && (memcmp(s[b].k,refA[b],len) == 0);
+      }
+      check(ok && (s[TEST_BATCH-1].res != 1),"calculateKaBatchScratch",curve.bsize,i);
+    }
+    peerCacheDestroy(cache);
+  }
+  free(scratch);
+  printf("key exchange:         %d x %d curves x %d engines\n",iters,NCURVES-1,(int)(sizeof(engines)/sizeof(engines[0])));
+}
+
+int userSource(uint8_t* buf,int len)
+/* Entropy source of the user: bytes of rng */
+{
+  int i;
+
+  for (i=0;i<len;i++)
+  {
+    buf[i] = (uint8_t)rng();
+  }
+  return 1;
+}
+
+int failingSource(uint8_t* buf,int len)
+/* Entropy source of the user that always fails */
+{
+  return -1;
+}
+
+void testRandom(int iters)
+/* Entropy sources: different outputs, and the DRBG of the child of a fork different from the parent */
+{
+  static const int backends[] = {ENTROPY_SYSTEM,ENTROPY_RDRAND,ENTROPY_USER,ENTROPY_DRBG};
+  ellipticCurve curve;
+  uint8_t a[600],b[600];
+  uint8_t hello[WIRE_MAX];
+  keyC esk1,esk2,Xx,Xy,Yx,Yy,sk,zero;
+  keyPC pk;
+  sessionXY xy[2];
+  uint64_t seed;
+  int i,j,n,fd[2];
+  pid_t pid;
+
+  for (j=0;j<(int)(sizeof(backends)/sizeof(backends[0]));j++)
+  {
+    if (selectEntropy(backends[j],userSource) != 1) continue;   /* no RDRAND                   */
+    for (i=0;i<iters;i++)
+    {
+      n = 1 + rng() % sizeof(a);           /* also across the buffers of the DRBG         */
+      check(randomGen(a,8*n) == 1,"randomGen",backends[j],i);
+      check(randomGen(b,8*n) == 1,"randomGen",backends[j],i);
+      check((n < 8) || (memcmp(a,b,n) != 0),"randomGen different",backends[j],i);
+    }
+  }
+  check(selectEntropy(0,NULL) == -1,"selectEntropy invalid",0,0);
+  check(selectEntropy(ENTROPY_USER,NULL) == -1,"selectEntropy invalid",0,0);
+
+  selectCurve(&curve,NIST_P256);           /* esk of calculateXY from the source of the user */
+  randomKey(sk,&curve);
+  seed = rngState;
+  selectEntropy(ENTROPY_USER,userSource);
+  calculateXY(Xx,Xy,esk1,sk,&curve);
+  rngState = seed;
+  calculateXY(Yx,Yy,esk2,sk,&curve);
+  check((memcmp(esk1,esk2,32) == 0) && (memcmp(Xx,Yx,32) == 0),"ENTROPY_USER calculateXY",256,0);
+
+  selectEntropy(ENTROPY_USER,failingSource);   /* no esk and no X when the source fails   */
+  memset(esk1,0xFF,sizeof(keyC));
+  memset(zero,0,sizeof(keyC));
+  publicKeyCompressed(pk,sk,&curve);
+  check((calculateXY(Xx,Xy,esk1,sk,&curve) == -1) && (memcmp(esk1,zero,sizeof(keyC)) == 0) &&
+        (memcmp(Xx,zero,sizeof(keyC)) == 0),"calculateXY entropy failure",256,0);
+  check(calculateXYWire(hello,esk1,sk,sk,pk,&curve) == -1,"calculateXYWire entropy failure",256,0);
+  memset(xy,0,sizeof(xy));
+  check(calculateXYBatch(xy,2,&curve) == 1,"calculateXYBatch entropy failure",256,0);
+  check((xy[0].res == -1) && (xy[1].res == -1),"calculateXYBatch entropy failure",256,0);
+  selectEntropy(ENTROPY_DRBG,NULL);
+
+  selectCurve(&curve,NIST_P192);           /* no X without the hash of the curve            */
+  randomKey(sk,&curve);
+  memset(esk1,0xFF,sizeof(keyC));
+  memset(Xx,0xFF,sizeof(keyC));
+  check((calculateXY(Xx,Xy,esk1,sk,&curve) == -5) && (memcmp(esk1,zero,sizeof(keyC)) == 0) &&
+        (memcmp(Xx,zero,sizeof(keyC)) == 0),"calculateXY without hash",192,0);
+  memset(xy,0,sizeof(xy));
+  check(calculateXYBatch(xy,2,&curve) == 1,"calculateXYBatch without hash",192,0);
+  check((xy[0].res == -5) && (xy[1].res == -5) && (memcmp(xy[0].Xx,zero,sizeof(keyC)) == 0),
+        "calculateXYBatch without hash",192,0);
+
+  randomGen(a,8*32);                       /* DRBG seeded before the fork                 */
+  if (pipe(fd) == 0)
+  {
+    pid = fork();
+    if (pid == 0)
+    {
+      randomGen(a,8*32);
+      n = write(fd[1],a,32);
+      _exit(n == 32 ? 0 : 1);
+    }
+    randomGen(b,8*32);
+    check((pid > 0) && (read(fd[0],a,32) == 32) && (memcmp(a,b,32) != 0),"DRBG after fork",0,0);
+    if (pid > 0) waitpid(pid,NULL,0);
+    close(fd[0]);
+    close(fd[1]);
+  }
+  randomClear();
+  printf("random:               %d x %d sources\n",iters,(int)(sizeof(backends)/sizeof(backends[0])));
+}
+
+void testArena(int iters)
+/* Secure arena: allocations, release of the sessions and overflow on the guard page */
+{
+  naxosArena* arena;
+  uint8_t* p;
+  uint8_t* q;
+  size_t mark,len,size;
+  int i,j,ok,status;
+  pid_t pid;
+
+  size = 2*(size_t)sysconf(_SC_PAGESIZE);
+  arena = naxosArenaCreate(size);
+  check(arena != NULL,"naxosArenaCreate",0,0);
+  if (arena == NULL) return;
+  for (i=0;i<iters;i++)
+  {
+    mark = naxosArenaMark(arena);
+    len = 1 + rng() % 1000;
+    p = (uint8_t*)naxosArenaAlloc(arena,len);
+    q = (uint8_t*)naxosArenaAlloc(arena,len);
+    check((p != NULL) && (q != NULL) && (((uintptr_t)q % ARENA_ALIGN) == 0) && (q >= p+len),"naxosArenaAlloc",0,i);
+    if ((p == NULL) || (q == NULL)) break;
+    ok = 1;
+    for (j=0;j<(int)len;j++)
+    {
+      ok = ok && (p[j] == 0) && (q[j] == 0);
+      p[j] = (uint8_t)rng() | 1;
+      q[j] = 0xFF;
+    }
+    check(ok,"naxosArenaAlloc zero",0,i);
+    naxosArenaRelease(arena,mark);         /* end of the session: p and q wiped           */
+    check((p[0] == 0) && (q[len-1] == 0) && (naxosArenaMark(arena) == mark),"naxosArenaRelease",0,i);
+  }
+  check(naxosArenaAlloc(arena,size+1) == NULL,"naxosArenaAlloc full",0,0);
+
+  p = (uint8_t*)naxosArenaAlloc(arena,size);
+  pid = fork();
+  if (pid == 0)
+  {
+    p[size] = 1;                           /* first byte of the guard page: SIGSEGV       */
+    _exit(0);
+  }
+  check((pid > 0) && (waitpid(pid,&status,0) == pid) && WIFSIGNALED(status),"arena guard page",0,0);
+  naxosArenaDestroy(arena);
+  printf("arena:                %d sessions\n",iters);
+}
+
+void curveBytes(keyC b,coord a,ellipticCurve* curve)
+/* It converts a from the Montgomery form of curve to the byte array format */
+{
+  coord t;
+
+  coordFromMont(t,a,curve);
+  memset(b,0,sizeof(keyC));
+  wordToByte(b,t,curve->wsize);
+}
+
+void testCurve(int iters)
+/* Curves defined by the user with the parameters of the NIST curves against the NIST ones */
+{
+  ellipticCurve *nist,*user;
+  keyC p,a,b,gX,gY,sk,pkx,pky,ux,uy,esk,Yx,Yy,skB,pkBx,pkBy,idA,idB,kA,k;
+  int i,j,len;
+
+  for (j=1;j<NCURVES-1;j++)                /* P-224, P-256, P-384: bsize multiple of 8     */
+  {
+    nist = curveContext(curves[j]);
+    check((nist != NULL) && (nist == curveContext(curves[j])),"curveContext",curves[j],0);
+    memset(p,0,sizeof(keyC));
+    wordToByte(p,nist->p,nist->wsize);
+    curveBytes(a,nist->a,nist);
+    curveBytes(b,nist->b,nist);
+    curveBytes(gX,nist->g.aX,nist);
+    curveBytes(gY,nist->g.aY,nist);
+    len = nist->hash.klen;
+
+    gY[0] ^= 1;                            /* G not on the curve                           */
+    check(curveCreate(p,a,b,gX,gY,nist->bsize) == NULL,"curveCreate invalid G",nist->bsize,0);
+    gY[0] ^= 1;
+    check(curveCreate(p,a,b,gX,gY,nist->bsize-8) == NULL,"curveCreate invalid bsize",nist->bsize,0);
+    user = curveCreate(p,a,b,gX,gY,nist->bsize);
+    check(user != NULL,"curveCreate",nist->bsize,0);
+    if (user == NULL) continue;
+    check((user->sqrtS == nist->sqrtS) && (user->pbits == nist->pbits),"curveCreate constants",nist->bsize,0);
+
+    for (i=0;i<iters;i++)
+    {
+      randomKey(sk,nist);
+      randomKey(skB,nist);
+      randomKey(idA,nist);
+      randomKey(idB,nist);
+      publicKey(pkx,pky,sk,nist);
+      publicKey(ux,uy,sk,user);
+      check((memcmp(pkx,ux,nist->bsize/8) == 0) && (memcmp(pky,uy,nist->bsize/8) == 0),
+            "curveCreate publicKey",nist->bsize,i);
+
+      publicKey(pkBx,pkBy,skB,nist);
+      calculateXY(Yx,Yy,esk,skB,user);
+      check(calculateKa(kA,Yx,Yy,esk,sk,pkBx,pkBy,idA,idB,nist) == 1,"curveCreate calculateKa",nist->bsize,i);
+      check((calculateKa(k,Yx,Yy,esk,sk,pkBx,pkBy,idA,idB,user) == 1) && (memcmp(k,kA,len) == 0),
+            "curveCreate calculateKa",nist->bsize,i);
+    }
+    curveDestroy(user);
+  }
+  printf("user curves:          %d x %d curves\n",iters,NCURVES-2);
+}
+
+static int allocs = -1;       /* Scratches allocated before testAlloc fails, -1 = all       */
+
+void* testAlloc(size_t size)
+/* Allocation function of the batch functions (naxosSetBatchAlloc): it fails after allocs calls,
+   i.e. after allocs batches
+*/
+{
+  if (allocs == 0) return NULL;
+  if (allocs > 0) allocs--;
+  return malloc(size);
+}
+
+#define TEST_SESSIONS 20      /* Sessions of the session table: more than SESSION_BATCH     */
+
+void testSessions(int iters)
+/* Session table: a full table of initiators against calculateKb of the peers */
+{
+  ellipticCurve curve;
+  sessionTable* t;
+  keyC skA,pkAx,pkAy,idA,Xx,Xy,eskB;
+  keyC skB[TEST_SESSIONS],pkBx[TEST_SESSIONS],pkBy[TEST_SESSIONS],idB[TEST_SESSIONS];
+  keyC Yx[TEST_SESSIONS+1],Yy[TEST_SESSIONS+1],kA[TEST_SESSIONS+1],kB[TEST_SESSIONS];
+  keyPC Xc;
+  int idx[TEST_SESSIONS+1],res[TEST_SESSIONS+1],bad[SESSION_BATCH+2];
+  int i,j,s,len,ok;
+
+  for (j=1;j<NCURVES;j++)                  /* P-192 has no hash functions                 */
+  {
+    selectCurve(&curve,curves[j]);
+    len = curve.hash.klen;
+    t = sessionTableCreate(&curve,TEST_SESSIONS);
+    check(t != NULL,"sessionTableCreate",curve.bsize,0);
+    if (t == NULL) continue;
+    for (i=0;i<iters;i++)
+    {
+      randomKey(skA,&curve);
+      randomKey(idA,&curve);
+      publicKey(pkAx,pkAy,skA,&curve);
+      for (s=0;s<TEST_SESSIONS;s++)
+      {
+        randomKey(skB[s],&curve);
+        randomKey(idB[s],&curve);
+        publicKey(pkBx[s],pkBy[s],skB[s],&curve);
+        idx[s] = sessionTableOpen(t,pkBx[s],pkBy[s],idB[s]);
+        check(idx[s] >= 0,"sessionTableOpen",curve.bsize,i);
+      }
+      check((sessionTableOpen(t,pkBx[0],pkBy[0],idB[0]) == -1) && (sessionTableCount(t) == TEST_SESSIONS),
+            "sessionTableOpen full",curve.bsize,i);
+      check(sessionTableXY(t,skA,idx,TEST_SESSIONS) == TEST_SESSIONS,"sessionTableXY",curve.bsize,i);
+
+      for (s=0;s<TEST_SESSIONS;s++)        /* the peers answer with Y and calculate kB    */
+      {
+        memcpy(Xc,sessionTableGetX(t,idx[s]),t->len+1);
+        ok = (decompressPoint(Xx,Xy,Xc,&curve) == 1);
+        calculateXY(Yx[s],Yy[s],eskB,skB[s],&curve);
+        ok = ok && (calculateKb(kB[s],pkAx,pkAy,eskB,skB[s],Xx,Xy,idA,idB[s],&curve) == 1);
+        check(ok,"sessionTable calculateKb",curve.bsize,i);
+      }
+      idx[TEST_SESSIONS] = idx[0];         /* the session 0 again: already closed         */
+      memcpy(Yx[TEST_SESSIONS],Yx[0],sizeof(keyC));
+      memcpy(Yy[TEST_SESSIONS],Yy[0],sizeof(keyC));
+      if (i%2 == 1)                        /* the second batch fails, the first is closed */
+      {
+        memcpy(bad,idx,SESSION_BATCH*sizeof(int));   /* the first batch fails: nothing closed */
+        bad[SESSION_BATCH] = -1;
+        bad[SESSION_BATCH+1] = idx[SESSION_BATCH];
+        allocs = 0;
+        naxosSetBatchAlloc(testAlloc);
+        ok = (sessionTableKa(t,skA,idA,bad,Yx,Yy,SESSION_BATCH+2,kA,res) == -1);
+        naxosSetBatchAlloc(NULL);
+        for (s=0;s<SESSION_BATCH;s++)
+        {
+          ok = ok && (res[s] == -1);
+        }
+        check(ok && (res[SESSION_BATCH] == -6) && (res[SESSION_BATCH+1] == -1) &&
+              (sessionTableCount(t) == TEST_SESSIONS),"sessionTableKa first batch",curve.bsize,i);
+
+        allocs = 1;                        /* the scratch of the first calculateKaBatch    */
+        naxosSetBatchAlloc(testAlloc);
+        ok = (sessionTableKa(t,skA,idA,idx,Yx,Yy,TEST_SESSIONS+1,kA,res) == -1);
+        naxosSetBatchAlloc(NULL);
+        for (s=0;s<TEST_SESSIONS;s++)
+        {
+          ok = ok && ((s < SESSION_BATCH)?((res[s] == 1) && (memcmp(kA[s],kB[s],len) == 0)):(res[s] == -1));
+        }
+        check(ok && (res[TEST_SESSIONS] == -6) && (sessionTableCount(t) == TEST_SESSIONS-SESSION_BATCH),
+              "sessionTableKa second batch",curve.bsize,i);
+        check(sessionTableKa(t,skA,idA,idx+SESSION_BATCH,Yx+SESSION_BATCH,Yy+SESSION_BATCH,
+                             TEST_SESSIONS+1-SESSION_BATCH,kA+SESSION_BATCH,res+SESSION_BATCH) == 1,
+              "sessionTableKa retry",curve.bsize,i);
+      }
+      else
+      {
+        check(sessionTableKa(t,skA,idA,idx,Yx,Yy,TEST_SESSIONS+1,kA,res) == 1,"sessionTableKa",curve.bsize,i);
+      }
+      for (s=0;s<TEST_SESSIONS;s++)
+      {
+        check((res[s] == 1) && (memcmp(kA[s],kB[s],len) == 0),"sessionTableKa Ka = Kb",curve.bsize,i);
+      }
+      check((res[TEST_SESSIONS] == -6) && (sessionTableCount(t) == 0),"sessionTableKa close",curve.bsize,i);
+    }
+    sessionTableDestroy(t);
+  }
+  printf("session table:        %d x %d sessions x %d curves\n",iters,TEST_SESSIONS,NCURVES-1);
+}
+
+void testWire(int iters)
+/* Wire format: limb layout, handshake with the frames and invalid frames */
+{
+  ellipticCurve curve;
+  keyC skA,skB,idA,idB,eskA,eskB,Yx,Yy,kA,kB,b,c;
+  keyPC pkA,pkB;
+  coord w;
+  uint8_t hello[WIRE_MAX],reply[WIRE_MAX];
+  uint64_t ref;
+  int i,j,k,len,n,m,ok;
+
+  for (i=0;i<iters;i++)                    /* byteToWord and wordToByte                   */
+  {
+    len = 1 + rng() % COORD_BYTES;
+    for (k=0;k<COORD_BYTES;k++)
+    {
+      b[k] = (uint8_t)rng();
+    }
+    coordInit(w);
+    byteToWord(w,b,len);
+    ok = 1;
+    for (j=0;j<(len+7)/8;j++)
+    {
+      ref = 0;
+      for (k=7;k>=0;k--)
+      {
+        ref = (ref<<8) | ((j*8+k < len)?b[j*8+k]:0);
+      }
+      ok = ok && (w[j] == ref);
+    }
+    check(ok,"byteToWord",0,i);
+    memset(c,0xFF,sizeof(keyC));
+    wordToByte(c,w,(len+7)/8);
+    for (k=0;k<(len+7)/8*8;k++)
+    {
+      ok = ok && (c[k] == ((k < len)?b[k]:0));
+    }
+    check(ok,"wordToByte",0,i);
+  }
+
+  for (j=1;j<NCURVES;j++)                  /* P-192 has no hash functions                 */
+  {
+    selectCurve(&curve,curves[j]);
+    len = curve.hash.klen;
+    for (i=0;i<iters/10+1;i++)
+    {
+      randomKey(skA,&curve);
+      randomKey(skB,&curve);
+      randomKey(idA,&curve);
+      randomKey(idB,&curve);
+      publicKeyCompressed(pkA,skA,&curve);
+      publicKeyCompressed(pkB,skB,&curve);
+
+      n = calculateXYWire(hello,eskA,skA,idA,pkA,&curve);
+      check(naxosWireFrameBytes(hello,n,WIRE_HELLO,&curve) == n,"calculateXYWire",curve.bsize,i);
+      calculateXY(Yx,Yy,eskB,skB,&curve);
+      check(calculateKbWire(kB,hello,n,eskB,skB,idB,&curve) == 1,"calculateKbWire",curve.bsize,i);
+      m = naxosWireReply(reply,Yx,Yy,&curve);
+      check((calculateKaWire(kA,reply,m,eskA,skA,idA,pkB,idB,&curve) == 1) && (memcmp(kA,kB,len) == 0),
+            "calculateKaWire Ka = Kb",curve.bsize,i);
+
+      check(calculateKbWire(kB,hello,n-1,eskB,skB,idB,&curve) == -6,"calculateKbWire length",curve.bsize,i);
+      hello[0]++;                          /* version                                     */
+      check(calculateKbWire(kB,hello,n,eskB,skB,idB,&curve) == -6,"calculateKbWire version",curve.bsize,i);
+      hello[0]--;
+      memset(hello+WIRE_HEADER+2*WIRE_SLOT(&curve),0xFF,WIRE_SLOT(&curve));   /* x of X >= p      */
+      check(calculateKbWire(kB,hello,n,eskB,skB,idB,&curve) == -3,"calculateKbWire x >= p",curve.bsize,i);
+      check(calculateKaWire(kA,hello,n,eskA,skA,idA,pkB,idB,&curve) == -6,"calculateKaWire type",curve.bsize,i);
+    }
+  }
+  printf("wire:                 %d x %d curves\n",iters/10+1,NCURVES-1);
+}
+
+void testTicket(int iters)
+/* Tickets: k' of naxosResumeKey (A) = k' of naxosTicketStoreResume (B), a ticket is used once */
+{
+  ellipticCurve curve;
+  naxosTicketStore* s;
+  naxosTicket t;
+  keyC k,kA,kB,idA,idB,idS;
+  keyPC pkA,pkS;
+  uint8_t nonceA[TICKET_NONCE],nonceB[TICKET_NONCE],used[TICKET_ID];
+  int i,j,r,n,len;
+
+  selectCurve(&curve,NIST_P192);
+  check((naxosTicketDerive(&t,k,&curve) == -1) && (naxosTicketStoreCreate(&curve,4,60) == NULL),
+        "naxosTicket P-192",curve.bsize,0);
+  for (j=1;j<NCURVES;j++)
+  {
+    selectCurve(&curve,curves[j]);
+    len = curve.hash.klen;
+    s = naxosTicketStoreCreate(&curve,4,60);
+    check(s != NULL,"naxosTicketStoreCreate",curve.bsize,0);
+    if (s == NULL) continue;
+    for (i=0;i<iters;i++)
+    {
+      randomKey(k,&curve);
+      randomKey(idA,&curve);
+      randomKey(idB,&curve);
+      publicKeyCompressed(pkA,k,&curve);
+      check((naxosTicketStoreAdd(s,k,idA,pkA) == 1) && (naxosTicketDerive(&t,k,&curve) == 1),
+            "naxosTicketStoreAdd",curve.bsize,i);
+      for (r=0;r<3;r++)                    /* the next tickets                            */
+      {
+        for (n=0;n<TICKET_NONCE;n++)
+        {
+          nonceA[n] = (uint8_t)rng();
+        }
+        memcpy(used,t.id,TICKET_ID);
+        check((naxosTicketStoreResume(s,kB,idS,pkS,t.id,nonceA,nonceB,idB) == 1) &&
+              (naxosResumeKey(kA,&t,nonceA,nonceB,idA,idB,&curve) == 1) && (memcmp(kA,kB,len) == 0),
+              "naxosTicketStoreResume Ka = Kb",curve.bsize,i);
+        check((memcmp(idS,idA,sizeof(keyC)) == 0) && (memcmp(pkS,pkA,(curve.bsize+7)/8+1) == 0),
+              "naxosTicketStoreResume idA pkA",curve.bsize,i);
+        check(naxosTicketStoreResume(s,kB,idS,pkS,used,nonceA,nonceB,idB) == -1,
+              "naxosTicketStoreResume used",curve.bsize,i);
+        check(memcmp(kA,k,len) != 0,"naxosResumeKey",curve.bsize,i);
+      }
+    }
+    naxosTicketStoreDestroy(s);
+
+    s = naxosTicketStoreCreate(&curve,1,0);    /* expired at once                             */
+    check((s != NULL) && (naxosTicketStoreAdd(s,k,idA,pkA) == 1) &&
+          (naxosTicketStoreResume(s,kB,idS,pkS,t.id,nonceA,nonceB,idB) == -1),"naxosTicketStore expiry",curve.bsize,0);
+    naxosTicketStoreDestroy(s);
+  }
+  printf("ticket:               %d x 3 resumptions x %d curves\n",iters,NCURVES-1);
+}
+
+#define TEST_WORKERS 3        /* Workers of the engine                                      */
+#define TEST_WAIT 30          /* Seconds of wait for the jobs of the engine                 */
+
+int xyValid(sessionXY* xy,keyC pkAx,keyC pkAy,ellipticCurve* curve)
+/* It returns 1 if X = G*H(esk,sk) of xy, i.e. kA with its esk and sk = kB of a peer with its X */
+{
+  keyC skB,pkBx,pkBy,eskB,Yx,Yy,idA,idB,kA,kB;
+
+  randomKey(skB,curve);
+  randomKey(idA,curve);
+  randomKey(idB,curve);
+  publicKey(pkBx,pkBy,skB,curve);
+  calculateXY(Yx,Yy,eskB,skB,curve);
+  return (xy->res == 1) &&
+         (calculateKa(kA,Yx,Yy,xy->esk,xy->sk,pkBx,pkBy,idA,idB,curve) == 1) &&
+         (calculateKb(kB,pkAx,pkAy,eskB,skB,xy->Xx,xy->Xy,idA,idB,curve) == 1) &&
+         (memcmp(kA,kB,curve->hash.klen) == 0);
+}
+
+typedef struct testGate   /* Job of the engine that keeps its worker in the callback until open */
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int blocked;
+  int open;
+} testGate;
+
+void testGateCallback(naxosJob* job)
+/* Callback of the engine: it waits until the gate is open */
+{
+  testGate* g = (testGate*)job->arg;
+
+  pthread_mutex_lock(&g->lock);
+  g->blocked = 1;
+  pthread_cond_broadcast(&g->cond);
+  while (!g->open)
+  {
+    pthread_cond_wait(&g->cond,&g->lock);
+  }
+  pthread_mutex_unlock(&g->lock);
+}
+
+void testCountCallback(naxosJob* job)
+/* Callback of the engine: it counts the completed jobs */
+{
+  atomic_fetch_add((atomic_int*)job->arg,1);
+}
+
+int testPollJobs(naxosEngine* engine,int n)
+/* It takes n jobs from the completion queue with naxosEnginePoll, waiting at most TEST_WAIT
+   seconds. It returns the number of jobs taken
+*/
+{
+  time_t end = time(NULL)+TEST_WAIT;
+  int m = 0;
+
+  while ((m < n) && (time(NULL) < end))
+  {
+    if (naxosEnginePoll(engine) != NULL) m++;
+    else usleep(1000);
+  }
+  return m;
+}
+
+void testEngine(int iters)
+/* Engine: the single XY, Ka and Kb jobs and the batch jobs against calculateXY, calculateKa,
+   calculateKb and calculateKbWire, the work stealing,
+   the jobs rejected by naxosEngineSubmit, and the workers pinned in a restricted CPU set
+*/
+{
+  ellipticCurve curve;
+  naxosEngine* engine;
+  peerCache* cache;
+  testGate gate;
+  atomic_int done;
+  naxosJob jobs[NAXOS_JOB_BATCH_MAX+1],wires[NAXOS_JOB_BATCH_MAX],batch,bad,gateJob;
+  naxosJob* sub[NAXOS_JOB_BATCH_MAX+1];
+  naxosJob* wsub[NAXOS_JOB_BATCH_MAX];
+  sessionXY xy[NAXOS_JOB_BATCH_MAX];
+  sessionK ka[TEST_BATCH],kb[TEST_BATCH],sa[TEST_BATCH],sb[TEST_BATCH],kw[NAXOS_JOB_BATCH_MAX],g;
+  keyC refA[TEST_BATCH],refB[TEST_BATCH],refW[NAXOS_JOB_BATCH_MAX];
+  keyC skA,pkAx,pkAy,idA,eskA,Yx,Yy;
+  keyPC pkA;
+  uint8_t hello[NAXOS_JOB_BATCH_MAX][WIRE_MAX];
+  cpu_set_t all,one;
+  int i,j,b,f,len,ok;
+
+  for (j=1;j<NCURVES;j++)                  /* P-192 has no hash functions                 */
+  {
+    selectCurve(&curve,curves[j]);
+    len = curve.hash.klen;
+    cache = (j%2 == 0)?peerCacheCreate(&curve,4):NULL;   /* Ka and Kb with and without cache */
+    engine = naxosEngineCreate(&curve,TEST_WORKERS,0,cache);
+    check(engine != NULL,"naxosEngineCreate",curve.bsize,0);
+    if (engine == NULL)
+    {
+      peerCacheDestroy(cache);
+      continue;
+    }
+
+    memset(&bad,0,sizeof(bad));              /* invalid jobs                                */
+    bad.type = 0;
+    ok = (naxosEngineSubmit(engine,&bad) == -1);
+    bad.type = NAXOS_JOB_BATCH+1;
+    ok = ok && (naxosEngineSubmit(engine,&bad) == -1);
+    memset(jobs,0,sizeof(jobs));
+    for (b=0;b<NAXOS_JOB_BATCH_MAX+1;b++)
+    {
+      jobs[b].type = NAXOS_JOB_XY;
+      sub[b] = &jobs[b];
+    }
+    bad.type = NAXOS_JOB_BATCH;
+    bad.batch = sub;
+    bad.n = NAXOS_JOB_BATCH_MAX+1;
+    ok = ok && (naxosEngineSubmit(engine,&bad) == -1);
+    bad.n = 0;
+    ok = ok && (naxosEngineSubmit(engine,&bad) == -1);
+    jobs[1].type = NAXOS_JOB_KA;             /* mixed batch                                 */
+    bad.n = 2;
+    ok = ok && (naxosEngineSubmit(engine,&bad) == -1);
+    check(ok,"naxosEngineSubmit invalid",curve.bsize,0);
+
+    for (i=0;i<iters;i++)
+    {
+      randomKey(skA,&curve);
+      randomKey(idA,&curve);
+      publicKey(pkAx,pkAy,skA,&curve);
+      publicKeyCompressed(pkA,skA,&curve);
+      batchSessions(sa,sb,refA,refB,&curve);
+
+      /* the worker of the first job is blocked in its callback: its jobs are stolen */
+      pthread_mutex_init(&gate.lock,NULL);
+      pthread_cond_init(&gate.cond,NULL);
+      gate.blocked = 0;
+      gate.open = 0;
+      g = sb[0];
+      memset(&gateJob,0,sizeof(gateJob));
+      gateJob.type = NAXOS_JOB_KB;
+      gateJob.k = &g;
+      gateJob.callback = testGateCallback;
+      gateJob.arg = &gate;
+      check(naxosEngineSubmit(engine,&gateJob) == 1,"naxosEngineSubmit",curve.bsize,i);
+      pthread_mutex_lock(&gate.lock);
+      while (!gate.blocked)
+      {
+        pthread_cond_wait(&gate.cond,&gate.lock);
+      }
+      pthread_mutex_unlock(&gate.lock);
+
+      memset(jobs,0,sizeof(jobs));           /* Kb and XY jobs in the completion queue      */
+      for (b=0;b<TEST_BATCH;b++)
+      {
+        kb[b] = sb[b];
+        jobs[b].type = NAXOS_JOB_KB;
+        jobs[b].k = &kb[b];
+        check(naxosEngineSubmit(engine,&jobs[b]) == 1,"naxosEngineSubmit",curve.bsize,i);
+      }
+      for (b=TEST_BATCH;b<TEST_BATCH+TEST_WORKERS;b++)
+      {
+        memset(&xy[b],0,sizeof(sessionXY));
+        memcpy(xy[b].sk,skA,sizeof(keyC));
+        jobs[b].type = NAXOS_JOB_XY;
+        jobs[b].xy = &xy[b];
+        check(naxosEngineSubmit(engine,&jobs[b]) == 1,"naxosEngineSubmit",curve.bsize,i);
+      }
+      check(testPollJobs(engine,TEST_BATCH+TEST_WORKERS) == TEST_BATCH+TEST_WORKERS,
+            "naxosEngine work stealing",curve.bsize,i);
+      pthread_mutex_lock(&gate.lock);
+      gate.open = 1;
+      pthread_cond_broadcast(&gate.cond);
+      pthread_mutex_unlock(&gate.lock);
+      check((g.res == 1) && (memcmp(g.k,refB[0],len) == 0),"naxosEngine callback Kb",curve.bsize,i);
+      for (b=0;b<TEST_BATCH-1;b++)
+      {
+        check((kb[b].res == 1) && (memcmp(kb[b].k,refB[b],len) == 0),"naxosEngine Kb",curve.bsize,i);
+      }
+      check(kb[TEST_BATCH-1].res != 1,"naxosEngine Kb invalid",curve.bsize,i);
+      for (b=TEST_BATCH;b<TEST_BATCH+TEST_WORKERS;b++)
+      {
+        check(xyValid(&xy[b],pkAx,pkAy,&curve),"naxosEngine XY",curve.bsize,i);
+      }
+
+      atomic_init(&done,0);                  /* Ka jobs with a callback                     */
+      for (b=0;b<TEST_BATCH;b++)
+      {
+        ka[b] = sa[b];
+        jobs[b].type = NAXOS_JOB_KA;
+        jobs[b].k = &ka[b];
+        jobs[b].callback = testCountCallback;
+        jobs[b].arg = &done;
+        check(naxosEngineSubmit(engine,&jobs[b]) == 1,"naxosEngineSubmit",curve.bsize,i);
+      }
+      for (f=0;(f<TEST_WAIT*1000)&&(atomic_load(&done) < TEST_BATCH);f++)
+      {
+        usleep(1000);
+      }
+      check(atomic_load(&done) == TEST_BATCH,"naxosEngine callback",curve.bsize,i);
+      for (b=0;b<TEST_BATCH-1;b++)
+      {
+        check((ka[b].res == 1) && (memcmp(ka[b].k,refA[b],len) == 0),"naxosEngine Ka",curve.bsize,i);
+      }
+      check(ka[TEST_BATCH-1].res != 1,"naxosEngine Ka invalid",curve.bsize,i);
+
+      memset(jobs,0,sizeof(jobs));           /* the batch jobs                              */
+      memset(wires,0,sizeof(wires));
+      for (b=0;b<NAXOS_JOB_BATCH_MAX;b++)
+      {
+        memset(&xy[b],0,sizeof(sessionXY));
+        memcpy(xy[b].sk,skA,sizeof(keyC));
+        jobs[b].type = NAXOS_JOB_XY;
+        jobs[b].xy = &xy[b];
+        sub[b] = &jobs[b];
+
+        memset(&kw[b],0,sizeof(sessionK));   /* hellos of A to B                            */
+        randomKey(kw[b].sk,&curve);
+        randomKey(kw[b].idB,&curve);
+        calculateXY(Yx,Yy,kw[b].esk,kw[b].sk,&curve);
+        wires[b].type = NAXOS_JOB_KB_WIRE;
+        wires[b].k = &kw[b];
+        wires[b].wire = hello[b];
+        wires[b].wireLen = calculateXYWire(hello[b],eskA,skA,idA,pkA,&curve);
+        calculateKbWire(refW[b],hello[b],wires[b].wireLen,kw[b].esk,kw[b].sk,kw[b].idB,&curve);
+        wsub[b] = &wires[b];
+      }
+      wires[1].wireLen--;                  /* one invalid hello                           */
+
+      memset(&batch,0,sizeof(batch));
+      batch.type = NAXOS_JOB_BATCH;
+      batch.batch = sub;
+      batch.n = NAXOS_JOB_BATCH_MAX;
+      ok = (naxosEngineSubmit(engine,&batch) == 1) && (naxosEngineWait(engine) == &batch);
+      batch.batch = wsub;
+      ok = ok && (naxosEngineSubmit(engine,&batch) == 1) && (naxosEngineWait(engine) == &batch);
+      check(ok,"naxosEngine batch",curve.bsize,i);
+
+      for (b=0;b<NAXOS_JOB_BATCH_MAX;b++)
+      {
+        check(xyValid(&xy[b],pkAx,pkAy,&curve),"naxosEngine XY",curve.bsize,i);
+        if (b == 1)
+        {
+          check(kw[b].res == -6,"naxosEngine Kb wire invalid",curve.bsize,i);
+          continue;
+        }
+        check((kw[b].res == 1) && (memcmp(kw[b].k,refW[b],len) == 0),"naxosEngine Kb wire",curve.bsize,i);
+      }
+      pthread_mutex_destroy(&gate.lock);
+      pthread_cond_destroy(&gate.cond);
+    }
+    naxosEngineDestroy(engine);
+    peerCacheDestroy(cache);
+  }
+
+  if (sched_getaffinity(0,sizeof(cpu_set_t),&all) == 0)   /* pinned in a single allowed CPU */
+  {
+    for (b=0;!CPU_ISSET(b,&all);b++);
+    CPU_ZERO(&one);
+    CPU_SET(b,&one);
+    sched_setaffinity(0,sizeof(cpu_set_t),&one);
+    engine = naxosEngineCreate(&curve,TEST_WORKERS,1,NULL);
+    sched_setaffinity(0,sizeof(cpu_set_t),&all);
+    ok = (engine != NULL);
+    if (ok)
+    {
+      memset(&xy[0],0,sizeof(sessionXY));
+      memcpy(xy[0].sk,skA,sizeof(keyC));
+      memset(&jobs[0],0,sizeof(naxosJob));
+      jobs[0].type = NAXOS_JOB_XY;
+      jobs[0].xy = &xy[0];
+      ok = (naxosEngineSubmit(engine,&jobs[0]) == 1) && (naxosEngineWait(engine) == &jobs[0]) &&
+           xyValid(&xy[0],pkAx,pkAy,&curve);
+    }
+    check(ok,"naxosEngineCreate pinned",curve.bsize,0);
+    naxosEngineDestroy(engine);
+  }
+  printf("engine:               %d x %d workers x %d curves\n",iters,TEST_WORKERS,NCURVES-1);
+}
+
+#define TEST_DEPTH 8          /* Tuples of a ring of the pool                               */
+
+static pthread_t testMain;
+
+int mainSource(uint8_t* buf,int len)
+/* Entropy source of the user: bytes of rng for the main thread, it fails for the producers */
+{
+  if (!pthread_equal(pthread_self(),testMain)) return -1;
+  return userSource(buf,len);
+}
+
+int testPoolFill(naxosPool* pool,int consumer,int n)
+/* It waits until n tuples are ready for the consumer, at most TEST_WAIT seconds.
+   It returns 1 if they are ready
+*/
+{
+  time_t end = time(NULL)+TEST_WAIT;
+
+  while ((naxosPoolAvailable(pool,consumer) < n) && (time(NULL) < end))
+  {
+    usleep(1000);
+  }
+  return naxosPoolAvailable(pool,consumer) >= n;
+}
+
+void testPool(int iters)
+/* Pool: the tuples taken from the ring against calculateXY (Ka = Kb with their esk and X),
+   the inline calculation with another sk, with an empty ring and with a failing source, and
+   the refill of the ring by the producer. The entropy source is changed only without
+   producers running
+*/
+{
+  ellipticCurve curve;
+  naxosPool* pool;
+  sessionXY xy;
+  keyC skA,pkAx,pkAy,skC,pkCx,pkCy;
+  int i,j,b;
+
+  testMain = pthread_self();
+  selectCurve(&curve,NIST_P192);
+  randomKey(skA,&curve);
+  check(calculateXYPool(xy.Xx,xy.Xy,xy.esk,skA,&curve,NULL,0) == -5,"calculateXYPool P-192",curve.bsize,0);
+  for (j=1;j<NCURVES;j++)                  /* P-192 has no hash functions                 */
+  {
+    selectCurve(&curve,curves[j]);
+    for (i=0;i<iters;i++)
+    {
+      randomKey(skA,&curve);
+      do
+      {
+        randomKey(skC,&curve);
+      } while (memcmp(skC,skA,sizeof(keyC)) == 0);   /* the edge cases of randomKey         */
+      publicKey(pkAx,pkAy,skA,&curve);
+      publicKey(pkCx,pkCy,skC,&curve);
+      pool = naxosPoolCreate(&curve,skA,2,TEST_DEPTH,1);
+      check(pool != NULL,"naxosPoolCreate",curve.bsize,i);
+      if (pool == NULL) continue;
+      check(testPoolFill(pool,0,TEST_DEPTH) && testPoolFill(pool,1,TEST_DEPTH),"naxosPool fill",curve.bsize,i);
+      memcpy(xy.sk,skA,sizeof(keyC));
+      for (b=0;b<TEST_DEPTH/2+1;b++)       /* half empty: the producer wakes up           */
+      {
+        xy.res = (calculateXYPool(xy.Xx,xy.Xy,xy.esk,xy.sk,&curve,pool,0) == 1)?1:0;
+        check(xyValid(&xy,pkAx,pkAy,&curve),"calculateXYPool",curve.bsize,i);
+      }
+      memcpy(xy.sk,skC,sizeof(keyC));        /* not the sk of the pool: inline             */
+      xy.res = (calculateXYPool(xy.Xx,xy.Xy,xy.esk,xy.sk,&curve,pool,1) == 0)?1:0;
+      check(xyValid(&xy,pkCx,pkCy,&curve) && (naxosPoolAvailable(pool,1) == TEST_DEPTH),
+            "calculateXYPool other sk",curve.bsize,i);
+      check(testPoolFill(pool,0,TEST_DEPTH/2+1),"naxosPoolAvailable refill",curve.bsize,i);   /* past half */
+      memcpy(xy.sk,skA,sizeof(keyC));
+      xy.res = (calculateXYPool(xy.Xx,xy.Xy,xy.esk,xy.sk,&curve,pool,0) == 1)?1:0;
+      check(xyValid(&xy,pkAx,pkAy,&curve),"calculateXYPool refill",curve.bsize,i);
+      naxosPoolDestroy(pool);
+
+      selectEntropy(ENTROPY_USER,mainSource);   /* selected without producers: this one    */
+      pool = naxosPoolCreate(&curve,skA,1,TEST_DEPTH,1);   /* never fills its ring          */
+      xy.res = (calculateXYPool(xy.Xx,xy.Xy,xy.esk,xy.sk,&curve,pool,0) == 0)?1:0;
+      check((pool != NULL) && xyValid(&xy,pkAx,pkAy,&curve) && (naxosPoolAvailable(pool,0) == 0),
+            "calculateXYPool empty",curve.bsize,i);
+      naxosPoolDestroy(pool);
+
+      selectEntropy(ENTROPY_USER,failingSource);
+      pool = naxosPoolCreate(&curve,skA,1,TEST_DEPTH,1);
+      check((pool != NULL) && (calculateXYPool(xy.Xx,xy.Xy,xy.esk,skA,&curve,pool,0) == -1),
+            "calculateXYPool source",curve.bsize,i);
+      naxosPoolDestroy(pool);
+      selectEntropy(ENTROPY_DRBG,NULL);
+    }
+  }
+  printf("pool:                 %d x %d tuples x %d curves\n",iters,TEST_DEPTH,NCURVES-1);
+}
+
+#define TEST_CLIENTS 4        /* Client threads of the server                               */
+
+typedef struct testClient
+{
+  const char* path;
+  ellipticCurve* curve;
+  int iters;
+  keyC skA,idA,idB,kA;
+  keyPC pkA,pkB;
+  int ok;
+} testClient;
+
+typedef struct testKeys   /* Keys delivered by the server, indexed by idA[0] */
+{
+  keyC kB[TEST_CLIENTS];
+  keyPC pkA[TEST_CLIENTS];
+  int count;
+} testKeys;
+
+void testOnKey(keyC kB,keyC idA,keyPC pkA,void* arg)
+/* Callback of the server: kB and pkA of the client idA[0] */
+{
+  testKeys* keys = (testKeys*)arg;
+
+  memcpy(keys->kB[idA[0]%TEST_CLIENTS],kB,sizeof(keyC));
+  memcpy(keys->pkA[idA[0]%TEST_CLIENTS],pkA,sizeof(keyPC));
+  keys->count++;
+}
+
+void* testServerMain(void* arg)
+{
+  naxosServerRun((naxosServer*)arg);
+  return NULL;
+}
+
+void* testClientMain(void* arg)
+/* iters handshakes and iters resumptions of a client on one connection, then the first ticket
+   again: rejected, and a last handshake
+*/
+{
+  testClient* c = (testClient*)arg;
+  naxosTicket t,first;
+  int i,fd;
+
+  fd = naxosClientConnectUnix(c->path);
+  c->ok = (fd >= 0);
+  for (i=0;(i<c->iters)&&c->ok;i++)
+  {
+    c->ok = (naxosClientHandshake(fd,c->kA,c->skA,c->pkA,c->idA,c->pkB,c->idB,c->curve) == 1);
+  }
+  c->ok = c->ok && (naxosTicketDerive(&t,c->kA,c->curve) == 1);
+  first = t;
+  for (i=0;(i<c->iters)&&c->ok;i++)
+  {
+    c->ok = (naxosClientResume(fd,c->kA,&t,c->idA,c->idB,c->curve) == 1);
+  }
+  c->ok = c->ok && (naxosClientResume(fd,c->kA,&first,c->idA,c->idB,c->curve) == -7) && (first.valid == 0);
+  c->ok = c->ok && (naxosClientHandshake(fd,c->kA,c->skA,c->pkA,c->idA,c->pkB,c->idB,c->curve) == 1);
+  if (fd >= 0) close(fd);
+  return NULL;
+}
+
+void testServer(int iters)
+/* Server: client threads against the server, kA of each client = kB delivered by the server,
+   after the handshakes and after the resumptions
+*/
+{
+  ellipticCurve curve;
+  naxosServer* server;
+  testClient clients[TEST_CLIENTS];
+  testKeys keys;
+  pthread_t serverThread,threads[TEST_CLIENTS];
+  keyC skB,idB;
+  keyPC pkB;
+  char path[64];
+  int i,j,fd,len;
+
+  snprintf(path,sizeof(path),"/tmp/Test_Naxos.%d.sock",(int)getpid());
+  for (j=0;j<2;j++)                        /* P-256 with the pool, P-384 with XY jobs     */
+  {
+    selectCurve(&curve,(j == 0)?NIST_P256:NIST_P384);
+    len = curve.hash.klen;
+    randomKey(skB,&curve);
+    randomKey(idB,&curve);
+    publicKeyCompressed(pkB,skB,&curve);
+    memset(&keys,0,sizeof(keys));
+    server = naxosServerCreate(&curve,skB,idB,2,TEST_CLIENTS+1,(j == 0)?8:0,testOnKey,&keys);
+    check((server != NULL) && (naxosServerListenUnix(server,path) == 1) &&
+          (naxosServerTickets(server,TEST_CLIENTS,60) == 1),"naxosServerCreate",curve.bsize,0);
+    if (server == NULL) continue;
+    pthread_create(&serverThread,NULL,testServerMain,server);
+
+    for (i=0;i<TEST_CLIENTS;i++)
+    {
+      clients[i].path = path;
+      clients[i].curve = &curve;
+      clients[i].iters = iters;
+      randomKey(clients[i].skA,&curve);
+      randomKey(clients[i].idA,&curve);
+      clients[i].idA[0] = (uint8_t)i;
+      memcpy(clients[i].idB,idB,sizeof(keyC));
+      memcpy(clients[i].pkB,pkB,sizeof(keyPC));
+      publicKeyCompressed(clients[i].pkA,clients[i].skA,&curve);
+      pthread_create(&threads[i],NULL,testClientMain,&clients[i]);
+    }
+    for (i=0;i<TEST_CLIENTS;i++)
+    {
+      pthread_join(threads[i],NULL);
+    }
+
+    memset(clients[0].pkA+1,0xFF,(curve.bsize+7)/8);   /* x of pkA not lower than p: rejected */
+    fd = naxosClientConnectUnix(path);
+    check((fd >= 0) && (naxosClientHandshake(fd,clients[0].kA,clients[0].skA,clients[0].pkA,clients[0].idA,
+          pkB,idB,&curve) == -6),"naxosServer rejected hello",curve.bsize,0);
+    if (fd >= 0) close(fd);
+
+    naxosServerStop(server);
+    pthread_join(serverThread,NULL);
+    naxosServerDestroy(server);
+    for (i=0;i<TEST_CLIENTS;i++)
+    {
+      check(clients[i].ok,"naxosClientHandshake",curve.bsize,i);
+      check(memcmp(clients[i].kA,keys.kB[i],len) == 0,"naxosServer Ka = Kb",curve.bsize,i);
+      if (i > 0) check(memcmp(clients[i].pkA,keys.pkA[i],(curve.bsize+7)/8+1) == 0,"naxosServer pkA",curve.bsize,i);
+    }
+    check(keys.count == TEST_CLIENTS*(2*iters+1),"naxosServer handshakes",curve.bsize,0);
+  }
+  printf("server:               %d x %d clients x 2 curves\n",iters,TEST_CLIENTS);
+}
+
+int main(int argc,char** argv)
+{
+  int iters = 200;
+
+  rngState = 0x9E3779B97F4A7C15ULL;
+  if (argc > 1) iters = atoi(argv[1]);
+  if (argc > 2) rngState = strtoull(argv[2],NULL,0) | 1;
+
+  testKat();
+  testField(iters*10);
+  testPoint(iters/10+1);
+  testHash(iters);
+  testKey(iters/20+1);
+  testCurve(iters/20+1);
+  testRandom(iters);
+  testArena(iters);
+  testSessions(iters/50+1);
+  testWire(iters);
+  testTicket(iters/10+1);
+  testEngine(iters/50+1);
+  testPool(iters/50+1);
+  testServer(iters/20+1);
+
+  if (failures != 0)
+  {
+    printf("%d FAILURES\n",failures);
+    return 1;
+  }
+  printf("ALL TESTS PASSED\n");
+  return 0;
+}